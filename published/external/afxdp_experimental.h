@@ -11,6 +11,10 @@
 #ifndef AFXDP_EXPERIMENTAL_H
 #define AFXDP_EXPERIMENTAL_H
 
+#include <afxdp.h>
+#include <xdp/objectheader.h>
+#include <xdp/program.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -98,6 +102,477 @@ typedef struct _XSK_OFFLOAD_UDP_CHECKSUM_TX_CAPABILITIES {
     BOOLEAN Supported;
 } XSK_OFFLOAD_UDP_CHECKSUM_TX_CAPABILITIES;
 
+//
+// XSK_SOCKOPT_STATISTICS_EX
+//
+// Supports: get
+// Optval type: XSK_STATISTICS_EX
+// Description: Gets extended statistics from a socket. The socket returns the
+//              highest revision that fits within the option length, and sets
+//              the header revision and size accordingly. Counters are updated
+//              without interlocked operations and may be approximate.
+//
+#define XSK_SOCKOPT_STATISTICS_EX 1005
+
+typedef struct _XSK_STATISTICS_EX {
+    XDP_OBJECT_HEADER Header;
+
+    //
+    // The counters returned by XSK_SOCKOPT_STATISTICS.
+    //
+    UINT64 RxDropped;
+    UINT64 RxTruncated;
+    UINT64 RxInvalidDescriptors;
+    UINT64 TxInvalidDescriptors;
+
+    //
+    // RX batches that found fewer fill ring descriptors than frames.
+    //
+    UINT64 RxFillRingEmpty;
+
+    //
+    // RX frames dropped because the RX ring was full.
+    //
+    UINT64 RxRingFullDrops;
+
+    //
+    // TX fill passes limited by available TX completion ring space.
+    //
+    UINT64 TxCompletionRingFull;
+
+    //
+    // Waits on RX or TX satisfied by the data path.
+    //
+    UINT64 RxWakeups;
+    UINT64 TxWakeups;
+
+    //
+    // Notify calls with XSK_NOTIFY_FLAG_POKE_RX or XSK_NOTIFY_FLAG_POKE_TX.
+    //
+    UINT64 RxPokes;
+    UINT64 TxPokes;
+
+    //
+    // Successful changes of the XSK_SOCKOPT_POLL_MODE setting.
+    //
+    UINT64 PollModeChanges;
+
+    //
+    // RX frames rejected by the XSK_SOCKOPT_RX_FILTER filter. Added in
+    // XSK_STATISTICS_EX_REVISION_2.
+    //
+    UINT64 RxFiltered;
+} XSK_STATISTICS_EX;
+
+#define XSK_STATISTICS_EX_REVISION_1 1
+#define XSK_STATISTICS_EX_REVISION_2 2
+
+#define XSK_SIZEOF_STATISTICS_EX_REVISION_1 \
+    RTL_SIZEOF_THROUGH_FIELD(XSK_STATISTICS_EX, PollModeChanges)
+#define XSK_SIZEOF_STATISTICS_EX_REVISION_2 \
+    RTL_SIZEOF_THROUGH_FIELD(XSK_STATISTICS_EX, RxFiltered)
+
+//
+// XSK_SOCKOPT_CAPTURE
+//
+// Supports: set
+// Optval type: XSK_CAPTURE_CONFIG
+// Description: Turns the socket into a capture tap. Once activated, the socket
+//              receives a copy of the first SnapLength bytes of one in every
+//              SampleInterval frames inspected by the XDP program on its RX
+//              queue, regardless of the program's verdict. Each RX descriptor
+//              points to an XSK_CAPTURE_HEADER followed by the captured bytes.
+//              The tap is attached when the socket is activated and detached
+//              when the socket is closed. This option must be set before the
+//              socket is bound, and the socket must be bound with
+//              XSK_BIND_FLAG_RX only. Use XSK_SOCKOPT_RX_HOOK_ID to tap the
+//              transmit inspection hook. Capture sockets cannot be the target
+//              of XDP redirect rules.
+//
+#define XSK_SOCKOPT_CAPTURE 1006
+
+typedef struct _XSK_CAPTURE_CONFIG {
+    XDP_OBJECT_HEADER Header;
+
+    //
+    // Capture one in every SampleInterval frames. Must be non-zero.
+    //
+    UINT32 SampleInterval;
+
+    //
+    // The maximum number of frame bytes to capture. Must be non-zero. Frames
+    // are further truncated to fit within a UMEM chunk.
+    //
+    UINT32 SnapLength;
+} XSK_CAPTURE_CONFIG;
+
+#define XSK_CAPTURE_CONFIG_REVISION_1 1
+
+#define XSK_SIZEOF_CAPTURE_CONFIG_REVISION_1 \
+    RTL_SIZEOF_THROUGH_FIELD(XSK_CAPTURE_CONFIG, SnapLength)
+
+//
+// The index of the rule that determined the verdict is unknown, either because
+// no rule matched or because the program is not a rule-based program.
+//
+#define XSK_CAPTURE_RULE_INDEX_NONE 0xFFFFFFFF
+
+#pragma pack(push)
+#pragma pack(1)
+typedef struct _XSK_CAPTURE_HEADER {
+    //
+    // The performance counter value at the time of capture. Use
+    // QueryPerformanceFrequency to convert to wall clock time.
+    //
+    UINT64 Timestamp;
+
+    //
+    // The original length of the frame, including all fragments.
+    //
+    UINT32 FrameLength;
+
+    //
+    // The number of frame bytes following this header.
+    //
+    UINT32 CaptureLength;
+
+    //
+    // The index of the rule that determined the verdict, or
+    // XSK_CAPTURE_RULE_INDEX_NONE.
+    //
+    UINT32 RuleIndex;
+
+    //
+    // The XDP_RX_ACTION verdict. Redirected frames are reported as dropped.
+    //
+    UINT8 Action;
+
+    UINT8 Reserved[3];
+} XSK_CAPTURE_HEADER;
+#pragma pack(pop)
+
+//
+// XSK_SOCKOPT_TX_DOORBELL
+//
+// Supports: set
+// Optval type: XSK_TX_DOORBELL_CONFIG
+// Description: Enables a kernel poller that watches the TX ring and pokes the
+//              interface on behalf of the application. While the poller is
+//              awake, XSK_RING_FLAG_NEED_POKE stays clear on the TX ring and
+//              producing TX descriptors requires no system calls. The poller
+//              goes to sleep after the TX ring producer index has not changed
+//              for IdleTimeoutMs and sets XSK_RING_FLAG_NEED_POKE; the next
+//              XSK_NOTIFY_FLAG_POKE_TX wakes the poller. This option must be
+//              set before the socket is bound; setting it again updates the
+//              idle timeout.
+//
+//              Pollers are shared by all sockets whose TX rings have the same
+//              ideal processor and run on that processor. An awake poller
+//              busy polls its sockets, consuming the processor until every
+//              socket has been idle for its timeout, so each wake costs up to
+//              IdleTimeoutMs of CPU time on the TX ring's ideal processor.
+//
+#define XSK_SOCKOPT_TX_DOORBELL 1007
+
+typedef struct _XSK_TX_DOORBELL_CONFIG {
+    XDP_OBJECT_HEADER Header;
+
+    //
+    // The time the poller stays awake without new TX descriptors. Must be
+    // non-zero and no greater than XSK_TX_DOORBELL_MAX_IDLE_TIMEOUT_MS.
+    //
+    UINT32 IdleTimeoutMs;
+} XSK_TX_DOORBELL_CONFIG;
+
+#define XSK_TX_DOORBELL_MAX_IDLE_TIMEOUT_MS 100
+
+#define XSK_TX_DOORBELL_CONFIG_REVISION_1 1
+
+#define XSK_SIZEOF_TX_DOORBELL_CONFIG_REVISION_1 \
+    RTL_SIZEOF_THROUGH_FIELD(XSK_TX_DOORBELL_CONFIG, IdleTimeoutMs)
+
+//
+// XSK_SOCKOPT_POLL_SOCKET_CONFIG
+//
+// Supports: set
+// Optval type: XSK_POLL_SOCKET_CONFIG
+// Description: Configures how a socket polls its interfaces in the
+//              XSK_POLL_MODE_SOCKET polling mode. The configuration can be
+//              changed at any time and takes effect on the next notify call.
+//
+#define XSK_SOCKOPT_POLL_SOCKET_CONFIG 1008
+
+typedef struct _XSK_POLL_SOCKET_CONFIG {
+    XDP_OBJECT_HEADER Header;
+
+    //
+    // The maximum number of RX and TX frames processed by each poll iteration.
+    // Zero selects the system default.
+    //
+    UINT32 RxQuota;
+    UINT32 TxQuota;
+
+    //
+    // The number of descriptors a waited ring must contain before a notify
+    // call returns while the interface continues to make progress. Once the
+    // interface has no further work, the call returns as soon as any waited
+    // ring is non-empty. Zero and one return as soon as any waited ring is
+    // non-empty, which minimizes latency; larger values improve throughput.
+    //
+    UINT32 MinReadyBatch;
+} XSK_POLL_SOCKET_CONFIG;
+
+#define XSK_POLL_SOCKET_CONFIG_REVISION_1 1
+
+#define XSK_SIZEOF_POLL_SOCKET_CONFIG_REVISION_1 \
+    RTL_SIZEOF_THROUGH_FIELD(XSK_POLL_SOCKET_CONFIG, MinReadyBatch)
+
+//
+// XSK_SOCKOPT_EBPF_REDIRECT
+//
+// Supports: set
+// Optval type: XSK_EBPF_REDIRECT_CONFIG
+// Description: Registers the socket as the XSK map entry of its RX queue. An
+//              eBPF program attached to the queue redirects a frame to the
+//              socket by returning the verdict of the bpf_xdp_redirect_xsk
+//              helper declared in xdp_ebpf_helpers.h.
+//              Like bpf_redirect_map, the helper returns XDP_REDIRECT (4) if a
+//              socket is registered and otherwise returns the verdict in the
+//              lower two bits of its flags argument, or XDP_DROP if those bits
+//              are zero. Redirected frames are delivered in batches like XDP
+//              redirect rules. The entry is attached when the socket is bound
+//              and detached when the socket is closed; at most one socket may
+//              be registered on each RX queue. This option must be set before
+//              the socket is bound, the socket must be bound with
+//              XSK_BIND_FLAG_RX, and capture sockets cannot be registered.
+//
+#define XSK_SOCKOPT_EBPF_REDIRECT 1009
+
+typedef struct _XSK_EBPF_REDIRECT_CONFIG {
+    XDP_OBJECT_HEADER Header;
+
+    //
+    // Reserved. Must be zero.
+    //
+    UINT32 Flags;
+} XSK_EBPF_REDIRECT_CONFIG;
+
+#define XSK_EBPF_REDIRECT_CONFIG_REVISION_1 1
+
+#define XSK_SIZEOF_EBPF_REDIRECT_CONFIG_REVISION_1 \
+    RTL_SIZEOF_THROUGH_FIELD(XSK_EBPF_REDIRECT_CONFIG, Flags)
+
+//
+// XSK_SOCKOPT_RX_METADATA
+//
+// Supports: set
+// Optval type: XSK_RX_METADATA_CONFIG
+// Description: Enables per-frame RX metadata. For each frame the socket
+//              receives, an XSK_RX_METADATA structure is written to the UMEM
+//              headroom immediately preceding the frame data, i.e. at
+//              BaseAddress + Offset - sizeof(XSK_RX_METADATA). The metadata
+//              identifies the XDP rule that redirected or mirrored the frame,
+//              or carries the metadata an eBPF program attached to the frame
+//              with bpf_xdp_adjust_meta before redirecting it to the socket.
+//              The UMEM headroom must be at least sizeof(XSK_RX_METADATA)
+//              bytes when the socket is activated. This option must be set
+//              before the socket is bound, and capture sockets cannot receive
+//              metadata.
+//
+#define XSK_SOCKOPT_RX_METADATA 1010
+
+typedef struct _XSK_RX_METADATA_CONFIG {
+    XDP_OBJECT_HEADER Header;
+
+    //
+    // Reserved. Must be zero.
+    //
+    UINT32 Flags;
+} XSK_RX_METADATA_CONFIG;
+
+#define XSK_RX_METADATA_CONFIG_REVISION_1 1
+
+#define XSK_SIZEOF_RX_METADATA_CONFIG_REVISION_1 \
+    RTL_SIZEOF_THROUGH_FIELD(XSK_RX_METADATA_CONFIG, Flags)
+
+typedef enum _XSK_RX_METADATA_FLAGS {
+    XSK_RX_METADATA_FLAG_NONE = 0x0,
+
+    //
+    // RuleIndex and Tag identify the XDP rule that delivered the frame.
+    //
+    XSK_RX_METADATA_FLAG_RULE = 0x1,
+
+    //
+    // The frame was redirected by an eBPF program, and the first EbpfMetaLength
+    // bytes of EbpfMeta hold the program's metadata.
+    //
+    XSK_RX_METADATA_FLAG_EBPF = 0x2,
+} XSK_RX_METADATA_FLAGS;
+
+#define XSK_RX_METADATA_EBPF_MAX_LENGTH 32
+
+typedef struct _XSK_RX_METADATA {
+    //
+    // A combination of XSK_RX_METADATA_FLAGS.
+    //
+    UINT32 Flags;
+
+    //
+    // The index of the matching rule within its XDP program.
+    //
+    UINT32 RuleIndex;
+
+    //
+    // The XDP_TAGGED_REDIRECT_PARAMS tag of the matching rule. Zero for
+    // untagged redirect rules and mirror rules.
+    //
+    UINT32 Tag;
+
+    UINT32 EbpfMetaLength;
+    UINT8 EbpfMeta[XSK_RX_METADATA_EBPF_MAX_LENGTH];
+} XSK_RX_METADATA;
+
+//
+// XSK_SOCKOPT_RX_FILTER
+//
+// Supports: set
+// Optval type: XSK_RX_FILTER_CONFIG
+// Description: Sets a filter evaluated on each frame delivered to the socket
+//              before the frame is copied into the UMEM, allowing many sockets
+//              to share a small XDP program while each receives only a subset
+//              of its frames. The filter consists of XDP_RULE match conditions
+//              evaluated in order; the first matching rule's action decides
+//              the frame's fate, and frames matching no rule are delivered.
+//              Only the XDP_PROGRAM_ACTION_PASS (deliver) and
+//              XDP_PROGRAM_ACTION_DROP actions are supported. Filtered frames
+//              are counted in the RxFiltered field of XSK_STATISTICS_EX and
+//              consume neither RX nor fill ring entries. This option must be
+//              set before the socket is bound, and capture sockets cannot be
+//              filtered.
+//
+#define XSK_SOCKOPT_RX_FILTER 1011
+
+typedef struct _XSK_RX_FILTER_CONFIG {
+    XDP_OBJECT_HEADER Header;
+
+    //
+    // The number of rules in the filter. Must be non-zero.
+    //
+    UINT32 RuleCount;
+
+    //
+    // The filter rules. The rules are captured by the socket option.
+    //
+    CONST XDP_RULE *Rules;
+} XSK_RX_FILTER_CONFIG;
+
+#define XSK_RX_FILTER_CONFIG_REVISION_1 1
+
+#define XSK_SIZEOF_RX_FILTER_CONFIG_REVISION_1 \
+    RTL_SIZEOF_THROUGH_FIELD(XSK_RX_FILTER_CONFIG, Rules)
+
+//
+// Pokes and/or waits on a socket like XskNotifySocket, with a wait timeout in
+// microseconds. Finite waits are timed by a high-resolution timer, so
+// sub-millisecond timeouts are honored regardless of the system timer
+// resolution. The wait timeout interval can be set to INFINITE to specify that
+// the wait will not time out.
+//
+typedef
+HRESULT
+XSK_NOTIFY_SOCKET_PRECISE_FN(
+    _In_ HANDLE Socket,
+    _In_ XSK_NOTIFY_FLAGS Flags,
+    _In_ UINT32 WaitTimeoutMicroseconds,
+    _Out_ XSK_NOTIFY_RESULT_FLAGS *Result
+    );
+
+#define XSK_NOTIFY_SOCKET_PRECISE_FN_NAME "XskNotifySocketPreciseExperimental"
+
+//
+// XSK notify sets.
+//
+// A notify set waits for XSK_NOTIFY_FLAG_WAIT_RX and XSK_NOTIFY_FLAG_WAIT_TX
+// readiness on many sockets with a single call. Readiness is level-triggered:
+// each wait reports a member for as long as its RX ring or TX completion ring
+// is not empty. A socket can belong to at most one notify set. While it is a
+// member, XskNotifySocket and XskNotifyAsync fail wait requests on that
+// socket; pokes are unaffected. Sockets are removed from their notify set when
+// closed. Notify sets are closed with CloseHandle.
+//
+
+typedef struct _XSK_NOTIFY_SET_EVENT {
+    //
+    // The context supplied when the socket was added to the notify set.
+    //
+    VOID *Context;
+
+    //
+    // The ready IO. XSK_NOTIFY_RESULT_FLAG_NONE indicates the socket is no
+    // longer active, e.g. because its interface was detached; the application
+    // should check the ring errors and remove the socket.
+    //
+    XSK_NOTIFY_RESULT_FLAGS Result;
+} XSK_NOTIFY_SET_EVENT;
+
+//
+// Creates an empty notify set.
+//
+typedef
+HRESULT
+XSK_NOTIFY_SET_CREATE_FN(
+    _Out_ HANDLE *NotifySet
+    );
+
+#define XSK_NOTIFY_SET_CREATE_FN_NAME "XskNotifySetCreateExperimental"
+
+//
+// Adds an active socket to a notify set. Flags must contain one or both of
+// XSK_NOTIFY_FLAG_WAIT_RX and XSK_NOTIFY_FLAG_WAIT_TX, and no other flags.
+//
+typedef
+HRESULT
+XSK_NOTIFY_SET_ADD_FN(
+    _In_ HANDLE NotifySet,
+    _In_ HANDLE Socket,
+    _In_ XSK_NOTIFY_FLAGS Flags,
+    _In_opt_ VOID *Context
+    );
+
+#define XSK_NOTIFY_SET_ADD_FN_NAME "XskNotifySetAddExperimental"
+
+//
+// Removes a socket from a notify set.
+//
+typedef
+HRESULT
+XSK_NOTIFY_SET_REMOVE_FN(
+    _In_ HANDLE NotifySet,
+    _In_ HANDLE Socket
+    );
+
+#define XSK_NOTIFY_SET_REMOVE_FN_NAME "XskNotifySetRemoveExperimental"
+
+//
+// Waits until at least one member of the notify set is ready or the timeout
+// expires, and returns up to EventCount ready members. On timeout, the function
+// succeeds and ReadyCount is zero. The wait timeout interval can be set to
+// INFINITE to specify that the wait will not time out. Only one thread may wait
+// on a notify set at a time.
+//
+typedef
+HRESULT
+XSK_NOTIFY_SET_WAIT_FN(
+    _In_ HANDLE NotifySet,
+    _In_ UINT32 WaitTimeoutMilliseconds,
+    _Out_writes_to_(EventCount, *ReadyCount) XSK_NOTIFY_SET_EVENT *Events,
+    _In_ UINT32 EventCount,
+    _Out_ UINT32 *ReadyCount
+    );
+
+#define XSK_NOTIFY_SET_WAIT_FN_NAME "XskNotifySetWaitExperimental"
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -38,12 +38,28 @@ struct _XDP_CAPABILITIES_EX {
     UINT32 DriverApiVersionCount;
     XDP_VERSION DdkDriverApiVersion;
     GUID InstanceId;
+
+    //
+    // Revision 2: a bitmask of XDP_CAPABILITIES_EX_FLAG_* values.
+    //
+    UINT32 Flags;
 } XDP_CAPABILITIES_EX;
 
 #define XDP_CAPABILITIES_EX_REVISION_1 1
+#define XDP_CAPABILITIES_EX_REVISION_2 2
 
 #define XDP_SIZEOF_CAPABILITIES_EX_REVISION_1 \
     RTL_SIZEOF_THROUGH_FIELD(XDP_CAPABILITIES_EX, InstanceId)
+#define XDP_SIZEOF_CAPABILITIES_EX_REVISION_2 \
+    RTL_SIZEOF_THROUGH_FIELD(XDP_CAPABILITIES_EX, Flags)
+
+//
+// The interface supports the L2 TX inspect hook. XDP creates RX queues bound
+// to the TX inspect hook, and the interface indicates each frame sent by the
+// local stack to those queues via XdpReceive before posting it to hardware.
+// Frames are forwarded to hardware only if XDP returns XDP_RX_ACTION_PASS.
+//
+#define XDP_CAPABILITIES_EX_FLAG_TX_INSPECT 0x00000001
 
 typedef struct _XDP_CAPABILITIES {
     XDP_CAPABILITIES_EX CapabilitiesEx;
@@ -64,8 +80,8 @@ XdpInitializeCapabilities(
     };
 
     RtlZeroMemory(Capabilities, sizeof(*Capabilities));
-    Capabilities->CapabilitiesEx.Header.Revision = XDP_CAPABILITIES_EX_REVISION_1;
-    Capabilities->CapabilitiesEx.Header.Size = XDP_SIZEOF_CAPABILITIES_EX_REVISION_1;
+    Capabilities->CapabilitiesEx.Header.Revision = XDP_CAPABILITIES_EX_REVISION_2;
+    Capabilities->CapabilitiesEx.Header.Size = XDP_SIZEOF_CAPABILITIES_EX_REVISION_2;
 
     Capabilities->CapabilitiesEx.DriverApiVersionsOffset =
         FIELD_OFFSET(XDP_CAPABILITIES, DriverApiVersion);
@@ -16,6 +16,12 @@ XDP_RX_QUEUE_GET_TARGET_QUEUE_INFO(
     _In_ XDP_RX_QUEUE_CONFIG_CREATE RxQueueConfig
     );
 
+typedef
+CONST XDP_HOOK_ID *
+XDP_RX_QUEUE_GET_HOOK_ID(
+    _In_ XDP_RX_QUEUE_CONFIG_CREATE RxQueueConfig
+    );
+
 typedef
 BOOLEAN
 XDP_RX_QUEUE_CREATE_IS_ENABLED(
@@ -78,13 +84,18 @@ typedef struct _XDP_RX_QUEUE_CONFIG_CREATE_DISPATCH {
     XDP_RX_QUEUE_SET_CAPABILITIES           *SetRxQueueCapabilities;
     XDP_RX_QUEUE_SET_DESCRIPTOR_CONTEXTS    *SetRxDescriptorContexts;
     XDP_RX_QUEUE_SET_POLL_INFO              *SetPollInfo;
+    XDP_RX_QUEUE_GET_HOOK_ID                *GetHookId;
 } XDP_RX_QUEUE_CONFIG_CREATE_DISPATCH;
 
 #define XDP_RX_QUEUE_CONFIG_CREATE_DISPATCH_REVISION_1 1
+#define XDP_RX_QUEUE_CONFIG_CREATE_DISPATCH_REVISION_2 2
 
 #define XDP_SIZEOF_RX_QUEUE_CONFIG_CREATE_DISPATCH_REVISION_1 \
     RTL_SIZEOF_THROUGH_FIELD(XDP_RX_QUEUE_CONFIG_CREATE_DISPATCH, SetPollInfo)
 
+#define XDP_SIZEOF_RX_QUEUE_CONFIG_CREATE_DISPATCH_REVISION_2 \
+    RTL_SIZEOF_THROUGH_FIELD(XDP_RX_QUEUE_CONFIG_CREATE_DISPATCH, GetHookId)
+
 typedef struct _XDP_RX_QUEUE_CONFIG_CREATE_DETAILS {
     CONST XDP_RX_QUEUE_CONFIG_CREATE_DISPATCH *Dispatch;
 } XDP_RX_QUEUE_CONFIG_CREATE_DETAILS;
@@ -161,6 +172,23 @@ XDPEXPORT(XdpRxQueueSetPollInfo)(
     Details->Dispatch->SetPollInfo(RxQueueConfig, PollInfo);
 }
 
+inline
+CONST XDP_HOOK_ID *
+XDPEXPORT(XdpRxQueueGetHookId)(
+    _In_ XDP_RX_QUEUE_CONFIG_CREATE RxQueueConfig
+    )
+{
+    XDP_RX_QUEUE_CONFIG_CREATE_DETAILS *Details = (XDP_RX_QUEUE_CONFIG_CREATE_DETAILS *)RxQueueConfig;
+    CONST XDP_RX_QUEUE_CONFIG_CREATE_DISPATCH *Dispatch = Details->Dispatch;
+
+    if (Dispatch->Header.Revision < XDP_RX_QUEUE_CONFIG_CREATE_DISPATCH_REVISION_2 ||
+        Dispatch->Header.Size < XDP_SIZEOF_RX_QUEUE_CONFIG_CREATE_DISPATCH_REVISION_2) {
+        return NULL;
+    }
+
+    return Dispatch->GetHookId(RxQueueConfig);
+}
+
 inline
 XDP_RING *
 XDPEXPORT(XdpRxQueueGetFrameRing)(
@@ -16,6 +16,12 @@ XDP_TX_QUEUE_GET_TARGET_QUEUE_INFO(
     _In_ XDP_TX_QUEUE_CONFIG_CREATE TxQueueConfig
     );
 
+typedef
+CONST XDP_HOOK_ID *
+XDP_TX_QUEUE_GET_HOOK_ID(
+    _In_ XDP_TX_QUEUE_CONFIG_CREATE TxQueueConfig
+    );
+
 typedef
 BOOLEAN
 XDP_TX_QUEUE_CREATE_IS_ENABLED(
@@ -78,13 +84,18 @@ typedef struct _XDP_TX_QUEUE_CONFIG_CREATE_DISPATCH {
     XDP_TX_QUEUE_SET_CAPABILITIES           *SetTxQueueCapabilities;
     XDP_TX_QUEUE_SET_DESCRIPTOR_CONTEXTS    *SetTxDescriptorContexts;
     XDP_TX_QUEUE_SET_POLL_INFO              *SetPollInfo;
+    XDP_TX_QUEUE_GET_HOOK_ID                *GetHookId;
 } XDP_TX_QUEUE_CONFIG_CREATE_DISPATCH;
 
 #define XDP_TX_QUEUE_CONFIG_CREATE_DISPATCH_REVISION_1 1
+#define XDP_TX_QUEUE_CONFIG_CREATE_DISPATCH_REVISION_2 2
 
 #define XDP_SIZEOF_TX_QUEUE_CONFIG_CREATE_DISPATCH_REVISION_1 \
     RTL_SIZEOF_THROUGH_FIELD(XDP_TX_QUEUE_CONFIG_CREATE_DISPATCH, SetPollInfo)
 
+#define XDP_SIZEOF_TX_QUEUE_CONFIG_CREATE_DISPATCH_REVISION_2 \
+    RTL_SIZEOF_THROUGH_FIELD(XDP_TX_QUEUE_CONFIG_CREATE_DISPATCH, GetHookId)
+
 typedef struct _XDP_TX_QUEUE_CONFIG_CREATE_DETAILS {
     CONST XDP_TX_QUEUE_CONFIG_CREATE_DISPATCH *Dispatch;
 } XDP_TX_QUEUE_CONFIG_CREATE_DETAILS;
@@ -164,6 +175,23 @@ XDPEXPORT(XdpTxQueueSetPollInfo)(
     Details->Dispatch->SetPollInfo(TxQueueConfig, PollInfo);
 }
 
+inline
+CONST XDP_HOOK_ID *
+XDPEXPORT(XdpTxQueueGetHookId)(
+    _In_ XDP_TX_QUEUE_CONFIG_CREATE TxQueueConfig
+    )
+{
+    XDP_TX_QUEUE_CONFIG_CREATE_DETAILS *Details = (XDP_TX_QUEUE_CONFIG_CREATE_DETAILS *)TxQueueConfig;
+    CONST XDP_TX_QUEUE_CONFIG_CREATE_DISPATCH *Dispatch = Details->Dispatch;
+
+    if (Dispatch->Header.Revision < XDP_TX_QUEUE_CONFIG_CREATE_DISPATCH_REVISION_2 ||
+        Dispatch->Header.Size < XDP_SIZEOF_TX_QUEUE_CONFIG_CREATE_DISPATCH_REVISION_2) {
+        return NULL;
+    }
+
+    return Dispatch->GetHookId(TxQueueConfig);
+}
+
 inline
 XDP_RING *
 XDPEXPORT(XdpTxQueueGetFrameRing)(
@@ -93,10 +93,21 @@ typedef enum _XDP_RULE_ACTION {
     // Reserved.
     //
     XDP_PROGRAM_ACTION_EBPF,
+    //
+    // Non-terminal: enqueue a copy of the frame, truncated to the snap length,
+    // to the mirror target and continue evaluating subsequent rules. Copies
+    // are dropped if the target cannot accept them.
+    //
+    XDP_PROGRAM_ACTION_MIRROR,
 } XDP_RULE_ACTION;
 
 typedef enum _XDP_REDIRECT_TARGET_TYPE {
     XDP_REDIRECT_TARGET_TYPE_XSK,
+    //
+    // Redirect to an XSK and tag each frame. Only valid for redirect rules,
+    // which specify the target in the TaggedRedirect parameters.
+    //
+    XDP_REDIRECT_TARGET_TYPE_XSK_TAGGED,
 } XDP_REDIRECT_TARGET_TYPE;
 
 typedef struct _XDP_REDIRECT_PARAMS {
@@ -104,17 +115,45 @@ typedef struct _XDP_REDIRECT_PARAMS {
     HANDLE Target;
 } XDP_REDIRECT_PARAMS;
 
+typedef struct _XDP_TAGGED_REDIRECT_PARAMS {
+    //
+    // Must be XDP_REDIRECT_TARGET_TYPE_XSK_TAGGED.
+    //
+    XDP_REDIRECT_TARGET_TYPE TargetType;
+    //
+    // An opaque classification tag delivered with each redirected frame to
+    // XSK targets that enable XSK_SOCKOPT_RX_METADATA.
+    //
+    UINT32 Tag;
+    HANDLE Target;
+} XDP_TAGGED_REDIRECT_PARAMS;
+
 typedef struct _XDP_EBPF_PARAMS {
     HANDLE Target;
 } XDP_EBPF_PARAMS;
 
+typedef struct _XDP_MIRROR_PARAMS {
+    XDP_REDIRECT_TARGET_TYPE TargetType;
+    //
+    // The maximum number of bytes copied from each frame, or 0 to copy the
+    // entire frame.
+    //
+    UINT32 SnapLength;
+    HANDLE Target;
+} XDP_MIRROR_PARAMS;
+
+//
+// XDP program rule. Rules must be zero-initialized before their fields are set.
+//
 typedef struct _XDP_RULE {
     XDP_MATCH_TYPE Match;
     XDP_MATCH_PATTERN Pattern;
     XDP_RULE_ACTION Action;
     union {
         XDP_REDIRECT_PARAMS Redirect;
+        XDP_TAGGED_REDIRECT_PARAMS TaggedRedirect;
         XDP_EBPF_PARAMS Ebpf;
+        XDP_MIRROR_PARAMS Mirror;
     };
 } XDP_RULE;
 
@@ -9,6 +9,7 @@ EXTERN_C_START
 
 #include <xdp/extension.h>
 #include <xdp/extensioninfo.h>
+#include <xdp/hookid.h>
 #include <xdp/pollinfo.h>
 #include <xdp/queueinfo.h>
 #include <xdp/objectheader.h>
@@ -21,19 +22,42 @@ XdpRxQueueGetTargetQueueInfo(
     _In_ XDP_RX_QUEUE_CONFIG_CREATE RxQueueConfig
     );
 
+//
+// Gets the hook the queue is created for. Interfaces advertising
+// XDP_CAPABILITIES_EX_FLAG_TX_INSPECT receive queues for both the L2 RX
+// inspect and L2 TX inspect hooks. Returns NULL if the XDP platform predates
+// this routine, in which case the queue is for the L2 RX inspect hook.
+//
+CONST XDP_HOOK_ID *
+XdpRxQueueGetHookId(
+    _In_ XDP_RX_QUEUE_CONFIG_CREATE RxQueueConfig
+    );
+
 typedef struct _XDP_RX_CAPABILITIES {
     XDP_OBJECT_HEADER Header;
     BOOLEAN VirtualAddressSupported;
     UINT16 ReceiveFrameCountHint;
     UINT8 MaximumFragments;
     BOOLEAN TxActionSupported;
+    BOOLEAN DataAdjustSupported;
+    UINT16 Headroom;
 } XDP_RX_CAPABILITIES;
 
 #define XDP_RX_CAPABILITIES_REVISION_1 1
+#define XDP_RX_CAPABILITIES_REVISION_2 2
 
 #define XDP_SIZEOF_RX_CAPABILITIES_REVISION_1 \
     RTL_SIZEOF_THROUGH_FIELD(XDP_RX_CAPABILITIES, TxActionSupported)
 
+#define XDP_SIZEOF_RX_CAPABILITIES_REVISION_2 \
+    RTL_SIZEOF_THROUGH_FIELD(XDP_RX_CAPABILITIES, Headroom)
+
+//
+// The headroom interfaces should reserve to allow XDP programs to push
+// encapsulation headers.
+//
+#define XDP_RX_HEADROOM_DEFAULT 256
+
 inline
 VOID
 XdpInitializeRxCapabilitiesDriverVa(
@@ -41,8 +65,8 @@ XdpInitializeRxCapabilitiesDriverVa(
     )
 {
     RtlZeroMemory(Capabilities, sizeof(*Capabilities));
-    Capabilities->Header.Revision = XDP_RX_CAPABILITIES_REVISION_1;
-    Capabilities->Header.Size = XDP_SIZEOF_RX_CAPABILITIES_REVISION_1;
+    Capabilities->Header.Revision = XDP_RX_CAPABILITIES_REVISION_2;
+    Capabilities->Header.Size = XDP_SIZEOF_RX_CAPABILITIES_REVISION_2;
     Capabilities->VirtualAddressSupported = TRUE;
 }
 
@@ -10,6 +10,7 @@ EXTERN_C_START
 #include <xdp/dma.h>
 #include <xdp/extension.h>
 #include <xdp/extensioninfo.h>
+#include <xdp/hookid.h>
 #include <xdp/pollinfo.h>
 #include <xdp/queueinfo.h>
 #include <xdp/objectheader.h>
@@ -22,6 +23,15 @@ XdpTxQueueGetTargetQueueInfo(
     _In_ XDP_TX_QUEUE_CONFIG_CREATE TxQueueConfig
     );
 
+//
+// Gets the hook the queue is created for. Returns NULL if the XDP platform
+// predates this routine, in which case the queue is for the L2 TX inject hook.
+//
+CONST XDP_HOOK_ID *
+XdpTxQueueGetHookId(
+    _In_ XDP_TX_QUEUE_CONFIG_CREATE TxQueueConfig
+    );
+
 typedef struct _XDP_TX_CAPABILITIES {
     XDP_OBJECT_HEADER Header;
     BOOLEAN VirtualAddressEnabled;
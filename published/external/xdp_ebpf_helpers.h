@@ -0,0 +1,54 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+
+#pragma once
+
+//
+// Declarations of the XDP helpers available to eBPF programs attached to XDP.
+// eBPF programs include this header after eBPF-for-Windows' bpf_helpers.h.
+// Like the Linux XDP helpers, each helper returns a negative value on error,
+// in which case the context is not modified.
+//
+
+#ifndef XDP_EXT_HELPER_FN_BASE
+#define XDP_EXT_HELPER_FN_BASE 0xFFFF
+#endif
+
+#ifndef XDP_REDIRECT
+#define XDP_REDIRECT 4
+#endif
+
+#ifndef bpf_xdp_adjust_head
+//
+// Moves the start of the frame data, along with any metadata, by delta bytes.
+// A negative delta grows the frame into the buffer headroom.
+//
+EBPF_HELPER(int, bpf_xdp_adjust_head, (xdp_md_t *ctx, int delta));
+#define bpf_xdp_adjust_head ((bpf_xdp_adjust_head_t)(XDP_EXT_HELPER_FN_BASE + 1))
+#endif
+
+//
+// Returns XDP_REDIRECT if an AF_XDP socket is registered on the frame's RX queue
+// with XSK_SOCKOPT_EBPF_REDIRECT. Otherwise returns the verdict in the lower two
+// bits of flags, or XDP_DROP if those bits are zero. Programs return the
+// verdict to redirect the frame to the socket.
+//
+EBPF_HELPER(int, bpf_xdp_redirect_xsk, (xdp_md_t *ctx, uint64_t flags));
+#define bpf_xdp_redirect_xsk ((bpf_xdp_redirect_xsk_t)(XDP_EXT_HELPER_FN_BASE + 2))
+
+//
+// Moves the end of the frame data by delta bytes. A positive delta grows the
+// frame into the buffer tailroom, which is zeroed.
+//
+EBPF_HELPER(int, bpf_xdp_adjust_tail, (xdp_md_t *ctx, int delta));
+#define bpf_xdp_adjust_tail ((bpf_xdp_adjust_tail_t)(XDP_EXT_HELPER_FN_BASE + 3))
+
+//
+// Moves the start of the frame metadata by delta bytes. A negative delta grows
+// the metadata into the buffer headroom. Metadata is delivered to AF_XDP sockets
+// that enable XSK_SOCKOPT_RX_METADATA.
+//
+EBPF_HELPER(int, bpf_xdp_adjust_meta, (xdp_md_t *ctx, int delta));
+#define bpf_xdp_adjust_meta ((bpf_xdp_adjust_meta_t)(XDP_EXT_HELPER_FN_BASE + 4))
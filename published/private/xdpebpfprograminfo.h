@@ -0,0 +1,92 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+
+#pragma once
+
+//
+// The following definitions are proposed to be upstreamed:
+// https://github.com/microsoft/ebpf-for-windows/issues/2145
+//
+
+#define EBPF_PROGRAM_TYPE_XDP_INIT { \
+    0xf1832a85, \
+    0x85d5, \
+    0x45b0, \
+    {0x98, 0xa0, 0x70, 0x69, 0xd6, 0x30, 0x13, 0xb0}}
+
+#define EBPF_ATTACH_TYPE_XDP_INIT { \
+    0x85e0d8ef, \
+    0x579e, \
+    0x4931, \
+    {0xb0, 0x72, 0x8e, 0xe2, 0x26, 0xbb, 0x2e, 0x9d}}
+
+//
+// The eBPF program information for XDP programs. The XDP driver provides it to
+// the eBPF runtime, and xdpcfg.exe writes it to the eBPF store so the verifier
+// resolves the XDP helpers when programs are verified in user mode. The helper
+// IDs must match the declarations in xdp_ebpf_helpers.h.
+//
+
+static const ebpf_context_descriptor_t EbpfXdpContextDescriptor = {
+    .size = sizeof(xdp_md_t),
+    .data = FIELD_OFFSET(xdp_md_t, data),
+    .end = FIELD_OFFSET(xdp_md_t, data_end),
+    .meta = FIELD_OFFSET(xdp_md_t, data_meta),
+};
+
+#define XDP_EXT_HELPER_FUNCTION_START EBPF_MAX_GENERAL_HELPER_FUNCTION
+
+// XDP helper function prototype descriptors.
+static const ebpf_helper_function_prototype_t EbpfXdpHelperFunctionPrototype[] = {
+    {
+        .helper_id = XDP_EXT_HELPER_FUNCTION_START + 1,
+        .name = "bpf_xdp_adjust_head",
+        .return_type = EBPF_RETURN_TYPE_INTEGER,
+        .arguments = {
+            EBPF_ARGUMENT_TYPE_PTR_TO_CTX,
+            EBPF_ARGUMENT_TYPE_ANYTHING,
+        },
+    },
+    {
+        .helper_id = XDP_EXT_HELPER_FUNCTION_START + 2,
+        .name = "bpf_xdp_redirect_xsk",
+        .return_type = EBPF_RETURN_TYPE_INTEGER,
+        .arguments = {
+            EBPF_ARGUMENT_TYPE_PTR_TO_CTX,
+            EBPF_ARGUMENT_TYPE_ANYTHING,
+        },
+    },
+    {
+        .helper_id = XDP_EXT_HELPER_FUNCTION_START + 3,
+        .name = "bpf_xdp_adjust_tail",
+        .return_type = EBPF_RETURN_TYPE_INTEGER,
+        .arguments = {
+            EBPF_ARGUMENT_TYPE_PTR_TO_CTX,
+            EBPF_ARGUMENT_TYPE_ANYTHING,
+        },
+    },
+    {
+        .helper_id = XDP_EXT_HELPER_FUNCTION_START + 4,
+        .name = "bpf_xdp_adjust_meta",
+        .return_type = EBPF_RETURN_TYPE_INTEGER,
+        .arguments = {
+            EBPF_ARGUMENT_TYPE_PTR_TO_CTX,
+            EBPF_ARGUMENT_TYPE_ANYTHING,
+        },
+    },
+};
+
+#pragma warning(suppress:4090) // 'initializing': different 'const' qualifiers
+static const ebpf_program_info_t EbpfXdpProgramInfo = {
+#pragma warning(suppress:4090) // 'initializing': different 'const' qualifiers
+    .program_type_descriptor = {
+        .name = "xdp",
+        .context_descriptor = &EbpfXdpContextDescriptor,
+        .program_type = EBPF_PROGRAM_TYPE_XDP_INIT,
+        BPF_PROG_TYPE_XDP,
+    },
+    .count_of_program_type_specific_helpers = RTL_NUMBER_OF(EbpfXdpHelperFunctionPrototype),
+    .program_type_specific_helper_prototype = EbpfXdpHelperFunctionPrototype,
+};
@@ -32,6 +32,7 @@ typedef enum _XDP_OBJECT_TYPE {
     XDP_OBJECT_TYPE_PROGRAM,
     XDP_OBJECT_TYPE_XSK,
     XDP_OBJECT_TYPE_INTERFACE,
+    XDP_OBJECT_TYPE_XSK_NOTIFY_SET,
 } XDP_OBJECT_TYPE;
 
 //
@@ -124,3 +125,48 @@ typedef struct _XSK_NOTIFY_IN {
     XSK_NOTIFY_FLAGS Flags;
     UINT32 WaitTimeoutMilliseconds;
 } XSK_NOTIFY_IN;
+
+//
+// Extended input struct for IOCTL_XSK_NOTIFY, identified by its length. The
+// wait timeout is in 100ns units and WaitTimeoutMilliseconds is ignored.
+//
+typedef struct _XSK_NOTIFY_PRECISE_IN {
+    XSK_NOTIFY_IN Notify;
+    UINT64 WaitTimeout;
+} XSK_NOTIFY_PRECISE_IN;
+
+#define XSK_NOTIFY_TIMEOUT_INFINITE MAXUINT64
+
+//
+// Define IOCTLs supported by an XSK notify set file handle.
+//
+
+#define IOCTL_XSK_NOTIFY_SET_ADD \
+    CTL_CODE(FILE_DEVICE_NETWORK, 0, METHOD_BUFFERED, FILE_WRITE_ACCESS)
+#define IOCTL_XSK_NOTIFY_SET_REMOVE \
+    CTL_CODE(FILE_DEVICE_NETWORK, 1, METHOD_BUFFERED, FILE_WRITE_ACCESS)
+#define IOCTL_XSK_NOTIFY_SET_WAIT \
+    CTL_CODE(FILE_DEVICE_NETWORK, 2, METHOD_NEITHER, FILE_WRITE_ACCESS)
+
+//
+// Input struct for IOCTL_XSK_NOTIFY_SET_ADD
+//
+typedef struct _XSK_NOTIFY_SET_ADD_IN {
+    HANDLE Socket;
+    XSK_NOTIFY_FLAGS Flags;
+    VOID *Context;
+} XSK_NOTIFY_SET_ADD_IN;
+
+//
+// Input struct for IOCTL_XSK_NOTIFY_SET_REMOVE
+//
+typedef struct _XSK_NOTIFY_SET_REMOVE_IN {
+    HANDLE Socket;
+} XSK_NOTIFY_SET_REMOVE_IN;
+
+//
+// Input struct for IOCTL_XSK_NOTIFY_SET_WAIT
+//
+typedef struct _XSK_NOTIFY_SET_WAIT_IN {
+    UINT32 WaitTimeoutMilliseconds;
+} XSK_NOTIFY_SET_WAIT_IN;
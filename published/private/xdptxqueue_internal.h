@@ -7,12 +7,6 @@
 
 #include <xdp/details/txqueueconfig.h>
 
-typedef
-CONST XDP_HOOK_ID *
-XDP_TX_QUEUE_CREATE_GET_HOOK_ID(
-    _In_ XDP_TX_QUEUE_CONFIG_CREATE TxQueueConfig
-    );
-
 typedef struct _XDP_TX_QUEUE_NOTIFY_HANDLE *XDP_TX_QUEUE_NOTIFY_HANDLE;
 typedef
 XDP_TX_QUEUE_NOTIFY_HANDLE
@@ -22,7 +16,6 @@ XDP_TX_QUEUE_CREATE_GET_NOTIFY_HANDLE(
 
 typedef struct _XDP_TX_QUEUE_CONFIG_RESERVED {
     XDP_OBJECT_HEADER                       Header;
-    XDP_TX_QUEUE_CREATE_GET_HOOK_ID         *GetHookId;
     XDP_TX_QUEUE_CREATE_GET_NOTIFY_HANDLE   *GetNotifyHandle;
 } XDP_TX_QUEUE_CONFIG_RESERVED;
 
@@ -31,25 +24,6 @@ typedef struct _XDP_TX_QUEUE_CONFIG_RESERVED {
 #define XDP_SIZEOF_TX_QUEUE_CONFIG_RESERVED_REVISION_1 \
     RTL_SIZEOF_THROUGH_FIELD(XDP_TX_QUEUE_CONFIG_RESERVED, GetNotifyHandle)
 
-inline
-CONST XDP_HOOK_ID *
-XdpTxQueueGetHookId(
-    _In_ XDP_TX_QUEUE_CONFIG_CREATE TxQueueConfig
-    )
-{
-    XDP_TX_QUEUE_CONFIG_CREATE_DETAILS *Details = (XDP_TX_QUEUE_CONFIG_CREATE_DETAILS *)TxQueueConfig;
-    CONST XDP_TX_QUEUE_CONFIG_RESERVED *Reserved = Details->Dispatch->Reserved;
-
-    if (Reserved == NULL ||
-        Reserved->Header.Revision < XDP_TX_QUEUE_CONFIG_RESERVED_REVISION_1 ||
-        Reserved->Header.Size < XDP_SIZEOF_TX_QUEUE_CONFIG_RESERVED_REVISION_1 ||
-        Reserved->GetHookId == NULL) {
-        return NULL;
-    }
-
-    return Reserved->GetHookId(TxQueueConfig);
-}
-
 inline
 XDP_TX_QUEUE_NOTIFY_HANDLE
 XdpTxQueueGetNotifyHandle(
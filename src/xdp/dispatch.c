@@ -129,6 +129,10 @@ XdpIrpCreate(
         CreateRoutine = XdpIrpCreateInterface;
         break;
 
+    case XDP_OBJECT_TYPE_XSK_NOTIFY_SET:
+        CreateRoutine = XskIrpCreateNotifySet;
+        break;
+
     default:
         Status = STATUS_INVALID_PARAMETER;
         goto Exit;
@@ -314,6 +318,11 @@ XdpFastDeviceIoControl(
             XskFastIo(
                 FileObjHeader, InputBuffer, InputBufferLength, OutputBuffer,
                 OutputBufferLength, IoControlCode, IoStatus);
+    case XDP_OBJECT_TYPE_XSK_NOTIFY_SET:
+        return
+            XskNotifySetFastIo(
+                FileObjHeader, InputBuffer, InputBufferLength, OutputBuffer,
+                OutputBufferLength, IoControlCode, IoStatus);
     default:
         return FALSE;
     }
@@ -39,7 +39,6 @@
 #include <ebpf_program_types.h>
 #include <ebpf_result.h>
 #include <ebpf_structs.h>
-#include "ebpf_private_extension.h"
 
 #define XDPAPI
 #define XDPEXPORT(RoutineName) RoutineName##Thunk
@@ -58,6 +57,7 @@
 #include <xdpapi.h>
 #include <xdpapi_experimental.h>
 #include <xdpassert.h>
+#include <xdpebpfprograminfo.h>
 #include <xdpetw.h>
 #include <xdpif.h>
 #include <xdpioctl.h>
@@ -68,7 +68,6 @@
 #include <xdprefcount.h>
 #include <xdpregistry.h>
 #include <xdprtl.h>
-#include <xdprxqueue_internal.h>
 #include <xdptrace.h>
 #include <xdptransport.h>
 #include <xdptxqueue_internal.h>
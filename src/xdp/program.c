@@ -13,72 +13,204 @@
 
 typedef struct _EBPF_XDP_MD {
     xdp_md_t Base;
+    XDP_INSPECTION_CONTEXT *InspectionContext;
+
+    //
+    // The writable bounds of the buffer containing the frame, within which
+    // helpers may move the data, data_meta and data_end pointers. NULL if the
+    // frame cannot be adjusted.
+    //
+    UCHAR *BufferStart;
+    UCHAR *BufferEnd;
 } EBPF_XDP_MD;
 
+//
+// The maximum metadata length and alignment, matching Linux.
+//
+#define XDP_EBPF_MAX_META_LENGTH 32
+#define XDP_EBPF_META_ALIGNMENT 4
+
+//
+// eBPF-for-Windows does not define a redirect verdict, so use the Linux value.
+// The XSK map helper returns this verdict when the frame can be redirected.
+//
+#define XDP_EBPF_ACTION_REDIRECT 4
+
+//
+// The mask of the XSK map helper flags specifying the fallback verdict.
+//
+#define XDP_EBPF_REDIRECT_FALLBACK_MASK 0x3
+
 //
 // Data path routines.
 //
 
 static
-XDP_RX_ACTION
-XdpInvokeEbpf(
-    _In_ HANDLE EbpfTarget,
+VOID
+XdpEbpfCopyFrame(
+    _In_ XDP_FRAME *Frame,
+    _In_opt_ XDP_RING *FragmentRing,
+    _In_ UINT32 FragmentIndex,
+    _In_ UINT32 FragmentCount,
+    _In_ XDP_EXTENSION *VirtualAddressExtension,
+    _Inout_ UCHAR *Storage,
+    _In_ BOOLEAN ToFrame
+    )
+{
+    XDP_BUFFER *Buffer = &Frame->Buffer;
+
+    //
+    // Copy each buffer of a frame to or from contiguous storage. The first
+    // buffer is stored in the frame ring and the remaining buffers are stored
+    // in the fragment ring.
+    //
+    for (UINT32 Index = 0; Index <= FragmentCount; Index++) {
+        UCHAR *Va;
+
+        if (Index > 0) {
+            ASSERT(FragmentRing != NULL);
+            Buffer =
+                XdpRingGetElement(
+                    FragmentRing, (FragmentIndex + Index - 1) & FragmentRing->Mask);
+        }
+
+        Va = XdpGetVirtualAddressExtension(Buffer, VirtualAddressExtension)->VirtualAddress;
+        Va += Buffer->DataOffset;
+
+        if (ToFrame) {
+            RtlCopyMemory(Va, Storage, Buffer->DataLength);
+        } else {
+            RtlCopyMemory(Storage, Va, Buffer->DataLength);
+        }
+
+        Storage += Buffer->DataLength;
+    }
+}
+
+static
+_Success_(return != FALSE)
+BOOLEAN
+XdpEbpfGetLinearizedLength(
+    _In_ XDP_FRAME *Frame,
+    _In_ XDP_RING *FragmentRing,
+    _In_ UINT32 FragmentIndex,
+    _In_ UINT32 FragmentCount,
+    _Out_ UINT32 *FrameLength
+    )
+{
+    UINT32 Length = 0;
+
+    for (UINT32 Index = 0; Index <= FragmentCount; Index++) {
+        XDP_BUFFER *Buffer = &Frame->Buffer;
+
+        if (Index > 0) {
+            Buffer =
+                XdpRingGetElement(
+                    FragmentRing, (FragmentIndex + Index - 1) & FragmentRing->Mask);
+        }
+
+        if (Buffer->DataLength > XDP_EBPF_FRAME_STORAGE_SIZE - Length) {
+            return FALSE;
+        }
+
+        Length += Buffer->DataLength;
+    }
+
+    *FrameLength = Length;
+    return TRUE;
+}
+
+static
+_Success_(return != FALSE)
+BOOLEAN
+XdpEbpfPrepareContext(
+    _In_ XDP_PROGRAM *Program,
     _In_ XDP_INSPECTION_CONTEXT *InspectionContext,
     _In_ XDP_FRAME *Frame,
     _In_opt_ XDP_RING *FragmentRing,
-    _In_opt_ XDP_EXTENSION *FragmentExtension,
     _In_ UINT32 FragmentIndex,
-    _In_ XDP_EXTENSION *VirtualAddressExtension
+    _In_ UINT32 FragmentCount,
+    _In_ XDP_EXTENSION *VirtualAddressExtension,
+    _Out_ EBPF_XDP_MD *XdpMd
     )
 {
-    const EBPF_EXTENSION_CLIENT *Client = (const EBPF_EXTENSION_CLIENT *)EbpfTarget;
-    const VOID *ClientBindingContext = EbpfExtensionClientGetClientContext(Client);
-    XDP_PCW_RX_QUEUE *RxQueueStats = XdpRxQueueGetStatsFromInspectionContext(InspectionContext);
-    XDP_INSPECTION_EBPF_CONTEXT *EbpfContext = &InspectionContext->EbpfContext;
-    XDP_BUFFER *Buffer;
+    XDP_BUFFER *Buffer = &Frame->Buffer;
     UCHAR *Va;
-    EBPF_XDP_MD XdpMd;
-    ebpf_result_t EbpfResult;
-    XDP_RX_ACTION RxAction;
-    UINT32 Result;
-
-    UNREFERENCED_PARAMETER(FragmentIndex);
+    UINT32 FrameLength;
 
-    ASSERT((FragmentRing == NULL) || (FragmentExtension != NULL));
+    if (FragmentCount == 0) {
+        Va = XdpGetVirtualAddressExtension(Buffer, VirtualAddressExtension)->VirtualAddress;
+        Va += Buffer->DataOffset;
+        FrameLength = Buffer->DataLength;
+    } else {
+        //
+        // eBPF programs require contiguous packet data, so linearize
+        // fragmented frames into the program's scratch storage. Frames too
+        // large for the storage are dropped.
+        //
+        if (Program->EbpfFrameStorage == NULL ||
+            !XdpEbpfGetLinearizedLength(
+                Frame, FragmentRing, FragmentIndex, FragmentCount, &FrameLength)) {
+            return FALSE;
+        }
 
-    //
-    // Fragmented frames are currently not supported by eBPF.
-    //
-    if (FragmentRing != NULL &&
-        XdpGetFragmentExtension(Frame, FragmentExtension)->FragmentBufferCount != 0) {
-        RxAction = XDP_RX_ACTION_DROP;
-        goto Exit;
+        Va = Program->EbpfFrameStorage;
+        XdpEbpfCopyFrame(
+            Frame, FragmentRing, FragmentIndex, FragmentCount, VirtualAddressExtension, Va,
+            FALSE);
     }
 
-    Buffer = &Frame->Buffer;
-    Va = XdpGetVirtualAddressExtension(Buffer, VirtualAddressExtension)->VirtualAddress;
-    Va += Buffer->DataOffset;
+    XdpMd->Base.data = Va;
+    XdpMd->Base.data_end = Va + FrameLength;
+    XdpMd->Base.ingress_ifindex = IFI_UNSPECIFIED;
+    XdpMd->InspectionContext = InspectionContext;
 
-    XdpMd.Base.data = Va;
-    XdpMd.Base.data_end = Va + Buffer->DataLength;
-    XdpMd.Base.data_meta = 0;
-    XdpMd.Base.ingress_ifindex = IFI_UNSPECIFIED;
+    if (FragmentCount == 0 && InspectionContext->DataAdjustSupported) {
+        ASSERT(Buffer->DataOffset >= InspectionContext->Headroom);
+        XdpMd->BufferStart = Va - Buffer->DataOffset;
+        XdpMd->BufferEnd = XdpMd->BufferStart + Buffer->BufferLength;
 
-    ebpf_program_batch_invoke_function_t EbpfInvokeProgram =
-        EbpfExtensionClientGetProgramDispatch(Client)->ebpf_program_batch_invoke_function;
-    EbpfResult = EbpfInvokeProgram(ClientBindingContext, &XdpMd.Base, &Result, EbpfContext);
+        //
+        // The metadata is initially empty.
+        //
+        XdpMd->Base.data_meta = (UINT64)Va;
+    } else {
+        XdpMd->BufferStart = NULL;
+        XdpMd->BufferEnd = NULL;
 
-    if (EbpfResult != EBPF_SUCCESS) {
-        EventWriteEbpfProgramFailure(&MICROSOFT_XDP_PROVIDER, ClientBindingContext, EbpfResult);
-        RxAction = XDP_RX_ACTION_DROP;
-        STAT_INC(RxQueueStats, InspectFramesDropped);
-        goto Exit;
+        //
+        // Like Linux, place the metadata beyond the data so programs cannot
+        // access it.
+        //
+        XdpMd->Base.data_meta = (UINT64)(Va + 1);
     }
 
+    return TRUE;
+}
+
+static
+XDP_RX_ACTION
+XdpEbpfCompleteContext(
+    _In_ XDP_PROGRAM *Program,
+    _In_ XDP_INSPECTION_CONTEXT *InspectionContext,
+    _In_ XDP_FRAME *Frame,
+    _In_ UINT32 FrameIndex,
+    _In_opt_ XDP_RING *FragmentRing,
+    _In_ UINT32 FragmentIndex,
+    _In_ UINT32 FragmentCount,
+    _In_ XDP_EXTENSION *VirtualAddressExtension,
+    _In_ CONST EBPF_XDP_MD *XdpMd,
+    _In_ UINT32 Result
+    )
+{
+    XDP_PCW_RX_QUEUE *RxQueueStats = XdpRxQueueGetStatsFromInspectionContext(InspectionContext);
+    XDP_RX_ACTION RxAction;
+    XDP_REDIRECT_METADATA Metadata = {0};
+    BOOLEAN Redirected = FALSE;
+
     switch (Result) {
     case XDP_PASS:
         RxAction = XDP_RX_ACTION_PASS;
-        STAT_INC(RxQueueStats, InspectFramesPassed);
         break;
 
     case XDP_TX:
@@ -86,6 +218,38 @@ XdpInvokeEbpf(
         STAT_INC(RxQueueStats, InspectFramesForwarded);
         break;
 
+    case XDP_EBPF_ACTION_REDIRECT:
+        //
+        // The XSK map entry cannot change within a batch, so it is the same
+        // entry the helper observed.
+        //
+        if (InspectionContext->EbpfRedirectTarget == NULL) {
+            RxAction = XDP_RX_ACTION_DROP;
+            STAT_INC(RxQueueStats, InspectFramesDropped);
+            break;
+        }
+
+        Metadata.RuleIndex = XDP_INSPECTION_RULE_INDEX_NONE;
+        Metadata.Ebpf = TRUE;
+
+        if (XdpMd->BufferStart != NULL) {
+            //
+            // The metadata precedes the frame data within the frame's buffer,
+            // where it remains until the redirect batch is flushed.
+            //
+            Metadata.EbpfMetaLength =
+                (UINT8)((UCHAR *)XdpMd->Base.data - (UCHAR *)XdpMd->Base.data_meta);
+        }
+
+        XdpRedirect(
+            &InspectionContext->RedirectContext, FrameIndex, FragmentIndex,
+            XDP_REDIRECT_TARGET_TYPE_XSK, InspectionContext->EbpfRedirectTarget, &Metadata);
+
+        Redirected = TRUE;
+        RxAction = XDP_RX_ACTION_DROP;
+        STAT_INC(RxQueueStats, InspectFramesRedirected);
+        break;
+
     default:
         ASSERT(FALSE);
         __fallthrough;
@@ -95,17 +259,79 @@ XdpInvokeEbpf(
         break;
     }
 
-Exit:
+    if (XdpMd->BufferStart != NULL) {
+        XDP_BUFFER *Buffer = &Frame->Buffer;
+
+        //
+        // Apply any adjustments made by the eBPF program to the buffer.
+        //
+        Buffer->DataOffset = (UINT32)((UCHAR *)XdpMd->Base.data - XdpMd->BufferStart);
+        Buffer->DataLength = (UINT32)((UCHAR *)XdpMd->Base.data_end - (UCHAR *)XdpMd->Base.data);
+    }
+
+    if (FragmentCount != 0 && (RxAction != XDP_RX_ACTION_DROP || Redirected)) {
+        //
+        // Write any modifications made by the eBPF program back to the frame.
+        // Redirected frames are copied when the redirect batch is flushed.
+        //
+        XdpEbpfCopyFrame(
+            Frame, FragmentRing, FragmentIndex, FragmentCount, VirtualAddressExtension,
+            Program->EbpfFrameStorage, TRUE);
+    }
 
     return RxAction;
 }
 
+static
+XDP_RX_ACTION
+XdpEbpfInvokeFrame(
+    _In_ XDP_PROGRAM *Program,
+    _In_ XDP_INSPECTION_CONTEXT *InspectionContext,
+    _In_ XDP_FRAME *Frame,
+    _In_ UINT32 FrameIndex,
+    _In_opt_ XDP_RING *FragmentRing,
+    _In_ UINT32 FragmentIndex,
+    _In_ UINT32 FragmentCount,
+    _In_ XDP_EXTENSION *VirtualAddressExtension
+    )
+{
+    const EBPF_EXTENSION_CLIENT *Client = (const EBPF_EXTENSION_CLIENT *)Program->EbpfTarget;
+    const VOID *ClientBindingContext = EbpfExtensionClientGetClientContext(Client);
+    XDP_PCW_RX_QUEUE *RxQueueStats = XdpRxQueueGetStatsFromInspectionContext(InspectionContext);
+    XDP_INSPECTION_EBPF_CONTEXT *EbpfContext = &InspectionContext->EbpfContext;
+    EBPF_XDP_MD XdpMd;
+    ebpf_result_t EbpfResult;
+    UINT32 Result;
+
+    if (!XdpEbpfPrepareContext(
+            Program, InspectionContext, Frame, FragmentRing, FragmentIndex, FragmentCount,
+            VirtualAddressExtension, &XdpMd)) {
+        STAT_INC(RxQueueStats, InspectFramesDropped);
+        return XDP_RX_ACTION_DROP;
+    }
+
+    ebpf_program_batch_invoke_function_t EbpfInvokeProgram =
+        EbpfExtensionClientGetProgramDispatch(Client)->ebpf_program_batch_invoke_function;
+    EbpfResult = EbpfInvokeProgram(ClientBindingContext, &XdpMd.Base, &Result, EbpfContext);
+
+    if (EbpfResult != EBPF_SUCCESS) {
+        EventWriteEbpfProgramFailure(&MICROSOFT_XDP_PROVIDER, ClientBindingContext, EbpfResult);
+        STAT_INC(RxQueueStats, InspectFramesDropped);
+        return XDP_RX_ACTION_DROP;
+    }
+
+    return
+        XdpEbpfCompleteContext(
+            Program, InspectionContext, Frame, FrameIndex, FragmentRing, FragmentIndex,
+            FragmentCount, VirtualAddressExtension, &XdpMd, Result);
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 XDP_RX_ACTION
-XdpInspectEbpf(
+XdpInvokeEbpf(
     _In_ XDP_PROGRAM *Program,
     _In_ XDP_INSPECTION_CONTEXT *InspectionContext,
-    _In_ XDP_RING *FrameRing,
+    _In_ XDP_FRAME *Frame,
     _In_ UINT32 FrameIndex,
     _In_opt_ XDP_RING *FragmentRing,
     _In_opt_ XDP_EXTENSION *FragmentExtension,
@@ -113,20 +339,187 @@ XdpInspectEbpf(
     _In_ XDP_EXTENSION *VirtualAddressExtension
     )
 {
-    XDP_FRAME *Frame;
+    XDP_RX_QUEUE *RxQueue = XdpRxQueueFromRedirectContext(&InspectionContext->RedirectContext);
+    UINT32 FragmentCount = 0;
+    UINT64 StartCycles = 0;
+    BOOLEAN CycleSample;
+    XDP_RX_ACTION RxAction;
+
+    ASSERT((FragmentRing == NULL) || (FragmentExtension != NULL));
+    ASSERT(InspectionContext->EbpfBatchActive);
+
+    if (FragmentRing != NULL) {
+        FragmentCount = XdpGetFragmentExtension(Frame, FragmentExtension)->FragmentBufferCount;
+    }
+
+    CycleSample = XdpRxQueueIsCycleSampleBatch(RxQueue);
+    if (CycleSample) {
+        StartCycles = XdpQueueReadCycles();
+    }
+
+    RxAction =
+        XdpEbpfInvokeFrame(
+            Program, InspectionContext, Frame, FrameIndex, FragmentRing, FragmentIndex,
+            FragmentCount, VirtualAddressExtension);
+
+    if (CycleSample) {
+        XDP_PCW_RX_QUEUE *RxQueueStats = XdpRxQueueGetStats(RxQueue);
+
+        STAT_ADD(RxQueueStats, EbpfCycles, XdpQueueReadCycles() - StartCycles);
+        STAT_INC(RxQueueStats, EbpfCycleSampledFrames);
+    }
+
+    return RxAction;
+}
+
+static
+VOID
+XdpEbpfCompleteVector(
+    _In_ XDP_PROGRAM *Program,
+    _In_ XDP_INSPECTION_CONTEXT *InspectionContext,
+    _In_ XDP_RING *FrameRing,
+    _In_ UINT32 FrameIndex,
+    _In_ UINT32 StartIndex,
+    _In_ UINT32 EndIndex,
+    _In_opt_ XDP_RING *FragmentRing,
+    _In_ CONST UINT32 *FragmentIndexes,
+    _In_ XDP_EXTENSION *VirtualAddressExtension,
+    _In_ CONST EBPF_XDP_MD *XdpMd,
+    _In_ CONST UINT32 *Results,
+    _Inout_ XDP_RX_ACTION *Actions
+    )
+{
+    for (UINT32 Index = StartIndex; Index < EndIndex; Index++) {
+        UINT32 RingIndex = (FrameIndex + Index) & FrameRing->Mask;
+
+        Actions[Index] =
+            XdpEbpfCompleteContext(
+                Program, InspectionContext, XdpRingGetElement(FrameRing, RingIndex), RingIndex,
+                FragmentRing, FragmentIndexes[Index], 0, VirtualAddressExtension, &XdpMd[Index],
+                Results[Index]);
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+XdpInspectEbpfVector(
+    _In_ XDP_PROGRAM *Program,
+    _In_ XDP_INSPECTION_CONTEXT *InspectionContext,
+    _In_ XDP_RING *FrameRing,
+    _In_ UINT32 FrameIndex,
+    _In_ UINT32 FrameCount,
+    _In_opt_ XDP_RING *FragmentRing,
+    _In_opt_ XDP_EXTENSION *FragmentExtension,
+    _In_ UINT32 FragmentIndex,
+    _In_ XDP_EXTENSION *VirtualAddressExtension,
+    _Out_writes_(FrameCount) XDP_RX_ACTION *Actions
+    )
+{
+    const EBPF_EXTENSION_CLIENT *Client = (const EBPF_EXTENSION_CLIENT *)Program->EbpfTarget;
+    const VOID *ClientBindingContext = EbpfExtensionClientGetClientContext(Client);
+    ebpf_program_batch_invoke_function_t EbpfInvokeProgram =
+        EbpfExtensionClientGetProgramDispatch(Client)->ebpf_program_batch_invoke_function;
+    XDP_RX_QUEUE *RxQueue = XdpRxQueueFromRedirectContext(&InspectionContext->RedirectContext);
+    XDP_PCW_RX_QUEUE *RxQueueStats = XdpRxQueueGetStats(RxQueue);
+    XDP_INSPECTION_EBPF_CONTEXT *EbpfContext = &InspectionContext->EbpfContext;
+    EBPF_XDP_MD XdpMd[XDP_EBPF_INVOKE_VECTOR_SIZE];
+    UINT32 Results[XDP_EBPF_INVOKE_VECTOR_SIZE];
+    UINT32 FragmentIndexes[XDP_EBPF_INVOKE_VECTOR_SIZE];
+    UINT8 FragmentCounts[XDP_EBPF_INVOKE_VECTOR_SIZE];
+    UINT32 PendingIndex = 0;
+    UINT64 StartCycles = 0;
+    BOOLEAN CycleSample;
 
     ASSERT(XdpProgramIsEbpf(Program));
-    ASSERT(FrameIndex <= FrameRing->Mask);
-    ASSERT(
-        (FragmentRing == NULL && FragmentIndex == 0) ||
-        (FragmentRing && FragmentIndex <= FragmentRing->Mask));
+    ASSERT(InspectionContext->EbpfBatchActive);
+    ASSERT(FrameCount > 0 && FrameCount <= XDP_EBPF_INVOKE_VECTOR_SIZE);
+    ASSERT((FragmentRing == NULL) || (FragmentExtension != NULL));
 
-    Frame = XdpRingGetElement(FrameRing, FrameIndex);
+    //
+    // The verdict is determined within the eBPF program, not by a rule.
+    //
+    InspectionContext->MatchedRuleIndex = XDP_INSPECTION_RULE_INDEX_NONE;
 
-    return
-        XdpInvokeEbpf(
-            Program->Rules[0].Ebpf.Target, InspectionContext, Frame, FragmentRing,
-            FragmentExtension, FragmentIndex, VirtualAddressExtension);
+    //
+    // Prepare the contexts of all frames in the window up front so the eBPF
+    // program is invoked in a tight loop. Fragmented frames share the
+    // program's linearization storage, so their contexts are prepared and
+    // completed individually as they are invoked.
+    //
+    for (UINT32 Index = 0; Index < FrameCount; Index++) {
+        XDP_FRAME *Frame = XdpRingGetElement(FrameRing, (FrameIndex + Index) & FrameRing->Mask);
+
+        FragmentCounts[Index] = 0;
+        FragmentIndexes[Index] = 0;
+
+        if (FragmentRing != NULL) {
+            FragmentCounts[Index] =
+                XdpGetFragmentExtension(Frame, FragmentExtension)->FragmentBufferCount;
+            FragmentIndexes[Index] = FragmentIndex & FragmentRing->Mask;
+            FragmentIndex += FragmentCounts[Index];
+        }
+
+        if (FragmentCounts[Index] == 0) {
+            XdpEbpfPrepareContext(
+                Program, InspectionContext, Frame, NULL, 0, 0, VirtualAddressExtension,
+                &XdpMd[Index]);
+        }
+    }
+
+    CycleSample = XdpRxQueueIsCycleSampleBatch(RxQueue);
+    if (CycleSample) {
+        StartCycles = XdpQueueReadCycles();
+    }
+
+    for (UINT32 Index = 0; Index < FrameCount; Index++) {
+        ebpf_result_t EbpfResult;
+
+        if (FragmentCounts[Index] != 0) {
+            //
+            // Completing a frame may redirect it, so complete the single-buffer
+            // frames invoked so far before the fragmented frame to preserve
+            // the ring order.
+            //
+            XdpEbpfCompleteVector(
+                Program, InspectionContext, FrameRing, FrameIndex, PendingIndex, Index,
+                FragmentRing, FragmentIndexes, VirtualAddressExtension, XdpMd, Results, Actions);
+
+            Actions[Index] =
+                XdpEbpfInvokeFrame(
+                    Program, InspectionContext,
+                    XdpRingGetElement(FrameRing, (FrameIndex + Index) & FrameRing->Mask),
+                    (FrameIndex + Index) & FrameRing->Mask, FragmentRing, FragmentIndexes[Index],
+                    FragmentCounts[Index], VirtualAddressExtension);
+
+            PendingIndex = Index + 1;
+            continue;
+        }
+
+        EbpfResult =
+            EbpfInvokeProgram(
+                ClientBindingContext, &XdpMd[Index].Base, &Results[Index], EbpfContext);
+
+        if (EbpfResult != EBPF_SUCCESS) {
+            EventWriteEbpfProgramFailure(
+                &MICROSOFT_XDP_PROVIDER, ClientBindingContext, EbpfResult);
+            Results[Index] = XDP_DROP;
+        }
+    }
+
+    XdpEbpfCompleteVector(
+        Program, InspectionContext, FrameRing, FrameIndex, PendingIndex, FrameCount,
+        FragmentRing, FragmentIndexes, VirtualAddressExtension, XdpMd, Results, Actions);
+
+    if (CycleSample) {
+        STAT_ADD(RxQueueStats, EbpfCycles, XdpQueueReadCycles() - StartCycles);
+        STAT_ADD(RxQueueStats, EbpfCycleSampledFrames, FrameCount);
+    }
+
+    for (UINT32 Index = 0; Index < FrameCount; Index++) {
+        if (Actions[Index] == XDP_RX_ACTION_PASS) {
+            STAT_INC(RxQueueStats, InspectFramesPassed);
+        }
+    }
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
@@ -141,9 +534,16 @@ XdpInspectEbpfStartBatch(
     const VOID *ClientBindingContext;
     ebpf_result_t EbpfResult;
 
-    ASSERT(XdpProgramIsEbpf(Program));
+    ASSERT(!InspectionContext->EbpfBatchActive);
 
-    Client = (const EBPF_EXTENSION_CLIENT *)Program->Rules[0].Ebpf.Target;
+    //
+    // The eBPF rule may have been removed from a chained program in-place.
+    //
+    if (Program->EbpfTarget == NULL) {
+        return FALSE;
+    }
+
+    Client = (const EBPF_EXTENSION_CLIENT *)Program->EbpfTarget;
     ClientBindingContext = EbpfExtensionClientGetClientContext(Client);
 
     ebpf_program_batch_begin_invoke_function_t EbpfBatchBegin =
@@ -154,7 +554,9 @@ XdpInspectEbpfStartBatch(
             ClientBindingContext, sizeof(InspectionContext->EbpfContext),
             &InspectionContext->EbpfContext);
 
-    return EbpfResult == EBPF_SUCCESS;
+    InspectionContext->EbpfBatchActive = (EbpfResult == EBPF_SUCCESS);
+
+    return InspectionContext->EbpfBatchActive;
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
@@ -168,9 +570,10 @@ XdpInspectEbpfEndBatch(
     const VOID *ClientBindingContext;
     ebpf_result_t EbpfResult;
 
-    ASSERT(XdpProgramIsEbpf(Program));
+    ASSERT(InspectionContext->EbpfBatchActive);
+    ASSERT(Program->EbpfTarget != NULL);
 
-    Client = (const EBPF_EXTENSION_CLIENT *)Program->Rules[0].Ebpf.Target;
+    Client = (const EBPF_EXTENSION_CLIENT *)Program->EbpfTarget;
     ClientBindingContext = EbpfExtensionClientGetClientContext(Client);
 
     ebpf_program_batch_end_invoke_function_t EbpfBatchEnd =
@@ -179,6 +582,8 @@ XdpInspectEbpfEndBatch(
     EbpfResult = EbpfBatchEnd(ClientBindingContext, &InspectionContext->EbpfContext);
 
     ASSERT(EbpfResult == EBPF_SUCCESS);
+
+    InspectionContext->EbpfBatchActive = FALSE;
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
@@ -409,7 +814,9 @@ XdpProgramTrace(
                 TRACE_CORE,
                 "Program=%p Rule[%u] Action=XDP_PROGRAM_ACTION_REDIRECT "
                 "TargetType=%!REDIRECT_TARGET_TYPE! Target=%p",
-                Program, i, Rule->Redirect.TargetType, Rule->Redirect.Target);
+                Program, i, Rule->Redirect.TargetType,
+                (Rule->Redirect.TargetType == XDP_REDIRECT_TARGET_TYPE_XSK_TAGGED) ?
+                    Rule->TaggedRedirect.Target : Rule->Redirect.Target);
             break;
 
         case XDP_PROGRAM_ACTION_L2FWD:
@@ -426,6 +833,15 @@ XdpProgramTrace(
                 Program, i, Rule->Ebpf.Target);
             break;
 
+        case XDP_PROGRAM_ACTION_MIRROR:
+            TraceInfo(
+                TRACE_CORE,
+                "Program=%p Rule[%u] Action=XDP_PROGRAM_ACTION_MIRROR "
+                "TargetType=%!REDIRECT_TARGET_TYPE! Target=%p SnapLength=%u",
+                Program, i, Rule->Mirror.TargetType, Rule->Mirror.Target,
+                Rule->Mirror.SnapLength);
+            break;
+
         default:
             ASSERT(FALSE);
             break;
@@ -446,58 +862,137 @@ XdpProgramTraceObject(
     XdpProgramTrace(&ProgramObject->Program);
 }
 
-static const ebpf_context_descriptor_t EbpfXdpContextDescriptor = {
-    .size = sizeof(xdp_md_t),
-    .data = FIELD_OFFSET(xdp_md_t, data),
-    .end = FIELD_OFFSET(xdp_md_t, data_end),
-    .meta = FIELD_OFFSET(xdp_md_t, data_meta),
-};
+//
+// The XDP helpers follow Linux semantics: any return < 0 is an error, in which
+// case the context is not modified. Offsets are computed using signed 64-bit
+// arithmetic so arbitrary deltas cannot overflow.
+//
 
-#define XDP_EXT_HELPER_FUNCTION_START EBPF_MAX_GENERAL_HELPER_FUNCTION
-
-// XDP helper function prototype descriptors.
-static const ebpf_helper_function_prototype_t EbpfXdpHelperFunctionPrototype[] = {
-    {
-        .helper_id = XDP_EXT_HELPER_FUNCTION_START + 1,
-        .name = "bpf_xdp_adjust_head",
-        .return_type = EBPF_RETURN_TYPE_INTEGER,
-        .arguments = {
-            EBPF_ARGUMENT_TYPE_PTR_TO_CTX,
-            EBPF_ARGUMENT_TYPE_ANYTHING,
-        },
-    },
-};
+static
+int
+EbpfXdpAdjustHead(
+    _Inout_ xdp_md_t *Context,
+    _In_ int Delta
+    )
+{
+    EBPF_XDP_MD *XdpMd = CONTAINING_RECORD(Context, EBPF_XDP_MD, Base);
+    UCHAR *Data = Context->data;
+    UCHAR *Meta = (UCHAR *)Context->data_meta;
+    INT64 MetaLength;
 
-#pragma warning(suppress:4090) // 'initializing': different 'const' qualifiers
-static const ebpf_program_info_t EbpfXdpProgramInfo = {
-#pragma warning(suppress:4090) // 'initializing': different 'const' qualifiers
-    .program_type_descriptor = {
-        .name = "xdp",
-        .context_descriptor = &EbpfXdpContextDescriptor,
-        .program_type = EBPF_PROGRAM_TYPE_XDP_INIT,
-        BPF_PROG_TYPE_XDP,
-    },
-    .count_of_program_type_specific_helpers = RTL_NUMBER_OF(EbpfXdpHelperFunctionPrototype),
-    .program_type_specific_helper_prototype = EbpfXdpHelperFunctionPrototype,
-};
+    if (XdpMd->BufferStart == NULL) {
+        return -1;
+    }
+
+    MetaLength = Data - Meta;
+
+    //
+    // The metadata moves along with the start of the data, and at least an
+    // Ethernet header must remain.
+    //
+    if ((Meta - XdpMd->BufferStart) + Delta < 0 ||
+        ((UCHAR *)Context->data_end - Data) - Delta < (INT64)sizeof(ETHERNET_HEADER)) {
+        return -1;
+    }
+
+    if (MetaLength > 0) {
+        RtlMoveMemory(Meta + Delta, Meta, (SIZE_T)MetaLength);
+    }
+
+    Context->data = Data + Delta;
+    Context->data_meta = (UINT64)(Meta + Delta);
+
+    return 0;
+}
 
 static
 int
-EbpfXdpAdjustHead(
+EbpfXdpAdjustTail(
     _Inout_ xdp_md_t *Context,
     _In_ int Delta
     )
 {
+    EBPF_XDP_MD *XdpMd = CONTAINING_RECORD(Context, EBPF_XDP_MD, Base);
+    UCHAR *DataEnd = Context->data_end;
+
+    if (XdpMd->BufferStart == NULL) {
+        return -1;
+    }
+
+    if ((XdpMd->BufferEnd - DataEnd) - Delta < 0 ||
+        (DataEnd - (UCHAR *)Context->data) + Delta < (INT64)sizeof(ETHERNET_HEADER)) {
+        return -1;
+    }
+
     //
-    // Not implemented. Any return < 0 is an error.
+    // Do not expose stale buffer contents to the program.
     //
-    UNREFERENCED_PARAMETER(Context);
-    UNREFERENCED_PARAMETER(Delta);
-    return -1;
+    if (Delta > 0) {
+        RtlZeroMemory(DataEnd, Delta);
+    }
+
+    Context->data_end = DataEnd + Delta;
+
+    return 0;
+}
+
+static
+int
+EbpfXdpAdjustMeta(
+    _Inout_ xdp_md_t *Context,
+    _In_ int Delta
+    )
+{
+    EBPF_XDP_MD *XdpMd = CONTAINING_RECORD(Context, EBPF_XDP_MD, Base);
+    UCHAR *Meta = (UCHAR *)Context->data_meta;
+    INT64 MetaLength;
+
+    if (XdpMd->BufferStart == NULL) {
+        return -1;
+    }
+
+    MetaLength = ((UCHAR *)Context->data - Meta) - Delta;
+
+    if ((Meta - XdpMd->BufferStart) + Delta < 0 ||
+        MetaLength < 0 || MetaLength > XDP_EBPF_MAX_META_LENGTH ||
+        (MetaLength % XDP_EBPF_META_ALIGNMENT) != 0) {
+        return -1;
+    }
+
+    Context->data_meta = (UINT64)(Meta + Delta);
+
+    return 0;
+}
+
+static
+int
+EbpfXdpRedirectXsk(
+    _In_ xdp_md_t *Context,
+    _In_ UINT64 Flags
+    )
+{
+    EBPF_XDP_MD *XdpMd = CONTAINING_RECORD(Context, EBPF_XDP_MD, Base);
+    int Action;
+
+    //
+    // XSKs register themselves as the XSK map entry of their RX queue, so the
+    // map is implicitly indexed by the RX queue of the frame. Like
+    // bpf_redirect_map, the lower bits of Flags specify the verdict returned
+    // if the map entry is empty.
+    //
+    if (XdpMd->InspectionContext->EbpfRedirectTarget != NULL) {
+        return XDP_EBPF_ACTION_REDIRECT;
+    }
+
+    Action = (int)(Flags & XDP_EBPF_REDIRECT_FALLBACK_MASK);
+    return (Action != 0) ? Action : XDP_DROP;
 }
 
 static const VOID *EbpfXdpHelperFunctions[] = {
     (VOID *)EbpfXdpAdjustHead,
+    (VOID *)EbpfXdpRedirectXsk,
+    (VOID *)EbpfXdpAdjustTail,
+    (VOID *)EbpfXdpAdjustMeta,
 };
 
 static const ebpf_helper_function_addresses_t XdpHelperFunctionAddresses = {
@@ -547,6 +1042,28 @@ static const NPI_MODULEID EbpfXdpHookProviderModuleId = {
 static EBPF_EXTENSION_PROVIDER *EbpfXdpProgramInfoProvider;
 static EBPF_EXTENSION_PROVIDER *EbpfXdpProgramHookProvider;
 
+static
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+XdpProgramCompileRule(
+    _Inout_ XDP_PROGRAM *Program,
+    _In_ UINT32 RuleIndex,
+    _In_ CONST XDP_RULE *Rule
+    )
+{
+    Program->Rules[RuleIndex] = *Rule;
+
+    if (Rule->Action == XDP_PROGRAM_ACTION_EBPF) {
+        //
+        // Rules are evaluated in binding order, so native rules bound ahead of
+        // an eBPF program filter the frames it is invoked on, and rules bound
+        // after it evaluate frames the eBPF program passes.
+        //
+        ASSERT(Program->EbpfTarget == NULL);
+        Program->EbpfTarget = Rule->Ebpf.Target;
+    }
+}
+
 static
 _IRQL_requires_max_(DISPATCH_LEVEL)
 VOID
@@ -561,6 +1078,8 @@ XdpProgramUpdateCompiledProgram(
 
     TraceEnter(TRACE_CORE, "Updating Program=%p on RxQueue=%p", Program, RxQueue);
 
+    Program->EbpfTarget = NULL;
+
     while (Entry != BindingListHead) {
         XDP_PROGRAM_BINDING *ProgramBinding =
             CONTAINING_RECORD(Entry, XDP_PROGRAM_BINDING, RxQueueEntry);
@@ -572,7 +1091,7 @@ XdpProgramUpdateCompiledProgram(
         XdpProgramTraceObject(BoundProgramObject);
 
         for (UINT32 i = 0; i < BoundProgramObject->Program.RuleCount; i++) {
-            Program->Rules[RuleIndex++] = BoundProgramObject->Program.Rules[i];
+            XdpProgramCompileRule(Program, RuleIndex++, &BoundProgramObject->Program.Rules[i]);
         }
 
         Entry = Entry->Flink;
@@ -602,7 +1121,9 @@ XdpProgramCompileNewProgram(
     LIST_ENTRY *BindingListHead = XdpRxQueueGetProgramBindingList(RxQueue);
     LIST_ENTRY *Entry = BindingListHead->Flink;
     UINT32 RuleCount = 0;
+    BOOLEAN HasEbpf = FALSE;
     XDP_PROGRAM *NewProgram;
+    SIZE_T RulesSize;
     SIZE_T AllocationSize;
 
     TraceEnter(TRACE_CORE, "Compiling new program on RxQueue=%p", RxQueue);
@@ -616,6 +1137,9 @@ XdpProgramCompileNewProgram(
         if (!NT_SUCCESS(Status)) {
             goto Exit;
         }
+        if (XdpProgramIsEbpf(&ProgramBinding->OwningProgram->Program)) {
+            HasEbpf = TRUE;
+        }
         Entry = Entry->Flink;
     }
 
@@ -628,22 +1152,38 @@ XdpProgramCompileNewProgram(
         goto Exit;
     }
 
-    Status = RtlSizeTMult(sizeof(XDP_RULE), RuleCount, &AllocationSize);
+    Status = RtlSizeTMult(sizeof(XDP_RULE), RuleCount, &RulesSize);
     if (!NT_SUCCESS(Status)) {
         goto Exit;
     }
 
-    Status = RtlSizeTAdd(FIELD_OFFSET(XDP_PROGRAM, Rules), AllocationSize, &AllocationSize);
+    Status = RtlSizeTAdd(FIELD_OFFSET(XDP_PROGRAM, Rules), RulesSize, &AllocationSize);
     if (!NT_SUCCESS(Status)) {
         goto Exit;
     }
 
+    if (HasEbpf) {
+        //
+        // Reserve scratch storage for linearizing fragmented frames after the
+        // rules. The storage remains valid if the program is later updated
+        // in-place.
+        //
+        Status = RtlSizeTAdd(AllocationSize, XDP_EBPF_FRAME_STORAGE_SIZE, &AllocationSize);
+        if (!NT_SUCCESS(Status)) {
+            goto Exit;
+        }
+    }
+
     NewProgram = ExAllocatePoolZero(NonPagedPoolNx, AllocationSize, XDP_POOLTAG_PROGRAM);
     if (NewProgram == NULL) {
         Status = STATUS_NO_MEMORY;
         goto Exit;
     }
 
+    if (HasEbpf) {
+        NewProgram->EbpfFrameStorage = RTL_PTR_ADD(NewProgram->Rules, RulesSize);
+    }
+
     Entry = BindingListHead->Flink;
     while (Entry != BindingListHead) {
         XDP_PROGRAM_BINDING *ProgramBinding =
@@ -656,7 +1196,8 @@ XdpProgramCompileNewProgram(
         XdpProgramTraceObject(BoundProgramObject);
 
         for (UINT32 i = 0; i < BoundProgramObject->Program.RuleCount; i++) {
-            NewProgram->Rules[NewProgram->RuleCount++] = BoundProgramObject->Program.Rules[i];
+            XdpProgramCompileRule(
+                NewProgram, NewProgram->RuleCount++, &BoundProgramObject->Program.Rules[i]);
         }
 
         Entry = Entry->Flink;
@@ -849,6 +1390,14 @@ XdpProgramIsEbpf(
     return Program->RuleCount == 1 && Program->Rules[0].Action == XDP_PROGRAM_ACTION_EBPF;
 }
 
+BOOLEAN
+XdpProgramHasEbpf(
+    _In_ XDP_PROGRAM *Program
+    )
+{
+    return Program->EbpfTarget != NULL;
+}
+
 BOOLEAN
 XdpProgramCanXskBypass(
     _In_ XDP_PROGRAM *Program,
@@ -972,6 +1521,70 @@ Exit:
     return Status;
 }
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+XdpProgramCreateFilter(
+    _In_ CONST XDP_RULE *Rules,
+    _In_ UINT32 RuleCount,
+    _In_ KPROCESSOR_MODE RequestorMode,
+    _Out_ XDP_PROGRAM **NewFilter
+    )
+{
+    NTSTATUS Status;
+    XDP_PROGRAM_OBJECT *ProgramObject = NULL;
+
+    TraceEnter(TRACE_CORE, "RuleCount=%u", RuleCount);
+
+    *NewFilter = NULL;
+
+    if (RuleCount == 0) {
+        Status = STATUS_INVALID_PARAMETER;
+        goto Exit;
+    }
+
+    Status = XdpCaptureProgram(Rules, RuleCount, RequestorMode, &ProgramObject);
+    if (!NT_SUCCESS(Status)) {
+        goto Exit;
+    }
+
+    for (UINT32 Index = 0; Index < RuleCount; Index++) {
+        //
+        // Filters only decide whether frames are delivered, so they cannot
+        // reference other objects.
+        //
+        if (ProgramObject->Program.Rules[Index].Action != XDP_PROGRAM_ACTION_PASS &&
+            ProgramObject->Program.Rules[Index].Action != XDP_PROGRAM_ACTION_DROP) {
+            Status = STATUS_INVALID_PARAMETER;
+            goto Exit;
+        }
+    }
+
+    TraceInfo(TRACE_CORE, "Created Filter=%p", &ProgramObject->Program);
+
+    *NewFilter = &ProgramObject->Program;
+    ProgramObject = NULL;
+    Status = STATUS_SUCCESS;
+
+Exit:
+
+    if (ProgramObject != NULL) {
+        XdpProgramDelete(ProgramObject);
+    }
+
+    TraceExitStatus(TRACE_CORE);
+
+    return Status;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+VOID
+XdpProgramDeleteFilter(
+    _In_ XDP_PROGRAM *Filter
+    )
+{
+    XdpProgramDelete(CONTAINING_RECORD(Filter, XDP_PROGRAM_OBJECT, Program));
+}
+
 static
 NTSTATUS
 XdpProgramValidateIfQueue(
@@ -1097,6 +1710,29 @@ XdpProgramBindingAttach(
 
                 break;
 
+            case XDP_REDIRECT_TARGET_TYPE_XSK_TAGGED:
+                Status = XskValidateDatapathHandle(Rule->TaggedRedirect.Target);
+                if (!NT_SUCCESS(Status)) {
+                    goto Exit;
+                }
+
+                break;
+
+            default:
+                break;
+            }
+        } else if (Rule->Action == XDP_PROGRAM_ACTION_MIRROR) {
+
+            switch (Rule->Mirror.TargetType) {
+
+            case XDP_REDIRECT_TARGET_TYPE_XSK:
+                Status = XskValidateDatapathHandle(Rule->Mirror.Target);
+                if (!NT_SUCCESS(Status)) {
+                    goto Exit;
+                }
+
+                break;
+
             default:
                 break;
             }
@@ -1106,11 +1742,11 @@ XdpProgramBindingAttach(
     XDP_PROGRAM *OldCompiledProgram = XdpRxQueueGetProgram(ProgramBinding->RxQueue);
 
     //
-    // Do not allow eBPF programs to be replaced or to replace existing
-    // programs.
+    // eBPF programs may be chained with rule programs, but each RX queue
+    // supports at most one eBPF program.
     //
     if (OldCompiledProgram != NULL &&
-        (XdpProgramIsEbpf(OldCompiledProgram) || XdpProgramIsEbpf(Program))) {
+        XdpProgramHasEbpf(OldCompiledProgram) && XdpProgramIsEbpf(Program)) {
         Status = STATUS_INVALID_DEVICE_STATE;
         goto Exit;
     }
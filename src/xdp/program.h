@@ -12,9 +12,39 @@ typedef struct _XDP_RX_QUEUE XDP_RX_QUEUE;
 
 typedef ebpf_execution_context_state_t XDP_INSPECTION_EBPF_CONTEXT;
 
+//
+// The rule index reported when no rule determined the verdict.
+//
+#define XDP_INSPECTION_RULE_INDEX_NONE MAXUINT32
+
 typedef struct _XDP_INSPECTION_CONTEXT {
     XDP_INSPECTION_EBPF_CONTEXT EbpfContext;
     XDP_REDIRECT_CONTEXT RedirectContext;
+
+    //
+    // The index of the rule that determined the verdict of the most recently
+    // inspected frame.
+    //
+    UINT32 MatchedRuleIndex;
+
+    //
+    // The optional XSK map entry of the queue, which eBPF programs redirect
+    // frames to. Updated on the data path execution context.
+    //
+    VOID *EbpfRedirectTarget;
+
+    //
+    // Set while an eBPF batch invocation is in progress.
+    //
+    BOOLEAN EbpfBatchActive;
+
+    //
+    // Set if the interface honors adjustments to the data of single-buffer
+    // frames, in which case the first buffer of every frame has at least
+    // Headroom bytes before its data.
+    //
+    BOOLEAN DataAdjustSupported;
+    UINT16 Headroom;
 } XDP_INSPECTION_CONTEXT;
 
 //
@@ -36,7 +66,50 @@ XDP_RX_INSPECT_ROUTINE(
     );
 
 XDP_RX_INSPECT_ROUTINE XdpInspect;
-XDP_RX_INSPECT_ROUTINE XdpInspectEbpf;
+
+//
+// The maximum number of frames inspected by each XdpInspectEbpfVector call.
+//
+#define XDP_EBPF_INVOKE_VECTOR_SIZE 16
+
+//
+// Inspects FrameCount consecutive frames, starting at the unmasked FrameIndex
+// and FragmentIndex ring positions, with a program consisting solely of an
+// eBPF program. The contexts of all frames are prepared before the eBPF
+// program is invoked on each frame in a tight loop. Frames are completed, and
+// therefore redirected, in ring order.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+XdpInspectEbpfVector(
+    _In_ XDP_PROGRAM *Program,
+    _In_ XDP_INSPECTION_CONTEXT *InspectionContext,
+    _In_ XDP_RING *FrameRing,
+    _In_ UINT32 FrameIndex,
+    _In_ UINT32 FrameCount,
+    _In_opt_ XDP_RING *FragmentRing,
+    _In_opt_ XDP_EXTENSION *FragmentExtension,
+    _In_ UINT32 FragmentIndex,
+    _In_ XDP_EXTENSION *VirtualAddressExtension,
+    _Out_writes_(FrameCount) XDP_RX_ACTION *Actions
+    );
+
+//
+// Invokes a program's eBPF program within an active eBPF batch. A PASS verdict
+// is not counted, allowing callers to continue evaluating chained rules.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+XDP_RX_ACTION
+XdpInvokeEbpf(
+    _In_ XDP_PROGRAM *Program,
+    _In_ XDP_INSPECTION_CONTEXT *InspectionContext,
+    _In_ XDP_FRAME *Frame,
+    _In_ UINT32 FrameIndex,
+    _In_opt_ XDP_RING *FragmentRing,
+    _In_opt_ XDP_EXTENSION *FragmentExtension,
+    _In_ UINT32 FragmentIndex,
+    _In_ XDP_EXTENSION *VirtualAddressExtension
+    );
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
 _Success_(return)
@@ -53,6 +126,22 @@ XdpInspectEbpfEndBatch(
     _Inout_ XDP_INSPECTION_CONTEXT *InspectionContext
     );
 
+//
+// Evaluates a filter created by XdpProgramCreateFilter on a frame. Returns TRUE
+// if the frame passes the filter.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+XdpInspectFilter(
+    _In_ XDP_PROGRAM *Filter,
+    _In_ XDP_RING *FrameRing,
+    _In_ UINT32 FrameIndex,
+    _In_opt_ XDP_RING *FragmentRing,
+    _In_opt_ XDP_EXTENSION *FragmentExtension,
+    _In_ UINT32 FragmentIndex,
+    _In_ XDP_EXTENSION *VirtualAddressExtension
+    );
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 VOID *
 XdpProgramGetXskBypassTarget(
@@ -69,12 +158,36 @@ XdpProgramIsEbpf(
     _In_ XDP_PROGRAM *Program
     );
 
+BOOLEAN
+XdpProgramHasEbpf(
+    _In_ XDP_PROGRAM *Program
+    );
+
 BOOLEAN
 XdpProgramCanXskBypass(
     _In_ XDP_PROGRAM *Program,
     _In_ XDP_RX_QUEUE *RxQueue
     );
 
+//
+// Creates a standalone program of PASS and DROP rules for filtering frames
+// outside of an RX queue's program.
+//
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+XdpProgramCreateFilter(
+    _In_ CONST XDP_RULE *Rules,
+    _In_ UINT32 RuleCount,
+    _In_ KPROCESSOR_MODE RequestorMode,
+    _Out_ XDP_PROGRAM **NewFilter
+    );
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+VOID
+XdpProgramDeleteFilter(
+    _In_ XDP_PROGRAM *Filter
+    );
+
 XDP_FILE_CREATE_ROUTINE XdpIrpCreateProgram;
 
 NTSTATUS
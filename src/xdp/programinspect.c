@@ -300,36 +300,35 @@ XdpParseFragmentedFrame(
     FragmentIndex--;
     FragmentCount = XdpGetFragmentExtension(Frame, FragmentExtension)->FragmentBufferCount;
 
-    if (!Cache->EthValid) {
-        XdpParseFragmentedEthernet(
-            Frame, &Buffer, &BufferDataOffset, &FragmentIndex, &FragmentCount, FragmentRing,
-            VirtualAddressExtension, Cache, Storage);
+    //
+    // Headers already found in the first buffer are parsed again: they are
+    // returned in place without a copy, and walking them advances the buffer
+    // offset to the first header that was not contiguous.
+    //
+    XdpParseFragmentedEthernet(
+        Frame, &Buffer, &BufferDataOffset, &FragmentIndex, &FragmentCount, FragmentRing,
+        VirtualAddressExtension, Cache, Storage);
 
-        if (!Cache->EthValid) {
-            return;
-        }
+    if (!Cache->EthValid) {
+        return;
     }
 
     if (Cache->EthHdr->Type == htons(ETHERNET_TYPE_IPV4)) {
-        if (!Cache->Ip4Valid) {
-            XdpParseFragmentedIp4(
-                Frame, &Buffer, &BufferDataOffset, &FragmentIndex, &FragmentCount, FragmentRing,
-                VirtualAddressExtension, Cache, Storage);
+        XdpParseFragmentedIp4(
+            Frame, &Buffer, &BufferDataOffset, &FragmentIndex, &FragmentCount, FragmentRing,
+            VirtualAddressExtension, Cache, Storage);
 
-            if (!Cache->Ip4Valid) {
-                return;
-            }
+        if (!Cache->Ip4Valid) {
+            return;
         }
         IpProto = Cache->Ip4Hdr->Protocol;
     } else if (Cache->EthHdr->Type == htons(ETHERNET_TYPE_IPV6)) {
-        if (!Cache->Ip6Valid) {
-            XdpParseFragmentedIp6(
-                Frame, &Buffer, &BufferDataOffset, &FragmentIndex, &FragmentCount, FragmentRing,
-                VirtualAddressExtension, Cache, Storage);
+        XdpParseFragmentedIp6(
+            Frame, &Buffer, &BufferDataOffset, &FragmentIndex, &FragmentCount, FragmentRing,
+            VirtualAddressExtension, Cache, Storage);
 
-            if (!Cache->Ip6Valid) {
-                return;
-            }
+        if (!Cache->Ip6Valid) {
+            return;
         }
         IpProto = Cache->Ip6Hdr->NextHeader;
     } else {
@@ -458,6 +457,9 @@ XdpParseFrame(
         }
 
         HeaderLength = TCP_HDR_LEN_TO_BYTES(((TCP_HDR *)&Va[Offset])->th_len);
+        if (HeaderLength < sizeof(*Cache->TcpHdr)) {
+            return;
+        }
         if (Buffer->DataLength < Offset + HeaderLength) {
             goto BufferTooSmall;
         }
@@ -582,6 +584,14 @@ XdpParseQuicHeaderPayload(
         }
         FrameCache->QuicCidLength =
             QuicHdr->LONG_HDR.DestCid[QuicHdr->LONG_HDR.DestCidLength];
+        //
+        // QUIC v1 limits connection IDs to 20 bytes; longer IDs would also not
+        // fit the storage used for headers spanning multiple buffers.
+        //
+        if (QuicHdr->LONG_HDR.DestCidLength > XDP_QUIC_MAX_CID_LENGTH ||
+            FrameCache->QuicCidLength > XDP_QUIC_MAX_CID_LENGTH) {
+            return FALSE;
+        }
         if (DataLength <
                 RTL_SIZEOF_THROUGH_FIELD(QUIC_HEADER_INVARIANT, LONG_HDR) +
                 QuicHdr->LONG_HDR.DestCidLength +
@@ -740,274 +750,300 @@ XdpL2Fwd(
     return XDP_RX_ACTION_TX;
 }
 
-_IRQL_requires_max_(DISPATCH_LEVEL)
-XDP_RX_ACTION
-XdpInspect(
-    _In_ XDP_PROGRAM *Program,
-    _In_ XDP_INSPECTION_CONTEXT *InspectionContext,
-    _In_ XDP_RING *FrameRing,
-    _In_ UINT32 FrameIndex,
+static
+FORCEINLINE
+BOOLEAN
+XdpInspectMatchRule(
+    _In_ CONST XDP_RULE *Rule,
+    _In_ XDP_FRAME *Frame,
     _In_opt_ XDP_RING *FragmentRing,
     _In_opt_ XDP_EXTENSION *FragmentExtension,
     _In_ UINT32 FragmentIndex,
-    _In_ XDP_EXTENSION *VirtualAddressExtension
+    _In_ XDP_EXTENSION *VirtualAddressExtension,
+    _Inout_ XDP_PROGRAM_FRAME_CACHE *FrameCache,
+    _Inout_ XDP_PROGRAM_FRAME_STORAGE *FrameStorage
     )
 {
-    XDP_RX_ACTION Action = XDP_RX_ACTION_PASS;
-    XDP_PROGRAM_FRAME_CACHE FrameCache;
-    XDP_FRAME *Frame;
     BOOLEAN Matched = FALSE;
-    XDP_PCW_RX_QUEUE *RxQueueStats = XdpRxQueueGetStatsFromInspectionContext(InspectionContext);
 
-    ASSERT(FrameIndex <= FrameRing->Mask);
-    ASSERT(
-        (FragmentRing == NULL && FragmentIndex == 0) ||
-        (FragmentRing && FragmentIndex <= FragmentRing->Mask));
+    switch (Rule->Match) {
+    case XDP_MATCH_ALL:
+        Matched = TRUE;
+        break;
 
-    XdpInitializeFrameCache(&FrameCache);
-    Frame = XdpRingGetElement(FrameRing, FrameIndex);
+    case XDP_MATCH_UDP:
+        if (!FrameCache->UdpCached) {
+            XdpParseFrame(
+                Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
+                FrameCache, FrameStorage);
+        }
+        if (FrameCache->UdpValid) {
+            Matched = TRUE;
+        }
+        break;
 
-    for (ULONG RuleIndex = 0; RuleIndex < Program->RuleCount; RuleIndex++) {
-        XDP_RULE *Rule = &Program->Rules[RuleIndex];
+    case XDP_MATCH_UDP_DST:
+        if (!FrameCache->UdpCached) {
+            XdpParseFrame(
+                Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
+                FrameCache, FrameStorage);
+        }
+        if (FrameCache->UdpValid &&
+            FrameCache->UdpHdr->uh_dport == Rule->Pattern.Port) {
+            Matched = TRUE;
+        }
+        break;
 
-        //
-        // Check the match conditions.
-        //
+    case XDP_MATCH_IPV4_DST_MASK:
+        if (!FrameCache->Ip4Cached) {
+            XdpParseFrame(
+                Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
+                FrameCache, FrameStorage);
+        }
+        if (FrameCache->Ip4Valid &&
+            Ipv4PrefixMatch(
+                &FrameCache->Ip4Hdr->DestinationAddress, &Rule->Pattern.IpMask.Address.Ipv4,
+                &Rule->Pattern.IpMask.Mask.Ipv4)) {
+            Matched = TRUE;
+        }
+        break;
 
-        switch (Rule->Match) {
-        case XDP_MATCH_ALL:
+    case XDP_MATCH_IPV6_DST_MASK:
+        if (!FrameCache->Ip6Cached) {
+            XdpParseFrame(
+                Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
+                FrameCache, FrameStorage);
+        }
+        if (FrameCache->Ip6Valid &&
+            Ipv6PrefixMatch(
+                &FrameCache->Ip6Hdr->DestinationAddress,
+                &Rule->Pattern.IpMask.Address.Ipv6,
+                &Rule->Pattern.IpMask.Mask.Ipv6)) {
             Matched = TRUE;
-            break;
+        }
+        break;
 
-        case XDP_MATCH_UDP:
-            if (!FrameCache.UdpCached) {
-                XdpParseFrame(
-                    Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
-                    &FrameCache, &Program->FrameStorage);
-            }
-            if (FrameCache.UdpValid) {
-                Matched = TRUE;
-            }
-            break;
+    case XDP_MATCH_QUIC_FLOW_SRC_CID:
+    case XDP_MATCH_QUIC_FLOW_DST_CID:
+        if (!FrameCache->UdpCached || !FrameCache->TransportPayloadCached) {
+            XdpParseFrame(
+                Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
+                FrameCache, FrameStorage);
+        }
 
-        case XDP_MATCH_UDP_DST:
-            if (!FrameCache.UdpCached) {
-                XdpParseFrame(
-                    Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
-                    &FrameCache, &Program->FrameStorage);
-            }
-            if (FrameCache.UdpValid &&
-                FrameCache.UdpHdr->uh_dport == Rule->Pattern.Port) {
-                Matched = TRUE;
-            }
+        if (!FrameCache->UdpValid || !FrameCache->TransportPayloadValid ||
+            FrameCache->UdpHdr->uh_dport != Rule->Pattern.QuicFlow.UdpPort) {
             break;
+        }
 
-        case XDP_MATCH_IPV4_DST_MASK:
-            if (!FrameCache.Ip4Cached) {
-                XdpParseFrame(
-                    Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
-                    &FrameCache, &Program->FrameStorage);
-            }
-            if (FrameCache.Ip4Valid &&
-                Ipv4PrefixMatch(
-                    &FrameCache.Ip4Hdr->DestinationAddress, &Rule->Pattern.IpMask.Address.Ipv4,
-                    &Rule->Pattern.IpMask.Mask.Ipv4)) {
-                Matched = TRUE;
-            }
-            break;
+        if (!FrameCache->QuicCached) {
+            XdpParseQuicHeader(
+                Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
+                &FrameCache->TransportPayload, FrameStorage, FrameCache);
+        }
 
-        case XDP_MATCH_IPV6_DST_MASK:
-            if (!FrameCache.Ip6Cached) {
-                XdpParseFrame(
-                    Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
-                    &FrameCache, &Program->FrameStorage);
-            }
-            if (FrameCache.Ip6Valid &&
-                Ipv6PrefixMatch(
-                    &FrameCache.Ip6Hdr->DestinationAddress,
-                    &Rule->Pattern.IpMask.Address.Ipv6,
-                    &Rule->Pattern.IpMask.Mask.Ipv6)) {
-                Matched = TRUE;
-            }
-            break;
+        if (FrameCache->QuicValid &&
+            QuicCidMatch(
+                Rule->Match,
+                FrameCache,
+                &Rule->Pattern.QuicFlow)) {
+            Matched = TRUE;
+        }
+        break;
 
-        case XDP_MATCH_QUIC_FLOW_SRC_CID:
-        case XDP_MATCH_QUIC_FLOW_DST_CID:
-            if (!FrameCache.UdpCached || !FrameCache.TransportPayloadCached) {
-                XdpParseFrame(
-                    Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
-                    &FrameCache, &Program->FrameStorage);
-            }
+    case XDP_MATCH_IPV4_UDP_TUPLE:
+    case XDP_MATCH_IPV6_UDP_TUPLE:
+        if (!FrameCache->UdpCached) {
+            XdpParseFrame(
+                Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
+                FrameCache, FrameStorage);
+        }
+        if (FrameCache->UdpValid &&
+            UdpTupleMatch(
+                Rule->Match,
+                FrameCache,
+                &Rule->Pattern.Tuple)) {
+            Matched = TRUE;
+        }
+        break;
 
-            if (!FrameCache.UdpValid || !FrameCache.TransportPayloadValid ||
-                FrameCache.UdpHdr->uh_dport != Rule->Pattern.QuicFlow.UdpPort) {
-                break;
-            }
+    case XDP_MATCH_UDP_PORT_SET:
+        if (!FrameCache->UdpCached) {
+            XdpParseFrame(
+                Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
+                FrameCache, FrameStorage);
+        }
+        if (FrameCache->UdpValid &&
+            XdpTestBit(Rule->Pattern.PortSet.PortSet, FrameCache->UdpHdr->uh_dport)) {
+            Matched = TRUE;
+        }
+        break;
 
-            if (!FrameCache.QuicCached) {
-                XdpParseQuicHeader(
-                    Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
-                    &FrameCache.TransportPayload, &Program->FrameStorage, &FrameCache);
-            }
+    case XDP_MATCH_IPV4_UDP_PORT_SET:
+        if (!FrameCache->UdpCached) {
+            XdpParseFrame(
+                Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
+                FrameCache, FrameStorage);
+        }
+        if (FrameCache->Ip4Valid &&
+            IN4_ADDR_EQUAL(
+                &FrameCache->Ip4Hdr->DestinationAddress,
+                &Rule->Pattern.IpPortSet.Address.Ipv4) &&
+            FrameCache->UdpValid &&
+            XdpTestBit(Rule->Pattern.IpPortSet.PortSet.PortSet, FrameCache->UdpHdr->uh_dport)) {
+            Matched = TRUE;
+        }
+        break;
 
-            if (FrameCache.QuicValid &&
-                QuicCidMatch(
-                    Rule->Match,
-                    &FrameCache,
-                    &Rule->Pattern.QuicFlow)) {
-                Matched = TRUE;
-            }
-            break;
+    case XDP_MATCH_IPV6_UDP_PORT_SET:
+        if (!FrameCache->UdpCached) {
+            XdpParseFrame(
+                Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
+                FrameCache, FrameStorage);
+        }
+        if (FrameCache->Ip6Valid &&
+            IN6_ADDR_EQUAL(
+                &FrameCache->Ip6Hdr->DestinationAddress,
+                &Rule->Pattern.IpPortSet.Address.Ipv6) &&
+            FrameCache->UdpValid &&
+            XdpTestBit(Rule->Pattern.IpPortSet.PortSet.PortSet, FrameCache->UdpHdr->uh_dport)) {
+            Matched = TRUE;
+        }
+        break;
 
-        case XDP_MATCH_IPV4_UDP_TUPLE:
-        case XDP_MATCH_IPV6_UDP_TUPLE:
-            if (!FrameCache.UdpCached) {
-                XdpParseFrame(
-                    Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
-                    &FrameCache, &Program->FrameStorage);
-            }
-            if (FrameCache.UdpValid &&
-                UdpTupleMatch(
-                    Rule->Match,
-                    &FrameCache,
-                    &Rule->Pattern.Tuple)) {
-                Matched = TRUE;
-            }
-            break;
+    case XDP_MATCH_IPV4_TCP_PORT_SET:
+        if (!FrameCache->TcpCached) {
+            XdpParseFrame(
+                Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
+                FrameCache, FrameStorage);
+        }
+        if (FrameCache->Ip4Valid &&
+            IN4_ADDR_EQUAL(
+                &FrameCache->Ip4Hdr->DestinationAddress,
+                &Rule->Pattern.IpPortSet.Address.Ipv4) &&
+            FrameCache->TcpValid &&
+            XdpTestBit(Rule->Pattern.IpPortSet.PortSet.PortSet, FrameCache->TcpHdr->th_dport)) {
+            Matched = TRUE;
+        }
+        break;
 
-        case XDP_MATCH_UDP_PORT_SET:
-            if (!FrameCache.UdpCached) {
-                XdpParseFrame(
-                    Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
-                    &FrameCache, &Program->FrameStorage);
-            }
-            if (FrameCache.UdpValid &&
-                XdpTestBit(Rule->Pattern.PortSet.PortSet, FrameCache.UdpHdr->uh_dport)) {
-                Matched = TRUE;
-            }
-            break;
+    case XDP_MATCH_IPV6_TCP_PORT_SET:
+        if (!FrameCache->TcpCached) {
+            XdpParseFrame(
+                Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
+                FrameCache, FrameStorage);
+        }
+        if (FrameCache->Ip6Valid &&
+            IN6_ADDR_EQUAL(
+                &FrameCache->Ip6Hdr->DestinationAddress,
+                &Rule->Pattern.IpPortSet.Address.Ipv6) &&
+            FrameCache->TcpValid &&
+            XdpTestBit(Rule->Pattern.IpPortSet.PortSet.PortSet, FrameCache->TcpHdr->th_dport)) {
+            Matched = TRUE;
+        }
+        break;
 
-        case XDP_MATCH_IPV4_UDP_PORT_SET:
-            if (!FrameCache.UdpCached) {
-                XdpParseFrame(
-                    Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
-                    &FrameCache, &Program->FrameStorage);
-            }
-            if (FrameCache.Ip4Valid &&
-                IN4_ADDR_EQUAL(
-                    &FrameCache.Ip4Hdr->DestinationAddress,
-                    &Rule->Pattern.IpPortSet.Address.Ipv4) &&
-                FrameCache.UdpValid &&
-                XdpTestBit(Rule->Pattern.IpPortSet.PortSet.PortSet, FrameCache.UdpHdr->uh_dport)) {
-                Matched = TRUE;
-            }
-            break;
+    case XDP_MATCH_TCP_DST:
+        if (!FrameCache->TcpCached) {
+            XdpParseFrame(
+                Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
+                FrameCache, FrameStorage);
+        }
+        if (FrameCache->TcpValid &&
+            FrameCache->TcpHdr->th_dport == Rule->Pattern.Port) {
+            Matched = TRUE;
+        }
+        break;
 
-        case XDP_MATCH_IPV6_UDP_PORT_SET:
-            if (!FrameCache.UdpCached) {
-                XdpParseFrame(
-                    Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
-                    &FrameCache, &Program->FrameStorage);
-            }
-            if (FrameCache.Ip6Valid &&
-                IN6_ADDR_EQUAL(
-                    &FrameCache.Ip6Hdr->DestinationAddress,
-                    &Rule->Pattern.IpPortSet.Address.Ipv6) &&
-                FrameCache.UdpValid &&
-                XdpTestBit(Rule->Pattern.IpPortSet.PortSet.PortSet, FrameCache.UdpHdr->uh_dport)) {
-                Matched = TRUE;
-            }
-            break;
+    case XDP_MATCH_TCP_QUIC_FLOW_SRC_CID:
+    case XDP_MATCH_TCP_QUIC_FLOW_DST_CID:
+        if (!FrameCache->TcpCached || !FrameCache->TransportPayloadCached) {
+            XdpParseFrame(
+                Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
+                FrameCache, FrameStorage);
+        }
 
-        case XDP_MATCH_IPV4_TCP_PORT_SET:
-            if (!FrameCache.TcpCached) {
-                XdpParseFrame(
-                    Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
-                    &FrameCache, &Program->FrameStorage);
-            }
-            if (FrameCache.Ip4Valid &&
-                IN4_ADDR_EQUAL(
-                    &FrameCache.Ip4Hdr->DestinationAddress,
-                    &Rule->Pattern.IpPortSet.Address.Ipv4) &&
-                FrameCache.TcpValid &&
-                XdpTestBit(Rule->Pattern.IpPortSet.PortSet.PortSet, FrameCache.TcpHdr->th_dport)) {
-                Matched = TRUE;
-            }
+        if (!FrameCache->TcpValid || !FrameCache->TransportPayloadValid ||
+            FrameCache->TcpHdr->th_dport != Rule->Pattern.QuicFlow.UdpPort) {
             break;
+        }
 
-        case XDP_MATCH_IPV6_TCP_PORT_SET:
-            if (!FrameCache.TcpCached) {
-                XdpParseFrame(
-                    Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
-                    &FrameCache, &Program->FrameStorage);
-            }
-            if (FrameCache.Ip6Valid &&
-                IN6_ADDR_EQUAL(
-                    &FrameCache.Ip6Hdr->DestinationAddress,
-                    &Rule->Pattern.IpPortSet.Address.Ipv6) &&
-                FrameCache.TcpValid &&
-                XdpTestBit(Rule->Pattern.IpPortSet.PortSet.PortSet, FrameCache.TcpHdr->th_dport)) {
-                Matched = TRUE;
-            }
-            break;
+        if (!FrameCache->QuicCached) {
+            XdpParseQuicHeader(
+                Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
+                &FrameCache->TransportPayload, FrameStorage, FrameCache);
+        }
 
-        case XDP_MATCH_TCP_DST:
-            if (!FrameCache.TcpCached) {
-                XdpParseFrame(
-                    Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
-                    &FrameCache, &Program->FrameStorage);
-            }
-            if (FrameCache.TcpValid &&
-                FrameCache.TcpHdr->th_dport == Rule->Pattern.Port) {
-                Matched = TRUE;
-            }
-            break;
+        if (FrameCache->QuicValid &&
+            QuicCidMatch(
+                Rule->Match,
+                FrameCache,
+                &Rule->Pattern.QuicFlow)) {
+            Matched = TRUE;
+        }
+        break;
 
-        case XDP_MATCH_TCP_QUIC_FLOW_SRC_CID:
-        case XDP_MATCH_TCP_QUIC_FLOW_DST_CID:
-            if (!FrameCache.TcpCached || !FrameCache.TransportPayloadCached) {
-                XdpParseFrame(
-                    Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
-                    &FrameCache, &Program->FrameStorage);
-            }
+    case XDP_MATCH_TCP_CONTROL_DST:
+        if (!FrameCache->TcpCached) {
+            XdpParseFrame(
+                Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
+                FrameCache, FrameStorage);
+        }
+        if (FrameCache->TcpValid &&
+            FrameCache->TcpHdr->th_dport == Rule->Pattern.Port &&
+            (FrameCache->TcpHdr->th_flags & (TH_SYN | TH_FIN | TH_RST)) != 0) {
+            Matched = TRUE;
+        }
+        break;
 
-            if (!FrameCache.TcpValid || !FrameCache.TransportPayloadValid ||
-                FrameCache.TcpHdr->th_dport != Rule->Pattern.QuicFlow.UdpPort) {
-                break;
-            }
+    default:
+        ASSERT(FALSE);
+        break;
+    }
 
-            if (!FrameCache.QuicCached) {
-                XdpParseQuicHeader(
-                    Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
-                    &FrameCache.TransportPayload, &Program->FrameStorage, &FrameCache);
-            }
+    return Matched;
+}
 
-            if (FrameCache.QuicValid &&
-                QuicCidMatch(
-                    Rule->Match,
-                    &FrameCache,
-                    &Rule->Pattern.QuicFlow)) {
-                Matched = TRUE;
-            }
-            break;
+_IRQL_requires_max_(DISPATCH_LEVEL)
+XDP_RX_ACTION
+XdpInspect(
+    _In_ XDP_PROGRAM *Program,
+    _In_ XDP_INSPECTION_CONTEXT *InspectionContext,
+    _In_ XDP_RING *FrameRing,
+    _In_ UINT32 FrameIndex,
+    _In_opt_ XDP_RING *FragmentRing,
+    _In_opt_ XDP_EXTENSION *FragmentExtension,
+    _In_ UINT32 FragmentIndex,
+    _In_ XDP_EXTENSION *VirtualAddressExtension
+    )
+{
+    XDP_RX_ACTION Action = XDP_RX_ACTION_PASS;
+    XDP_PROGRAM_FRAME_CACHE FrameCache;
+    XDP_FRAME *Frame;
+    BOOLEAN Matched = FALSE;
+    BOOLEAN Mirrored = FALSE;
+    XDP_REDIRECT_METADATA Metadata = {0};
+    XDP_PCW_RX_QUEUE *RxQueueStats = XdpRxQueueGetStatsFromInspectionContext(InspectionContext);
 
-        case XDP_MATCH_TCP_CONTROL_DST:
-            if (!FrameCache.TcpCached) {
-                XdpParseFrame(
-                    Frame, FragmentRing, FragmentExtension, FragmentIndex, VirtualAddressExtension,
-                    &FrameCache, &Program->FrameStorage);
-            }
-            if (FrameCache.TcpValid &&
-                FrameCache.TcpHdr->th_dport == Rule->Pattern.Port &&
-                (FrameCache.TcpHdr->th_flags & (TH_SYN | TH_FIN | TH_RST)) != 0) {
-                Matched = TRUE;
-            }
-            break;
+    ASSERT(FrameIndex <= FrameRing->Mask);
+    ASSERT(
+        (FragmentRing == NULL && FragmentIndex == 0) ||
+        (FragmentRing && FragmentIndex <= FragmentRing->Mask));
 
-        default:
-            ASSERT(FALSE);
-            break;
-        }
+    XdpInitializeFrameCache(&FrameCache);
+    Frame = XdpRingGetElement(FrameRing, FrameIndex);
+
+    for (ULONG RuleIndex = 0; RuleIndex < Program->RuleCount; RuleIndex++) {
+        XDP_RULE *Rule = &Program->Rules[RuleIndex];
+
+        //
+        // Check the match conditions.
+        //
+
+        Matched =
+            XdpInspectMatchRule(
+                Rule, Frame, FragmentRing, FragmentExtension, FragmentIndex,
+                VirtualAddressExtension, &FrameCache, &Program->FrameStorage);
 
         if (Matched) {
             //
@@ -1016,21 +1052,77 @@ XdpInspect(
             switch (Rule->Action) {
 
             case XDP_PROGRAM_ACTION_REDIRECT:
-                XdpRedirect(
-                    &InspectionContext->RedirectContext, FrameIndex, FragmentIndex,
-                    Rule->Redirect.TargetType, Rule->Redirect.Target);
+                Metadata.RuleIndex = RuleIndex;
+                if (Rule->Redirect.TargetType == XDP_REDIRECT_TARGET_TYPE_XSK_TAGGED) {
+                    Metadata.Tag = Rule->TaggedRedirect.Tag;
+                    XdpRedirect(
+                        &InspectionContext->RedirectContext, FrameIndex, FragmentIndex,
+                        XDP_REDIRECT_TARGET_TYPE_XSK, Rule->TaggedRedirect.Target, &Metadata);
+                } else {
+                    Metadata.Tag = 0;
+                    XdpRedirect(
+                        &InspectionContext->RedirectContext, FrameIndex, FragmentIndex,
+                        Rule->Redirect.TargetType, Rule->Redirect.Target, &Metadata);
+                }
 
                 Action = XDP_RX_ACTION_DROP;
                 STAT_INC(RxQueueStats, InspectFramesRedirected);
                 break;
 
-            case XDP_PROGRAM_ACTION_EBPF:
+            case XDP_PROGRAM_ACTION_MIRROR:
+                Metadata.RuleIndex = RuleIndex;
+                Metadata.Tag = 0;
+                XdpMirror(
+                    &InspectionContext->RedirectContext, FrameIndex, FragmentIndex,
+                    Rule->Mirror.TargetType, Rule->Mirror.Target, Rule->Mirror.SnapLength,
+                    &Metadata);
+
+                STAT_INC(RxQueueStats, InspectFramesMirrored);
+
                 //
-                // Programs containing an eBPF action are expected to use the
-                // XdpInspectEbpf routine instead of XdpInspect.
+                // Mirroring is not a terminating action; continue evaluating
+                // the remaining rules.
                 //
-                ASSERT(FALSE);
-                __fallthrough;
+                Mirrored = TRUE;
+                Matched = FALSE;
+                continue;
+
+            case XDP_PROGRAM_ACTION_EBPF:
+                if (!InspectionContext->EbpfBatchActive) {
+                    //
+                    // The eBPF batch could not be started; drop the frame.
+                    //
+                    Action = XDP_RX_ACTION_DROP;
+                    STAT_INC(RxQueueStats, InspectFramesDropped);
+                    break;
+                }
+
+                if (Mirrored) {
+                    //
+                    // Deliver pending mirror copies before the eBPF program
+                    // can modify the frame.
+                    //
+                    XdpFlushRedirect(&InspectionContext->RedirectContext);
+                    Mirrored = FALSE;
+                }
+
+                Action =
+                    XdpInvokeEbpf(
+                        Program, InspectionContext, Frame, FrameIndex, FragmentRing,
+                        FragmentExtension, FragmentIndex, VirtualAddressExtension);
+
+                if (Action == XDP_RX_ACTION_PASS) {
+                    //
+                    // A PASS verdict defers to the remaining chained rules. The
+                    // eBPF program may have modified the frame, so discard any
+                    // cached headers.
+                    //
+                    XdpInitializeFrameCache(&FrameCache);
+                    Matched = FALSE;
+                    continue;
+                }
+
+                break;
 
             case XDP_PROGRAM_ACTION_DROP:
                 Action = XDP_RX_ACTION_DROP;
@@ -1043,6 +1135,14 @@ XdpInspect(
                 break;
 
             case XDP_PROGRAM_ACTION_L2FWD:
+                if (Mirrored) {
+                    //
+                    // Deliver pending mirror copies before the frame headers
+                    // are rewritten in place.
+                    //
+                    XdpFlushRedirect(&InspectionContext->RedirectContext);
+                }
+
                 Action =
                     XdpL2Fwd(
                         Frame, FragmentRing, FragmentExtension, FragmentIndex,
@@ -1055,6 +1155,7 @@ XdpInspect(
                 break;
             }
 
+            InspectionContext->MatchedRuleIndex = RuleIndex;
             goto Done;
         }
     }
@@ -1064,12 +1165,55 @@ XdpInspect(
     //
     ASSERT(Action == XDP_RX_ACTION_PASS);
     STAT_INC(RxQueueStats, InspectFramesPassed);
+    InspectionContext->MatchedRuleIndex = XDP_INSPECTION_RULE_INDEX_NONE;
 
 Done:
 
     return Action;
 }
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+XdpInspectFilter(
+    _In_ XDP_PROGRAM *Filter,
+    _In_ XDP_RING *FrameRing,
+    _In_ UINT32 FrameIndex,
+    _In_opt_ XDP_RING *FragmentRing,
+    _In_opt_ XDP_EXTENSION *FragmentExtension,
+    _In_ UINT32 FragmentIndex,
+    _In_ XDP_EXTENSION *VirtualAddressExtension
+    )
+{
+    XDP_PROGRAM_FRAME_CACHE FrameCache;
+    XDP_FRAME *Frame;
+
+    ASSERT(FrameIndex <= FrameRing->Mask);
+    ASSERT(
+        (FragmentRing == NULL && FragmentIndex == 0) ||
+        (FragmentRing && FragmentIndex <= FragmentRing->Mask));
+
+    XdpInitializeFrameCache(&FrameCache);
+    Frame = XdpRingGetElement(FrameRing, FrameIndex);
+
+    for (UINT32 RuleIndex = 0; RuleIndex < Filter->RuleCount; RuleIndex++) {
+        CONST XDP_RULE *Rule = &Filter->Rules[RuleIndex];
+
+        if (XdpInspectMatchRule(
+                Rule, Frame, FragmentRing, FragmentExtension, FragmentIndex,
+                VirtualAddressExtension, &FrameCache, &Filter->FrameStorage)) {
+            ASSERT(
+                Rule->Action == XDP_PROGRAM_ACTION_PASS ||
+                Rule->Action == XDP_PROGRAM_ACTION_DROP);
+            return Rule->Action == XDP_PROGRAM_ACTION_PASS;
+        }
+    }
+
+    //
+    // Like XDP programs, pass frames that match no rule.
+    //
+    return TRUE;
+}
+
 //
 // Control path routines.
 //
@@ -1101,6 +1245,29 @@ XdpProgramDeleteRule(
             }
             break;
 
+        case XDP_REDIRECT_TARGET_TYPE_XSK_TAGGED:
+            if (Rule->TaggedRedirect.Target != NULL) {
+                XskDereferenceDatapathHandle(Rule->TaggedRedirect.Target);
+                Rule->TaggedRedirect.Target = NULL;
+            }
+            break;
+
+        default:
+            ASSERT(FALSE);
+        }
+    }
+
+    if (Rule->Action == XDP_PROGRAM_ACTION_MIRROR) {
+
+        switch (Rule->Mirror.TargetType) {
+
+        case XDP_REDIRECT_TARGET_TYPE_XSK:
+            if (Rule->Mirror.Target != NULL) {
+                XskDereferenceDatapathHandle(Rule->Mirror.Target);
+                Rule->Mirror.Target = NULL;
+            }
+            break;
+
         default:
             ASSERT(FALSE);
         }
@@ -1204,7 +1371,7 @@ XdpProgramValidateRule(
     }
 
     if (UserRule->Action < XDP_PROGRAM_ACTION_DROP ||
-        UserRule->Action > XDP_PROGRAM_ACTION_EBPF) {
+        UserRule->Action > XDP_PROGRAM_ACTION_MIRROR) {
         Status = STATUS_INVALID_PARAMETER;
         goto Exit;
     }
@@ -1226,6 +1393,14 @@ XdpProgramValidateRule(
                     &ValidatedRule->Redirect.Target);
             break;
 
+        case XDP_REDIRECT_TARGET_TYPE_XSK_TAGGED:
+            Status =
+                XskReferenceDatapathHandle(
+                    RequestorMode, &UserRule->TaggedRedirect.Target, TRUE,
+                    &ValidatedRule->TaggedRedirect.Target);
+            ValidatedRule->TaggedRedirect.Tag = UserRule->TaggedRedirect.Tag;
+            break;
+
         default:
             Status = STATUS_INVALID_PARAMETER;
             break;
@@ -1235,6 +1410,32 @@ XdpProgramValidateRule(
             goto Exit;
         }
 
+        ValidatedRule->Redirect.TargetType = UserRule->Redirect.TargetType;
+
+        break;
+
+    case XDP_PROGRAM_ACTION_MIRROR:
+        switch (UserRule->Mirror.TargetType) {
+
+        case XDP_REDIRECT_TARGET_TYPE_XSK:
+            Status =
+                XskReferenceDatapathHandle(
+                    RequestorMode, &UserRule->Mirror.Target, TRUE,
+                    &ValidatedRule->Mirror.Target);
+            break;
+
+        default:
+            Status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        if (!NT_SUCCESS(Status)) {
+            goto Exit;
+        }
+
+        ValidatedRule->Mirror.TargetType = UserRule->Mirror.TargetType;
+        ValidatedRule->Mirror.SnapLength = UserRule->Mirror.SnapLength;
+
         break;
 
     case XDP_PROGRAM_ACTION_EBPF:
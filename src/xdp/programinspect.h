@@ -97,6 +97,11 @@ typedef struct _XDP_PROGRAM_FRAME_CACHE {
     XDP_PROGRAM_PAYLOAD_CACHE TransportPayload;
 } XDP_PROGRAM_FRAME_CACHE;
 
+//
+// The maximum length of a fragmented frame that can be inspected by eBPF.
+//
+#define XDP_EBPF_FRAME_STORAGE_SIZE 0x4000
+
 #pragma warning(push)
 #pragma warning(disable:4324) // structure was padded due to alignment specifier
 
@@ -108,6 +113,17 @@ typedef struct _XDP_PROGRAM {
 
     DECLSPEC_CACHEALIGN
     UINT32 RuleCount;
+
+    //
+    // The eBPF program invoked by this compiled program's
+    // XDP_PROGRAM_ACTION_EBPF rule, if any.
+    //
+    HANDLE EbpfTarget;
+
+    //
+    // Scratch storage for linearizing fragmented frames passed to eBPF.
+    //
+    UCHAR *EbpfFrameStorage;
     XDP_RULE Rules[0];
 } XDP_PROGRAM;
 
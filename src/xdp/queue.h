@@ -53,6 +53,41 @@ XdpQueueDatapathSync(
     }
 }
 
+//
+// Data path cycle accounting. Only every Nth batch is timed, so the cost of
+// reading the processor cycle counter is amortized across unsampled batches.
+// The sample interval must be a power of two; zero disables sampling.
+//
+typedef struct _XDP_QUEUE_CYCLE_SAMPLER {
+    UINT32 BatchCount;
+    BOOLEAN Active;
+} XDP_QUEUE_CYCLE_SAMPLER;
+
+FORCEINLINE
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+XdpQueueCycleSamplerStartBatch(
+    _Inout_ XDP_QUEUE_CYCLE_SAMPLER *Sampler,
+    _In_ UINT32 SampleInterval
+    )
+{
+    ASSERT(SampleInterval == 0 || RTL_IS_POWER_OF_TWO(SampleInterval));
+
+    Sampler->Active =
+        SampleInterval != 0 && (++Sampler->BatchCount & (SampleInterval - 1)) == 0;
+
+    return Sampler->Active;
+}
+
+FORCEINLINE
+UINT64
+XdpQueueReadCycles(
+    VOID
+    )
+{
+    return ReadTimeStampCounter();
+}
+
 VOID
 XdpQueueSyncInitialize(
     _Out_ XDP_QUEUE_SYNC *Sync
@@ -40,14 +40,17 @@ XdpFlushRedirect(
     }
 }
 
-_IRQL_requires_max_(DISPATCH_LEVEL)
+static
+FORCEINLINE
 VOID
-XdpRedirect(
+XdpEnqueueRedirect(
     _In_ XDP_REDIRECT_CONTEXT *Redirect,
     _In_ UINT32 FrameIndex,
     _In_ UINT32 FragmentIndex,
     _In_ XDP_REDIRECT_TARGET_TYPE TargetType,
-    _In_ VOID *Target
+    _In_ VOID *Target,
+    _In_ UINT32 SnapLength,
+    _In_ CONST XDP_REDIRECT_METADATA *Metadata
     )
 {
     XDP_REDIRECT_BATCH *Batch = &Redirect->RedirectBatches[0];
@@ -55,6 +58,7 @@ XdpRedirect(
     if (Batch->Count > 0 &&
         (Batch->TargetType != TargetType ||
          Batch->Target != Target ||
+         Batch->SnapLength != SnapLength ||
          Batch->Count == RTL_NUMBER_OF(Batch->FrameIndexes))) {
         //
         // Flush the batch.
@@ -68,6 +72,7 @@ XdpRedirect(
         //
         Batch->TargetType = TargetType;
         Batch->Target = Target;
+        Batch->SnapLength = SnapLength;
         Batch->RxQueue = XdpRxQueueFromRedirectContext(Redirect);
     }
 
@@ -77,5 +82,43 @@ XdpRedirect(
     ASSERT(Batch->Count < RTL_NUMBER_OF(Batch->FrameIndexes));
     Batch->FrameIndexes[Batch->Count].FrameIndex = FrameIndex;
     Batch->FrameIndexes[Batch->Count].FragmentIndex = FragmentIndex;
+    Batch->FrameIndexes[Batch->Count].Metadata = *Metadata;
     Batch->Count++;
 }
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+XdpRedirect(
+    _In_ XDP_REDIRECT_CONTEXT *Redirect,
+    _In_ UINT32 FrameIndex,
+    _In_ UINT32 FragmentIndex,
+    _In_ XDP_REDIRECT_TARGET_TYPE TargetType,
+    _In_ VOID *Target,
+    _In_ CONST XDP_REDIRECT_METADATA *Metadata
+    )
+{
+    XdpEnqueueRedirect(
+        Redirect, FrameIndex, FragmentIndex, TargetType, Target, XDP_REDIRECT_SNAP_LENGTH_FULL,
+        Metadata);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+XdpMirror(
+    _In_ XDP_REDIRECT_CONTEXT *Redirect,
+    _In_ UINT32 FrameIndex,
+    _In_ UINT32 FragmentIndex,
+    _In_ XDP_REDIRECT_TARGET_TYPE TargetType,
+    _In_ VOID *Target,
+    _In_ UINT32 SnapLength,
+    _In_ CONST XDP_REDIRECT_METADATA *Metadata
+    )
+{
+    //
+    // Mirror copies share the redirect batches, so a full or backpressured
+    // target drops the copies without affecting the original frame.
+    //
+    XdpEnqueueRedirect(
+        Redirect, FrameIndex, FragmentIndex, TargetType, Target,
+        SnapLength == 0 ? XDP_REDIRECT_SNAP_LENGTH_FULL : SnapLength, Metadata);
+}
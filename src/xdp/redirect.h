@@ -7,15 +7,33 @@
 
 typedef struct _XDP_RX_QUEUE XDP_RX_QUEUE;
 
+#define XDP_REDIRECT_SNAP_LENGTH_FULL MAXUINT32
+
+//
+// Per-frame metadata delivered to redirect targets.
+//
+typedef struct _XDP_REDIRECT_METADATA {
+    UINT32 RuleIndex;
+    UINT32 Tag;
+    //
+    // The number of eBPF metadata bytes preceding the frame data, or 0 if the
+    // frame was not redirected by an eBPF program.
+    //
+    UINT8 EbpfMetaLength;
+    BOOLEAN Ebpf;
+} XDP_REDIRECT_METADATA;
+
 typedef struct _XDP_REDIRECT_FRAME {
     UINT32 FrameIndex;
     UINT32 FragmentIndex;
+    XDP_REDIRECT_METADATA Metadata;
 } XDP_REDIRECT_FRAME;
 
 typedef struct _XDP_REDIRECT_BATCH {
     VOID *Target;
     XDP_RX_QUEUE *RxQueue;
     XDP_REDIRECT_TARGET_TYPE TargetType;
+    UINT32 SnapLength;
     UINT32 Count;
     XDP_REDIRECT_FRAME FrameIndexes[32];
 } XDP_REDIRECT_BATCH;
@@ -31,7 +49,25 @@ XdpRedirect(
     _In_ UINT32 FrameIndex,
     _In_ UINT32 FragmentIndex,
     _In_ XDP_REDIRECT_TARGET_TYPE TargetType,
-    _In_ VOID *Target
+    _In_ VOID *Target,
+    _In_ CONST XDP_REDIRECT_METADATA *Metadata
+    );
+
+//
+// Enqueue a copy of a frame, truncated to SnapLength bytes, without consuming
+// the frame itself. A SnapLength of XDP_REDIRECT_SNAP_LENGTH_FULL copies the
+// entire frame.
+//
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+XdpMirror(
+    _In_ XDP_REDIRECT_CONTEXT *Redirect,
+    _In_ UINT32 FrameIndex,
+    _In_ UINT32 FragmentIndex,
+    _In_ XDP_REDIRECT_TARGET_TYPE TargetType,
+    _In_ VOID *Target,
+    _In_ UINT32 SnapLength,
+    _In_ CONST XDP_REDIRECT_METADATA *Metadata
     );
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
@@ -12,6 +12,9 @@ static XDP_REG_WATCHER_CLIENT_ENTRY XdpRxRegWatcherEntry;
 #define XDP_DEFAULT_RX_RING_SIZE 32
 static UINT32 XdpRxRingSize = XDP_DEFAULT_RX_RING_SIZE;
 
+#define XDP_DEFAULT_RX_CYCLE_SAMPLE_INTERVAL 64
+static UINT32 XdpRxCycleSampleInterval = XDP_DEFAULT_RX_CYCLE_SAMPLE_INTERVAL;
+
 typedef enum _XDP_RX_QUEUE_STATE {
     XdpRxQueueStateUnbound,
     XdpRxQueueStateActive,
@@ -55,11 +58,26 @@ typedef struct _XDP_RX_QUEUE {
     //
     XDP_INSPECTION_CONTEXT InspectionContext;
 
+    //
+    // The optional capture tap. Updated on the data path execution context.
+    //
+    VOID *CaptureTarget;
+
     //
     // Perf counters.
     //
     XDP_PCW_RX_QUEUE PcwStats;
 
+    //
+    // Data path cycle accounting. The counter snapshots are taken at the start
+    // of each sampled batch and used to trace the per-batch deltas.
+    //
+    XDP_QUEUE_CYCLE_SAMPLER CycleSampler;
+    UINT64 CycleSampledFramesStart;
+    UINT64 InspectCyclesStart;
+    UINT64 RedirectFlushCyclesStart;
+    UINT64 XskRxCopyCyclesStart;
+
     //
     // The pending data path / control path serialization callback.
     //
@@ -97,6 +115,16 @@ typedef struct _XDP_RX_QUEUE_SWAP_PROGRAM_PARAMS {
     XDP_PROGRAM *NewProgram;
 } XDP_RX_QUEUE_SWAP_PROGRAM_PARAMS;
 
+typedef struct _XDP_RX_QUEUE_SET_CAPTURE_PARAMS {
+    XDP_RX_QUEUE *RxQueue;
+    VOID *CaptureTarget;
+} XDP_RX_QUEUE_SET_CAPTURE_PARAMS;
+
+typedef struct _XDP_RX_QUEUE_SET_EBPF_REDIRECT_PARAMS {
+    XDP_RX_QUEUE *RxQueue;
+    VOID *RedirectTarget;
+} XDP_RX_QUEUE_SET_EBPF_REDIRECT_PARAMS;
+
 static
 XDP_RX_QUEUE *
 XdpRxQueueFromHandle(
@@ -120,8 +148,24 @@ XdpReceiveBatchStart(
     _In_ XDP_RX_QUEUE *RxQueue
     )
 {
+    XDP_PCW_RX_QUEUE *RxQueueStats = XdpRxQueueGetStats(RxQueue);
+
     XdbgEnterQueueEc(RxQueue);
-    STAT_INC(XdpRxQueueGetStats(RxQueue), InspectBatches);
+    STAT_INC(RxQueueStats, InspectBatches);
+
+    if (XdpRingCount(RxQueue->FrameRing) > 0) {
+        STAT_HISTOGRAM_INC(
+            RxQueueStats, InspectBatchSize, XdpRingCount(RxQueue->FrameRing),
+            XDP_PCW_BATCH_SIZE_FIRST_BUCKET_LIMIT_LOG2);
+    }
+
+    if (XdpQueueCycleSamplerStartBatch(&RxQueue->CycleSampler, XdpRxCycleSampleInterval)) {
+        STAT_INC(RxQueueStats, CycleSampledBatches);
+        RxQueue->CycleSampledFramesStart = RxQueueStats->CycleSampledFrames;
+        RxQueue->InspectCyclesStart = RxQueueStats->InspectCycles;
+        RxQueue->RedirectFlushCyclesStart = RxQueueStats->RedirectFlushCycles;
+        RxQueue->XskRxCopyCyclesStart = RxQueueStats->XskRxCopyCycles;
+    }
 }
 
 static
@@ -130,6 +174,18 @@ XdpReceiveBatchComplete(
     _In_ XDP_RX_QUEUE *RxQueue
     )
 {
+    if (RxQueue->CycleSampler.Active) {
+        XDP_PCW_RX_QUEUE *RxQueueStats = XdpRxQueueGetStats(RxQueue);
+
+        EventWriteRxQueueCycleSample(
+            &MICROSOFT_XDP_PROVIDER, RxQueue,
+            (UINT32)(RxQueueStats->CycleSampledFrames - RxQueue->CycleSampledFramesStart),
+            RxQueueStats->InspectCycles - RxQueue->InspectCyclesStart,
+            RxQueueStats->RedirectFlushCycles - RxQueue->RedirectFlushCyclesStart,
+            RxQueueStats->XskRxCopyCycles - RxQueue->XskRxCopyCyclesStart);
+        RxQueue->CycleSampler.Active = FALSE;
+    }
+
     XdbgExitQueueEc(RxQueue);
 }
 
@@ -142,7 +198,17 @@ XdppFlushReceive(
 {
     XDP_RING *FrameRing = RxQueue->FrameRing;
 
-    XdpFlushRedirect(&RxQueue->InspectionContext.RedirectContext);
+    if (RxQueue->CycleSampler.Active) {
+        UINT64 StartCycles = XdpQueueReadCycles();
+
+        XdpFlushRedirect(&RxQueue->InspectionContext.RedirectContext);
+
+        STAT_ADD(
+            XdpRxQueueGetStats(RxQueue), RedirectFlushCycles,
+            XdpQueueReadCycles() - StartCycles);
+    } else {
+        XdpFlushRedirect(&RxQueue->InspectionContext.RedirectContext);
+    }
 
     //
     // We've removed all references to the internally buffered frames, so
@@ -175,6 +241,81 @@ XdpFlushReceive(
     XdbgExitQueueEc(RxQueue);
 }
 
+static
+_IRQL_requires_max_(DISPATCH_LEVEL)
+UINT32
+XdppReceiveGetFrameLength(
+    _In_ XDP_RX_QUEUE *RxQueue,
+    _In_ XDP_FRAME *Frame,
+    _In_ UINT32 FragmentIndex
+    )
+{
+    UINT32 FrameLength = Frame->Buffer.DataLength;
+
+    if (RxQueue->FragmentRing != NULL) {
+        XDP_FRAME_FRAGMENT *Fragment = XdpGetFragmentExtension(Frame, &RxQueue->FragmentExtension);
+
+        for (UINT32 Index = 0; Index < Fragment->FragmentBufferCount; Index++) {
+            XDP_BUFFER *Buffer =
+                XdpRingGetElement(
+                    RxQueue->FragmentRing, (FragmentIndex + Index) & RxQueue->FragmentRing->Mask);
+            FrameLength += Buffer->DataLength;
+        }
+    }
+
+    STAT_HISTOGRAM_INC(
+        XdpRxQueueGetStats(RxQueue), InspectFrameLength, FrameLength,
+        XDP_PCW_FRAME_LENGTH_FIRST_BUCKET_LIMIT_LOG2);
+
+    return FrameLength;
+}
+
+static
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+XdppReceiveCompleteFrame(
+    _In_ XDP_RX_QUEUE *RxQueue,
+    _In_opt_ VOID *CaptureTarget,
+    _In_ UINT32 FrameLength,
+    _In_ XDP_RX_ACTION Action,
+    _In_ UINT32 MatchedRuleIndex
+    )
+{
+    XDP_RING *FrameRing = RxQueue->FrameRing;
+    UINT32 FrameIndex = FrameRing->ConsumerIndex & FrameRing->Mask;
+    XDP_FRAME *Frame = XdpRingGetElement(FrameRing, FrameIndex);
+    XDP_FRAME_RX_ACTION *ActionExtension;
+
+    //
+    // Record the action of the frame at the consumer index and release the
+    // frame and its fragments from the rings.
+    //
+    ActionExtension = XdpGetRxActionExtension(Frame, &RxQueue->RxActionExtension);
+    ActionExtension->RxAction = Action;
+
+    if (CaptureTarget != NULL) {
+        UINT32 FragmentIndex = 0;
+
+        if (RxQueue->FragmentRing != NULL) {
+            FragmentIndex = RxQueue->FragmentRing->ConsumerIndex & RxQueue->FragmentRing->Mask;
+        }
+
+        XskCaptureFrame(
+            CaptureTarget, FrameIndex, FragmentIndex, FrameLength, Action, MatchedRuleIndex);
+    }
+
+    FrameRing->ConsumerIndex++;
+
+    if (RxQueue->FragmentRing != NULL) {
+        RxQueue->FragmentRing->ConsumerIndex +=
+            XdpGetFragmentExtension(Frame, &RxQueue->FragmentExtension)->FragmentBufferCount;
+    }
+
+#if DBG
+    RxQueue->FrameConsumerIndex = FrameRing->ConsumerIndex;
+#endif
+}
+
 static
 _IRQL_requires_max_(DISPATCH_LEVEL)
 VOID
@@ -184,6 +325,14 @@ XdppReceiveBatch(
     )
 {
     XDP_RING *FrameRing = RxQueue->FrameRing;
+    XDP_PCW_RX_QUEUE *RxQueueStats = XdpRxQueueGetStats(RxQueue);
+    VOID *CaptureTarget = RxQueue->CaptureTarget;
+    UINT64 StartCycles = 0;
+
+    if (RxQueue->CycleSampler.Active) {
+        STAT_ADD(RxQueueStats, CycleSampledFrames, XdpRingCount(FrameRing));
+        StartCycles = XdpQueueReadCycles();
+    }
 
     //
     // XdpReceive makes no assumptions on the number of elements queued at
@@ -194,36 +343,98 @@ XdppReceiveBatch(
     while (XdpRingCount(FrameRing) > 0) {
         UINT32 FrameIndex = FrameRing->ConsumerIndex & FrameRing->Mask;
         UINT32 FragmentIndex = 0;
-        XDP_FRAME *Frame;
         XDP_RX_ACTION Action;
-        XDP_FRAME_FRAGMENT *Fragment = NULL;
-        XDP_FRAME_RX_ACTION *ActionExtension;
-
-        Frame = XdpRingGetElement(FrameRing, FrameIndex);
+        UINT32 FrameLength;
 
         if (RxQueue->FragmentRing != NULL) {
             FragmentIndex = RxQueue->FragmentRing->ConsumerIndex & RxQueue->FragmentRing->Mask;
-            Fragment = XdpGetFragmentExtension(Frame, &RxQueue->FragmentExtension);
         }
 
+        FrameLength =
+            XdppReceiveGetFrameLength(
+                RxQueue, XdpRingGetElement(FrameRing, FrameIndex), FragmentIndex);
+
         Action =
             InspectRoutine(
                 RxQueue->Program, &RxQueue->InspectionContext, RxQueue->FrameRing, FrameIndex,
                 RxQueue->FragmentRing, &RxQueue->FragmentExtension, FragmentIndex,
                 &RxQueue->VirtualAddressExtension);
 
-        ActionExtension = XdpGetRxActionExtension(Frame, &RxQueue->RxActionExtension);
-        ActionExtension->RxAction = Action;
+        XdppReceiveCompleteFrame(
+            RxQueue, CaptureTarget, FrameLength, Action,
+            RxQueue->InspectionContext.MatchedRuleIndex);
+    }
 
-        FrameRing->ConsumerIndex++;
+    if (CaptureTarget != NULL) {
+        XskCaptureFlush(CaptureTarget);
+    }
 
-        if (RxQueue->FragmentRing != NULL) {
-            RxQueue->FragmentRing->ConsumerIndex += Fragment->FragmentBufferCount;
+    if (RxQueue->CycleSampler.Active) {
+        STAT_ADD(RxQueueStats, InspectCycles, XdpQueueReadCycles() - StartCycles);
+    }
+}
+
+static
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+XdppReceiveBatchEbpfVector(
+    _In_ XDP_RX_QUEUE *RxQueue
+    )
+{
+    XDP_RING *FrameRing = RxQueue->FrameRing;
+    XDP_RING *FragmentRing = RxQueue->FragmentRing;
+    XDP_PCW_RX_QUEUE *RxQueueStats = XdpRxQueueGetStats(RxQueue);
+    VOID *CaptureTarget = RxQueue->CaptureTarget;
+    XDP_RX_ACTION Actions[XDP_EBPF_INVOKE_VECTOR_SIZE];
+    UINT32 FrameLengths[XDP_EBPF_INVOKE_VECTOR_SIZE];
+    UINT64 StartCycles = 0;
+
+    if (RxQueue->CycleSampler.Active) {
+        STAT_ADD(RxQueueStats, CycleSampledFrames, XdpRingCount(FrameRing));
+        StartCycles = XdpQueueReadCycles();
+    }
+
+    //
+    // Inspect the ring in windows of frames, invoking the eBPF program on all
+    // frames of each window at once.
+    //
+    while (XdpRingCount(FrameRing) > 0) {
+        UINT32 FrameCount = min(XdpRingCount(FrameRing), XDP_EBPF_INVOKE_VECTOR_SIZE);
+        UINT32 FragmentIndex = (FragmentRing != NULL) ? FragmentRing->ConsumerIndex : 0;
+
+        for (UINT32 Index = 0; Index < FrameCount; Index++) {
+            XDP_FRAME *Frame =
+                XdpRingGetElement(
+                    FrameRing, (FrameRing->ConsumerIndex + Index) & FrameRing->Mask);
+
+            FrameLengths[Index] = XdppReceiveGetFrameLength(RxQueue, Frame, FragmentIndex);
+
+            if (FragmentRing != NULL) {
+                XDP_FRAME_FRAGMENT *Fragment =
+                    XdpGetFragmentExtension(Frame, &RxQueue->FragmentExtension);
+                FragmentIndex += Fragment->FragmentBufferCount;
+            }
         }
 
-#if DBG
-        RxQueue->FrameConsumerIndex = FrameRing->ConsumerIndex;
-#endif
+        XdpInspectEbpfVector(
+            RxQueue->Program, &RxQueue->InspectionContext, FrameRing, FrameRing->ConsumerIndex,
+            FrameCount, FragmentRing, &RxQueue->FragmentExtension,
+            (FragmentRing != NULL) ? FragmentRing->ConsumerIndex : 0,
+            &RxQueue->VirtualAddressExtension, Actions);
+
+        for (UINT32 Index = 0; Index < FrameCount; Index++) {
+            XdppReceiveCompleteFrame(
+                RxQueue, CaptureTarget, FrameLengths[Index], Actions[Index],
+                XDP_INSPECTION_RULE_INDEX_NONE);
+        }
+    }
+
+    if (CaptureTarget != NULL) {
+        XskCaptureFlush(CaptureTarget);
+    }
+
+    if (RxQueue->CycleSampler.Active) {
+        STAT_ADD(RxQueueStats, InspectCycles, XdpQueueReadCycles() - StartCycles);
     }
 }
 
@@ -255,7 +466,16 @@ XdpReceiveEbpf(
     XdpReceiveBatchStart(RxQueue);
 
     if (XdpInspectEbpfStartBatch(RxQueue->Program, &RxQueue->InspectionContext)) {
-        XdppReceiveBatch(RxQueue, XdpInspectEbpf);
+        //
+        // Programs consisting solely of an eBPF program bypass rule
+        // evaluation and invoke the eBPF program on vectors of frames;
+        // otherwise the eBPF program is invoked from within the chained rules.
+        //
+        if (XdpProgramIsEbpf(RxQueue->Program)) {
+            XdppReceiveBatchEbpfVector(RxQueue);
+        } else {
+            XdppReceiveBatch(RxQueue, XdpInspect);
+        }
         XdpInspectEbpfEndBatch(RxQueue->Program, &RxQueue->InspectionContext);
     } else {
         XdppReceiveBatch(RxQueue, XdpInspect);
@@ -335,8 +555,8 @@ static CONST XDP_RX_QUEUE_DISPATCH XdpRxExclusiveXskDispatch = {
 };
 
 //
-// This dispatch table optimizes the case with an eBPF program receiving all
-// traffic.
+// This dispatch table handles programs containing an eBPF program, invoking
+// the eBPF program in batches.
 //
 static CONST XDP_RX_QUEUE_DISPATCH XdpRxEbpfDispatch = {
     .Receive = XdpReceiveEbpf,
@@ -457,7 +677,32 @@ XdpRxQueueSetCapabilities(
     FRE_ASSERT(Capabilities->Header.Revision >= XDP_RX_CAPABILITIES_REVISION_1);
     FRE_ASSERT(Capabilities->Header.Size >= XDP_SIZEOF_RX_CAPABILITIES_REVISION_1);
 
-    RxQueue->InterfaceRxCapabilities = *Capabilities;
+    //
+    // Interfaces built against older headers may provide a smaller structure,
+    // so copy only the provided fields and leave the remainder disabled.
+    //
+    RtlZeroMemory(&RxQueue->InterfaceRxCapabilities, sizeof(RxQueue->InterfaceRxCapabilities));
+    RtlCopyMemory(
+        &RxQueue->InterfaceRxCapabilities, Capabilities,
+        min(Capabilities->Header.Size, sizeof(RxQueue->InterfaceRxCapabilities)));
+
+    if (Capabilities->Header.Revision < XDP_RX_CAPABILITIES_REVISION_2 ||
+        Capabilities->Header.Size < XDP_SIZEOF_RX_CAPABILITIES_REVISION_2) {
+        RxQueue->InterfaceRxCapabilities.DataAdjustSupported = FALSE;
+        RxQueue->InterfaceRxCapabilities.Headroom = 0;
+    }
+
+    TraceInfo(
+        TRACE_CORE, "RxQueue=%p DataAdjustSupported=%u Headroom=%u",
+        RxQueue, RxQueue->InterfaceRxCapabilities.DataAdjustSupported,
+        RxQueue->InterfaceRxCapabilities.Headroom);
+
+    //
+    // Data adjustments are applied by eBPF helpers on the data path.
+    //
+    RxQueue->InspectionContext.DataAdjustSupported =
+        RxQueue->InterfaceRxCapabilities.DataAdjustSupported;
+    RxQueue->InspectionContext.Headroom = RxQueue->InterfaceRxCapabilities.Headroom;
 
     //
     // XDP programs require a system virtual address. Ensure the driver has
@@ -627,25 +872,17 @@ XdppRxQueueGetHookId(
     return &RxQueue->Key.HookId;
 }
 
-static CONST XDP_RX_QUEUE_CONFIG_RESERVED XdpRxConfigReservedDispatch = {
-    .Header                         = {
-        .Revision                   = XDP_RX_QUEUE_CONFIG_RESERVED_REVISION_1,
-        .Size                       = XDP_SIZEOF_RX_QUEUE_CONFIG_RESERVED_REVISION_1,
-    },
-    .GetHookId                      = XdppRxQueueGetHookId,
-};
-
 static CONST XDP_RX_QUEUE_CONFIG_CREATE_DISPATCH XdpRxConfigCreateDispatch = {
     .Header                     = {
-        .Revision               = XDP_RX_QUEUE_CONFIG_CREATE_DISPATCH_REVISION_1,
-        .Size                   = XDP_SIZEOF_RX_QUEUE_CONFIG_CREATE_DISPATCH_REVISION_1
+        .Revision               = XDP_RX_QUEUE_CONFIG_CREATE_DISPATCH_REVISION_2,
+        .Size                   = XDP_SIZEOF_RX_QUEUE_CONFIG_CREATE_DISPATCH_REVISION_2
     },
-    .Reserved                   = &XdpRxConfigReservedDispatch,
     .GetTargetQueueInfo         = XdpRxQueueGetTargetQueueInfo,
     .SetRxQueueCapabilities     = XdpRxQueueSetCapabilities,
     .RegisterExtensionVersion   = XdpRxQueueRegisterExtensionVersion,
     .SetRxDescriptorContexts    = XdpRxQueueSetDescriptorContexts,
     .SetPollInfo                = XdpRxQueueSetPollInfo,
+    .GetHookId                  = XdppRxQueueGetHookId,
 };
 
 static CONST XDP_RX_QUEUE_CONFIG_ACTIVATE_DISPATCH XdpRxConfigActivateDispatch = {
@@ -748,9 +985,10 @@ XdpRxQueueUpdateDispatch(
     // scenarios, otherwise falls back to the common code path.
     //
 
-    if (XdpProgramIsEbpf(RxQueue->Program)) {
+    if (XdpProgramHasEbpf(RxQueue->Program)) {
         RxQueue->Dispatch = XdpRxEbpfDispatch;
-    } else if (XdpProgramCanXskBypass(RxQueue->Program, RxQueue) && !XdpFaultInject()) {
+    } else if (RxQueue->CaptureTarget == NULL &&
+        XdpProgramCanXskBypass(RxQueue->Program, RxQueue) && !XdpFaultInject()) {
         RxQueue->Dispatch = XdpRxExclusiveXskDispatch;
     } else {
         RxQueue->Dispatch = XdpRxDispatch;
@@ -1235,6 +1473,112 @@ Exit:
     return Status;
 }
 
+static
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+XdpRxQueueSwapCapture(
+    _In_opt_ VOID *CallbackContext
+    )
+{
+    XDP_RX_QUEUE_SET_CAPTURE_PARAMS *Params = CallbackContext;
+
+    ASSERT(CallbackContext != NULL);
+
+    Params->RxQueue->CaptureTarget = Params->CaptureTarget;
+
+    //
+    // The exclusive XSK dispatch bypasses inspection, so it cannot be used
+    // while a capture tap is attached.
+    //
+    if (Params->RxQueue->Program != NULL) {
+        XdpRxQueueUpdateDispatch(Params->RxQueue);
+    }
+}
+
+NTSTATUS
+XdpRxQueueSetCaptureTarget(
+    _In_ XDP_RX_QUEUE *RxQueue,
+    _In_opt_ VOID *CaptureTarget
+    )
+{
+    NTSTATUS Status;
+    XDP_RX_QUEUE_SET_CAPTURE_PARAMS Params = {0};
+
+    TraceEnter(
+        TRACE_CORE, "RxQueue=%p CaptureTarget=%p OldCaptureTarget=%p",
+        RxQueue, CaptureTarget, RxQueue->CaptureTarget);
+
+    if (CaptureTarget != NULL && RxQueue->CaptureTarget != NULL) {
+        Status = STATUS_DUPLICATE_OBJECTID;
+        goto Exit;
+    }
+
+    //
+    // Swap the capture target on the data path execution context to ensure the
+    // old target is not touched after the swap is performed.
+    //
+    Params.RxQueue = RxQueue;
+    Params.CaptureTarget = CaptureTarget;
+    XdpRxQueueSync(RxQueue, XdpRxQueueSwapCapture, &Params);
+
+    Status = STATUS_SUCCESS;
+
+Exit:
+
+    TraceExitStatus(TRACE_CORE);
+    return Status;
+}
+
+static
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+XdpRxQueueSwapEbpfRedirect(
+    _In_opt_ VOID *CallbackContext
+    )
+{
+    XDP_RX_QUEUE_SET_EBPF_REDIRECT_PARAMS *Params = CallbackContext;
+
+    ASSERT(CallbackContext != NULL);
+
+    Params->RxQueue->InspectionContext.EbpfRedirectTarget = Params->RedirectTarget;
+}
+
+NTSTATUS
+XdpRxQueueSetEbpfRedirectTarget(
+    _In_ XDP_RX_QUEUE *RxQueue,
+    _In_opt_ VOID *RedirectTarget
+    )
+{
+    NTSTATUS Status;
+    XDP_RX_QUEUE_SET_EBPF_REDIRECT_PARAMS Params = {0};
+    VOID *OldRedirectTarget = RxQueue->InspectionContext.EbpfRedirectTarget;
+
+    TraceEnter(
+        TRACE_CORE, "RxQueue=%p RedirectTarget=%p OldRedirectTarget=%p",
+        RxQueue, RedirectTarget, OldRedirectTarget);
+
+    if (RedirectTarget != NULL && OldRedirectTarget != NULL) {
+        Status = STATUS_DUPLICATE_OBJECTID;
+        goto Exit;
+    }
+
+    //
+    // Swap the XSK map entry on the data path execution context to ensure the
+    // old target is neither invoked nor referenced by a pending redirect batch
+    // after the swap is performed.
+    //
+    Params.RxQueue = RxQueue;
+    Params.RedirectTarget = RedirectTarget;
+    XdpRxQueueSync(RxQueue, XdpRxQueueSwapEbpfRedirect, &Params);
+
+    Status = STATUS_SUCCESS;
+
+Exit:
+
+    TraceExitStatus(TRACE_CORE);
+    return Status;
+}
+
 LIST_ENTRY *
 XdpRxQueueGetProgramBindingList(
     _In_ XDP_RX_QUEUE *RxQueue
@@ -1275,6 +1619,14 @@ XdpRxQueueGetStats(
     return &RxQueue->PcwStats;
 }
 
+BOOLEAN
+XdpRxQueueIsCycleSampleBatch(
+    _In_ XDP_RX_QUEUE *RxQueue
+    )
+{
+    return RxQueue->CycleSampler.Active;
+}
+
 XDP_PCW_RX_QUEUE *
 XdpRxQueueGetStatsFromInspectionContext(
     _In_ const XDP_INSPECTION_CONTEXT *Context
@@ -1315,6 +1667,13 @@ XdpRxRegistryUpdate(
     } else {
         XdpRxRingSize = XDP_DEFAULT_RX_RING_SIZE;
     }
+
+    Status = XdpRegQueryDwordValue(XDP_PARAMETERS_KEY, L"XdpRxCycleSampleInterval", &Value);
+    if (NT_SUCCESS(Status) && (Value == 0 || RTL_IS_POWER_OF_TWO(Value))) {
+        XdpRxCycleSampleInterval = Value;
+    } else {
+        XdpRxCycleSampleInterval = XDP_DEFAULT_RX_CYCLE_SAMPLE_INTERVAL;
+    }
 }
 
 NTSTATUS
@@ -88,6 +88,29 @@ XdpRxQueueSetProgram(
     _In_opt_ VOID *ValidationContext
     );
 
+//
+// Attaches or detaches (CaptureTarget == NULL) the XSK capture tap of an RX
+// queue. At most one capture tap may be attached to each queue. This routine
+// must be called from the interface binding thread.
+//
+NTSTATUS
+XdpRxQueueSetCaptureTarget(
+    _In_ XDP_RX_QUEUE *RxQueue,
+    _In_opt_ VOID *CaptureTarget
+    );
+
+//
+// Attaches or detaches (RedirectTarget == NULL) the XSK map entry used by eBPF
+// programs to redirect frames from an RX queue. At most one XSK may be
+// attached to each queue. This routine must be called from the interface
+// binding thread.
+//
+NTSTATUS
+XdpRxQueueSetEbpfRedirectTarget(
+    _In_ XDP_RX_QUEUE *RxQueue,
+    _In_opt_ VOID *RedirectTarget
+    );
+
 XDP_RX_QUEUE *
 XdpRxQueueFromRedirectContext(
     _In_ XDP_REDIRECT_CONTEXT *RedirectContext
@@ -128,6 +151,11 @@ XdpRxQueueGetStats(
     _In_ XDP_RX_QUEUE *RxQueue
     );
 
+BOOLEAN
+XdpRxQueueIsCycleSampleBatch(
+    _In_ XDP_RX_QUEUE *RxQueue
+    );
+
 XDP_PCW_RX_QUEUE *
 XdpRxQueueGetStatsFromInspectionContext(
     _In_ const XDP_INSPECTION_CONTEXT *Context
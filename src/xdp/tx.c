@@ -15,6 +15,9 @@ static XDP_REG_WATCHER_CLIENT_ENTRY XdpTxRegWatcherEntry;
 #define XDP_DEFAULT_TX_RING_SIZE 32
 static UINT32 XdpTxRingSize = XDP_DEFAULT_TX_RING_SIZE;
 
+#define XDP_DEFAULT_TX_CYCLE_SAMPLE_INTERVAL 64
+static UINT32 XdpTxCycleSampleInterval = XDP_DEFAULT_TX_CYCLE_SAMPLE_INTERVAL;
+
 typedef struct _XDP_TX_QUEUE_KEY {
     XDP_HOOK_ID HookId;
     UINT32 QueueId;
@@ -64,6 +67,7 @@ typedef struct _XDP_TX_QUEUE {
     XDP_EXTENSION_SET *TxFrameCompletionExtensionSet;
     XDP_EXTENSION TxCompletionContextExtension;
     XDP_PCW_TX_QUEUE PcwStats;
+    XDP_QUEUE_CYCLE_SAMPLER CycleSampler;
     LIST_ENTRY ClientList;
     LIST_ENTRY *FillEntry;
     XDP_TX_QUEUE_DISPATCH Dispatch;
@@ -149,8 +153,10 @@ XdpTxQueueDatapathFill(
 {
     LIST_ENTRY *FirstEntry = TxQueue->FillEntry;
     XDP_RING *FrameRing = TxQueue->FrameRing;
+    XDP_PCW_TX_QUEUE *TxQueueStats = XdpTxQueueGetStats(TxQueue);
     UINT32 TxLimit = FrameRing->Mask + 1;
     UINT32 TxAvailable;
+    UINT32 ProducerIndex = FrameRing->ProducerIndex;
 
     if (TxQueue->CompletionRing == NULL) {
         TxAvailable = TxLimit - (FrameRing->ProducerIndex - FrameRing->Reserved);
@@ -183,7 +189,24 @@ NextEntry:
         }
     }
 
-    STAT_SET(XdpTxQueueGetStats(TxQueue), QueueDepth, TxLimit - TxAvailable);
+    if (FrameRing->ProducerIndex != ProducerIndex) {
+        STAT_HISTOGRAM_INC(
+            TxQueueStats, InjectionBatchSize, FrameRing->ProducerIndex - ProducerIndex,
+            XDP_PCW_BATCH_SIZE_FIRST_BUCKET_LIMIT_LOG2);
+
+        //
+        // Frames produced by XSK consist of a single buffer.
+        //
+        while (ProducerIndex != FrameRing->ProducerIndex) {
+            XDP_FRAME *Frame = XdpRingGetElement(FrameRing, ProducerIndex++ & FrameRing->Mask);
+
+            STAT_HISTOGRAM_INC(
+                TxQueueStats, InjectionFrameLength, Frame->Buffer.DataLength,
+                XDP_PCW_FRAME_LENGTH_FIRST_BUCKET_LIMIT_LOG2);
+        }
+    }
+
+    STAT_SET(TxQueueStats, QueueDepth, TxLimit - TxAvailable);
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
@@ -193,12 +216,32 @@ XdpFlushTransmit(
     )
 {
     XDP_TX_QUEUE *TxQueue = CONTAINING_RECORD(XdpTxQueue, XDP_TX_QUEUE, Dispatch);
+    XDP_PCW_TX_QUEUE *TxQueueStats = XdpTxQueueGetStats(TxQueue);
 
     XdbgEnterQueueEc(TxQueue);
-    STAT_INC(XdpTxQueueGetStats(TxQueue), InjectionBatches);
+    STAT_INC(TxQueueStats, InjectionBatches);
+
+    if (XdpQueueCycleSamplerStartBatch(&TxQueue->CycleSampler, XdpTxCycleSampleInterval)) {
+        UINT64 StartCycles = XdpQueueReadCycles();
+        UINT64 CompletionEndCycles;
+        UINT64 FillEndCycles;
 
-    XdpTxQueueDatapathComplete(TxQueue);
-    XdpTxQueueDatapathFill(TxQueue);
+        XdpTxQueueDatapathComplete(TxQueue);
+        CompletionEndCycles = XdpQueueReadCycles();
+        XdpTxQueueDatapathFill(TxQueue);
+        FillEndCycles = XdpQueueReadCycles();
+
+        STAT_INC(TxQueueStats, CycleSampledBatches);
+        STAT_ADD(TxQueueStats, CompletionCycles, CompletionEndCycles - StartCycles);
+        STAT_ADD(TxQueueStats, FillCycles, FillEndCycles - CompletionEndCycles);
+
+        EventWriteTxQueueCycleSample(
+            &MICROSOFT_XDP_PROVIDER, TxQueue, CompletionEndCycles - StartCycles,
+            FillEndCycles - CompletionEndCycles);
+    } else {
+        XdpTxQueueDatapathComplete(TxQueue);
+        XdpTxQueueDatapathFill(TxQueue);
+    }
 
     XdpQueueDatapathSync(&TxQueue->Sync);
 
@@ -655,14 +698,13 @@ static CONST XDP_TX_QUEUE_CONFIG_RESERVED XdpTxConfigReservedDispatch = {
         .Revision                   = XDP_TX_QUEUE_CONFIG_RESERVED_REVISION_1,
         .Size                       = XDP_SIZEOF_TX_QUEUE_CONFIG_RESERVED_REVISION_1
     },
-    .GetHookId                      = XdppTxQueueGetHookId,
     .GetNotifyHandle                = XdppTxQueueGetNotifyHandle,
 };
 
 static CONST XDP_TX_QUEUE_CONFIG_CREATE_DISPATCH XdpTxConfigCreateDispatch = {
     .Header                         = {
-        .Revision                   = XDP_TX_QUEUE_CONFIG_CREATE_DISPATCH_REVISION_1,
-        .Size                       = XDP_SIZEOF_TX_QUEUE_CONFIG_CREATE_DISPATCH_REVISION_1
+        .Revision                   = XDP_TX_QUEUE_CONFIG_CREATE_DISPATCH_REVISION_2,
+        .Size                       = XDP_SIZEOF_TX_QUEUE_CONFIG_CREATE_DISPATCH_REVISION_2
     },
     .Reserved                       = &XdpTxConfigReservedDispatch,
     .GetTargetQueueInfo             = XdpTxQueueGetTargetQueueInfo,
@@ -670,6 +712,7 @@ static CONST XDP_TX_QUEUE_CONFIG_CREATE_DISPATCH XdpTxConfigCreateDispatch = {
     .RegisterExtensionVersion       = XdpTxQueueRegisterExtensionVersion,
     .SetTxDescriptorContexts        = XdpTxQueueSetDescriptorContexts,
     .SetPollInfo                    = XdpTxQueueSetPollInfo,
+    .GetHookId                      = XdppTxQueueGetHookId,
 };
 
 static CONST XDP_TX_QUEUE_CONFIG_ACTIVATE_DISPATCH XdpTxConfigActivateDispatch = {
@@ -1325,6 +1368,13 @@ XdpTxRegistryUpdate(
     } else {
         XdpTxRingSize = XDP_DEFAULT_TX_RING_SIZE;
     }
+
+    Status = XdpRegQueryDwordValue(XDP_PARAMETERS_KEY, L"XdpTxCycleSampleInterval", &Value);
+    if (NT_SUCCESS(Status) && (Value == 0 || RTL_IS_POWER_OF_TWO(Value))) {
+        XdpTxCycleSampleInterval = Value;
+    } else {
+        XdpTxCycleSampleInterval = XDP_DEFAULT_TX_CYCLE_SAMPLE_INTERVAL;
+    }
 }
 
 NTSTATUS
@@ -83,6 +83,8 @@ typedef struct _XSK_RX_XDP {
     struct {
         UINT8 NotificationsRegistered : 1;
         UINT8 DatapathAttached : 1;
+        UINT8 CaptureAttached : 1;
+        UINT8 EbpfRedirectAttached : 1;
     } Flags;
 
     //
@@ -94,10 +96,39 @@ typedef struct _XSK_RX_XDP {
     XDP_RX_QUEUE_NOTIFICATION_ENTRY QueueNotificationEntry;
 } XSK_RX_XDP;
 
+//
+// Capture tap state. A socket is a capture tap if SampleInterval is non-zero.
+// The remaining fields are updated by the RX queue's data path.
+//
+typedef struct _XSK_RX_CAPTURE {
+    UINT32 SampleInterval;
+    UINT32 SnapLength;
+    UINT32 SampleCountdown;
+    UINT32 Attempted;
+    UINT32 FillConsumed;
+    UINT32 Produced;
+} XSK_RX_CAPTURE;
+
 typedef struct _XSK_RX {
     XSK_KERNEL_RING Ring;
     XSK_KERNEL_RING FillRing;
     XSK_RX_XDP Xdp;
+    XSK_RX_CAPTURE Capture;
+
+    //
+    // Set if the socket is the eBPF XSK map entry of its RX queue.
+    //
+    BOOLEAN EbpfRedirect;
+
+    //
+    // Set if XSK_RX_METADATA is written to the headroom of received frames.
+    //
+    BOOLEAN Metadata;
+
+    //
+    // The XSK_SOCKOPT_RX_FILTER filter evaluated before frames are received.
+    //
+    XDP_PROGRAM *Filter;
 } XSK_RX;
 
 typedef struct _XSK_TX_XDP {
@@ -136,14 +167,69 @@ typedef struct _XSK_TX_XDP {
     KEVENT OutstandingFlushComplete;
 } XSK_TX_XDP;
 
+//
+// The optional TX doorbell poller. While the poller is awake, the TX data path
+// records the need for a poke in NeedNotify rather than the shared ring flags,
+// and the poller pokes the interface once new TX descriptors are produced.
+//
+typedef struct _XSK_TX_DOORBELL_POLLER XSK_TX_DOORBELL_POLLER;
+
+typedef struct _XSK_TX_DOORBELL {
+    //
+    // Serializes queueing the socket to a poller with stopping the doorbell.
+    //
+    EX_PUSH_LOCK Lock;
+    //
+    // The poller the socket was last queued to, and its entry in the poller's
+    // socket list. Queued is set while the socket is on the list.
+    //
+    XSK_TX_DOORBELL_POLLER *Poller;
+    LIST_ENTRY Link;
+    UINT64 IdleTimeout;
+    UINT64 IdleStartTime;
+    UINT32 LastProducerIndex;
+    BOOLEAN Enabled;
+    BOOLEAN Queued;
+    BOOLEAN Awake;
+    BOOLEAN NeedNotify;
+    BOOLEAN Stop;
+} XSK_TX_DOORBELL;
+
 typedef struct _XSK_TX {
     XSK_KERNEL_RING Ring;
     XSK_KERNEL_RING CompletionRing;
     UMEM_BOUNCE Bounce;
     XSK_TX_XDP Xdp;
+    XSK_TX_DOORBELL Doorbell;
     DMA_ADAPTER *DmaAdapter;
 } XSK_TX;
 
+//
+// Extended statistics. Each counter is updated by a single serialized context
+// (the RX or TX data path, the socket spin lock or the poll lock), so no
+// interlocked operations are needed.
+//
+typedef struct _XSK_EXTENDED_STATISTICS {
+    UINT64 RxFillRingEmpty;
+    UINT64 RxRingFullDrops;
+    UINT64 TxCompletionRingFull;
+    UINT64 RxWakeups;
+    UINT64 TxWakeups;
+    UINT64 RxPokes;
+    UINT64 TxPokes;
+    UINT64 PollModeChanges;
+    UINT64 RxFiltered;
+} XSK_EXTENDED_STATISTICS;
+
+//
+// Socket polling mode settings, protected by the poll lock.
+//
+typedef struct _XSK_POLL_SOCKET_SETTINGS {
+    UINT32 RxQuota;
+    UINT32 TxQuota;
+    UINT32 MinReadyBatch;
+} XSK_POLL_SOCKET_SETTINGS;
+
 typedef struct _XSK {
     XDP_FILE_OBJECT_HEADER Header;
     XDP_REFERENCE_COUNT ReferenceCount;
@@ -155,15 +241,59 @@ typedef struct _XSK {
     UINT32 IoWaitFlags;
     XSK_IO_WAIT_FLAGS IoWaitInternalFlags;
     KEVENT IoWaitEvent;
+    EX_TIMER *IoWaitTimer;
+    KEVENT IoWaitTimerEvent;
     IRP *IoWaitIrp;
+    struct _XSK_NOTIFY_SET_MEMBER *NotifySetMember;
     XSK_STATISTICS Statistics;
+    XSK_EXTENDED_STATISTICS ExtendedStatistics;
     EX_PUSH_LOCK PollLock;
     XSK_POLL_MODE PollMode;
+    XSK_POLL_SOCKET_SETTINGS PollSocket;
     BOOLEAN PollBusy;
     ULONG PollWaiters;
     KEVENT PollRequested;
 } XSK;
 
+//
+// A notify set aggregates IO waits across many sockets. Each member is either
+// armed, with its socket's IoWaitFlags set; ready, on the set's ready list; or
+// waiting to be re-armed, on the set's rearm list. Members on the ready list
+// are returned by the next wait and then moved to the rearm list, so readiness
+// is re-evaluated on every wait.
+//
+typedef struct _XSK_NOTIFY_SET {
+    XDP_FILE_OBJECT_HEADER Header;
+    XDP_REFERENCE_COUNT ReferenceCount;
+
+    //
+    // Serializes membership changes with waits.
+    //
+    EX_PUSH_LOCK MemberLock;
+    LIST_ENTRY Members;
+
+    //
+    // Protects the member state lists and the wait state. This lock is
+    // acquired after the socket lock.
+    //
+    KSPIN_LOCK Lock;
+    LIST_ENTRY ReadyList;
+    LIST_ENTRY RearmList;
+    BOOLEAN WaitActive;
+    BOOLEAN Closing;
+    KEVENT WaitEvent;
+} XSK_NOTIFY_SET;
+
+typedef struct _XSK_NOTIFY_SET_MEMBER {
+    LIST_ENTRY Link;
+    LIST_ENTRY StateLink;
+    XSK_NOTIFY_SET *Set;
+    XSK *Xsk;
+    VOID *Context;
+    UINT32 WaitFlags;
+    UINT32 ReadyFlags;
+} XSK_NOTIFY_SET_MEMBER;
+
 typedef struct _XSK_BINDING_WORKITEM {
     XDP_BINDING_WORKITEM IfWorkItem;
     XSK *Xsk;
@@ -172,9 +302,34 @@ typedef struct _XSK_BINDING_WORKITEM {
     NTSTATUS CompletionStatus;
 } XSK_BINDING_WORKITEM;
 
+//
+// A TX doorbell poller is a system thread affinitized to one processor that
+// polls the TX rings of all sockets queued to it. Pollers are created on
+// demand for the ideal processor of each socket's TX ring and are shared by
+// all sockets with the same ideal processor.
+//
+typedef struct _XSK_TX_DOORBELL_POLLER {
+    //
+    // Protects the socket list. Held by the poller while it polls the sockets.
+    //
+    EX_PUSH_LOCK Lock;
+    LIST_ENTRY Sockets;
+    KEVENT WakeEvent;
+    PKTHREAD Thread;
+    UINT32 ProcessorIndex;
+    BOOLEAN Stop;
+} XSK_TX_DOORBELL_POLLER;
+
 typedef struct _XSK_GLOBALS {
     BOOLEAN DisableTxBounce;
     BOOLEAN RxZeroCopy;
+
+    //
+    // Serializes the creation of TX doorbell pollers, indexed by processor.
+    //
+    EX_PUSH_LOCK DoorbellPollersLock;
+    XSK_TX_DOORBELL_POLLER **DoorbellPollers;
+    UINT32 DoorbellPollerCount;
 } XSK_GLOBALS;
 
 static
@@ -182,13 +337,37 @@ NTSTATUS
 XskPoke(
     _In_ XSK *Xsk,
     _In_ UINT32 Flags,
-    _In_ UINT32 TimeoutMs
+    _In_ UINT64 Timeout
+    );
+
+static
+VOID
+XskNotifySetDetachSocket(
+    _In_ XSK *Xsk
+    );
+
+static
+_IRQL_requires_(PASSIVE_LEVEL)
+VOID
+XskTxDoorbellWake(
+    _In_ XSK *Xsk
+    );
+
+static
+_IRQL_requires_(PASSIVE_LEVEL)
+VOID
+XskTxDoorbellStop(
+    _In_ XSK *Xsk
     );
 
 #define POOLTAG_BOUNCE 'BksX' // XskB
 #define POOLTAG_RING   'RksX' // XskR
 #define POOLTAG_UMEM   'UksX' // XskU
 #define POOLTAG_XSK    'kksX' // Xskk
+#define POOLTAG_NOTIFY_SET 'NksX' // XskN
+#define POOLTAG_DOORBELL 'DksX' // XskD
+
+#define XSK_POLL_SOCKET_DEFAULT_QUOTA 256
 #define INFINITE 0xFFFFFFFF
 
 static XSK_GLOBALS XskGlobals;
@@ -201,6 +380,14 @@ static XDP_FILE_DISPATCH XskFileDispatch = {
     .Cleanup    = XskIrpCleanup,
     .Close      = XskIrpClose,
 };
+static XDP_FILE_IRP_ROUTINE XskNotifySetIrpDeviceIoControl;
+static XDP_FILE_IRP_ROUTINE XskNotifySetIrpCleanup;
+static XDP_FILE_IRP_ROUTINE XskNotifySetIrpClose;
+static XDP_FILE_DISPATCH XskNotifySetFileDispatch = {
+    .IoControl  = XskNotifySetIrpDeviceIoControl,
+    .Cleanup    = XskNotifySetIrpCleanup,
+    .Close      = XskNotifySetIrpClose,
+};
 
 static
 VOID
@@ -247,6 +434,24 @@ XskWaitInFlagsToOutFlags(
     return NotifyResult;
 }
 
+static
+_Requires_lock_held_(Member->Xsk->Lock)
+VOID
+XskNotifySetQueueReady(
+    _In_ XSK_NOTIFY_SET_MEMBER *Member,
+    _In_ UINT32 ReadyFlags
+    )
+{
+    XSK_NOTIFY_SET *Set = Member->Set;
+
+    KeAcquireSpinLockAtDpcLevel(&Set->Lock);
+    ASSERT(IsListEmpty(&Member->StateLink));
+    Member->ReadyFlags = ReadyFlags;
+    InsertTailList(&Set->ReadyList, &Member->StateLink);
+    (VOID)KeSetEvent(&Set->WaitEvent, IO_NETWORK_INCREMENT, FALSE);
+    KeReleaseSpinLockFromDpcLevel(&Set->Lock);
+}
+
 static
 VOID
 XskSignalReadyIo(
@@ -261,7 +466,21 @@ XskSignalReadyIo(
 
     KeAcquireSpinLock(&Xsk->Lock, &OldIrql);
     if ((Xsk->IoWaitFlags & ReadyFlags) != 0) {
-        if (Xsk->IoWaitIrp != NULL) {
+        if (Xsk->IoWaitFlags & ReadyFlags & XSK_NOTIFY_FLAG_WAIT_RX) {
+            Xsk->ExtendedStatistics.RxWakeups++;
+        }
+        if (Xsk->IoWaitFlags & ReadyFlags & XSK_NOTIFY_FLAG_WAIT_TX) {
+            Xsk->ExtendedStatistics.TxWakeups++;
+        }
+
+        if (Xsk->NotifySetMember != NULL) {
+            //
+            // Notify set members are disarmed until the next set wait.
+            //
+            XskNotifySetQueueReady(
+                Xsk->NotifySetMember, XskWaitInFlagsToOutFlags(Xsk->IoWaitFlags & ReadyFlags));
+            Xsk->IoWaitFlags = 0;
+        } else if (Xsk->IoWaitIrp != NULL) {
             Irp = Xsk->IoWaitIrp;
             Irp->IoStatus.Information = XskWaitInFlagsToOutFlags(Xsk->IoWaitFlags & ReadyFlags);
             Xsk->IoWaitIrp = NULL;
@@ -585,6 +804,30 @@ XskGetAvailableTxCompletion(
     return XskCompletionAvailable - Xsk->Tx.Xdp.OutstandingFrames;
 }
 
+static
+FORCEINLINE
+VOID
+XskTxSetNeedPoke(
+    _In_ XSK *Xsk
+    )
+{
+    //
+    // While the doorbell poller is awake, it pokes on behalf of the application
+    // so the need poke flag is kept private. Both this routine and the poller
+    // re-check the other's state after an interlocked update, so a poke cannot
+    // be lost while the poller goes to sleep.
+    //
+    if (ReadBooleanAcquire(&Xsk->Tx.Doorbell.Awake)) {
+        InterlockedExchange8((CHAR *)&Xsk->Tx.Doorbell.NeedNotify, TRUE);
+
+        if (ReadBooleanAcquire(&Xsk->Tx.Doorbell.Awake)) {
+            return;
+        }
+    }
+
+    InterlockedOr((LONG *)&Xsk->Tx.Ring.Shared->Flags, XSK_RING_FLAG_NEED_POKE);
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 UINT32
 XskFillTx(
@@ -599,6 +842,7 @@ XskFillTx(
     XSK_BUFFER_DESCRIPTOR *XskBuffer;
     UINT32 Count;
     UINT32 FrameCount = 0;
+    UINT64 FrameBytes = 0;
     UINT32 TxIndex;
     UINT32 XskCompletionAvailable;
     UINT32 XskTxAvailable;
@@ -617,7 +861,7 @@ XskFillTx(
     if (Xsk->Tx.Xdp.PollHandle == NULL &&
         ((XskRingConsPeek(&Xsk->Tx.Ring, 1) == 0 && Xsk->Tx.Xdp.OutstandingFrames == 0) ||
          (XskGetAvailableTxCompletion(Xsk) == 0))) {
-        InterlockedOr((LONG *)&Xsk->Tx.Ring.Shared->Flags, XSK_RING_FLAG_NEED_POKE);
+        XskTxSetNeedPoke(Xsk);
     }
 
     //
@@ -636,6 +880,10 @@ XskFillTx(
 
     Count = min(min(XdpTxAvailable, XskTxAvailable), XskCompletionAvailable);
 
+    if (XskCompletionAvailable < min(XdpTxAvailable, XskTxAvailable)) {
+        Xsk->ExtendedStatistics.TxCompletionRingFull++;
+    }
+
     for (ULONG i = 0; i < Count; i++) {
         XDP_FRAME *Frame;
         XDP_BUFFER *Buffer;
@@ -703,15 +951,24 @@ XskFillTx(
             CompletionContext->Context = &Xsk->Tx.Xdp.DatapathClientEntry;
         }
 
+        //
+        // Per-frame events are only enabled by the FrameDetail keyword; the
+        // batch event below summarizes the same information.
+        //
         EventWriteXskTxEnqueue(
             &MICROSOFT_XDP_PROVIDER, Xsk, Xsk->Tx.Ring.Shared->ConsumerIndex + i,
             FrameRing->ProducerIndex);
 
         FrameRing->ProducerIndex++;
         FrameCount++;
+        FrameBytes += Buffer->DataLength;
     }
 
     if (Count > 0) {
+        EventWriteXskTxEnqueueBatch(
+            &MICROSOFT_XDP_PROVIDER, Xsk, Xsk->Tx.Ring.Shared->ConsumerIndex, Count,
+            FrameRing->ProducerIndex - FrameCount, FrameCount, FrameBytes);
+
         XskRingConsRelease(&Xsk->Tx.Ring, Count);
         XskKernelRingUpdateIdealProcessor(&Xsk->Tx.Ring);
     }
@@ -725,6 +982,10 @@ XskFillTx(
         (Xsk->Tx.Ring.Shared->Flags & XSK_RING_FLAG_NEED_POKE)) {
         InterlockedAnd((LONG *)&Xsk->Tx.Ring.Shared->Flags, ~XSK_RING_FLAG_NEED_POKE);
     }
+    if (Xsk->Tx.Xdp.PollHandle == NULL && Xsk->Tx.Xdp.OutstandingFrames > 0 &&
+        Xsk->Tx.Doorbell.NeedNotify) {
+        InterlockedExchange8((CHAR *)&Xsk->Tx.Doorbell.NeedNotify, FALSE);
+    }
 
     return FrameCount;
 }
@@ -999,8 +1260,13 @@ XskIrpCreateSocket(
     Xsk->Tx.Xdp.HookId.SubLayer = XDP_HOOK_INJECT;
     KeInitializeSpinLock(&Xsk->Lock);
     KeInitializeEvent(&Xsk->IoWaitEvent, NotificationEvent, TRUE);
+    KeInitializeEvent(&Xsk->IoWaitTimerEvent, NotificationEvent, FALSE);
     KeInitializeEvent(&Xsk->PollRequested, SynchronizationEvent, FALSE);
     KeInitializeEvent(&Xsk->Tx.Xdp.OutstandingFlushComplete, NotificationEvent, FALSE);
+    ExInitializePushLock(&Xsk->Tx.Doorbell.Lock);
+    Xsk->PollSocket.RxQuota = XSK_POLL_SOCKET_DEFAULT_QUOTA;
+    Xsk->PollSocket.TxQuota = XSK_POLL_SOCKET_DEFAULT_QUOTA;
+    Xsk->PollSocket.MinReadyBatch = 1;
 
     IrpSp->FileObject->FsContext = Xsk;
 
@@ -1477,6 +1743,7 @@ XskSetPollMode(
     )
 {
     NTSTATUS Status = STATUS_SUCCESS;
+    XSK_POLL_MODE OldPollMode = Xsk->PollMode;
 
     if (Xsk->State != XskActive && PollMode != XSK_POLL_MODE_DEFAULT) {
         Status = STATUS_INVALID_DEVICE_STATE;
@@ -1536,6 +1803,10 @@ XskSetPollMode(
 
 Exit:
 
+    if (NT_SUCCESS(Status) && PollMode != OldPollMode) {
+        Xsk->ExtendedStatistics.PollModeChanges++;
+    }
+
     return Status;
 }
 
@@ -1673,7 +1944,7 @@ XskValidateDatapathHandle(
         return STATUS_INVALID_DEVICE_STATE;
     }
 
-    if (Xsk->Rx.Xdp.Queue == NULL) {
+    if (Xsk->Rx.Xdp.Queue == NULL || Xsk->Rx.Capture.SampleInterval != 0) {
         return STATUS_NOT_SUPPORTED;
     }
 
@@ -1700,6 +1971,14 @@ XskCanBypass(
         return FALSE;
     }
 
+    //
+    // The bypass path neither tracks the matching rule of each frame nor
+    // filters frames.
+    //
+    if (Xsk->Rx.Metadata || Xsk->Rx.Filter != NULL) {
+        return FALSE;
+    }
+
     return TRUE;
 }
 
@@ -1729,7 +2008,6 @@ XskIrpCleanup(
 
     KeAcquireSpinLock(&Xsk->Lock, &OldIrql);
     Xsk->State = XskClosing;
-    IoWaitFlags = Xsk->IoWaitFlags;
     KeReleaseSpinLock(&Xsk->Lock, OldIrql);
 
     //
@@ -1739,6 +2017,18 @@ XskIrpCleanup(
 
     XskReleasePollLock(Xsk);
 
+    //
+    // Closing sockets cannot be added to a notify set or start a TX doorbell
+    // poller, so both can now be torn down for good. The poller pokes under
+    // the poll lock, so it is stopped after the lock is released.
+    //
+    XskNotifySetDetachSocket(Xsk);
+    XskTxDoorbellStop(Xsk);
+
+    KeAcquireSpinLock(&Xsk->Lock, &OldIrql);
+    IoWaitFlags = Xsk->IoWaitFlags;
+    KeReleaseSpinLock(&Xsk->Lock, OldIrql);
+
     if (IoWaitFlags != 0) {
         XskSignalReadyIo(Xsk, IoWaitFlags);
     }
@@ -1911,6 +2201,16 @@ XskDetachRxIf(
     TraceEnter(TRACE_XSK, "Xsk=%p", Xsk);
 
     if (Xsk->Rx.Xdp.Queue != NULL) {
+        if (Xsk->Rx.Xdp.Flags.CaptureAttached) {
+            XdpRxQueueSetCaptureTarget(Xsk->Rx.Xdp.Queue, NULL);
+            Xsk->Rx.Xdp.Flags.CaptureAttached = FALSE;
+        }
+
+        if (Xsk->Rx.Xdp.Flags.EbpfRedirectAttached) {
+            XdpRxQueueSetEbpfRedirectTarget(Xsk->Rx.Xdp.Queue, NULL);
+            Xsk->Rx.Xdp.Flags.EbpfRedirectAttached = FALSE;
+        }
+
         if (Xsk->Rx.Xdp.Flags.NotificationsRegistered) {
             XdpRxQueueSync(Xsk->Rx.Xdp.Queue, XskRxSyncDetach, Xsk);
             XdpRxQueueDeregisterNotifications(Xsk->Rx.Xdp.Queue, &Xsk->Rx.Xdp.QueueNotificationEntry);
@@ -2098,6 +2398,32 @@ XskBindRxIf(
         goto Exit;
     }
 
+    if (Xsk->Rx.Capture.SampleInterval != 0) {
+        //
+        // Attach the capture tap now, while failure is still reversible. The
+        // tap remains inert until activation attaches the socket's data path.
+        //
+        Status = XdpRxQueueSetCaptureTarget(Xsk->Rx.Xdp.Queue, Xsk);
+        if (!NT_SUCCESS(Status)) {
+            goto Exit;
+        }
+
+        Xsk->Rx.Xdp.Flags.CaptureAttached = TRUE;
+    }
+
+    if (Xsk->Rx.EbpfRedirect) {
+        //
+        // Like capture taps, the XSK map entry is attached at bind time and
+        // frames are delivered once activation attaches the data path.
+        //
+        Status = XdpRxQueueSetEbpfRedirectTarget(Xsk->Rx.Xdp.Queue, Xsk);
+        if (!NT_SUCCESS(Status)) {
+            goto Exit;
+        }
+
+        Xsk->Rx.Xdp.Flags.EbpfRedirectAttached = TRUE;
+    }
+
     Status = STATUS_SUCCESS;
 
 Exit:
@@ -2428,11 +2754,19 @@ XskIrpClose(
         XskDereferenceUmem(Xsk->Umem);
     }
 
+    if (Xsk->Rx.Filter != NULL) {
+        XdpProgramDeleteFilter(Xsk->Rx.Filter);
+    }
+
     XskFreeRing(&Xsk->Rx.Ring);
     XskFreeRing(&Xsk->Rx.FillRing);
     XskFreeRing(&Xsk->Tx.Ring);
     XskFreeRing(&Xsk->Tx.CompletionRing);
 
+    if (Xsk->IoWaitTimer != NULL) {
+        ExDeleteTimer(Xsk->IoWaitTimer, TRUE, TRUE, NULL);
+    }
+
     XskDereference(Xsk);
 
     EventWriteXskCloseSocketStop(&MICROSOFT_XDP_PROVIDER, Xsk);
@@ -2477,6 +2811,23 @@ XskIrpBindSocket(
         goto Exit;
     }
 
+    //
+    // Capture taps only support RX.
+    //
+    if (Xsk->Rx.Capture.SampleInterval != 0 &&
+        (Bind.Flags & (XSK_BIND_FLAG_RX | XSK_BIND_FLAG_TX)) != XSK_BIND_FLAG_RX) {
+        Status = STATUS_INVALID_PARAMETER;
+        goto Exit;
+    }
+
+    //
+    // eBPF redirect targets receive frames from their RX queue.
+    //
+    if (Xsk->Rx.EbpfRedirect && (Bind.Flags & XSK_BIND_FLAG_RX) == 0) {
+        Status = STATUS_INVALID_PARAMETER;
+        goto Exit;
+    }
+
     if (Bind.Flags & XSK_BIND_FLAG_GENERIC) {
         RequiredMode = XDP_INTERFACE_MODE_GENERIC;
         ModeFilter = &RequiredMode;
@@ -2663,6 +3014,17 @@ XskIrpActivateSocket(
         KeReleaseSpinLock(&Xsk->Lock, OldIrql);
         goto Exit;
     }
+    if (Xsk->Rx.Capture.SampleInterval != 0 &&
+        Xsk->Umem->Reg.ChunkSize - Xsk->Umem->Reg.Headroom < sizeof(XSK_CAPTURE_HEADER)) {
+        Status = STATUS_INVALID_DEVICE_STATE;
+        KeReleaseSpinLock(&Xsk->Lock, OldIrql);
+        goto Exit;
+    }
+    if (Xsk->Rx.Metadata && Xsk->Umem->Reg.Headroom < sizeof(XSK_RX_METADATA)) {
+        Status = STATUS_INVALID_DEVICE_STATE;
+        KeReleaseSpinLock(&Xsk->Lock, OldIrql);
+        goto Exit;
+    }
 
     Xsk->State = XskActivating;
     ActivateIfInitiated = TRUE;
@@ -2768,6 +3130,10 @@ Exit:
 
     KeReleaseSpinLock(&Xsk->Lock, OldIrql);
 
+    if (NT_SUCCESS(Status) && Xsk->Tx.Xdp.IfHandle != NULL) {
+        XskTxDoorbellWake(Xsk);
+    }
+
     TraceInfo(TRACE_XSK, "Xsk=%p Flags=%x Status=%!STATUS!", Xsk, Activate.Flags, Status);
 
     TraceExitStatus(TRACE_XSK);
@@ -2808,6 +3174,65 @@ Exit:
     return Status;
 }
 
+static
+NTSTATUS
+XskSockoptGetStatisticsEx(
+    _In_ XSK *Xsk,
+    _In_ IRP *Irp,
+    _In_ IO_STACK_LOCATION *IrpSp
+    )
+{
+    NTSTATUS Status;
+    XSK_STATISTICS_EX *Statistics;
+    UINT32 OutputBufferLength = IrpSp->Parameters.DeviceIoControl.OutputBufferLength;
+    UINT32 Revision;
+    UINT32 Size;
+
+    TraceEnter(TRACE_XSK, "Xsk=%p", Xsk);
+
+    if (OutputBufferLength >= XSK_SIZEOF_STATISTICS_EX_REVISION_2) {
+        Revision = XSK_STATISTICS_EX_REVISION_2;
+        Size = XSK_SIZEOF_STATISTICS_EX_REVISION_2;
+    } else if (OutputBufferLength >= XSK_SIZEOF_STATISTICS_EX_REVISION_1) {
+        Revision = XSK_STATISTICS_EX_REVISION_1;
+        Size = XSK_SIZEOF_STATISTICS_EX_REVISION_1;
+    } else {
+        Status = STATUS_INVALID_PARAMETER;
+        goto Exit;
+    }
+
+    Statistics = (XSK_STATISTICS_EX *)Irp->AssociatedIrp.SystemBuffer;
+    RtlZeroMemory(Statistics, Size);
+
+    Statistics->Header.Revision = Revision;
+    Statistics->Header.Size = Size;
+    Statistics->RxDropped = Xsk->Statistics.RxDropped;
+    Statistics->RxTruncated = Xsk->Statistics.RxTruncated;
+    Statistics->RxInvalidDescriptors = Xsk->Statistics.RxInvalidDescriptors;
+    Statistics->TxInvalidDescriptors = Xsk->Statistics.TxInvalidDescriptors;
+    Statistics->RxFillRingEmpty = Xsk->ExtendedStatistics.RxFillRingEmpty;
+    Statistics->RxRingFullDrops = Xsk->ExtendedStatistics.RxRingFullDrops;
+    Statistics->TxCompletionRingFull = Xsk->ExtendedStatistics.TxCompletionRingFull;
+    Statistics->RxWakeups = Xsk->ExtendedStatistics.RxWakeups;
+    Statistics->TxWakeups = Xsk->ExtendedStatistics.TxWakeups;
+    Statistics->RxPokes = Xsk->ExtendedStatistics.RxPokes;
+    Statistics->TxPokes = Xsk->ExtendedStatistics.TxPokes;
+    Statistics->PollModeChanges = Xsk->ExtendedStatistics.PollModeChanges;
+
+    if (Revision >= XSK_STATISTICS_EX_REVISION_2) {
+        Statistics->RxFiltered = Xsk->ExtendedStatistics.RxFiltered;
+    }
+
+    Status = STATUS_SUCCESS;
+    Irp->IoStatus.Information = Size;
+
+Exit:
+
+    TraceExitStatus(TRACE_XSK);
+
+    return Status;
+}
+
 static
 VOID
 XskFillRingInfo(
@@ -3370,281 +3795,222 @@ Exit:
 
 static
 NTSTATUS
-XskSockoptGetError(
+XskSockoptSetCapture(
     _In_ XSK *Xsk,
-    _In_ UINT32 Option,
-    _In_ IRP *Irp,
-    _In_ IO_STACK_LOCATION *IrpSp
+    _In_ XSK_SET_SOCKOPT_IN *Sockopt,
+    _In_ KPROCESSOR_MODE RequestorMode
     )
 {
     NTSTATUS Status;
-    XSK_ERROR *XskError = Irp->AssociatedIrp.SystemBuffer;
+    CONST VOID *SockoptIn;
+    UINT32 SockoptInSize;
+    XSK_CAPTURE_CONFIG Config;
+    KIRQL OldIrql = {0};
+    BOOLEAN IsLockHeld = FALSE;
 
     TraceEnter(TRACE_XSK, "Xsk=%p", Xsk);
 
-    if (IrpSp->Parameters.DeviceIoControl.OutputBufferLength < sizeof(*XskError)) {
-        Status = STATUS_INVALID_PARAMETER;
+    //
+    // This is a nested buffer not copied by IO manager, so it needs special care.
+    //
+    SockoptIn = Sockopt->InputBuffer;
+    SockoptInSize = Sockopt->InputBufferLength;
+
+    if (SockoptInSize < XSK_SIZEOF_CAPTURE_CONFIG_REVISION_1) {
+        Status = STATUS_BUFFER_TOO_SMALL;
         goto Exit;
     }
 
-    switch (Option) {
-    case XSK_SOCKOPT_RX_ERROR:
-        *XskError = Xsk->Rx.Ring.Error;
-        break;
-
-    case XSK_SOCKOPT_RX_FILL_ERROR:
-        *XskError = Xsk->Rx.FillRing.Error;
-        break;
+    __try {
+        if (RequestorMode != KernelMode) {
+            ProbeForRead((VOID*)SockoptIn, SockoptInSize, PROBE_ALIGNMENT(XSK_CAPTURE_CONFIG));
+        }
+        RtlCopyVolatileMemory(&Config, SockoptIn, XSK_SIZEOF_CAPTURE_CONFIG_REVISION_1);
+    } __except (EXCEPTION_EXECUTE_HANDLER) {
+        Status = GetExceptionCode();
+        goto Exit;
+    }
 
-    case XSK_SOCKOPT_TX_ERROR:
-        *XskError = Xsk->Tx.Ring.Error;
-        break;
+    if (Config.Header.Revision < XSK_CAPTURE_CONFIG_REVISION_1 ||
+        Config.Header.Size < XSK_SIZEOF_CAPTURE_CONFIG_REVISION_1 ||
+        Config.SampleInterval == 0 || Config.SnapLength == 0) {
+        Status = STATUS_INVALID_PARAMETER;
+        goto Exit;
+    }
 
-    case XSK_SOCKOPT_TX_COMPLETION_ERROR:
-        *XskError = Xsk->Tx.CompletionRing.Error;
-        break;
+    KeAcquireSpinLock(&Xsk->Lock, &OldIrql);
+    IsLockHeld = TRUE;
 
-    default:
-        Status = STATUS_NOT_SUPPORTED;
+    if (Xsk->State != XskUnbound || Xsk->Rx.EbpfRedirect || Xsk->Rx.Metadata ||
+        Xsk->Rx.Filter != NULL) {
+        Status = STATUS_INVALID_DEVICE_STATE;
         goto Exit;
     }
 
+    TraceInfo(
+        TRACE_XSK, "Xsk=%p Set XSK_SOCKOPT_CAPTURE SampleInterval=%u SnapLength=%u",
+        Xsk, Config.SampleInterval, Config.SnapLength);
+
+    Xsk->Rx.Capture.SampleInterval = Config.SampleInterval;
+    Xsk->Rx.Capture.SnapLength = Config.SnapLength;
+    Xsk->Rx.Capture.SampleCountdown = Config.SampleInterval;
+
     Status = STATUS_SUCCESS;
-    Irp->IoStatus.Information = sizeof(*XskError);
 
 Exit:
 
+    if (IsLockHeld) {
+        KeReleaseSpinLock(&Xsk->Lock, OldIrql);
+    }
+
     TraceExitStatus(TRACE_XSK);
 
     return Status;
 }
 
 static
-UINT32
-XskQueryReadyIo(
-    _In_ XSK* Xsk,
-    _In_ UINT32 InFlags
-    )
-{
-    UINT32 SatisfiedFlags = 0;
-
-    if (InFlags & XSK_NOTIFY_FLAG_WAIT_TX && XskRingConsPeek(&Xsk->Tx.CompletionRing, 1) > 0) {
-        SatisfiedFlags |= XSK_NOTIFY_FLAG_WAIT_TX;
-    }
-    if (InFlags & XSK_NOTIFY_FLAG_WAIT_RX && XskRingConsPeek(&Xsk->Rx.Ring, 1) > 0) {
-        SatisfiedFlags |= XSK_NOTIFY_FLAG_WAIT_RX;
-    }
-
-    return SatisfiedFlags;
-}
-
-static
-_Requires_exclusive_lock_held_(&Xsk->PollLock)
-BOOLEAN
-XskPollInvoke(
+NTSTATUS
+XskSockoptSetEbpfRedirect(
     _In_ XSK *Xsk,
-    _In_ UINT32 RxQuota,
-    _In_ UINT32 TxQuota
+    _In_ XSK_SET_SOCKOPT_IN *Sockopt,
+    _In_ KPROCESSOR_MODE RequestorMode
     )
 {
-    BOOLEAN MoreData = FALSE;
-
-    ASSERT(Xsk->Rx.Xdp.PollHandle != NULL || Xsk->Tx.Xdp.PollHandle != NULL);
+    NTSTATUS Status;
+    CONST VOID *SockoptIn;
+    UINT32 SockoptInSize;
+    XSK_EBPF_REDIRECT_CONFIG Config;
+    KIRQL OldIrql = {0};
+    BOOLEAN IsLockHeld = FALSE;
 
-    if (Xsk->Rx.Xdp.PollHandle == Xsk->Tx.Xdp.PollHandle) {
-        //
-        // Typically the RX and TX poll contexts are the same.
-        //
-        MoreData = XdpPollInvoke(Xsk->Rx.Xdp.PollHandle, RxQuota, TxQuota);
-    } else {
-        if (Xsk->Rx.Xdp.PollHandle != NULL) {
-            MoreData |= XdpPollInvoke(Xsk->Rx.Xdp.PollHandle, RxQuota, TxQuota);
-        }
-        if (Xsk->Tx.Xdp.PollHandle != NULL) {
-            MoreData |= XdpPollInvoke(Xsk->Tx.Xdp.PollHandle, RxQuota, TxQuota);
-        }
-    }
+    TraceEnter(TRACE_XSK, "Xsk=%p", Xsk);
 
-    return MoreData;
-}
+    //
+    // This is a nested buffer not copied by IO manager, so it needs special care.
+    //
+    SockoptIn = Sockopt->InputBuffer;
+    SockoptInSize = Sockopt->InputBufferLength;
 
-static
-_Requires_exclusive_lock_held_(&Xsk->PollLock)
-VOID
-XskPollSetNotifications(
-    _In_ XSK *Xsk,
-    _In_ BOOLEAN EnableNotifications
-    )
-{
-    ASSERT(Xsk->Rx.Xdp.PollHandle != NULL || Xsk->Tx.Xdp.PollHandle != NULL);
+    if (SockoptInSize < XSK_SIZEOF_EBPF_REDIRECT_CONFIG_REVISION_1) {
+        Status = STATUS_BUFFER_TOO_SMALL;
+        goto Exit;
+    }
 
-    if (Xsk->Rx.Xdp.PollHandle == Xsk->Tx.Xdp.PollHandle) {
-        //
-        // Typically the RX and TX poll contexts are the same.
-        //
-        XdpPollSetNotifications(Xsk->Rx.Xdp.PollHandle, EnableNotifications);
-    } else {
-        if (Xsk->Rx.Xdp.PollHandle != NULL) {
-            XdpPollSetNotifications(Xsk->Rx.Xdp.PollHandle, EnableNotifications);
-        }
-        if (Xsk->Tx.Xdp.PollHandle != NULL) {
-            XdpPollSetNotifications(Xsk->Tx.Xdp.PollHandle, EnableNotifications);
+    __try {
+        if (RequestorMode != KernelMode) {
+            ProbeForRead(
+                (VOID*)SockoptIn, SockoptInSize, PROBE_ALIGNMENT(XSK_EBPF_REDIRECT_CONFIG));
         }
+        RtlCopyVolatileMemory(&Config, SockoptIn, XSK_SIZEOF_EBPF_REDIRECT_CONFIG_REVISION_1);
+    } __except (EXCEPTION_EXECUTE_HANDLER) {
+        Status = GetExceptionCode();
+        goto Exit;
     }
-}
-
-static
-_Requires_exclusive_lock_held_(&Xsk->PollLock)
-NTSTATUS
-XskPollSocket(
-    _In_ XSK *Xsk,
-    _In_ UINT32 Flags,
-    _In_ UINT32 TimeoutMs
-    )
-{
-    NTSTATUS Status;
-    BOOLEAN MoreData;
-    UINT32 WaitFlags;
-    BOOLEAN NotificationsArmed = FALSE;
-    UINT64 DueTime = 0;
-    UINT64 CurrentTime;
-    LARGE_INTEGER WaitTime;
-    LARGE_INTEGER *WaitTimePtr = NULL;
 
-    WaitFlags = Flags & (XSK_NOTIFY_FLAG_WAIT_RX | XSK_NOTIFY_FLAG_WAIT_TX);
-
-    if (TimeoutMs != INFINITE) {
-        WaitTimePtr = &WaitTime;
-        DueTime = KeQueryInterruptTime();
-        DueTime += RTL_MILLISEC_TO_100NANOSEC(TimeoutMs);
+    if (Config.Header.Revision < XSK_EBPF_REDIRECT_CONFIG_REVISION_1 ||
+        Config.Header.Size < XSK_SIZEOF_EBPF_REDIRECT_CONFIG_REVISION_1 ||
+        Config.Flags != 0) {
+        Status = STATUS_INVALID_PARAMETER;
+        goto Exit;
     }
 
-    while (TRUE) {
-        UINT32 RxQuota = 256;
-        UINT32 TxQuota = 256;
-
-        if (ReadULongNoFence(&Xsk->PollWaiters) > 0) {
-            //
-            // Give the control path a chance to acquire the poll lock.
-            //
-            RtlReleasePushLockExclusive(&Xsk->PollLock);
-            RtlAcquirePushLockExclusive(&Xsk->PollLock);
+    KeAcquireSpinLock(&Xsk->Lock, &OldIrql);
+    IsLockHeld = TRUE;
 
-            if (Xsk->PollMode != XSK_POLL_MODE_SOCKET ||
-                (Xsk->Rx.Xdp.PollHandle == NULL && Xsk->Tx.Xdp.PollHandle == NULL)) {
-                return STATUS_SUCCESS;
-            }
-        }
+    //
+    // Capture taps cannot be redirect targets.
+    //
+    if (Xsk->State != XskUnbound || Xsk->Rx.Capture.SampleInterval != 0) {
+        Status = STATUS_INVALID_DEVICE_STATE;
+        goto Exit;
+    }
 
-        //
-        // TODO: Optimize RX and TX quotas.
-        // TODO: Optimize common case where RX and TX share a poll handle.
-        //
-        if (Xsk->Rx.Xdp.PollHandle != NULL) {
-            RxQuota = XskRingConsPeek(&Xsk->Rx.FillRing, RxQuota);
-            RxQuota = XskRingProdReserve(&Xsk->Rx.Ring, RxQuota);
-        }
-        if (Xsk->Tx.Xdp.PollHandle != NULL) {
-            TxQuota = XskRingConsPeek(&Xsk->Tx.Ring, TxQuota);
-            TxQuota = XskRingProdReserve(&Xsk->Tx.CompletionRing, TxQuota);
-        }
+    TraceInfo(TRACE_XSK, "Xsk=%p Set XSK_SOCKOPT_EBPF_REDIRECT", Xsk);
 
-        MoreData = XskPollInvoke(Xsk, RxQuota, TxQuota);
+    Xsk->Rx.EbpfRedirect = TRUE;
 
-        //
-        // TODO: Optimize return conditions: should we try to completely fill
-        // all buffers, or return as soon as a single buffer is available, or
-        // something in between?
-        //
-        if (!WaitFlags || XskQueryReadyIo(Xsk, WaitFlags)) {
-            return STATUS_SUCCESS;
-        }
+    Status = STATUS_SUCCESS;
 
-        //
-        // Check if the wait interval has timed out.
-        // Review: should we use a higher precision time source?
-        //
-        if (TimeoutMs != INFINITE) {
-            CurrentTime = KeQueryInterruptTime();
-            if (CurrentTime >= DueTime) {
-                return STATUS_TIMEOUT;
-            }
+Exit:
 
-            WaitTime.QuadPart = -(LONG64)(DueTime - CurrentTime);
-        }
+    if (IsLockHeld) {
+        KeReleaseSpinLock(&Xsk->Lock, OldIrql);
+    }
 
-        //
-        // If no data is available, attempt to arm notifications and enter
-        // the waiting state.
-        //
-        if (!MoreData && !Xsk->PollBusy) {
-            if (!NotificationsArmed) {
-                XskPollSetNotifications(Xsk, TRUE);
-                NotificationsArmed = TRUE;
-            } else {
-                Status =
-                    KeWaitForSingleObject(
-                        &Xsk->PollRequested, UserRequest, UserMode, FALSE, WaitTimePtr);
-                if (Status != STATUS_SUCCESS) {
-                    return Status;
-                }
-                MoreData = TRUE;
-            }
-        }
+    TraceExitStatus(TRACE_XSK);
 
-        if (MoreData) {
-            NotificationsArmed = FALSE;
-        }
-    }
+    return Status;
 }
 
 static
 NTSTATUS
-XskSockoptSetPollMode(
+XskSockoptSetRxMetadata(
     _In_ XSK *Xsk,
     _In_ XSK_SET_SOCKOPT_IN *Sockopt,
     _In_ KPROCESSOR_MODE RequestorMode
     )
 {
     NTSTATUS Status;
-    CONST VOID *SockoptInputBuffer;
-    UINT32 SockoptInputBufferLength;
-    XSK_POLL_MODE PollMode;
+    CONST VOID *SockoptIn;
+    UINT32 SockoptInSize;
+    XSK_RX_METADATA_CONFIG Config;
+    KIRQL OldIrql = {0};
+    BOOLEAN IsLockHeld = FALSE;
 
     TraceEnter(TRACE_XSK, "Xsk=%p", Xsk);
 
     //
     // This is a nested buffer not copied by IO manager, so it needs special care.
     //
-    SockoptInputBuffer = Sockopt->InputBuffer;
-    SockoptInputBufferLength = Sockopt->InputBufferLength;
+    SockoptIn = Sockopt->InputBuffer;
+    SockoptInSize = Sockopt->InputBufferLength;
 
-    if (SockoptInputBufferLength < sizeof(XSK_POLL_MODE)) {
-        Status = STATUS_INVALID_PARAMETER;
+    if (SockoptInSize < XSK_SIZEOF_RX_METADATA_CONFIG_REVISION_1) {
+        Status = STATUS_BUFFER_TOO_SMALL;
         goto Exit;
     }
 
     __try {
         if (RequestorMode != KernelMode) {
             ProbeForRead(
-                (VOID*)SockoptInputBuffer, SockoptInputBufferLength, PROBE_ALIGNMENT(XSK_POLL_MODE));
+                (VOID*)SockoptIn, SockoptInSize, PROBE_ALIGNMENT(XSK_RX_METADATA_CONFIG));
         }
-        RtlCopyVolatileMemory(&PollMode, SockoptInputBuffer, sizeof(XSK_POLL_MODE));
+        RtlCopyVolatileMemory(&Config, SockoptIn, XSK_SIZEOF_RX_METADATA_CONFIG_REVISION_1);
     } __except (EXCEPTION_EXECUTE_HANDLER) {
         Status = GetExceptionCode();
         goto Exit;
     }
 
-    XskAcquirePollLock(Xsk);
-    Status = XskSetPollMode(Xsk, PollMode);
-    XskReleasePollLock(Xsk);
+    if (Config.Header.Revision < XSK_RX_METADATA_CONFIG_REVISION_1 ||
+        Config.Header.Size < XSK_SIZEOF_RX_METADATA_CONFIG_REVISION_1 ||
+        Config.Flags != 0) {
+        Status = STATUS_INVALID_PARAMETER;
+        goto Exit;
+    }
 
-    if (NT_SUCCESS(Status)) {
-        TraceInfo(TRACE_XSK, "Xsk=%p Set poll mode PollMode=%u", Xsk, PollMode);
+    KeAcquireSpinLock(&Xsk->Lock, &OldIrql);
+    IsLockHeld = TRUE;
+
+    //
+    // Capture taps never receive redirected frames.
+    //
+    if (Xsk->State != XskUnbound || Xsk->Rx.Capture.SampleInterval != 0) {
+        Status = STATUS_INVALID_DEVICE_STATE;
+        goto Exit;
     }
 
+    TraceInfo(TRACE_XSK, "Xsk=%p Set XSK_SOCKOPT_RX_METADATA", Xsk);
+
+    Xsk->Rx.Metadata = TRUE;
+
+    Status = STATUS_SUCCESS;
+
 Exit:
 
+    if (IsLockHeld) {
+        KeReleaseSpinLock(&Xsk->Lock, OldIrql);
+    }
+
     TraceExitStatus(TRACE_XSK);
 
     return Status;
@@ -3652,551 +4018,2070 @@ Exit:
 
 static
 NTSTATUS
-XskIrpGetSockopt(
-    _In_ IRP *Irp,
-    _In_ IO_STACK_LOCATION *IrpSp
+XskSockoptSetRxFilter(
+    _In_ XSK *Xsk,
+    _In_ XSK_SET_SOCKOPT_IN *Sockopt,
+    _In_ KPROCESSOR_MODE RequestorMode
     )
 {
-    NTSTATUS Status = STATUS_SUCCESS;
-    XSK *Xsk;
-    UINT32 Option = 0;
+    NTSTATUS Status;
+    CONST VOID *SockoptIn;
+    UINT32 SockoptInSize;
+    XSK_RX_FILTER_CONFIG Config;
+    XDP_PROGRAM *Filter = NULL;
+    KIRQL OldIrql = {0};
+    BOOLEAN IsLockHeld = FALSE;
 
-    Xsk = IrpSp->FileObject->FsContext;
+    TraceEnter(TRACE_XSK, "Xsk=%p", Xsk);
 
-    if (IrpSp->Parameters.DeviceIoControl.InputBufferLength < sizeof(Option)) {
-        return STATUS_INVALID_PARAMETER;
+    //
+    // This is a nested buffer not copied by IO manager, so it needs special care.
+    //
+    SockoptIn = Sockopt->InputBuffer;
+    SockoptInSize = Sockopt->InputBufferLength;
+
+    if (SockoptInSize < XSK_SIZEOF_RX_FILTER_CONFIG_REVISION_1) {
+        Status = STATUS_BUFFER_TOO_SMALL;
+        goto Exit;
     }
 
-    Option = *(UINT32 *)Irp->AssociatedIrp.SystemBuffer;
+    __try {
+        if (RequestorMode != KernelMode) {
+            ProbeForRead(
+                (VOID*)SockoptIn, SockoptInSize, PROBE_ALIGNMENT(XSK_RX_FILTER_CONFIG));
+        }
+        RtlCopyVolatileMemory(&Config, SockoptIn, XSK_SIZEOF_RX_FILTER_CONFIG_REVISION_1);
+    } __except (EXCEPTION_EXECUTE_HANDLER) {
+        Status = GetExceptionCode();
+        goto Exit;
+    }
 
-    switch (Option) {
-    case XSK_SOCKOPT_RING_INFO:
-        Status = XskSockoptGetRingInfo(Xsk, Irp, IrpSp);
-        break;
-    case XSK_SOCKOPT_STATISTICS:
-        Status = XskSockoptGetStatistics(Xsk, Irp, IrpSp);
-        break;
-    case XSK_SOCKOPT_RX_HOOK_ID:
-    case XSK_SOCKOPT_TX_HOOK_ID:
-        Status = XskSockoptGetHookId(Xsk, Option, Irp, IrpSp);
-        break;
-    case XSK_SOCKOPT_RX_ERROR:
-    case XSK_SOCKOPT_RX_FILL_ERROR:
-    case XSK_SOCKOPT_TX_ERROR:
-    case XSK_SOCKOPT_TX_COMPLETION_ERROR:
-        Status = XskSockoptGetError(Xsk, Option, Irp, IrpSp);
-        break;
-    default:
-        Status = STATUS_NOT_SUPPORTED;
-        break;
+    if (Config.Header.Revision < XSK_RX_FILTER_CONFIG_REVISION_1 ||
+        Config.Header.Size < XSK_SIZEOF_RX_FILTER_CONFIG_REVISION_1) {
+        Status = STATUS_INVALID_PARAMETER;
+        goto Exit;
     }
 
-    TraceInfo(TRACE_XSK, "Xsk=%p Option=%u Status=%!STATUS!", Xsk, Option, Status);
-
-    return Status;
-}
+    //
+    // The rules are a nested buffer, so they are captured by the filter.
+    //
+    Status = XdpProgramCreateFilter(Config.Rules, Config.RuleCount, RequestorMode, &Filter);
+    if (!NT_SUCCESS(Status)) {
+        goto Exit;
+    }
 
-static
-_Success_(NT_SUCCESS(IoStatus->Status))
-VOID
-XskGetIdealProcessor(
-    _In_ XSK *Xsk,
-    _Inout_ XSK_KERNEL_RING *Ring,
-    _In_ KPROCESSOR_MODE PreviousMode,
-    _Out_ VOID *OutputBuffer,
-    _In_ UINT32 OutputBufferLength,
-    _Out_ IO_STATUS_BLOCK *IoStatus
-    )
-{
-    UINT32 ProcIndex;
-    PROCESSOR_NUMBER ProcNumber;
+    KeAcquireSpinLock(&Xsk->Lock, &OldIrql);
+    IsLockHeld = TRUE;
 
     //
-    // N.B. This function must be called within a try/catch block.
+    // Capture taps receive copies of every frame, so they cannot be filtered.
     //
-
-    if (ReadUInt32Acquire((UINT32 *)&Xsk->State) < XskActive || Ring->Size == 0) {
-        IoStatus->Status = STATUS_INVALID_DEVICE_STATE;
-        return;
+    if (Xsk->State != XskUnbound || Xsk->Rx.Capture.SampleInterval != 0 ||
+        Xsk->Rx.Filter != NULL) {
+        Status = STATUS_INVALID_DEVICE_STATE;
+        goto Exit;
     }
 
-    if (OutputBufferLength < sizeof(PROCESSOR_NUMBER)) {
-        IoStatus->Status = STATUS_BUFFER_TOO_SMALL;
-        return;
-    }
+    TraceInfo(
+        TRACE_XSK, "Xsk=%p Set XSK_SOCKOPT_RX_FILTER RuleCount=%u", Xsk, Config.RuleCount);
 
-    if (PreviousMode != KernelMode) {
-        #pragma prefast(suppress:6001) // Using uninitialized memory '*OutputBuffer'
-        ProbeForWrite(
-            OutputBuffer, sizeof(PROCESSOR_NUMBER), PROBE_ALIGNMENT(PROCESSOR_NUMBER));
-    }
+    Xsk->Rx.Filter = Filter;
+    Filter = NULL;
 
-    //
-    // Reset the affinity flag before reading the affinity value.
-    //
-    InterlockedAnd((LONG *)&Ring->Shared->Flags, ~XSK_RING_FLAG_AFFINITY_CHANGED);
+    Status = STATUS_SUCCESS;
 
-    ProcIndex = ReadUInt32NoFence(&Ring->IdealProcessor);
-    if (ProcIndex == INVALID_PROCESSOR_INDEX) {
-        IoStatus->Status = STATUS_DEVICE_NOT_READY;
-        return;
+Exit:
+
+    if (IsLockHeld) {
+        KeReleaseSpinLock(&Xsk->Lock, OldIrql);
     }
 
-    NT_VERIFY(NT_SUCCESS(KeGetProcessorNumberFromIndex(ProcIndex, &ProcNumber)));
+    if (Filter != NULL) {
+        XdpProgramDeleteFilter(Filter);
+    }
 
-    *(PROCESSOR_NUMBER *)OutputBuffer = ProcNumber;
-    IoStatus->Information = sizeof(PROCESSOR_NUMBER);
-    IoStatus->Status = STATUS_SUCCESS;
+    TraceExitStatus(TRACE_XSK);
+
+    return Status;
 }
 
-#pragma warning(push)
-#pragma warning(disable:6101) // We don't set OutputBuffer in some paths
 static
-BOOLEAN
-XskFastGetSockopt(
-    _In_ XDP_FILE_OBJECT_HEADER *FileObjectHeader,
-    _In_opt_ VOID *InputBuffer,
-    _In_ UINT32 InputBufferLength,
-    _Out_opt_ VOID *OutputBuffer,
-    _In_ UINT32 OutputBufferLength,
-    _Out_ IO_STATUS_BLOCK *IoStatus
+NTSTATUS
+XskSockoptSetTxDoorbell(
+    _In_ XSK *Xsk,
+    _In_ XSK_SET_SOCKOPT_IN *Sockopt,
+    _In_ KPROCESSOR_MODE RequestorMode
     )
 {
-    XSK *Xsk = (XSK *)FileObjectHeader;
-    CONST KPROCESSOR_MODE PreviousMode = ExGetPreviousMode();
-    UINT32 Option = 0;
+    NTSTATUS Status;
+    CONST VOID *SockoptIn;
+    UINT32 SockoptInSize;
+    XSK_TX_DOORBELL_CONFIG Config;
+    KIRQL OldIrql = {0};
+    BOOLEAN IsPollLockHeld = FALSE;
 
-    __try {
-        #pragma prefast(push)
-        #pragma prefast(disable:6011) // Dereferencing NULL pointer is safe within try/catch.
-        #pragma prefast(disable:6387) // Dereferencing NULL pointer is safe within try/catch.
+    TraceEnter(TRACE_XSK, "Xsk=%p", Xsk);
 
-        if (InputBufferLength < sizeof(Option)) {
-            IoStatus->Status = STATUS_INVALID_PARAMETER;
-            goto Exit;
-        }
+    //
+    // This is a nested buffer not copied by IO manager, so it needs special care.
+    //
+    SockoptIn = Sockopt->InputBuffer;
+    SockoptInSize = Sockopt->InputBufferLength;
 
-        if (PreviousMode != KernelMode) {
+    if (SockoptInSize < XSK_SIZEOF_TX_DOORBELL_CONFIG_REVISION_1) {
+        Status = STATUS_BUFFER_TOO_SMALL;
+        goto Exit;
+    }
+
+    __try {
+        if (RequestorMode != KernelMode) {
             ProbeForRead(
-                (VOID *)InputBuffer, InputBufferLength, PROBE_ALIGNMENT(UINT32));
+                (VOID*)SockoptIn, SockoptInSize, PROBE_ALIGNMENT(XSK_TX_DOORBELL_CONFIG));
         }
+        RtlCopyVolatileMemory(&Config, SockoptIn, XSK_SIZEOF_TX_DOORBELL_CONFIG_REVISION_1);
+    } __except (EXCEPTION_EXECUTE_HANDLER) {
+        Status = GetExceptionCode();
+        goto Exit;
+    }
 
-        Option = ReadUInt32NoFence(InputBuffer);
-
-        switch (Option) {
-        case XSK_SOCKOPT_RX_PROCESSOR_AFFINITY:
-            XskGetIdealProcessor(
-                Xsk, &Xsk->Rx.Ring, PreviousMode, OutputBuffer, OutputBufferLength, IoStatus);
-            break;
-
-        case XSK_SOCKOPT_TX_PROCESSOR_AFFINITY:
-            XskGetIdealProcessor(
-                Xsk, &Xsk->Tx.Ring, PreviousMode, OutputBuffer, OutputBufferLength, IoStatus);
-            break;
+    if (Config.Header.Revision < XSK_TX_DOORBELL_CONFIG_REVISION_1 ||
+        Config.Header.Size < XSK_SIZEOF_TX_DOORBELL_CONFIG_REVISION_1 ||
+        Config.IdleTimeoutMs == 0 ||
+        Config.IdleTimeoutMs > XSK_TX_DOORBELL_MAX_IDLE_TIMEOUT_MS) {
+        Status = STATUS_INVALID_PARAMETER;
+        goto Exit;
+    }
 
-        default:
-            //
-            // Fall back to the IRP-based socket option path.
-            //
-            return FALSE;
-        }
+    //
+    // The poll lock serializes enabling the doorbell with socket cleanup,
+    // which marks the socket closing under the poll lock before stopping the
+    // doorbell: closing sockets fail the state check below.
+    //
+    XskAcquirePollLock(Xsk);
+    IsPollLockHeld = TRUE;
 
-        #pragma prefast(pop)
-    } __except (EXCEPTION_EXECUTE_HANDLER) {
-        IoStatus->Status = GetExceptionCode();
+    KeAcquireSpinLock(&Xsk->Lock, &OldIrql);
+    if (Xsk->State != XskUnbound) {
+        Status = STATUS_INVALID_DEVICE_STATE;
+        KeReleaseSpinLock(&Xsk->Lock, OldIrql);
         goto Exit;
     }
+    KeReleaseSpinLock(&Xsk->Lock, OldIrql);
+
+    TraceInfo(
+        TRACE_XSK, "Xsk=%p Set XSK_SOCKOPT_TX_DOORBELL IdleTimeoutMs=%u",
+        Xsk, Config.IdleTimeoutMs);
+
+    //
+    // Convert the idle timeout to 100ns interrupt time units.
+    //
+    Xsk->Tx.Doorbell.IdleTimeout = (UINT64)Config.IdleTimeoutMs * 10000;
+    Xsk->Tx.Doorbell.Enabled = TRUE;
+
+    Status = STATUS_SUCCESS;
 
 Exit:
 
-    return TRUE;
+    if (IsPollLockHeld) {
+        XskReleasePollLock(Xsk);
+    }
+
+    TraceExitStatus(TRACE_XSK);
+
+    return Status;
 }
-#pragma warning(pop)
 
 static
 NTSTATUS
-XskIrpSetSockopt(
+XskSockoptGetError(
+    _In_ XSK *Xsk,
+    _In_ UINT32 Option,
     _In_ IRP *Irp,
     _In_ IO_STACK_LOCATION *IrpSp
     )
 {
-    NTSTATUS Status = STATUS_SUCCESS;
-    XSK *Xsk;
-    XSK_SET_SOCKOPT_IN *Sockopt = NULL;
+    NTSTATUS Status;
+    XSK_ERROR *XskError = Irp->AssociatedIrp.SystemBuffer;
 
-    Xsk = IrpSp->FileObject->FsContext;
+    TraceEnter(TRACE_XSK, "Xsk=%p", Xsk);
 
-    if (IrpSp->Parameters.DeviceIoControl.InputBufferLength < sizeof(XSK_SET_SOCKOPT_IN)) {
-        return STATUS_INVALID_PARAMETER;
+    if (IrpSp->Parameters.DeviceIoControl.OutputBufferLength < sizeof(*XskError)) {
+        Status = STATUS_INVALID_PARAMETER;
+        goto Exit;
     }
 
-    Sockopt = Irp->AssociatedIrp.SystemBuffer;
-
-    switch (Sockopt->Option) {
-    case XSK_SOCKOPT_UMEM_REG:
-        Status = XskSockoptSetUmem(Xsk, Sockopt, Irp->RequestorMode);
+    switch (Option) {
+    case XSK_SOCKOPT_RX_ERROR:
+        *XskError = Xsk->Rx.Ring.Error;
         break;
-    case XSK_SOCKOPT_TX_RING_SIZE:
-    case XSK_SOCKOPT_RX_RING_SIZE:
-    case XSK_SOCKOPT_RX_FILL_RING_SIZE:
-    case XSK_SOCKOPT_TX_COMPLETION_RING_SIZE:
-        Status = XskSockoptSetRingSize(Xsk, Sockopt, Irp->RequestorMode);
+
+    case XSK_SOCKOPT_RX_FILL_ERROR:
+        *XskError = Xsk->Rx.FillRing.Error;
         break;
-    case XSK_SOCKOPT_RX_HOOK_ID:
-    case XSK_SOCKOPT_TX_HOOK_ID:
-        Status = XskSockoptSetHookId(Xsk, Sockopt, Irp->RequestorMode);
+
+    case XSK_SOCKOPT_TX_ERROR:
+        *XskError = Xsk->Tx.Ring.Error;
         break;
-#if !defined(XDP_OFFICIAL_BUILD)
-    case XSK_SOCKOPT_POLL_MODE:
-        Status = XskSockoptSetPollMode(Xsk, Sockopt, Irp->RequestorMode);
+
+    case XSK_SOCKOPT_TX_COMPLETION_ERROR:
+        *XskError = Xsk->Tx.CompletionRing.Error;
         break;
-#endif // !defined(XDP_OFFICIAL_BUILD)
+
     default:
         Status = STATUS_NOT_SUPPORTED;
-        break;
+        goto Exit;
     }
 
-    TraceInfo(
-        TRACE_XSK, "Xsk=%p Option=%u Status=%!STATUS! Value=%!HEXDUMP!",
-        Xsk, Sockopt->Option, Status, WppHexDump(Sockopt->InputBuffer, Sockopt->InputBufferLength));
+    Status = STATUS_SUCCESS;
+    Irp->IoStatus.Information = sizeof(*XskError);
+
+Exit:
+
+    TraceExitStatus(TRACE_XSK);
 
     return Status;
 }
 
 static
-NTSTATUS
-XskNotifyValidateParams(
-    _In_ XSK *Xsk,
-    _In_opt_ VOID *InputBuffer,
-    _In_ ULONG InputBufferLength,
-    _Out_ PUINT32 TimeoutMilliseconds,
-    _Out_ PUINT32 InFlags
+UINT32
+XskQueryReadyIo(
+    _In_ XSK* Xsk,
+    _In_ UINT32 InFlags
     )
 {
-    if (Xsk->State != XskActive){
-        return STATUS_INVALID_DEVICE_STATE;
-    }
+    UINT32 SatisfiedFlags = 0;
 
-    if (InputBufferLength < sizeof(XSK_NOTIFY_IN)) {
-        return STATUS_INVALID_PARAMETER;
+    if (InFlags & XSK_NOTIFY_FLAG_WAIT_TX && XskRingConsPeek(&Xsk->Tx.CompletionRing, 1) > 0) {
+        SatisfiedFlags |= XSK_NOTIFY_FLAG_WAIT_TX;
+    }
+    if (InFlags & XSK_NOTIFY_FLAG_WAIT_RX && XskRingConsPeek(&Xsk->Rx.Ring, 1) > 0) {
+        SatisfiedFlags |= XSK_NOTIFY_FLAG_WAIT_RX;
     }
 
-    __try {
-        ASSERT(InputBuffer);
-        if (ExGetPreviousMode() != KernelMode) {
-            ProbeForRead(
-                (VOID*)InputBuffer, InputBufferLength, PROBE_ALIGNMENT(XSK_NOTIFY_IN));
-        }
+    return SatisfiedFlags;
+}
 
-        *InFlags = ReadUInt32NoFence((UINT32 *)&((XSK_NOTIFY_IN *)InputBuffer)->Flags);
-        *TimeoutMilliseconds =
-            ReadUInt32NoFence(&((XSK_NOTIFY_IN *)InputBuffer)->WaitTimeoutMilliseconds);
-    } __except (EXCEPTION_EXECUTE_HANDLER) {
-        return GetExceptionCode();
-    }
+static
+_Requires_exclusive_lock_held_(&Xsk->PollLock)
+BOOLEAN
+XskPollReadyBatchReached(
+    _In_ XSK *Xsk,
+    _In_ UINT32 ReadyFlags
+    )
+{
+    UINT32 MinReadyBatch = Xsk->PollSocket.MinReadyBatch;
 
-    if (*InFlags == 0 || *InFlags &
-            ~(XSK_NOTIFY_FLAG_POKE_RX | XSK_NOTIFY_FLAG_POKE_TX | XSK_NOTIFY_FLAG_WAIT_RX | XSK_NOTIFY_FLAG_WAIT_TX)) {
-        return STATUS_INVALID_PARAMETER;
+    if (ReadyFlags & XSK_NOTIFY_FLAG_WAIT_TX &&
+        XskRingConsPeek(&Xsk->Tx.CompletionRing, MinReadyBatch) >= MinReadyBatch) {
+        return TRUE;
     }
-
-    if ((*InFlags & (XSK_NOTIFY_FLAG_POKE_RX | XSK_NOTIFY_FLAG_WAIT_RX) && Xsk->Rx.Ring.Size == 0) ||
-        (*InFlags & (XSK_NOTIFY_FLAG_POKE_TX | XSK_NOTIFY_FLAG_WAIT_TX) && Xsk->Tx.Ring.Size == 0)) {
-        return STATUS_INVALID_DEVICE_STATE;
+    if (ReadyFlags & XSK_NOTIFY_FLAG_WAIT_RX &&
+        XskRingConsPeek(&Xsk->Rx.Ring, MinReadyBatch) >= MinReadyBatch) {
+        return TRUE;
     }
 
-    return STATUS_SUCCESS;
+    return FALSE;
 }
 
 static
-NTSTATUS
-XskPoke(
+_Requires_exclusive_lock_held_(&Xsk->PollLock)
+BOOLEAN
+XskPollInvoke(
     _In_ XSK *Xsk,
-    _In_ UINT32 Flags,
-    _In_ UINT32 TimeoutMs
+    _In_ UINT32 RxQuota,
+    _In_ UINT32 TxQuota
     )
 {
-    NTSTATUS Status = STATUS_SUCCESS;
-
-    EventWriteXskNotifyPokeStart(&MICROSOFT_XDP_PROVIDER, Xsk, Flags);
+    BOOLEAN MoreData = FALSE;
 
-    RtlAcquirePushLockExclusive(&Xsk->PollLock);
+    ASSERT(Xsk->Rx.Xdp.PollHandle != NULL || Xsk->Tx.Xdp.PollHandle != NULL);
 
-    if (Xsk->PollMode == XSK_POLL_MODE_SOCKET &&
-        (Xsk->Rx.Xdp.PollHandle != NULL || Xsk->Tx.Xdp.PollHandle != NULL)) {
+    if (Xsk->Rx.Xdp.PollHandle == Xsk->Tx.Xdp.PollHandle) {
         //
-        // Socket polling mode is active, so poll the interfaces synchronously.
+        // Typically the RX and TX poll contexts are the same.
         //
-        Status = XskPollSocket(Xsk, Flags, TimeoutMs);
+        MoreData = XdpPollInvoke(Xsk->Rx.Xdp.PollHandle, RxQuota, TxQuota);
     } else {
         //
-        // Notify the underlying interfaces that data is available.
+        // Each poll context only services its own direction on behalf of this
+        // socket, so do not spend the other direction's quota on it.
         //
+        if (Xsk->Rx.Xdp.PollHandle != NULL) {
+            MoreData |= XdpPollInvoke(Xsk->Rx.Xdp.PollHandle, RxQuota, 0);
+        }
+        if (Xsk->Tx.Xdp.PollHandle != NULL) {
+            MoreData |= XdpPollInvoke(Xsk->Tx.Xdp.PollHandle, 0, TxQuota);
+        }
+    }
 
-        if (Flags & XSK_NOTIFY_FLAG_POKE_RX) {
-            ASSERT(Xsk->Rx.Ring.Size > 0);
-            ASSERT(Xsk->Rx.FillRing.Size > 0);
-            //
-            // TODO: Driver poke routine for zero copy RX.
-            //
-            ASSERT(Status == STATUS_SUCCESS);
+    return MoreData;
+}
+
+static
+_Requires_exclusive_lock_held_(&Xsk->PollLock)
+VOID
+XskPollSetNotifications(
+    _In_ XSK *Xsk,
+    _In_ BOOLEAN EnableNotifications
+    )
+{
+    ASSERT(Xsk->Rx.Xdp.PollHandle != NULL || Xsk->Tx.Xdp.PollHandle != NULL);
+
+    if (Xsk->Rx.Xdp.PollHandle == Xsk->Tx.Xdp.PollHandle) {
+        //
+        // Typically the RX and TX poll contexts are the same.
+        //
+        XdpPollSetNotifications(Xsk->Rx.Xdp.PollHandle, EnableNotifications);
+    } else {
+        if (Xsk->Rx.Xdp.PollHandle != NULL) {
+            XdpPollSetNotifications(Xsk->Rx.Xdp.PollHandle, EnableNotifications);
+        }
+        if (Xsk->Tx.Xdp.PollHandle != NULL) {
+            XdpPollSetNotifications(Xsk->Tx.Xdp.PollHandle, EnableNotifications);
         }
+    }
+}
 
-        if (Flags & XSK_NOTIFY_FLAG_POKE_TX) {
-            XDP_NOTIFY_QUEUE_FLAGS NotifyFlags = XDP_NOTIFY_QUEUE_FLAG_TX;
+static
+_Requires_exclusive_lock_held_(&Xsk->PollLock)
+NTSTATUS
+XskPollSocket(
+    _In_ XSK *Xsk,
+    _In_ UINT32 Flags,
+    _In_ UINT64 Timeout
+    )
+{
+    NTSTATUS Status;
+    BOOLEAN MoreData;
+    UINT32 WaitFlags;
+    BOOLEAN NotificationsArmed = FALSE;
+    UINT64 DueTime = 0;
+    UINT64 CurrentTime;
+    LARGE_INTEGER WaitTime;
+    LARGE_INTEGER *WaitTimePtr = NULL;
+    ULONG64 QpcTimeStamp;
+
+    WaitFlags = Flags & (XSK_NOTIFY_FLAG_WAIT_RX | XSK_NOTIFY_FLAG_WAIT_TX);
+
+    if (Timeout > MAXLONG64 && Timeout != XSK_NOTIFY_TIMEOUT_INFINITE) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    if (Timeout != XSK_NOTIFY_TIMEOUT_INFINITE) {
+        WaitTimePtr = &WaitTime;
+        DueTime = KeQueryInterruptTimePrecise(&QpcTimeStamp);
+        DueTime += Timeout;
+    }
+
+    while (TRUE) {
+        UINT32 RxQuota = Xsk->PollSocket.RxQuota;
+        UINT32 TxQuota = Xsk->PollSocket.TxQuota;
+        UINT32 ReadyFlags;
+
+        if (ReadULongNoFence(&Xsk->PollWaiters) > 0) {
             //
-            // Before invoking the poke routine, atomically clear the need poke
-            // flag on the TX ring. The poke routine is required to execute a
-            // FlushTransmit, which guarantees the need poke flag can be set.
+            // Give the control path a chance to acquire the poll lock.
             //
-            InterlockedAnd((LONG *)&Xsk->Tx.Ring.Shared->Flags, ~XSK_RING_FLAG_NEED_POKE);
+            RtlReleasePushLockExclusive(&Xsk->PollLock);
+            RtlAcquirePushLockExclusive(&Xsk->PollLock);
 
-            if (Xsk->Tx.Xdp.Flags.QueueActive) {
-                XdpTxQueueInvokeInterfaceNotify(Xsk->Tx.Xdp.Queue, NotifyFlags);
+            if (Xsk->PollMode != XSK_POLL_MODE_SOCKET ||
+                (Xsk->Rx.Xdp.PollHandle == NULL && Xsk->Tx.Xdp.PollHandle == NULL)) {
+                return STATUS_SUCCESS;
+            }
+        }
+
+        //
+        // Bound each quota by the descriptors available to the data path.
+        //
+        if (Xsk->Rx.Xdp.PollHandle != NULL) {
+            RxQuota = XskRingConsPeek(&Xsk->Rx.FillRing, RxQuota);
+            RxQuota = XskRingProdReserve(&Xsk->Rx.Ring, RxQuota);
+        }
+        if (Xsk->Tx.Xdp.PollHandle != NULL) {
+            TxQuota = XskRingConsPeek(&Xsk->Tx.Ring, TxQuota);
+            TxQuota = XskRingProdReserve(&Xsk->Tx.CompletionRing, TxQuota);
+        }
+
+        MoreData = XskPollInvoke(Xsk, RxQuota, TxQuota);
+
+        if (!WaitFlags) {
+            return STATUS_SUCCESS;
+        }
+
+        //
+        // Return once the minimum ready batch is available, or as soon as any
+        // IO is ready if the interfaces have no further work.
+        //
+        ReadyFlags = XskQueryReadyIo(Xsk, WaitFlags);
+        if (ReadyFlags != 0 && (!MoreData || XskPollReadyBatchReached(Xsk, ReadyFlags))) {
+            return STATUS_SUCCESS;
+        }
+
+        //
+        // Check if the wait interval has timed out.
+        //
+        if (Timeout != XSK_NOTIFY_TIMEOUT_INFINITE) {
+            CurrentTime = KeQueryInterruptTimePrecise(&QpcTimeStamp);
+            if (CurrentTime >= DueTime) {
+                return STATUS_TIMEOUT;
+            }
+
+            WaitTime.QuadPart = -(LONG64)(DueTime - CurrentTime);
+        }
+
+        //
+        // If no data is available, attempt to arm notifications and enter
+        // the waiting state.
+        //
+        if (!MoreData && !Xsk->PollBusy) {
+            if (!NotificationsArmed) {
+                XskPollSetNotifications(Xsk, TRUE);
+                NotificationsArmed = TRUE;
             } else {
-                Status = STATUS_DEVICE_REMOVED;
+                Status =
+                    KeWaitForSingleObject(
+                        &Xsk->PollRequested, UserRequest, UserMode, FALSE, WaitTimePtr);
+                if (Status != STATUS_SUCCESS) {
+                    return Status;
+                }
+                MoreData = TRUE;
             }
         }
+
+        if (MoreData) {
+            NotificationsArmed = FALSE;
+        }
     }
+}
 
-    RtlReleasePushLockExclusive(&Xsk->PollLock);
+static
+NTSTATUS
+XskSockoptSetPollMode(
+    _In_ XSK *Xsk,
+    _In_ XSK_SET_SOCKOPT_IN *Sockopt,
+    _In_ KPROCESSOR_MODE RequestorMode
+    )
+{
+    NTSTATUS Status;
+    CONST VOID *SockoptInputBuffer;
+    UINT32 SockoptInputBufferLength;
+    XSK_POLL_MODE PollMode;
 
-    EventWriteXskNotifyPokeStop(&MICROSOFT_XDP_PROVIDER, Xsk, Flags);
+    TraceEnter(TRACE_XSK, "Xsk=%p", Xsk);
+
+    //
+    // This is a nested buffer not copied by IO manager, so it needs special care.
+    //
+    SockoptInputBuffer = Sockopt->InputBuffer;
+    SockoptInputBufferLength = Sockopt->InputBufferLength;
+
+    if (SockoptInputBufferLength < sizeof(XSK_POLL_MODE)) {
+        Status = STATUS_INVALID_PARAMETER;
+        goto Exit;
+    }
+
+    __try {
+        if (RequestorMode != KernelMode) {
+            ProbeForRead(
+                (VOID*)SockoptInputBuffer, SockoptInputBufferLength, PROBE_ALIGNMENT(XSK_POLL_MODE));
+        }
+        RtlCopyVolatileMemory(&PollMode, SockoptInputBuffer, sizeof(XSK_POLL_MODE));
+    } __except (EXCEPTION_EXECUTE_HANDLER) {
+        Status = GetExceptionCode();
+        goto Exit;
+    }
+
+    XskAcquirePollLock(Xsk);
+    Status = XskSetPollMode(Xsk, PollMode);
+    XskReleasePollLock(Xsk);
+
+    if (NT_SUCCESS(Status)) {
+        TraceInfo(TRACE_XSK, "Xsk=%p Set poll mode PollMode=%u", Xsk, PollMode);
+    }
+
+Exit:
+
+    TraceExitStatus(TRACE_XSK);
 
     return Status;
 }
 
-static DRIVER_CANCEL XskCancelNotify;
-
 static
-_Use_decl_annotations_
-VOID
-XskCancelNotify(
-    DEVICE_OBJECT *DeviceObject,
-    IRP *Irp
+NTSTATUS
+XskSockoptSetPollSocketConfig(
+    _In_ XSK *Xsk,
+    _In_ XSK_SET_SOCKOPT_IN *Sockopt,
+    _In_ KPROCESSOR_MODE RequestorMode
     )
 {
-    XSK *Xsk;
-    IO_STACK_LOCATION *IrpSp;
+    NTSTATUS Status;
+    CONST VOID *SockoptIn;
+    UINT32 SockoptInSize;
+    XSK_POLL_SOCKET_CONFIG Config;
 
-    UNREFERENCED_PARAMETER(DeviceObject);
+    TraceEnter(TRACE_XSK, "Xsk=%p", Xsk);
+
+    //
+    // This is a nested buffer not copied by IO manager, so it needs special care.
+    //
+    SockoptIn = Sockopt->InputBuffer;
+    SockoptInSize = Sockopt->InputBufferLength;
+
+    if (SockoptInSize < XSK_SIZEOF_POLL_SOCKET_CONFIG_REVISION_1) {
+        Status = STATUS_BUFFER_TOO_SMALL;
+        goto Exit;
+    }
+
+    __try {
+        if (RequestorMode != KernelMode) {
+            ProbeForRead(
+                (VOID*)SockoptIn, SockoptInSize, PROBE_ALIGNMENT(XSK_POLL_SOCKET_CONFIG));
+        }
+        RtlCopyVolatileMemory(&Config, SockoptIn, XSK_SIZEOF_POLL_SOCKET_CONFIG_REVISION_1);
+    } __except (EXCEPTION_EXECUTE_HANDLER) {
+        Status = GetExceptionCode();
+        goto Exit;
+    }
+
+    if (Config.Header.Revision < XSK_POLL_SOCKET_CONFIG_REVISION_1 ||
+        Config.Header.Size < XSK_SIZEOF_POLL_SOCKET_CONFIG_REVISION_1) {
+        Status = STATUS_INVALID_PARAMETER;
+        goto Exit;
+    }
+
+    XskAcquirePollLock(Xsk);
+    Xsk->PollSocket.RxQuota =
+        Config.RxQuota != 0 ? Config.RxQuota : XSK_POLL_SOCKET_DEFAULT_QUOTA;
+    Xsk->PollSocket.TxQuota =
+        Config.TxQuota != 0 ? Config.TxQuota : XSK_POLL_SOCKET_DEFAULT_QUOTA;
+    Xsk->PollSocket.MinReadyBatch = max(Config.MinReadyBatch, 1);
+    XskReleasePollLock(Xsk);
+
+    TraceInfo(
+        TRACE_XSK, "Xsk=%p Set poll socket config RxQuota=%u TxQuota=%u MinReadyBatch=%u",
+        Xsk, Config.RxQuota, Config.TxQuota, Config.MinReadyBatch);
+
+    Status = STATUS_SUCCESS;
+
+Exit:
+
+    TraceExitStatus(TRACE_XSK);
+
+    return Status;
+}
+
+static
+NTSTATUS
+XskIrpGetSockopt(
+    _In_ IRP *Irp,
+    _In_ IO_STACK_LOCATION *IrpSp
+    )
+{
+    NTSTATUS Status = STATUS_SUCCESS;
+    XSK *Xsk;
+    UINT32 Option = 0;
+
+    Xsk = IrpSp->FileObject->FsContext;
+
+    if (IrpSp->Parameters.DeviceIoControl.InputBufferLength < sizeof(Option)) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    Option = *(UINT32 *)Irp->AssociatedIrp.SystemBuffer;
+
+    switch (Option) {
+    case XSK_SOCKOPT_RING_INFO:
+        Status = XskSockoptGetRingInfo(Xsk, Irp, IrpSp);
+        break;
+    case XSK_SOCKOPT_STATISTICS:
+        Status = XskSockoptGetStatistics(Xsk, Irp, IrpSp);
+        break;
+    case XSK_SOCKOPT_STATISTICS_EX:
+        Status = XskSockoptGetStatisticsEx(Xsk, Irp, IrpSp);
+        break;
+    case XSK_SOCKOPT_RX_HOOK_ID:
+    case XSK_SOCKOPT_TX_HOOK_ID:
+        Status = XskSockoptGetHookId(Xsk, Option, Irp, IrpSp);
+        break;
+    case XSK_SOCKOPT_RX_ERROR:
+    case XSK_SOCKOPT_RX_FILL_ERROR:
+    case XSK_SOCKOPT_TX_ERROR:
+    case XSK_SOCKOPT_TX_COMPLETION_ERROR:
+        Status = XskSockoptGetError(Xsk, Option, Irp, IrpSp);
+        break;
+    default:
+        Status = STATUS_NOT_SUPPORTED;
+        break;
+    }
+
+    TraceInfo(TRACE_XSK, "Xsk=%p Option=%u Status=%!STATUS!", Xsk, Option, Status);
+
+    return Status;
+}
+
+static
+_Success_(NT_SUCCESS(IoStatus->Status))
+VOID
+XskGetIdealProcessor(
+    _In_ XSK *Xsk,
+    _Inout_ XSK_KERNEL_RING *Ring,
+    _In_ KPROCESSOR_MODE PreviousMode,
+    _Out_ VOID *OutputBuffer,
+    _In_ UINT32 OutputBufferLength,
+    _Out_ IO_STATUS_BLOCK *IoStatus
+    )
+{
+    UINT32 ProcIndex;
+    PROCESSOR_NUMBER ProcNumber;
+
+    //
+    // N.B. This function must be called within a try/catch block.
+    //
+
+    if (ReadUInt32Acquire((UINT32 *)&Xsk->State) < XskActive || Ring->Size == 0) {
+        IoStatus->Status = STATUS_INVALID_DEVICE_STATE;
+        return;
+    }
+
+    if (OutputBufferLength < sizeof(PROCESSOR_NUMBER)) {
+        IoStatus->Status = STATUS_BUFFER_TOO_SMALL;
+        return;
+    }
+
+    if (PreviousMode != KernelMode) {
+        #pragma prefast(suppress:6001) // Using uninitialized memory '*OutputBuffer'
+        ProbeForWrite(
+            OutputBuffer, sizeof(PROCESSOR_NUMBER), PROBE_ALIGNMENT(PROCESSOR_NUMBER));
+    }
+
+    //
+    // Reset the affinity flag before reading the affinity value.
+    //
+    InterlockedAnd((LONG *)&Ring->Shared->Flags, ~XSK_RING_FLAG_AFFINITY_CHANGED);
+
+    ProcIndex = ReadUInt32NoFence(&Ring->IdealProcessor);
+    if (ProcIndex == INVALID_PROCESSOR_INDEX) {
+        IoStatus->Status = STATUS_DEVICE_NOT_READY;
+        return;
+    }
+
+    NT_VERIFY(NT_SUCCESS(KeGetProcessorNumberFromIndex(ProcIndex, &ProcNumber)));
+
+    *(PROCESSOR_NUMBER *)OutputBuffer = ProcNumber;
+    IoStatus->Information = sizeof(PROCESSOR_NUMBER);
+    IoStatus->Status = STATUS_SUCCESS;
+}
+
+#pragma warning(push)
+#pragma warning(disable:6101) // We don't set OutputBuffer in some paths
+static
+BOOLEAN
+XskFastGetSockopt(
+    _In_ XDP_FILE_OBJECT_HEADER *FileObjectHeader,
+    _In_opt_ VOID *InputBuffer,
+    _In_ UINT32 InputBufferLength,
+    _Out_opt_ VOID *OutputBuffer,
+    _In_ UINT32 OutputBufferLength,
+    _Out_ IO_STATUS_BLOCK *IoStatus
+    )
+{
+    XSK *Xsk = (XSK *)FileObjectHeader;
+    CONST KPROCESSOR_MODE PreviousMode = ExGetPreviousMode();
+    UINT32 Option = 0;
+
+    __try {
+        #pragma prefast(push)
+        #pragma prefast(disable:6011) // Dereferencing NULL pointer is safe within try/catch.
+        #pragma prefast(disable:6387) // Dereferencing NULL pointer is safe within try/catch.
+
+        if (InputBufferLength < sizeof(Option)) {
+            IoStatus->Status = STATUS_INVALID_PARAMETER;
+            goto Exit;
+        }
+
+        if (PreviousMode != KernelMode) {
+            ProbeForRead(
+                (VOID *)InputBuffer, InputBufferLength, PROBE_ALIGNMENT(UINT32));
+        }
+
+        Option = ReadUInt32NoFence(InputBuffer);
+
+        switch (Option) {
+        case XSK_SOCKOPT_RX_PROCESSOR_AFFINITY:
+            XskGetIdealProcessor(
+                Xsk, &Xsk->Rx.Ring, PreviousMode, OutputBuffer, OutputBufferLength, IoStatus);
+            break;
+
+        case XSK_SOCKOPT_TX_PROCESSOR_AFFINITY:
+            XskGetIdealProcessor(
+                Xsk, &Xsk->Tx.Ring, PreviousMode, OutputBuffer, OutputBufferLength, IoStatus);
+            break;
+
+        default:
+            //
+            // Fall back to the IRP-based socket option path.
+            //
+            return FALSE;
+        }
+
+        #pragma prefast(pop)
+    } __except (EXCEPTION_EXECUTE_HANDLER) {
+        IoStatus->Status = GetExceptionCode();
+        goto Exit;
+    }
+
+Exit:
+
+    return TRUE;
+}
+#pragma warning(pop)
+
+static
+NTSTATUS
+XskIrpSetSockopt(
+    _In_ IRP *Irp,
+    _In_ IO_STACK_LOCATION *IrpSp
+    )
+{
+    NTSTATUS Status = STATUS_SUCCESS;
+    XSK *Xsk;
+    XSK_SET_SOCKOPT_IN *Sockopt = NULL;
+
+    Xsk = IrpSp->FileObject->FsContext;
+
+    if (IrpSp->Parameters.DeviceIoControl.InputBufferLength < sizeof(XSK_SET_SOCKOPT_IN)) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    Sockopt = Irp->AssociatedIrp.SystemBuffer;
+
+    switch (Sockopt->Option) {
+    case XSK_SOCKOPT_UMEM_REG:
+        Status = XskSockoptSetUmem(Xsk, Sockopt, Irp->RequestorMode);
+        break;
+    case XSK_SOCKOPT_TX_RING_SIZE:
+    case XSK_SOCKOPT_RX_RING_SIZE:
+    case XSK_SOCKOPT_RX_FILL_RING_SIZE:
+    case XSK_SOCKOPT_TX_COMPLETION_RING_SIZE:
+        Status = XskSockoptSetRingSize(Xsk, Sockopt, Irp->RequestorMode);
+        break;
+    case XSK_SOCKOPT_RX_HOOK_ID:
+    case XSK_SOCKOPT_TX_HOOK_ID:
+        Status = XskSockoptSetHookId(Xsk, Sockopt, Irp->RequestorMode);
+        break;
+    case XSK_SOCKOPT_CAPTURE:
+        Status = XskSockoptSetCapture(Xsk, Sockopt, Irp->RequestorMode);
+        break;
+    case XSK_SOCKOPT_TX_DOORBELL:
+        Status = XskSockoptSetTxDoorbell(Xsk, Sockopt, Irp->RequestorMode);
+        break;
+    case XSK_SOCKOPT_EBPF_REDIRECT:
+        Status = XskSockoptSetEbpfRedirect(Xsk, Sockopt, Irp->RequestorMode);
+        break;
+    case XSK_SOCKOPT_RX_METADATA:
+        Status = XskSockoptSetRxMetadata(Xsk, Sockopt, Irp->RequestorMode);
+        break;
+    case XSK_SOCKOPT_RX_FILTER:
+        Status = XskSockoptSetRxFilter(Xsk, Sockopt, Irp->RequestorMode);
+        break;
+#if !defined(XDP_OFFICIAL_BUILD)
+    case XSK_SOCKOPT_POLL_MODE:
+        Status = XskSockoptSetPollMode(Xsk, Sockopt, Irp->RequestorMode);
+        break;
+    case XSK_SOCKOPT_POLL_SOCKET_CONFIG:
+        Status = XskSockoptSetPollSocketConfig(Xsk, Sockopt, Irp->RequestorMode);
+        break;
+#endif // !defined(XDP_OFFICIAL_BUILD)
+    default:
+        Status = STATUS_NOT_SUPPORTED;
+        break;
+    }
+
+    TraceInfo(
+        TRACE_XSK, "Xsk=%p Option=%u Status=%!STATUS! Value=%!HEXDUMP!",
+        Xsk, Sockopt->Option, Status, WppHexDump(Sockopt->InputBuffer, Sockopt->InputBufferLength));
+
+    return Status;
+}
+
+static
+NTSTATUS
+XskNotifyValidateParams(
+    _In_ XSK *Xsk,
+    _In_opt_ VOID *InputBuffer,
+    _In_ ULONG InputBufferLength,
+    _Out_ UINT64 *Timeout,
+    _Out_ BOOLEAN *PreciseTimeout,
+    _Out_ PUINT32 InFlags
+    )
+{
+    UINT32 TimeoutMilliseconds;
+
+    if (Xsk->State != XskActive){
+        return STATUS_INVALID_DEVICE_STATE;
+    }
+
+    if (InputBufferLength < sizeof(XSK_NOTIFY_IN)) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    __try {
+        ASSERT(InputBuffer);
+        if (ExGetPreviousMode() != KernelMode) {
+            ProbeForRead(
+                (VOID*)InputBuffer, InputBufferLength, PROBE_ALIGNMENT(XSK_NOTIFY_IN));
+        }
+
+        *InFlags = ReadUInt32NoFence((UINT32 *)&((XSK_NOTIFY_IN *)InputBuffer)->Flags);
+        TimeoutMilliseconds =
+            ReadUInt32NoFence(&((XSK_NOTIFY_IN *)InputBuffer)->WaitTimeoutMilliseconds);
+
+        //
+        // Requests with an extended length carry a timeout in 100ns units.
+        //
+        *PreciseTimeout = InputBufferLength >= sizeof(XSK_NOTIFY_PRECISE_IN);
+        if (*PreciseTimeout) {
+            *Timeout =
+                ReadUInt64NoFence(&((XSK_NOTIFY_PRECISE_IN *)InputBuffer)->WaitTimeout);
+        } else if (TimeoutMilliseconds == INFINITE) {
+            *Timeout = XSK_NOTIFY_TIMEOUT_INFINITE;
+        } else {
+            *Timeout = RTL_MILLISEC_TO_100NANOSEC((UINT64)TimeoutMilliseconds);
+        }
+    } __except (EXCEPTION_EXECUTE_HANDLER) {
+        return GetExceptionCode();
+    }
+
+    //
+    // Relative timeouts are negated into signed kernel due times, so reject
+    // finite values that do not fit.
+    //
+    if (*Timeout > MAXLONG64 && *Timeout != XSK_NOTIFY_TIMEOUT_INFINITE) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    if (*InFlags == 0 || *InFlags &
+            ~(XSK_NOTIFY_FLAG_POKE_RX | XSK_NOTIFY_FLAG_POKE_TX | XSK_NOTIFY_FLAG_WAIT_RX | XSK_NOTIFY_FLAG_WAIT_TX)) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    if ((*InFlags & (XSK_NOTIFY_FLAG_POKE_RX | XSK_NOTIFY_FLAG_WAIT_RX) && Xsk->Rx.Ring.Size == 0) ||
+        (*InFlags & (XSK_NOTIFY_FLAG_POKE_TX | XSK_NOTIFY_FLAG_WAIT_TX) && Xsk->Tx.Ring.Size == 0)) {
+        return STATUS_INVALID_DEVICE_STATE;
+    }
+
+    //
+    // Notify set members can only wait via their notify set.
+    //
+    if ((*InFlags & (XSK_NOTIFY_FLAG_WAIT_RX | XSK_NOTIFY_FLAG_WAIT_TX)) &&
+        ReadPointerNoFence(&Xsk->NotifySetMember) != NULL) {
+        return STATUS_INVALID_DEVICE_STATE;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+static
+NTSTATUS
+XskPoke(
+    _In_ XSK *Xsk,
+    _In_ UINT32 Flags,
+    _In_ UINT64 Timeout
+    )
+{
+    NTSTATUS Status = STATUS_SUCCESS;
+
+    EventWriteXskNotifyPokeStart(&MICROSOFT_XDP_PROVIDER, Xsk, Flags);
+
+    RtlAcquirePushLockExclusive(&Xsk->PollLock);
+
+    if (Flags & XSK_NOTIFY_FLAG_POKE_RX) {
+        Xsk->ExtendedStatistics.RxPokes++;
+    }
+    if (Flags & XSK_NOTIFY_FLAG_POKE_TX) {
+        Xsk->ExtendedStatistics.TxPokes++;
+    }
+
+    if (Xsk->PollMode == XSK_POLL_MODE_SOCKET &&
+        (Xsk->Rx.Xdp.PollHandle != NULL || Xsk->Tx.Xdp.PollHandle != NULL)) {
+        //
+        // Socket polling mode is active, so poll the interfaces synchronously.
+        //
+        Status = XskPollSocket(Xsk, Flags, Timeout);
+    } else {
+        //
+        // Notify the underlying interfaces that data is available.
+        //
+
+        if (Flags & XSK_NOTIFY_FLAG_POKE_RX) {
+            ASSERT(Xsk->Rx.Ring.Size > 0);
+            ASSERT(Xsk->Rx.FillRing.Size > 0);
+            //
+            // TODO: Driver poke routine for zero copy RX.
+            //
+            ASSERT(Status == STATUS_SUCCESS);
+        }
+
+        if (Flags & XSK_NOTIFY_FLAG_POKE_TX) {
+            XDP_NOTIFY_QUEUE_FLAGS NotifyFlags = XDP_NOTIFY_QUEUE_FLAG_TX;
+            //
+            // Before invoking the poke routine, atomically clear the need poke
+            // flag on the TX ring. The poke routine is required to execute a
+            // FlushTransmit, which guarantees the need poke flag can be set.
+            //
+            InterlockedAnd((LONG *)&Xsk->Tx.Ring.Shared->Flags, ~XSK_RING_FLAG_NEED_POKE);
+
+            if (Xsk->Tx.Xdp.Flags.QueueActive) {
+                XdpTxQueueInvokeInterfaceNotify(Xsk->Tx.Xdp.Queue, NotifyFlags);
+            } else {
+                Status = STATUS_DEVICE_REMOVED;
+            }
+        }
+    }
+
+    RtlReleasePushLockExclusive(&Xsk->PollLock);
+
+    if (Flags & XSK_NOTIFY_FLAG_POKE_TX) {
+        XskTxDoorbellWake(Xsk);
+    }
+
+    EventWriteXskNotifyPokeStop(&MICROSOFT_XDP_PROVIDER, Xsk, Flags);
+
+    return Status;
+}
+
+static
+BOOLEAN
+XskTxDoorbellPollSocket(
+    _In_ XSK *Xsk
+    )
+{
+    XSK_TX_DOORBELL *Doorbell = &Xsk->Tx.Doorbell;
+    UINT32 ProducerIndex = ReadUInt32Acquire(&Xsk->Tx.Ring.Shared->ProducerIndex);
+
+    //
+    // Polls the socket's TX ring once. Returns FALSE once the socket has been
+    // idle for its idle timeout and has handed the need poke state back to the
+    // application.
+    //
+    if (ProducerIndex != Doorbell->LastProducerIndex) {
+        Doorbell->LastProducerIndex = ProducerIndex;
+        Doorbell->IdleStartTime = KeQueryInterruptTime();
+    } else if (KeQueryInterruptTime() - Doorbell->IdleStartTime >= Doorbell->IdleTimeout) {
+        //
+        // Hand the need poke state back to the shared ring. If the application
+        // produced descriptors before observing the flag, it may not poke, so
+        // re-check the TX ring and keep polling on its behalf.
+        //
+        InterlockedExchange8((CHAR *)&Doorbell->Awake, FALSE);
+
+        if (InterlockedExchange8((CHAR *)&Doorbell->NeedNotify, FALSE)) {
+            InterlockedOr((LONG *)&Xsk->Tx.Ring.Shared->Flags, XSK_RING_FLAG_NEED_POKE);
+        }
+
+        if (!(ReadUInt32Acquire(&Xsk->Tx.Ring.Shared->Flags) & XSK_RING_FLAG_NEED_POKE) ||
+            XskRingConsPeek(&Xsk->Tx.Ring, 1) == 0) {
+            return FALSE;
+        }
+
+        InterlockedExchange8((CHAR *)&Doorbell->Awake, TRUE);
+
+        if (InterlockedAnd((LONG *)&Xsk->Tx.Ring.Shared->Flags, ~XSK_RING_FLAG_NEED_POKE) &
+                XSK_RING_FLAG_NEED_POKE) {
+            InterlockedExchange8((CHAR *)&Doorbell->NeedNotify, TRUE);
+        }
+
+        Doorbell->IdleStartTime = KeQueryInterruptTime();
+    }
+
+    if (ReadBooleanAcquire(&Doorbell->NeedNotify) && XskRingConsPeek(&Xsk->Tx.Ring, 1) > 0) {
+        InterlockedExchange8((CHAR *)&Doorbell->NeedNotify, FALSE);
+        XskPoke(Xsk, XSK_NOTIFY_FLAG_POKE_TX, 0);
+    }
+
+    return TRUE;
+}
+
+static KSTART_ROUTINE XskTxDoorbellWorker;
+
+static
+_Use_decl_annotations_
+VOID
+XskTxDoorbellWorker(
+    VOID *Context
+    )
+{
+    XSK_TX_DOORBELL_POLLER *Poller = Context;
+    GROUP_AFFINITY Affinity = {0};
+    GROUP_AFFINITY OldAffinity;
+    PROCESSOR_NUMBER ProcessorNumber;
+
+    KeGetProcessorNumberFromIndex(Poller->ProcessorIndex, &ProcessorNumber);
+    Affinity.Group = ProcessorNumber.Group;
+    Affinity.Mask = AFFINITY_MASK(ProcessorNumber.Number);
+    KeSetSystemGroupAffinityThread(&Affinity, &OldAffinity);
+
+    //
+    // Set the thread priority to the same priority as the interface execution
+    // context's passive worker.
+    //
+    KeSetPriorityThread(KeGetCurrentThread(), 12);
+
+    while (TRUE) {
+        KeWaitForSingleObject(&Poller->WakeEvent, Executive, KernelMode, FALSE, NULL);
+
+        if (ReadBooleanAcquire(&Poller->Stop)) {
+            break;
+        }
+
+        RtlAcquirePushLockExclusive(&Poller->Lock);
+
+        while (!IsListEmpty(&Poller->Sockets)) {
+            LIST_ENTRY *Entry = Poller->Sockets.Flink;
+
+            while (Entry != &Poller->Sockets) {
+                XSK *Xsk = CONTAINING_RECORD(Entry, XSK, Tx.Doorbell.Link);
+
+                Entry = Entry->Flink;
+
+                if (!XskTxDoorbellPollSocket(Xsk)) {
+                    RemoveEntryList(&Xsk->Tx.Doorbell.Link);
+                    WriteBooleanRelease(&Xsk->Tx.Doorbell.Queued, FALSE);
+                }
+            }
+
+            //
+            // Allow sockets to be queued and removed between polling passes.
+            //
+            RtlReleasePushLockExclusive(&Poller->Lock);
+            YieldProcessor();
+            RtlAcquirePushLockExclusive(&Poller->Lock);
+        }
+
+        RtlReleasePushLockExclusive(&Poller->Lock);
+    }
+
+    KeRevertToUserGroupAffinityThread(&OldAffinity);
+}
+
+static
+_IRQL_requires_(PASSIVE_LEVEL)
+VOID
+XskTxDoorbellDeletePoller(
+    _In_ XSK_TX_DOORBELL_POLLER *Poller
+    )
+{
+    if (Poller->Thread != NULL) {
+        ASSERT(IsListEmpty(&Poller->Sockets));
+        WriteBooleanRelease(&Poller->Stop, TRUE);
+        KeSetEvent(&Poller->WakeEvent, IO_NO_INCREMENT, FALSE);
+        KeWaitForSingleObject(Poller->Thread, Executive, KernelMode, FALSE, NULL);
+        ObDereferenceObject(Poller->Thread);
+    }
+
+    ExFreePoolWithTag(Poller, POOLTAG_DOORBELL);
+}
+
+static
+_IRQL_requires_(PASSIVE_LEVEL)
+XSK_TX_DOORBELL_POLLER *
+XskTxDoorbellGetPoller(
+    _In_ UINT32 ProcessorIndex
+    )
+{
+    XSK_TX_DOORBELL_POLLER *Poller;
+    HANDLE ThreadHandle = NULL;
+    NTSTATUS Status;
+
+    ASSERT(ProcessorIndex < XskGlobals.DoorbellPollerCount);
+
+    Poller = ReadPointerAcquire(&XskGlobals.DoorbellPollers[ProcessorIndex]);
+    if (Poller != NULL) {
+        return Poller;
+    }
+
+    RtlAcquirePushLockExclusive(&XskGlobals.DoorbellPollersLock);
+
+    Poller = XskGlobals.DoorbellPollers[ProcessorIndex];
+    if (Poller != NULL) {
+        goto Exit;
+    }
+
+    Poller = ExAllocatePoolZero(NonPagedPoolNx, sizeof(*Poller), POOLTAG_DOORBELL);
+    if (Poller == NULL) {
+        goto Exit;
+    }
+
+    ExInitializePushLock(&Poller->Lock);
+    InitializeListHead(&Poller->Sockets);
+    KeInitializeEvent(&Poller->WakeEvent, SynchronizationEvent, FALSE);
+    Poller->ProcessorIndex = ProcessorIndex;
+
+    Status =
+        PsCreateSystemThread(
+            &ThreadHandle, THREAD_ALL_ACCESS, NULL, NULL, NULL, XskTxDoorbellWorker, Poller);
+    if (!NT_SUCCESS(Status)) {
+        XskTxDoorbellDeletePoller(Poller);
+        Poller = NULL;
+        goto Exit;
+    }
+
+    Status =
+        ObReferenceObjectByHandle(
+            ThreadHandle, THREAD_ALL_ACCESS, *PsThreadType, KernelMode, &Poller->Thread, NULL);
+    FRE_ASSERT(NT_SUCCESS(Status));
+    ZwClose(ThreadHandle);
+
+    WritePointerRelease(&XskGlobals.DoorbellPollers[ProcessorIndex], Poller);
+
+Exit:
+
+    RtlReleasePushLockExclusive(&XskGlobals.DoorbellPollersLock);
+
+    return Poller;
+}
+
+static
+_IRQL_requires_(PASSIVE_LEVEL)
+VOID
+XskTxDoorbellWake(
+    _In_ XSK *Xsk
+    )
+{
+    XSK_TX_DOORBELL *Doorbell = &Xsk->Tx.Doorbell;
+    XSK_TX_DOORBELL_POLLER *Poller;
+    UINT32 ProcessorIndex;
+
+    //
+    // Pokes issued by a poller on behalf of a queued socket return here
+    // without acquiring any locks.
+    //
+    if (!Doorbell->Enabled || ReadBooleanAcquire(&Doorbell->Queued)) {
+        return;
+    }
+
+    if (ReadUInt32Acquire((UINT32 *)&Xsk->State) != XskActive || Xsk->Tx.Ring.Size == 0) {
+        return;
+    }
+
+    //
+    // Queue the socket to the poller of its TX ring's ideal processor. Until
+    // the data path has run, use the current processor. If the poller cannot
+    // be created, the application continues to poke the interface itself.
+    //
+    ProcessorIndex = ReadUInt32NoFence(&Xsk->Tx.Ring.IdealProcessor);
+    if (ProcessorIndex == INVALID_PROCESSOR_INDEX) {
+        ProcessorIndex = KeGetCurrentProcessorIndex();
+    }
+
+    Poller = XskTxDoorbellGetPoller(ProcessorIndex);
+    if (Poller == NULL) {
+        return;
+    }
+
+    RtlAcquirePushLockExclusive(&Doorbell->Lock);
+
+    if (!Doorbell->Queued && !Doorbell->Stop) {
+        RtlAcquirePushLockExclusive(&Poller->Lock);
+
+        //
+        // Take ownership of any pending need poke state from the shared ring,
+        // so the application does not poke while the poller is awake.
+        //
+        InterlockedExchange8((CHAR *)&Doorbell->Awake, TRUE);
+
+        if (InterlockedAnd((LONG *)&Xsk->Tx.Ring.Shared->Flags, ~XSK_RING_FLAG_NEED_POKE) &
+                XSK_RING_FLAG_NEED_POKE) {
+            InterlockedExchange8((CHAR *)&Doorbell->NeedNotify, TRUE);
+        }
+
+        Doorbell->LastProducerIndex = ReadUInt32Acquire(&Xsk->Tx.Ring.Shared->ProducerIndex);
+        Doorbell->IdleStartTime = KeQueryInterruptTime();
+        Doorbell->Poller = Poller;
+        InsertTailList(&Poller->Sockets, &Doorbell->Link);
+        WriteBooleanRelease(&Doorbell->Queued, TRUE);
+
+        RtlReleasePushLockExclusive(&Poller->Lock);
+
+        KeSetEvent(&Poller->WakeEvent, IO_NO_INCREMENT, FALSE);
+    }
+
+    RtlReleasePushLockExclusive(&Doorbell->Lock);
+}
+
+static
+_IRQL_requires_(PASSIVE_LEVEL)
+VOID
+XskTxDoorbellStop(
+    _In_ XSK *Xsk
+    )
+{
+    XSK_TX_DOORBELL *Doorbell = &Xsk->Tx.Doorbell;
+    XSK_TX_DOORBELL_POLLER *Poller;
+
+    if (!Doorbell->Enabled) {
+        return;
+    }
+
+    RtlAcquirePushLockExclusive(&Doorbell->Lock);
+    Doorbell->Stop = TRUE;
+    Poller = Doorbell->Poller;
+    RtlReleasePushLockExclusive(&Doorbell->Lock);
+
+    //
+    // The socket can no longer be queued. Once it is removed from its poller,
+    // the poller no longer references it.
+    //
+    if (Poller != NULL) {
+        RtlAcquirePushLockExclusive(&Poller->Lock);
+
+        if (Doorbell->Queued) {
+            RemoveEntryList(&Doorbell->Link);
+            Doorbell->Queued = FALSE;
+        }
+
+        RtlReleasePushLockExclusive(&Poller->Lock);
+    }
+
+    Doorbell->Awake = FALSE;
+}
+
+static DRIVER_CANCEL XskCancelNotify;
+
+static
+_Use_decl_annotations_
+VOID
+XskCancelNotify(
+    DEVICE_OBJECT *DeviceObject,
+    IRP *Irp
+    )
+{
+    XSK *Xsk;
+    IO_STACK_LOCATION *IrpSp;
+
+    UNREFERENCED_PARAMETER(DeviceObject);
+
+    IoReleaseCancelSpinLock(DISPATCH_LEVEL);
+
+    IrpSp = IoGetCurrentIrpStackLocation(Irp);
+    Xsk = IrpSp->FileObject->FsContext;
+
+    KeAcquireSpinLockAtDpcLevel(&Xsk->Lock);
+
+    //
+    // If the data path hasn't already dropped the IRP, reset the wait state
+    // here.
+    //
+
+    if (Xsk->IoWaitIrp == Irp) {
+        Xsk->IoWaitFlags = 0;
+        Xsk->IoWaitIrp = NULL;
+    }
+
+    KeReleaseSpinLock(&Xsk->Lock, Irp->CancelIrql);
+
+    Irp->IoStatus.Status = STATUS_CANCELLED;
+
+    EventWriteXskNotifyAsyncComplete(&MICROSOFT_XDP_PROVIDER, Xsk, Irp, Irp->IoStatus.Status);
+    IoCompleteRequest(Irp, IO_NETWORK_INCREMENT);
+}
+
+static EXT_CALLBACK XskIoWaitTimerCallback;
+
+static
+_Use_decl_annotations_
+VOID
+XskIoWaitTimerCallback(
+    EX_TIMER *Timer,
+    VOID *Context
+    )
+{
+    XSK *Xsk = Context;
+
+    UNREFERENCED_PARAMETER(Timer);
+
+    KeSetEvent(&Xsk->IoWaitTimerEvent, IO_NO_INCREMENT, FALSE);
+}
+
+static
+_IRQL_requires_(PASSIVE_LEVEL)
+NTSTATUS
+XskWaitIoPrecise(
+    _In_ XSK *Xsk,
+    _In_ UINT64 Timeout
+    )
+{
+    EX_TIMER *Timer;
+    VOID *WaitObjects[2];
+    NTSTATUS Status;
+
+    if (Timeout > MAXLONG64) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    //
+    // The kernel dispatcher wait timeout is rounded up to the system timer
+    // resolution, so time sub-millisecond waits with a high-resolution timer
+    // that is allocated on first use.
+    //
+    Timer = ReadPointerAcquire(&Xsk->IoWaitTimer);
+    if (Timer == NULL) {
+        EX_TIMER *OldTimer;
+
+        Timer = ExAllocateTimer(XskIoWaitTimerCallback, Xsk, EX_TIMER_HIGH_RESOLUTION);
+        if (Timer == NULL) {
+            return STATUS_NO_MEMORY;
+        }
+
+        OldTimer = InterlockedCompareExchangePointer(&Xsk->IoWaitTimer, Timer, NULL);
+        if (OldTimer != NULL) {
+            ExDeleteTimer(Timer, TRUE, FALSE, NULL);
+            Timer = OldTimer;
+        }
+    }
+
+    KeClearEvent(&Xsk->IoWaitTimerEvent);
+    ExSetTimer(Timer, -(LONG64)Timeout, 0, NULL);
+
+    WaitObjects[0] = &Xsk->IoWaitEvent;
+    WaitObjects[1] = &Xsk->IoWaitTimerEvent;
+    Status =
+        KeWaitForMultipleObjects(
+            RTL_NUMBER_OF(WaitObjects), WaitObjects, WaitAny, UserRequest, UserMode, FALSE,
+            NULL, NULL);
+    if (Status == STATUS_WAIT_1) {
+        Status = STATUS_TIMEOUT;
+    }
+
+    //
+    // If the timer could not be cancelled, it has expired and its callback
+    // may still be running. Wait for the callback to signal the timer event,
+    // so a stale signal cannot satisfy the next wait after it clears the event.
+    //
+    if (!ExCancelTimer(Timer, NULL)) {
+        KeWaitForSingleObject(&Xsk->IoWaitTimerEvent, Executive, KernelMode, FALSE, NULL);
+    }
+
+    return Status;
+}
+
+static
+_Success_(return == STATUS_SUCCESS)
+NTSTATUS
+XskNotify(
+    _In_ XSK *Xsk,
+    _In_opt_ VOID *InputBuffer,
+    _In_ ULONG InputBufferLength,
+    _Out_ ULONG_PTR *Information,
+    _Inout_opt_ IRP *Irp
+    )
+{
+    UINT64 WaitTimeout;
+    BOOLEAN PreciseTimeout;
+    UINT32 ReadyFlags;
+    UINT32 InFlags;
+    UINT32 OutFlags = 0;
+    KIRQL OldIrql;
+    LARGE_INTEGER Timeout;
+    NTSTATUS Status;
+    XSK_IO_WAIT_FLAGS InternalFlags;
+    CONST UINT32 WaitMask = (XSK_NOTIFY_FLAG_WAIT_RX | XSK_NOTIFY_FLAG_WAIT_TX);
+
+    Status =
+        XskNotifyValidateParams(
+            Xsk, InputBuffer, InputBufferLength, &WaitTimeout, &PreciseTimeout, &InFlags);
+    if (Status != STATUS_SUCCESS) {
+        TraceError(TRACE_XSK, "Xsk=%p Notify failed: Invalid params", Xsk);
+        goto Exit;
+    }
+
+    EventWriteXskNotifyStart(
+        &MICROSOFT_XDP_PROVIDER, Xsk, Irp, InFlags,
+        (UINT32)min(WaitTimeout / RTL_MILLISEC_TO_100NANOSEC(1), INFINITE));
+
+    //
+    // Snap the XSK notification state before performing the poke and/or wait.
+    //
+    InternalFlags = ReadULongAcquire((ULONG *)&Xsk->IoWaitInternalFlags);
+
+    if (InFlags & (XSK_NOTIFY_FLAG_POKE_RX | XSK_NOTIFY_FLAG_POKE_TX)) {
+        Status = XskPoke(Xsk, InFlags, WaitTimeout);
+        if (Status != STATUS_SUCCESS) {
+            TraceError(
+                TRACE_XSK, "Xsk=%p Notify failed: Poke failed Status=%!STATUS!",
+                Xsk, Status);
+            goto Exit;
+        }
+    }
+
+    if ((InFlags & (XSK_NOTIFY_FLAG_WAIT_RX | XSK_NOTIFY_FLAG_WAIT_TX)) == 0) {
+        //
+        // Not interested in waiting for IO.
+        //
+        ASSERT(Status == STATUS_SUCCESS);
+        goto Exit;
+    }
+
+    //
+    // Opportunistic check for ready IO to avoid setting up a wait context.
+    //
+    ReadyFlags = XskQueryReadyIo(Xsk, InFlags);
+    if (ReadyFlags != 0) {
+        OutFlags |= XskWaitInFlagsToOutFlags(ReadyFlags);
+        ASSERT(Status == STATUS_SUCCESS);
+        goto Exit;
+    }
+
+    //
+    // Set up the wait context.
+    //
+    KeAcquireSpinLock(&Xsk->Lock, &OldIrql);
+    if (Xsk->State != XskActive) {
+        KeReleaseSpinLock(&Xsk->Lock, OldIrql);
+        TraceInfo(TRACE_XSK, "Xsk=%p Notify wait failed: XSK not bound", Xsk);
+        Status = STATUS_INVALID_DEVICE_STATE;
+        goto Exit;
+    }
+    if (Xsk->IoWaitFlags != 0 || Xsk->NotifySetMember != NULL) {
+        //
+        // There is currently a wait active. Only a single wait is allowed.
+        //
+        KeReleaseSpinLock(&Xsk->Lock, OldIrql);
+        TraceError(TRACE_XSK, "Xsk=%p Notify wait failed: Wait already active", Xsk);
+        Status = STATUS_INVALID_DEVICE_STATE;
+        goto Exit;
+    }
+    Xsk->IoWaitFlags = InFlags & WaitMask;
+    if (Irp != NULL) {
+        Xsk->IoWaitIrp = Irp;
+
+        //
+        // Mark the IRP as pending prior to enabling cancellation; once we mark
+        // an IRP as pending, we must return STATUS_PENDING to the IO manager.
+        //
+        IoMarkIrpPending(Irp);
+        Status = STATUS_PENDING;
+
+        //
+        // Enable cancellation and synchronize with the IO manager.
+        //
+        IoSetCancelRoutine(Irp, XskCancelNotify);
+        if (Irp->Cancel) {
+            if (IoSetCancelRoutine(Irp, NULL) != NULL) {
+                //
+                // The cancellation routine will not run; cancel the IRP here
+                // and bail.
+                //
+                Xsk->IoWaitIrp = NULL;
+                Xsk->IoWaitFlags = 0;
+                KeReleaseSpinLock(&Xsk->Lock, OldIrql);
+                Irp->IoStatus.Status = STATUS_CANCELLED;
+                EventWriteXskNotifyAsyncComplete(
+                    &MICROSOFT_XDP_PROVIDER, Xsk, Irp, Irp->IoStatus.Status);
+                IoCompleteRequest(Irp, IO_NETWORK_INCREMENT);
+            } else {
+                //
+                // The cancellation routine will run; bail.
+                //
+                KeReleaseSpinLock(&Xsk->Lock, OldIrql);
+            }
+
+            goto Exit;
+        }
+    } else {
+        KeClearEvent(&Xsk->IoWaitEvent);
+    }
+    KeReleaseSpinLock(&Xsk->Lock, OldIrql);
+
+    //
+    // N.B. A memory barrier between the write of the wait event and the read of
+    // completed IO is needed in order to prevent a race condition when these
+    // operations are re-ordered. The race is between this thread and a thread
+    // completing IO. Memory barriers are also needed to protect against a
+    // similar race condition when the inverse of these operations are done
+    // during IO completion.
+    //
+    KeMemoryBarrier();
+
+    //
+    // Check for ready IO.
+    //
+    ReadyFlags = XskQueryReadyIo(Xsk, InFlags);
+    if (ReadyFlags != 0) {
+        XskSignalReadyIo(Xsk, ReadyFlags);
+    }
+
+    //
+    // If the notification state changed while processing this request, abandon
+    // the wait and allow the application to re-examine the shared ring flags.
+    //
+    if (InternalFlags != Xsk->IoWaitInternalFlags) {
+        XskSignalReadyIo(Xsk, InFlags & WaitMask);
+    }
+
+    if (Irp == NULL) {
+        //
+        // Wait for IO.
+        //
+        if (PreciseTimeout && WaitTimeout != XSK_NOTIFY_TIMEOUT_INFINITE) {
+            Status = XskWaitIoPrecise(Xsk, WaitTimeout);
+        } else {
+            Timeout.QuadPart = -(LONG64)WaitTimeout;
+            Status =
+                KeWaitForSingleObject(
+                    &Xsk->IoWaitEvent, UserRequest, UserMode, FALSE,
+                    (WaitTimeout == XSK_NOTIFY_TIMEOUT_INFINITE) ? NULL : &Timeout);
+        }
+    } else {
+        ASSERT(Status == STATUS_PENDING);
+        goto Exit;
+    }
+
+    KeAcquireSpinLock(&Xsk->Lock, &OldIrql);
+    Xsk->IoWaitFlags = 0;
+    KeReleaseSpinLock(&Xsk->Lock, OldIrql);
+
+    //
+    // Re-query ready IO regardless of the wait status.
+    //
+    ReadyFlags = XskQueryReadyIo(Xsk, InFlags);
+    if (ReadyFlags != 0) {
+        Status = STATUS_SUCCESS;
+        OutFlags |= XskWaitInFlagsToOutFlags(ReadyFlags);
+    }
+
+Exit:
+
+    //
+    // This IOCTL is assumed to never pend for fast IO, and code elsewhere takes
+    // advantage of this assumption.
+    //
+    ASSERT(Irp != NULL || Status != STATUS_PENDING);
+
+    if (Status != STATUS_PENDING) {
+        *Information = OutFlags;
+    }
+
+    EventWriteXskNotifyStop(&MICROSOFT_XDP_PROVIDER, Xsk, Irp, OutFlags, Status);
+
+    return Status;
+}
+
+#pragma warning(push)
+#pragma warning(disable:6101) // We don't set OutputBuffer in some paths
+BOOLEAN
+XskFastIo(
+    _In_ XDP_FILE_OBJECT_HEADER *FileObjectHeader,
+    _In_opt_ VOID *InputBuffer,
+    _In_ ULONG InputBufferLength,
+    _Out_opt_ VOID *OutputBuffer,
+    _In_ ULONG OutputBufferLength,
+    _In_ ULONG IoControlCode,
+    _Out_ IO_STATUS_BLOCK *IoStatus
+    )
+{
+    XSK *Xsk = CONTAINING_RECORD(FileObjectHeader, XSK, Header);
+
+    switch (IoControlCode) {
+    case IOCTL_XSK_NOTIFY:
+        IoStatus->Status =
+            XskNotify(
+                Xsk, InputBuffer, InputBufferLength, &IoStatus->Information, NULL);
+        return TRUE;
+
+    case IOCTL_XSK_GET_SOCKOPT:
+        return
+            XskFastGetSockopt(
+                FileObjectHeader, InputBuffer, InputBufferLength, OutputBuffer,
+                OutputBufferLength, IoStatus);
+    }
+
+    return FALSE;
+}
+#pragma warning(pop)
+
+static
+VOID
+XskNotifySetReference(
+    _In_ XSK_NOTIFY_SET *Set
+    )
+{
+    XdpIncrementReferenceCount(&Set->ReferenceCount);
+}
+
+static
+VOID
+XskNotifySetDereference(
+    _In_ XSK_NOTIFY_SET *Set
+    )
+{
+    if (XdpDecrementReferenceCount(&Set->ReferenceCount)) {
+        ExFreePoolWithTag(Set, POOLTAG_NOTIFY_SET);
+    }
+}
+
+_Use_decl_annotations_
+NTSTATUS
+XskIrpCreateNotifySet(
+    IRP *Irp,
+    IO_STACK_LOCATION *IrpSp,
+    UCHAR Disposition,
+    VOID *InputBuffer,
+    SIZE_T InputBufferLength
+    )
+{
+    NTSTATUS Status = STATUS_SUCCESS;
+    XSK_NOTIFY_SET *Set = NULL;
+
+    UNREFERENCED_PARAMETER(Irp);
+    UNREFERENCED_PARAMETER(Disposition);
+    UNREFERENCED_PARAMETER(InputBuffer);
+    UNREFERENCED_PARAMETER(InputBufferLength);
+
+    Set = ExAllocatePoolZero(NonPagedPoolNx, sizeof(*Set), POOLTAG_NOTIFY_SET);
+    if (Set == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto Exit;
+    }
+
+    Set->Header.ObjectType = XDP_OBJECT_TYPE_XSK_NOTIFY_SET;
+    Set->Header.Dispatch = &XskNotifySetFileDispatch;
+    XdpInitializeReferenceCount(&Set->ReferenceCount);
+    ExInitializePushLock(&Set->MemberLock);
+    InitializeListHead(&Set->Members);
+    KeInitializeSpinLock(&Set->Lock);
+    InitializeListHead(&Set->ReadyList);
+    InitializeListHead(&Set->RearmList);
+    KeInitializeEvent(&Set->WaitEvent, NotificationEvent, FALSE);
+
+    IrpSp->FileObject->FsContext = Set;
+
+Exit:
+
+    TraceInfo(TRACE_XSK, "NotifySet=%p Status=%!STATUS!", Set, Status);
+
+    return Status;
+}
+
+static
+VOID
+XskNotifySetArmMember(
+    _In_ XSK_NOTIFY_SET_MEMBER *Member
+    )
+{
+    XSK *Xsk = Member->Xsk;
+    UINT32 ReadyFlags;
+    KIRQL OldIrql;
+
+    ASSERT(IsListEmpty(&Member->StateLink));
+
+    KeAcquireSpinLock(&Xsk->Lock, &OldIrql);
+    if (Xsk->State != XskActive) {
+        //
+        // Report inactive sockets without any ready IO.
+        //
+        XskNotifySetQueueReady(Member, XSK_NOTIFY_RESULT_FLAG_NONE);
+        KeReleaseSpinLock(&Xsk->Lock, OldIrql);
+        return;
+    }
+    Xsk->IoWaitFlags = Member->WaitFlags;
+    KeClearEvent(&Xsk->IoWaitEvent);
+    KeReleaseSpinLock(&Xsk->Lock, OldIrql);
+
+    //
+    // N.B. See comment in XskNotify.
+    //
+    KeMemoryBarrier();
+
+    ReadyFlags = XskQueryReadyIo(Xsk, Member->WaitFlags);
+    if (ReadyFlags != 0) {
+        XskSignalReadyIo(Xsk, ReadyFlags);
+    }
+}
+
+static
+_Requires_exclusive_lock_held_(&Set->MemberLock)
+VOID
+XskNotifySetRemoveMember(
+    _In_ XSK_NOTIFY_SET *Set,
+    _In_ XSK_NOTIFY_SET_MEMBER *Member
+    )
+{
+    XSK *Xsk = Member->Xsk;
+    KIRQL OldIrql;
+
+    //
+    // Once the socket no longer refers to the member, the data path cannot
+    // queue it to the ready list.
+    //
+    KeAcquireSpinLock(&Xsk->Lock, &OldIrql);
+    ASSERT(Xsk->NotifySetMember == Member);
+    Xsk->NotifySetMember = NULL;
+    Xsk->IoWaitFlags = 0;
+    KeReleaseSpinLock(&Xsk->Lock, OldIrql);
+
+    KeAcquireSpinLock(&Set->Lock, &OldIrql);
+    if (!IsListEmpty(&Member->StateLink)) {
+        RemoveEntryList(&Member->StateLink);
+    }
+    KeReleaseSpinLock(&Set->Lock, OldIrql);
+
+    RemoveEntryList(&Member->Link);
+
+    TraceInfo(TRACE_XSK, "NotifySet=%p Xsk=%p removed", Set, Xsk);
+
+    XskDereference(Xsk);
+    ExFreePoolWithTag(Member, POOLTAG_NOTIFY_SET);
+}
+
+static
+VOID
+XskNotifySetDetachSocket(
+    _In_ XSK *Xsk
+    )
+{
+    XSK_NOTIFY_SET *Set = NULL;
+    KIRQL OldIrql;
 
-    IoReleaseCancelSpinLock(DISPATCH_LEVEL);
+    KeAcquireSpinLock(&Xsk->Lock, &OldIrql);
+    if (Xsk->NotifySetMember != NULL) {
+        Set = Xsk->NotifySetMember->Set;
+        XskNotifySetReference(Set);
+    }
+    KeReleaseSpinLock(&Xsk->Lock, OldIrql);
 
-    IrpSp = IoGetCurrentIrpStackLocation(Irp);
-    Xsk = IrpSp->FileObject->FsContext;
+    if (Set == NULL) {
+        return;
+    }
 
-    KeAcquireSpinLockAtDpcLevel(&Xsk->Lock);
+    RtlAcquirePushLockExclusive(&Set->MemberLock);
 
     //
-    // If the data path hasn't already dropped the IRP, reset the wait state
-    // here.
+    // The set may have removed the socket before the member lock was acquired.
+    // The socket is closing, so it cannot be added to another set.
     //
-
-    if (Xsk->IoWaitIrp == Irp) {
-        Xsk->IoWaitFlags = 0;
-        Xsk->IoWaitIrp = NULL;
+    if (Xsk->NotifySetMember != NULL) {
+        ASSERT(Xsk->NotifySetMember->Set == Set);
+        XskNotifySetRemoveMember(Set, Xsk->NotifySetMember);
     }
 
-    KeReleaseSpinLock(&Xsk->Lock, Irp->CancelIrql);
-
-    Irp->IoStatus.Status = STATUS_CANCELLED;
+    RtlReleasePushLockExclusive(&Set->MemberLock);
 
-    EventWriteXskNotifyAsyncComplete(&MICROSOFT_XDP_PROVIDER, Xsk, Irp, Irp->IoStatus.Status);
-    IoCompleteRequest(Irp, IO_NETWORK_INCREMENT);
+    XskNotifySetDereference(Set);
 }
 
 static
-_Success_(return == STATUS_SUCCESS)
 NTSTATUS
-XskNotify(
-    _In_ XSK *Xsk,
-    _In_opt_ VOID *InputBuffer,
-    _In_ ULONG InputBufferLength,
-    _Out_ ULONG_PTR *Information,
-    _Inout_opt_ IRP *Irp
+XskNotifySetIrpAdd(
+    _In_ IRP *Irp,
+    _In_ IO_STACK_LOCATION *IrpSp
     )
 {
-    UINT32 TimeoutMilliseconds;
-    UINT32 ReadyFlags;
-    UINT32 InFlags;
-    UINT32 OutFlags = 0;
+    XSK_NOTIFY_SET *Set = IrpSp->FileObject->FsContext;
+    XSK_NOTIFY_SET_ADD_IN *Params = Irp->AssociatedIrp.SystemBuffer;
+    XSK_NOTIFY_SET_MEMBER *Member = NULL;
+    FILE_OBJECT *FileObject = NULL;
+    XSK *Xsk = NULL;
     KIRQL OldIrql;
-    LARGE_INTEGER Timeout;
     NTSTATUS Status;
-    XSK_IO_WAIT_FLAGS InternalFlags;
     CONST UINT32 WaitMask = (XSK_NOTIFY_FLAG_WAIT_RX | XSK_NOTIFY_FLAG_WAIT_TX);
 
-    Status =
-        XskNotifyValidateParams(
-            Xsk, InputBuffer, InputBufferLength, &TimeoutMilliseconds, &InFlags);
-    if (Status != STATUS_SUCCESS) {
-        TraceError(TRACE_XSK, "Xsk=%p Notify failed: Invalid params", Xsk);
+    if (IrpSp->Parameters.DeviceIoControl.InputBufferLength < sizeof(*Params)) {
+        Status = STATUS_INVALID_PARAMETER;
         goto Exit;
     }
 
-    EventWriteXskNotifyStart(&MICROSOFT_XDP_PROVIDER, Xsk, Irp, InFlags, TimeoutMilliseconds);
-
-    //
-    // Snap the XSK notification state before performing the poke and/or wait.
-    //
-    InternalFlags = ReadULongAcquire((ULONG *)&Xsk->IoWaitInternalFlags);
+    if (Params->Flags == 0 || (Params->Flags & ~WaitMask) != 0) {
+        Status = STATUS_INVALID_PARAMETER;
+        goto Exit;
+    }
 
-    if (InFlags & (XSK_NOTIFY_FLAG_POKE_RX | XSK_NOTIFY_FLAG_POKE_TX)) {
-        Status = XskPoke(Xsk, InFlags, TimeoutMilliseconds);
-        if (Status != STATUS_SUCCESS) {
-            TraceError(
-                TRACE_XSK, "Xsk=%p Notify failed: Poke failed Status=%!STATUS!",
-                Xsk, Status);
-            goto Exit;
-        }
+    Status =
+        XdpReferenceObjectByHandle(
+            Params->Socket, XDP_OBJECT_TYPE_XSK, Irp->RequestorMode, FILE_GENERIC_WRITE,
+            &FileObject);
+    if (!NT_SUCCESS(Status)) {
+        goto Exit;
     }
 
-    if ((InFlags & (XSK_NOTIFY_FLAG_WAIT_RX | XSK_NOTIFY_FLAG_WAIT_TX)) == 0) {
-        //
-        // Not interested in waiting for IO.
-        //
-        ASSERT(Status == STATUS_SUCCESS);
+    Xsk = FileObject->FsContext;
+
+    Member = ExAllocatePoolZero(NonPagedPoolNx, sizeof(*Member), POOLTAG_NOTIFY_SET);
+    if (Member == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
         goto Exit;
     }
 
-    //
-    // Opportunistic check for ready IO to avoid setting up a wait context.
-    //
-    ReadyFlags = XskQueryReadyIo(Xsk, InFlags);
-    if (ReadyFlags != 0) {
-        OutFlags |= XskWaitInFlagsToOutFlags(ReadyFlags);
-        ASSERT(Status == STATUS_SUCCESS);
+    InitializeListHead(&Member->StateLink);
+    Member->Set = Set;
+    Member->Xsk = Xsk;
+    Member->Context = Params->Context;
+    Member->WaitFlags = Params->Flags;
+
+    RtlAcquirePushLockExclusive(&Set->MemberLock);
+
+    if (Set->Closing) {
+        RtlReleasePushLockExclusive(&Set->MemberLock);
+        Status = STATUS_INVALID_DEVICE_STATE;
         goto Exit;
     }
 
     //
-    // Set up the wait context.
+    // Socket cleanup marks the socket closing under its lock before detaching
+    // it from its notify set, so closing sockets must be rejected here.
     //
     KeAcquireSpinLock(&Xsk->Lock, &OldIrql);
-    if (Xsk->State != XskActive) {
-        KeReleaseSpinLock(&Xsk->Lock, OldIrql);
-        TraceInfo(TRACE_XSK, "Xsk=%p Notify wait failed: XSK not bound", Xsk);
+    if (Xsk->NotifySetMember != NULL) {
+        Status = STATUS_DUPLICATE_OBJECTID;
+    } else if (Xsk->State != XskActive || Xsk->IoWaitFlags != 0 ||
+        ((Member->WaitFlags & XSK_NOTIFY_FLAG_WAIT_RX) && Xsk->Rx.Ring.Size == 0) ||
+        ((Member->WaitFlags & XSK_NOTIFY_FLAG_WAIT_TX) && Xsk->Tx.Ring.Size == 0)) {
         Status = STATUS_INVALID_DEVICE_STATE;
-        goto Exit;
+    } else {
+        XskReference(Xsk);
+        Xsk->NotifySetMember = Member;
+        Status = STATUS_SUCCESS;
     }
-    if (Xsk->IoWaitFlags != 0) {
+    KeReleaseSpinLock(&Xsk->Lock, OldIrql);
+
+    if (NT_SUCCESS(Status)) {
+        InsertTailList(&Set->Members, &Member->Link);
+
         //
-        // There is currently a wait active. Only a single wait is allowed.
+        // Arm the socket immediately so an in-progress wait observes it.
         //
-        KeReleaseSpinLock(&Xsk->Lock, OldIrql);
-        TraceError(TRACE_XSK, "Xsk=%p Notify wait failed: Wait already active", Xsk);
-        Status = STATUS_INVALID_DEVICE_STATE;
-        goto Exit;
+        XskNotifySetArmMember(Member);
+        Member = NULL;
     }
-    Xsk->IoWaitFlags = InFlags & WaitMask;
-    if (Irp != NULL) {
-        Xsk->IoWaitIrp = Irp;
 
-        //
-        // Mark the IRP as pending prior to enabling cancellation; once we mark
-        // an IRP as pending, we must return STATUS_PENDING to the IO manager.
-        //
-        IoMarkIrpPending(Irp);
-        Status = STATUS_PENDING;
+    RtlReleasePushLockExclusive(&Set->MemberLock);
 
-        //
-        // Enable cancellation and synchronize with the IO manager.
-        //
-        IoSetCancelRoutine(Irp, XskCancelNotify);
-        if (Irp->Cancel) {
-            if (IoSetCancelRoutine(Irp, NULL) != NULL) {
-                //
-                // The cancellation routine will not run; cancel the IRP here
-                // and bail.
-                //
-                Xsk->IoWaitIrp = NULL;
-                Xsk->IoWaitFlags = 0;
-                KeReleaseSpinLock(&Xsk->Lock, OldIrql);
-                Irp->IoStatus.Status = STATUS_CANCELLED;
-                EventWriteXskNotifyAsyncComplete(
-                    &MICROSOFT_XDP_PROVIDER, Xsk, Irp, Irp->IoStatus.Status);
-                IoCompleteRequest(Irp, IO_NETWORK_INCREMENT);
-            } else {
-                //
-                // The cancellation routine will run; bail.
-                //
-                KeReleaseSpinLock(&Xsk->Lock, OldIrql);
-            }
+Exit:
 
-            goto Exit;
-        }
-    } else {
-        KeClearEvent(&Xsk->IoWaitEvent);
+    TraceInfo(
+        TRACE_XSK, "NotifySet=%p Xsk=%p Status=%!STATUS!", Set, Xsk, Status);
+
+    if (Member != NULL) {
+        ExFreePoolWithTag(Member, POOLTAG_NOTIFY_SET);
+    }
+
+    if (FileObject != NULL) {
+        ObDereferenceObject(FileObject);
+    }
+
+    return Status;
+}
+
+static
+NTSTATUS
+XskNotifySetIrpRemove(
+    _In_ IRP *Irp,
+    _In_ IO_STACK_LOCATION *IrpSp
+    )
+{
+    XSK_NOTIFY_SET *Set = IrpSp->FileObject->FsContext;
+    XSK_NOTIFY_SET_REMOVE_IN *Params = Irp->AssociatedIrp.SystemBuffer;
+    XSK_NOTIFY_SET_MEMBER *Member;
+    FILE_OBJECT *FileObject = NULL;
+    XSK *Xsk = NULL;
+    KIRQL OldIrql;
+    NTSTATUS Status;
+
+    if (IrpSp->Parameters.DeviceIoControl.InputBufferLength < sizeof(*Params)) {
+        Status = STATUS_INVALID_PARAMETER;
+        goto Exit;
+    }
+
+    Status =
+        XdpReferenceObjectByHandle(
+            Params->Socket, XDP_OBJECT_TYPE_XSK, Irp->RequestorMode, FILE_GENERIC_WRITE,
+            &FileObject);
+    if (!NT_SUCCESS(Status)) {
+        goto Exit;
     }
+
+    Xsk = FileObject->FsContext;
+
+    RtlAcquirePushLockExclusive(&Set->MemberLock);
+
+    KeAcquireSpinLock(&Xsk->Lock, &OldIrql);
+    Member = Xsk->NotifySetMember;
     KeReleaseSpinLock(&Xsk->Lock, OldIrql);
 
     //
-    // N.B. A memory barrier between the write of the wait event and the read of
-    // completed IO is needed in order to prevent a race condition when these
-    // operations are re-ordered. The race is between this thread and a thread
-    // completing IO. Memory barriers are also needed to protect against a
-    // similar race condition when the inverse of these operations are done
-    // during IO completion.
+    // Members of this set cannot be removed concurrently while the member lock
+    // is held exclusively.
     //
-    KeMemoryBarrier();
+    if (Member != NULL && Member->Set == Set) {
+        XskNotifySetRemoveMember(Set, Member);
+        Status = STATUS_SUCCESS;
+    } else {
+        Status = STATUS_NOT_FOUND;
+    }
+
+    RtlReleasePushLockExclusive(&Set->MemberLock);
+
+Exit:
+
+    TraceInfo(
+        TRACE_XSK, "NotifySet=%p Xsk=%p Status=%!STATUS!", Set, Xsk, Status);
+
+    if (FileObject != NULL) {
+        ObDereferenceObject(FileObject);
+    }
+
+    return Status;
+}
+
+static
+NTSTATUS
+XskNotifySetWait(
+    _In_ XSK_NOTIFY_SET *Set,
+    _In_opt_ VOID *InputBuffer,
+    _In_ ULONG InputBufferLength,
+    _Out_opt_ VOID *OutputBuffer,
+    _In_ ULONG OutputBufferLength,
+    _Out_ ULONG_PTR *Information
+    )
+{
+    CONST KPROCESSOR_MODE PreviousMode = ExGetPreviousMode();
+    XSK_NOTIFY_SET_EVENT *Events = OutputBuffer;
+    UINT32 EventCount = OutputBufferLength / sizeof(XSK_NOTIFY_SET_EVENT);
+    UINT32 ReadyCount = 0;
+    UINT32 TimeoutMilliseconds;
+    LIST_ENTRY ArmList;
+    LIST_ENTRY ReadyList;
+    LIST_ENTRY *Entry;
+    LARGE_INTEGER Timeout;
+    KIRQL OldIrql;
+    BOOLEAN WaitRequired;
+    NTSTATUS Status = STATUS_SUCCESS;
+
+    *Information = 0;
+
+    if (InputBufferLength < sizeof(XSK_NOTIFY_SET_WAIT_IN) || EventCount == 0) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    __try {
+        ASSERT(InputBuffer);
+        if (PreviousMode != KernelMode) {
+            ProbeForRead(
+                InputBuffer, InputBufferLength, PROBE_ALIGNMENT(XSK_NOTIFY_SET_WAIT_IN));
+            #pragma prefast(suppress:6001) // Using uninitialized memory '*Events'
+            ProbeForWrite(
+                Events, EventCount * sizeof(*Events), PROBE_ALIGNMENT(XSK_NOTIFY_SET_EVENT));
+        }
+
+        TimeoutMilliseconds =
+            ReadUInt32NoFence(&((XSK_NOTIFY_SET_WAIT_IN *)InputBuffer)->WaitTimeoutMilliseconds);
+    } __except (EXCEPTION_EXECUTE_HANDLER) {
+        return GetExceptionCode();
+    }
 
     //
-    // Check for ready IO.
+    // Membership cannot change while members are off the shared state lists.
     //
-    ReadyFlags = XskQueryReadyIo(Xsk, InFlags);
-    if (ReadyFlags != 0) {
-        XskSignalReadyIo(Xsk, ReadyFlags);
+    RtlAcquirePushLockShared(&Set->MemberLock);
+
+    KeAcquireSpinLock(&Set->Lock, &OldIrql);
+    if (Set->Closing || Set->WaitActive) {
+        KeReleaseSpinLock(&Set->Lock, OldIrql);
+        RtlReleasePushLockShared(&Set->MemberLock);
+        return STATUS_INVALID_DEVICE_STATE;
     }
+    Set->WaitActive = TRUE;
+    InitializeListHead(&ArmList);
+    AppendTailList(&ArmList, &Set->RearmList);
+    RemoveEntryList(&Set->RearmList);
+    InitializeListHead(&Set->RearmList);
+    KeReleaseSpinLock(&Set->Lock, OldIrql);
 
     //
-    // If the notification state changed while processing this request, abandon
-    // the wait and allow the application to re-examine the shared ring flags.
+    // Re-arm the members returned by the previous wait. Members that are still
+    // ready are immediately queued back to the ready list.
     //
-    if (InternalFlags != Xsk->IoWaitInternalFlags) {
-        XskSignalReadyIo(Xsk, InFlags & WaitMask);
+    while ((Entry = RemoveHeadList(&ArmList)) != &ArmList) {
+        XSK_NOTIFY_SET_MEMBER *Member =
+            CONTAINING_RECORD(Entry, XSK_NOTIFY_SET_MEMBER, StateLink);
+
+        InitializeListHead(&Member->StateLink);
+        XskNotifySetArmMember(Member);
     }
 
-    if (Irp == NULL) {
-        //
-        // Wait for IO.
-        //
+    RtlReleasePushLockShared(&Set->MemberLock);
+
+    KeAcquireSpinLock(&Set->Lock, &OldIrql);
+    WaitRequired = IsListEmpty(&Set->ReadyList) && !Set->Closing;
+    if (WaitRequired) {
+        KeClearEvent(&Set->WaitEvent);
+    }
+    KeReleaseSpinLock(&Set->Lock, OldIrql);
+
+    if (WaitRequired && TimeoutMilliseconds != 0) {
         Timeout.QuadPart = -1 * RTL_MILLISEC_TO_100NANOSEC(TimeoutMilliseconds);
         Status =
             KeWaitForSingleObject(
-                &Xsk->IoWaitEvent, UserRequest, UserMode, FALSE,
+                &Set->WaitEvent, UserRequest, UserMode, FALSE,
                 (TimeoutMilliseconds == INFINITE) ? NULL : &Timeout);
-    } else {
-        ASSERT(Status == STATUS_PENDING);
-        goto Exit;
+        if (Status == STATUS_TIMEOUT) {
+            //
+            // Timeouts are reported as success with no ready sockets.
+            //
+            Status = STATUS_SUCCESS;
+        }
     }
-
-    KeAcquireSpinLock(&Xsk->Lock, &OldIrql);
-    Xsk->IoWaitFlags = 0;
-    KeReleaseSpinLock(&Xsk->Lock, OldIrql);
-
-    //
-    // Re-query ready IO regardless of the wait status.
-    //
-    ReadyFlags = XskQueryReadyIo(Xsk, InFlags);
-    if (ReadyFlags != 0) {
-        Status = STATUS_SUCCESS;
-        OutFlags |= XskWaitInFlagsToOutFlags(ReadyFlags);
+
+    RtlAcquirePushLockShared(&Set->MemberLock);
+
+    InitializeListHead(&ReadyList);
+
+    KeAcquireSpinLock(&Set->Lock, &OldIrql);
+    while (ReadyCount < EventCount && !IsListEmpty(&Set->ReadyList)) {
+        InsertTailList(&ReadyList, RemoveHeadList(&Set->ReadyList));
+        ReadyCount++;
+    }
+    if (ReadyCount == 0 && Set->Closing && Status == STATUS_SUCCESS) {
+        Status = STATUS_INVALID_DEVICE_STATE;
     }
+    KeReleaseSpinLock(&Set->Lock, OldIrql);
 
-Exit:
+    ReadyCount = 0;
+
+    __try {
+        for (Entry = ReadyList.Flink; Entry != &ReadyList; Entry = Entry->Flink) {
+            XSK_NOTIFY_SET_MEMBER *Member =
+                CONTAINING_RECORD(Entry, XSK_NOTIFY_SET_MEMBER, StateLink);
+
+            Events[ReadyCount].Context = Member->Context;
+            Events[ReadyCount].Result = (XSK_NOTIFY_RESULT_FLAGS)Member->ReadyFlags;
+            ReadyCount++;
+        }
+
+        if (ReadyCount > 0) {
+            Status = STATUS_SUCCESS;
+        }
+    } __except (EXCEPTION_EXECUTE_HANDLER) {
+        Status = GetExceptionCode();
+        ReadyCount = 0;
+    }
 
     //
-    // This IOCTL is assumed to never pend for fast IO, and code elsewhere takes
-    // advantage of this assumption.
+    // Returned members are re-armed, and re-checked for ready IO, by the next
+    // wait. This makes readiness level-triggered.
     //
-    ASSERT(Irp != NULL || Status != STATUS_PENDING);
+    KeAcquireSpinLock(&Set->Lock, &OldIrql);
+    AppendTailList(&Set->RearmList, &ReadyList);
+    RemoveEntryList(&ReadyList);
+    Set->WaitActive = FALSE;
+    KeReleaseSpinLock(&Set->Lock, OldIrql);
 
-    if (Status != STATUS_PENDING) {
-        *Information = OutFlags;
-    }
+    RtlReleasePushLockShared(&Set->MemberLock);
 
-    EventWriteXskNotifyStop(&MICROSOFT_XDP_PROVIDER, Xsk, Irp, OutFlags, Status);
+    if (NT_SUCCESS(Status)) {
+        *Information = ReadyCount * sizeof(XSK_NOTIFY_SET_EVENT);
+    }
 
     return Status;
 }
@@ -4204,7 +6089,7 @@ Exit:
 #pragma warning(push)
 #pragma warning(disable:6101) // We don't set OutputBuffer in some paths
 BOOLEAN
-XskFastIo(
+XskNotifySetFastIo(
     _In_ XDP_FILE_OBJECT_HEADER *FileObjectHeader,
     _In_opt_ VOID *InputBuffer,
     _In_ ULONG InputBufferLength,
@@ -4214,25 +6099,146 @@ XskFastIo(
     _Out_ IO_STATUS_BLOCK *IoStatus
     )
 {
-    XSK *Xsk = CONTAINING_RECORD(FileObjectHeader, XSK, Header);
+    XSK_NOTIFY_SET *Set = CONTAINING_RECORD(FileObjectHeader, XSK_NOTIFY_SET, Header);
 
     switch (IoControlCode) {
-    case IOCTL_XSK_NOTIFY:
+    case IOCTL_XSK_NOTIFY_SET_WAIT:
         IoStatus->Status =
-            XskNotify(Xsk, InputBuffer, InputBufferLength, &IoStatus->Information, NULL);
+            XskNotifySetWait(
+                Set, InputBuffer, InputBufferLength, OutputBuffer, OutputBufferLength,
+                &IoStatus->Information);
         return TRUE;
-
-    case IOCTL_XSK_GET_SOCKOPT:
-        return
-            XskFastGetSockopt(
-                FileObjectHeader, InputBuffer, InputBufferLength, OutputBuffer,
-                OutputBufferLength, IoStatus);
     }
 
     return FALSE;
 }
 #pragma warning(pop)
 
+static
+_Use_decl_annotations_
+NTSTATUS
+XskNotifySetIrpDeviceIoControl(
+    IRP *Irp,
+    IO_STACK_LOCATION *IrpSp
+    )
+{
+    NTSTATUS Status;
+
+    Irp->IoStatus.Information = 0;
+
+    switch (IrpSp->Parameters.DeviceIoControl.IoControlCode) {
+    case IOCTL_XSK_NOTIFY_SET_ADD:
+        Status = XskNotifySetIrpAdd(Irp, IrpSp);
+        break;
+    case IOCTL_XSK_NOTIFY_SET_REMOVE:
+        Status = XskNotifySetIrpRemove(Irp, IrpSp);
+        break;
+    default:
+        Status = STATUS_NOT_SUPPORTED;
+        break;
+    }
+
+    return Status;
+}
+
+static
+_Use_decl_annotations_
+NTSTATUS
+XskNotifySetIrpCleanup(
+    IRP *Irp,
+    IO_STACK_LOCATION *IrpSp
+    )
+{
+    XSK_NOTIFY_SET *Set = IrpSp->FileObject->FsContext;
+    KIRQL OldIrql;
+
+    UNREFERENCED_PARAMETER(Irp);
+
+    TraceEnter(TRACE_XSK, "NotifySet=%p", Set);
+
+    //
+    // Fail new waits and release any wait in progress.
+    //
+    KeAcquireSpinLock(&Set->Lock, &OldIrql);
+    Set->Closing = TRUE;
+    (VOID)KeSetEvent(&Set->WaitEvent, IO_NETWORK_INCREMENT, FALSE);
+    KeReleaseSpinLock(&Set->Lock, OldIrql);
+
+    RtlAcquirePushLockExclusive(&Set->MemberLock);
+    while (!IsListEmpty(&Set->Members)) {
+        XskNotifySetRemoveMember(
+            Set, CONTAINING_RECORD(Set->Members.Flink, XSK_NOTIFY_SET_MEMBER, Link));
+    }
+    RtlReleasePushLockExclusive(&Set->MemberLock);
+
+    TraceExitSuccess(TRACE_XSK);
+
+    return STATUS_SUCCESS;
+}
+
+static
+_Use_decl_annotations_
+NTSTATUS
+XskNotifySetIrpClose(
+    IRP *Irp,
+    IO_STACK_LOCATION *IrpSp
+    )
+{
+    XSK_NOTIFY_SET *Set = IrpSp->FileObject->FsContext;
+
+    UNREFERENCED_PARAMETER(Irp);
+
+    ASSERT(IsListEmpty(&Set->Members));
+
+    XskNotifySetDereference(Set);
+
+    return STATUS_SUCCESS;
+}
+
+static
+FORCEINLINE
+VOID
+XskReceiveWriteMetadata(
+    _In_ UCHAR *UmemData,
+    _In_ CONST XDP_BUFFER *Buffer,
+    _In_ CONST XDP_BUFFER_VIRTUAL_ADDRESS *Va,
+    _In_opt_ CONST XDP_REDIRECT_METADATA *Metadata
+    )
+{
+    XSK_RX_METADATA *XskMetadata = (XSK_RX_METADATA *)(UmemData - sizeof(*XskMetadata));
+    UINT32 EbpfMetaLength = 0;
+    UINT32 Flags = XSK_RX_METADATA_FLAG_NONE;
+
+    //
+    // The headroom is validated to fit the metadata when the socket is
+    // activated.
+    //
+    if (Metadata != NULL) {
+        if (Metadata->RuleIndex != XDP_INSPECTION_RULE_INDEX_NONE) {
+            Flags |= XSK_RX_METADATA_FLAG_RULE;
+        }
+
+        if (Metadata->Ebpf) {
+            Flags |= XSK_RX_METADATA_FLAG_EBPF;
+            EbpfMetaLength = Metadata->EbpfMetaLength;
+            ASSERT(EbpfMetaLength <= sizeof(XskMetadata->EbpfMeta));
+            ASSERT(EbpfMetaLength <= Buffer->DataOffset);
+
+            //
+            // The eBPF metadata immediately precedes the frame data.
+            //
+            RtlCopyMemory(
+                XskMetadata->EbpfMeta, Va->VirtualAddress + Buffer->DataOffset - EbpfMetaLength,
+                EbpfMetaLength);
+        }
+    }
+
+    XskMetadata->Flags = Flags;
+    XskMetadata->RuleIndex = (Metadata != NULL) ? Metadata->RuleIndex : 0;
+    XskMetadata->Tag = (Metadata != NULL) ? Metadata->Tag : 0;
+    XskMetadata->EbpfMetaLength = EbpfMetaLength;
+}
+
 static
 FORCEINLINE
 VOID
@@ -4241,6 +6247,8 @@ XskReceiveSingleFrame(
     _In_ UINT32 FrameIndex,
     _In_ UINT32 FragmentIndex,
     _In_ UINT32 FillOffset,
+    _In_ UINT32 SnapLength,
+    _In_opt_ CONST XDP_REDIRECT_METADATA *Metadata,
     _Inout_ UINT32 *CompletionOffset
     )
 {
@@ -4252,6 +6260,7 @@ XskReceiveSingleFrame(
     UCHAR *UmemChunk;
     UINT64 UmemAddress;
     UINT32 UmemOffset;
+    UINT32 UmemLimit;
     UINT32 CopyLength;
     UINT32 RingIndex;
 
@@ -4274,17 +6283,32 @@ XskReceiveSingleFrame(
 
     UmemChunk = Xsk->Umem->Mapping.SystemAddress + UmemAddress;
     UmemOffset = Xsk->Umem->Reg.Headroom;
-    CopyLength = min(Buffer->DataLength, Xsk->Umem->Reg.ChunkSize - UmemOffset);
+    UmemLimit = Xsk->Umem->Reg.ChunkSize;
+
+    if (Xsk->Rx.Metadata) {
+        XskReceiveWriteMetadata(UmemChunk + UmemOffset, Buffer, Va, Metadata);
+    }
+
+    if (SnapLength < UmemLimit - UmemOffset) {
+        //
+        // Mirrored frames may be intentionally truncated to a snap length.
+        //
+        UmemLimit = UmemOffset + SnapLength;
+    }
+
+    CopyLength = min(Buffer->DataLength, UmemLimit - UmemOffset);
 
     if (!XskGlobals.RxZeroCopy) {
         RtlCopyMemory(UmemChunk + UmemOffset, Va->VirtualAddress + Buffer->DataOffset, CopyLength);
     }
     if (CopyLength < Buffer->DataLength) {
-        //
-        // Not enough available space in Umem.
-        //
-        Xsk->Statistics.RxTruncated++;
-        STAT_INC(XdpRxQueueGetStats(Xsk->Rx.Xdp.Queue), XskFramesTruncated);
+        if (UmemLimit == Xsk->Umem->Reg.ChunkSize) {
+            //
+            // Not enough available space in Umem.
+            //
+            Xsk->Statistics.RxTruncated++;
+            STAT_INC(XdpRxQueueGetStats(Xsk->Rx.Xdp.Queue), XskFramesTruncated);
+        }
     } else if (FragmentRing != NULL) {
         Fragment = XdpGetFragmentExtension(Frame, &Xsk->Rx.Xdp.FragmentExtension);
 
@@ -4293,7 +6317,7 @@ XskReceiveSingleFrame(
             Va = XdpGetVirtualAddressExtension(Buffer, &Xsk->Rx.Xdp.VaExtension);
 
             UmemOffset += CopyLength;
-            CopyLength = min(Buffer->DataLength, Xsk->Umem->Reg.ChunkSize - UmemOffset);
+            CopyLength = min(Buffer->DataLength, UmemLimit - UmemOffset);
 
             if (!XskGlobals.RxZeroCopy) {
                 RtlCopyMemory(
@@ -4301,11 +6325,13 @@ XskReceiveSingleFrame(
             }
 
             if (CopyLength < Buffer->DataLength) {
-                //
-                // Not enough available space in Umem.
-                //
-                Xsk->Statistics.RxTruncated++;
-                STAT_INC(XdpRxQueueGetStats(Xsk->Rx.Xdp.Queue), XskFramesTruncated);
+                if (UmemLimit == Xsk->Umem->Reg.ChunkSize) {
+                    //
+                    // Not enough available space in Umem.
+                    //
+                    Xsk->Statistics.RxTruncated++;
+                    STAT_INC(XdpRxQueueGetStats(Xsk->Rx.Xdp.Queue), XskFramesTruncated);
+                }
                 break;
             }
         }
@@ -4324,6 +6350,29 @@ XskReceiveSingleFrame(
     ++*CompletionOffset;
 }
 
+static
+FORCEINLINE
+UINT32
+XskReceiveReserveFill(
+    _In_ XSK *Xsk,
+    _In_ UINT32 BatchCount,
+    _In_ UINT32 RxReservedCount
+    )
+{
+    UINT32 FillReservedCount = XskRingConsPeek(&Xsk->Rx.FillRing, RxReservedCount);
+
+    //
+    // Attribute drops to the RX ring first, then to fill ring starvation.
+    //
+    Xsk->ExtendedStatistics.RxRingFullDrops += BatchCount - RxReservedCount;
+
+    if (FillReservedCount < RxReservedCount) {
+        Xsk->ExtendedStatistics.RxFillRingEmpty++;
+    }
+
+    return FillReservedCount;
+}
+
 static
 VOID
 XskReceiveSubmitBatch(
@@ -4366,29 +6415,86 @@ XskReceiveSubmitBatch(
     }
 }
 
+//
+// Evaluates the socket's RX filter on each frame of a redirect batch, moving
+// the frames that pass to the front of the batch. Returns the number of frames
+// that pass.
+//
+static
+UINT32
+XskReceiveFilterBatch(
+    _In_ XSK *Xsk,
+    _Inout_ XDP_REDIRECT_BATCH *Batch
+    )
+{
+    XDP_RING *FragmentRing = Xsk->Rx.Xdp.FragmentRing;
+    XDP_EXTENSION *FragmentExtension = NULL;
+    UINT32 PassCount = 0;
+
+    if (FragmentRing != NULL) {
+        FragmentExtension = &Xsk->Rx.Xdp.FragmentExtension;
+    }
+
+    for (UINT32 Index = 0; Index < Batch->Count; Index++) {
+        XDP_REDIRECT_FRAME *RedirectFrame = &Batch->FrameIndexes[Index];
+
+        if (XdpInspectFilter(
+                Xsk->Rx.Filter, Xsk->Rx.Xdp.FrameRing, RedirectFrame->FrameIndex,
+                FragmentRing, FragmentExtension, RedirectFrame->FragmentIndex,
+                &Xsk->Rx.Xdp.VaExtension)) {
+            Batch->FrameIndexes[PassCount++] = *RedirectFrame;
+        }
+    }
+
+    Xsk->ExtendedStatistics.RxFiltered += Batch->Count - PassCount;
+
+    return PassCount;
+}
+
 VOID
 XskReceive(
     _In_ XDP_REDIRECT_BATCH *Batch
     )
 {
     XSK *Xsk = Batch->Target;
+    UINT32 BatchCount;
     UINT32 ReservedCount;
     UINT32 RxCount = 0;
+    UINT64 StartCycles = 0;
+    BOOLEAN CycleSample;
 
     if (!Xsk->Rx.Xdp.Flags.DatapathAttached || Xsk->Rx.Xdp.Queue != Batch->RxQueue) {
         goto Exit;
     }
 
-    ReservedCount = XskRingProdReserve(&Xsk->Rx.Ring, Batch->Count);
-    ReservedCount = XskRingConsPeek(&Xsk->Rx.FillRing, ReservedCount);
+    CycleSample = XdpRxQueueIsCycleSampleBatch(Xsk->Rx.Xdp.Queue);
+    if (CycleSample) {
+        StartCycles = XdpQueueReadCycles();
+    }
+
+    BatchCount = Batch->Count;
+
+    if (Xsk->Rx.Filter != NULL) {
+        BatchCount = XskReceiveFilterBatch(Xsk, Batch);
+    }
+
+    ReservedCount = XskRingProdReserve(&Xsk->Rx.Ring, BatchCount);
+    ReservedCount = XskReceiveReserveFill(Xsk, BatchCount, ReservedCount);
 
     for (UINT32 FillIndex = 0; FillIndex < ReservedCount; FillIndex++) {
         XskReceiveSingleFrame(
             Xsk, Batch->FrameIndexes[RxCount].FrameIndex,
-            Batch->FrameIndexes[RxCount].FragmentIndex, FillIndex, &RxCount);
+            Batch->FrameIndexes[RxCount].FragmentIndex, FillIndex, Batch->SnapLength,
+            &Batch->FrameIndexes[RxCount].Metadata, &RxCount);
+    }
+
+    if (CycleSample) {
+        STAT_ADD(
+            XdpRxQueueGetStats(Xsk->Rx.Xdp.Queue), XskRxCopyCycles,
+            XdpQueueReadCycles() - StartCycles);
     }
 
-    XskReceiveSubmitBatch(Xsk, Batch->Count, ReservedCount, RxCount);
+    XskReceiveSubmitBatch(Xsk, BatchCount, ReservedCount, RxCount);
 
 Exit:
     return;
@@ -4405,15 +6511,22 @@ XskReceiveBatchedExclusive(
     UINT32 BatchCount;
     UINT32 ReservedCount;
     UINT32 RxCount = 0;
+    UINT64 StartCycles = 0;
+    BOOLEAN CycleSample;
 
     if (!Xsk->Rx.Xdp.Flags.DatapathAttached) {
         return FALSE;
     }
 
+    CycleSample = XdpRxQueueIsCycleSampleBatch(Xsk->Rx.Xdp.Queue);
+    if (CycleSample) {
+        StartCycles = XdpQueueReadCycles();
+    }
+
     BatchCount = FrameRing->ProducerIndex - FrameRing->ConsumerIndex;
 
     ReservedCount = XskRingProdReserve(&Xsk->Rx.Ring, BatchCount);
-    ReservedCount = XskRingConsPeek(&Xsk->Rx.FillRing, ReservedCount);
+    ReservedCount = XskReceiveReserveFill(Xsk, BatchCount, ReservedCount);
 
     for (UINT32 Index = 0; Index < BatchCount; Index++) {
         UINT32 FrameIndex = FrameRing->ConsumerIndex & FrameRing->Mask;
@@ -4432,7 +6545,9 @@ XskReceiveBatchedExclusive(
         }
 
         if (Index < ReservedCount) {
-            XskReceiveSingleFrame(Xsk, FrameIndex, FragmentIndex, Index, &RxCount);
+            XskReceiveSingleFrame(
+                Xsk, FrameIndex, FragmentIndex, Index, XDP_REDIRECT_SNAP_LENGTH_FULL, NULL,
+                &RxCount);
         }
 
         FrameRing->ConsumerIndex++;
@@ -4443,11 +6558,150 @@ XskReceiveBatchedExclusive(
         }
     }
 
+    if (CycleSample) {
+        STAT_ADD(
+            XdpRxQueueGetStats(Xsk->Rx.Xdp.Queue), XskRxCopyCycles,
+            XdpQueueReadCycles() - StartCycles);
+    }
+
     XskReceiveSubmitBatch(Xsk, BatchCount, ReservedCount, RxCount);
 
     return TRUE;
 }
 
+C_ASSERT(XSK_CAPTURE_RULE_INDEX_NONE == XDP_INSPECTION_RULE_INDEX_NONE);
+
+VOID
+XskCaptureFrame(
+    _In_ VOID *Target,
+    _In_ UINT32 FrameIndex,
+    _In_ UINT32 FragmentIndex,
+    _In_ UINT32 FrameLength,
+    _In_ XDP_RX_ACTION Action,
+    _In_ UINT32 RuleIndex
+    )
+{
+    XSK *Xsk = Target;
+    XSK_RX_CAPTURE *Capture = &Xsk->Rx.Capture;
+    XDP_RING *FragmentRing = Xsk->Rx.Xdp.FragmentRing;
+    XDP_FRAME *Frame;
+    XDP_BUFFER *Buffer;
+    XDP_BUFFER_VIRTUAL_ADDRESS *Va;
+    XSK_CAPTURE_HEADER Header = {0};
+    XSK_FRAME_DESCRIPTOR *XskFrame;
+    UCHAR *UmemData;
+    UINT64 UmemAddress;
+    UINT32 CaptureSpace;
+    UINT32 CopyLength;
+    UINT32 BufferCount = 1;
+    UINT32 RingIndex;
+
+    //
+    // Frames are inspected and captured by the RX queue's serialized data
+    // path, so the sampling countdown and pending ring offsets need no locks.
+    //
+    if (--Capture->SampleCountdown != 0) {
+        return;
+    }
+
+    Capture->SampleCountdown = Capture->SampleInterval;
+
+    if (!Xsk->Rx.Xdp.Flags.DatapathAttached) {
+        return;
+    }
+
+    //
+    // Sampled frames that are not produced are counted as drops at flush.
+    //
+    Capture->Attempted++;
+
+    if (XskRingProdReserve(&Xsk->Rx.Ring, Capture->Produced + 1) <= Capture->Produced) {
+        Xsk->ExtendedStatistics.RxRingFullDrops++;
+        return;
+    }
+
+    if (XskRingConsPeek(&Xsk->Rx.FillRing, Capture->FillConsumed + 1) <= Capture->FillConsumed) {
+        Xsk->ExtendedStatistics.RxFillRingEmpty++;
+        return;
+    }
+
+    RingIndex =
+        (ReadUInt32NoFence(&Xsk->Rx.FillRing.Shared->ConsumerIndex) + Capture->FillConsumed++) &
+            Xsk->Rx.FillRing.Mask;
+    UmemAddress = *(UINT64 *)XskKernelRingGetElement(&Xsk->Rx.FillRing, RingIndex);
+
+    if (UmemAddress > Xsk->Umem->Reg.TotalSize - Xsk->Umem->Reg.ChunkSize) {
+        //
+        // Invalid FILL descriptor.
+        //
+        Xsk->Statistics.RxInvalidDescriptors++;
+        STAT_INC(XdpRxQueueGetStats(Xsk->Rx.Xdp.Queue), XskInvalidDescriptors);
+        return;
+    }
+
+    //
+    // Activation guarantees each chunk has room for at least the header.
+    //
+    UmemData = Xsk->Umem->Mapping.SystemAddress + UmemAddress + Xsk->Umem->Reg.Headroom;
+    CaptureSpace =
+        min(Capture->SnapLength,
+            Xsk->Umem->Reg.ChunkSize - Xsk->Umem->Reg.Headroom - sizeof(Header));
+
+    Frame = XdpRingGetElement(Xsk->Rx.Xdp.FrameRing, FrameIndex);
+    Buffer = &Frame->Buffer;
+
+    if (FragmentRing != NULL) {
+        BufferCount +=
+            XdpGetFragmentExtension(Frame, &Xsk->Rx.Xdp.FragmentExtension)->FragmentBufferCount;
+    }
+
+    for (UINT32 Index = 0; Index < BufferCount && Header.CaptureLength < CaptureSpace; Index++) {
+        if (Index > 0) {
+            Buffer =
+                XdpRingGetElement(FragmentRing, (FragmentIndex + Index - 1) & FragmentRing->Mask);
+        }
+
+        Va = XdpGetVirtualAddressExtension(Buffer, &Xsk->Rx.Xdp.VaExtension);
+        CopyLength = min(Buffer->DataLength, CaptureSpace - Header.CaptureLength);
+
+        RtlCopyMemory(
+            UmemData + sizeof(Header) + Header.CaptureLength,
+            Va->VirtualAddress + Buffer->DataOffset, CopyLength);
+        Header.CaptureLength += CopyLength;
+    }
+
+    Header.Timestamp = KeQueryPerformanceCounter(NULL).QuadPart;
+    Header.FrameLength = FrameLength;
+    Header.RuleIndex = RuleIndex;
+    Header.Action = (UINT8)Action;
+    RtlCopyMemory(UmemData, &Header, sizeof(Header));
+
+    RingIndex =
+        (ReadUInt32NoFence(&Xsk->Rx.Ring.Shared->ProducerIndex) + Capture->Produced++) &
+            Xsk->Rx.Ring.Mask;
+    XskFrame = XskKernelRingGetElement(&Xsk->Rx.Ring, RingIndex);
+    XskFrame->Buffer.Address.BaseAddress = UmemAddress;
+    ASSERT(Xsk->Umem->Reg.Headroom <= MAXUINT16);
+    XskFrame->Buffer.Address.Offset = (UINT16)Xsk->Umem->Reg.Headroom;
+    XskFrame->Buffer.Length = sizeof(Header) + Header.CaptureLength;
+}
+
+VOID
+XskCaptureFlush(
+    _In_ VOID *Target
+    )
+{
+    XSK *Xsk = Target;
+    XSK_RX_CAPTURE *Capture = &Xsk->Rx.Capture;
+
+    if (Capture->Attempted > 0) {
+        XskReceiveSubmitBatch(Xsk, Capture->Attempted, Capture->FillConsumed, Capture->Produced);
+        Capture->Attempted = 0;
+        Capture->FillConsumed = 0;
+        Capture->Produced = 0;
+    }
+}
+
 _Use_decl_annotations_
 NTSTATUS
 XskIrpDeviceIoControl(
@@ -4519,6 +6773,18 @@ XskStart(
     )
 {
     RtlZeroMemory(&XskGlobals, sizeof(XskGlobals));
+
+    ExInitializePushLock(&XskGlobals.DoorbellPollersLock);
+    XskGlobals.DoorbellPollerCount = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+    XskGlobals.DoorbellPollers =
+        ExAllocatePoolZero(
+            NonPagedPoolNx,
+            sizeof(*XskGlobals.DoorbellPollers) * XskGlobals.DoorbellPollerCount,
+            POOLTAG_DOORBELL);
+    if (XskGlobals.DoorbellPollers == NULL) {
+        return STATUS_NO_MEMORY;
+    }
+
     XdpRegWatcherAddClient(XdpRegWatcher, XskRegistryUpdate, &XskRegWatcherEntry);
     return STATUS_SUCCESS;
 }
@@ -4529,4 +6795,15 @@ XskStop(
     )
 {
     XdpRegWatcherRemoveClient(XdpRegWatcher, &XskRegWatcherEntry);
+
+    if (XskGlobals.DoorbellPollers != NULL) {
+        for (UINT32 Index = 0; Index < XskGlobals.DoorbellPollerCount; Index++) {
+            if (XskGlobals.DoorbellPollers[Index] != NULL) {
+                XskTxDoorbellDeletePoller(XskGlobals.DoorbellPollers[Index]);
+            }
+        }
+
+        ExFreePoolWithTag(XskGlobals.DoorbellPollers, POOLTAG_DOORBELL);
+        XskGlobals.DoorbellPollers = NULL;
+    }
 }
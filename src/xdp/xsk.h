@@ -15,6 +15,21 @@ XskReceiveBatchedExclusive(
     _In_ VOID *Target
     );
 
+VOID
+XskCaptureFrame(
+    _In_ VOID *Target,
+    _In_ UINT32 FrameIndex,
+    _In_ UINT32 FragmentIndex,
+    _In_ UINT32 FrameLength,
+    _In_ XDP_RX_ACTION Action,
+    _In_ UINT32 RuleIndex
+    );
+
+VOID
+XskCaptureFlush(
+    _In_ VOID *Target
+    );
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 VOID
 XskFillTxCompletion(
@@ -65,6 +80,19 @@ XskFastIo(
     _Out_ IO_STATUS_BLOCK *IoStatus
     );
 
+XDP_FILE_CREATE_ROUTINE XskIrpCreateNotifySet;
+
+BOOLEAN
+XskNotifySetFastIo(
+    _In_ XDP_FILE_OBJECT_HEADER *FileObjectHeader,
+    _In_opt_ VOID *InputBuffer,
+    _In_ ULONG InputBufferLength,
+    _Out_opt_ VOID *OutputBuffer,
+    _In_ ULONG OutputBufferLength,
+    _In_ ULONG IoControlCode,
+    _Out_ IO_STATUS_BLOCK *IoStatus
+    );
+
 NTSTATUS
 XskStart(
     VOID
@@ -212,6 +212,47 @@ XskNotifySocket(
     return S_OK;
 }
 
+HRESULT
+XskNotifySocketPrecise(
+    _In_ HANDLE Socket,
+    _In_ XSK_NOTIFY_FLAGS Flags,
+    _In_ UINT32 WaitTimeoutMicroseconds,
+    _Out_ XSK_NOTIFY_RESULT_FLAGS *Result
+    )
+{
+    BOOL Res;
+    DWORD BytesReturned;
+    XSK_NOTIFY_PRECISE_IN Notify = {0};
+
+    Notify.Notify.Flags = Flags;
+    Notify.Notify.WaitTimeoutMilliseconds = INFINITE;
+
+    if (WaitTimeoutMicroseconds == INFINITE) {
+        Notify.WaitTimeout = XSK_NOTIFY_TIMEOUT_INFINITE;
+    } else {
+        Notify.WaitTimeout = (UINT64)WaitTimeoutMicroseconds * 10;
+    }
+
+    Res =
+        XdpIoctl(
+            Socket,
+            IOCTL_XSK_NOTIFY,
+            &Notify,
+            sizeof(Notify),
+            NULL,
+            0,
+            &BytesReturned,
+            NULL,
+            FALSE);
+    if (Res == 0) {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    *Result = BytesReturned;
+
+    return S_OK;
+}
+
 HRESULT
 XskNotifyAsync(
     _In_ HANDLE Socket,
@@ -260,3 +301,123 @@ XskGetNotifyAsyncResult(
 
     return S_OK;
 }
+
+HRESULT
+XskNotifySetCreate(
+    _Out_ HANDLE *NotifySet
+    )
+{
+    CHAR EaBuffer[XDP_OPEN_EA_LENGTH];
+
+    XdpInitializeEa(XDP_OBJECT_TYPE_XSK_NOTIFY_SET, EaBuffer, sizeof(EaBuffer));
+
+    *NotifySet = XdpOpen(FILE_CREATE, EaBuffer, sizeof(EaBuffer));
+    if (*NotifySet == NULL) {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    return S_OK;
+}
+
+HRESULT
+XskNotifySetAdd(
+    _In_ HANDLE NotifySet,
+    _In_ HANDLE Socket,
+    _In_ XSK_NOTIFY_FLAGS Flags,
+    _In_opt_ VOID *Context
+    )
+{
+    BOOL Res;
+    XSK_NOTIFY_SET_ADD_IN Add = {0};
+
+    Add.Socket = Socket;
+    Add.Flags = Flags;
+    Add.Context = Context;
+
+    Res =
+        XdpIoctl(
+            NotifySet,
+            IOCTL_XSK_NOTIFY_SET_ADD,
+            &Add,
+            sizeof(Add),
+            NULL,
+            0,
+            NULL,
+            NULL,
+            FALSE);
+    if (Res == 0) {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    return S_OK;
+}
+
+HRESULT
+XskNotifySetRemove(
+    _In_ HANDLE NotifySet,
+    _In_ HANDLE Socket
+    )
+{
+    BOOL Res;
+    XSK_NOTIFY_SET_REMOVE_IN Remove = {0};
+
+    Remove.Socket = Socket;
+
+    Res =
+        XdpIoctl(
+            NotifySet,
+            IOCTL_XSK_NOTIFY_SET_REMOVE,
+            &Remove,
+            sizeof(Remove),
+            NULL,
+            0,
+            NULL,
+            NULL,
+            FALSE);
+    if (Res == 0) {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    return S_OK;
+}
+
+HRESULT
+XskNotifySetWait(
+    _In_ HANDLE NotifySet,
+    _In_ UINT32 WaitTimeoutMilliseconds,
+    _Out_writes_to_(EventCount, *ReadyCount) XSK_NOTIFY_SET_EVENT *Events,
+    _In_ UINT32 EventCount,
+    _Out_ UINT32 *ReadyCount
+    )
+{
+    BOOL Res;
+    DWORD BytesReturned;
+    XSK_NOTIFY_SET_WAIT_IN Wait = {0};
+
+    *ReadyCount = 0;
+
+    if (EventCount == 0 || EventCount > MAXULONG / sizeof(*Events)) {
+        return E_INVALIDARG;
+    }
+
+    Wait.WaitTimeoutMilliseconds = WaitTimeoutMilliseconds;
+
+    Res =
+        XdpIoctl(
+            NotifySet,
+            IOCTL_XSK_NOTIFY_SET_WAIT,
+            &Wait,
+            sizeof(Wait),
+            Events,
+            EventCount * sizeof(*Events),
+            &BytesReturned,
+            NULL,
+            FALSE);
+    if (Res == 0) {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    *ReadyCount = BytesReturned / sizeof(*Events);
+
+    return S_OK;
+}
@@ -12,6 +12,7 @@
 #include <winternl.h>
 #include <crtdbg.h>
 #include <ifdef.h>
+#include <afxdp_experimental.h>
 #include <xdpapi.h>
 #include <xdpapi_experimental.h>
 #include <xdpassert.h>
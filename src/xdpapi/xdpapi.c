@@ -30,6 +30,11 @@ XDP_RSS_GET_CAPABILITIES_FN XdpRssGetCapabilities;
 XDP_RSS_SET_FN XdpRssSet;
 XDP_RSS_GET_FN XdpRssGet;
 XDP_QEO_SET_FN XdpQeoSet;
+XSK_NOTIFY_SOCKET_PRECISE_FN XskNotifySocketPrecise;
+XSK_NOTIFY_SET_CREATE_FN XskNotifySetCreate;
+XSK_NOTIFY_SET_ADD_FN XskNotifySetAdd;
+XSK_NOTIFY_SET_REMOVE_FN XskNotifySetRemove;
+XSK_NOTIFY_SET_WAIT_FN XskNotifySetWait;
 
 typedef struct _XDP_API_ROUTINE {
     _Null_terminated_ const CHAR *RoutineName;
@@ -58,6 +63,11 @@ static const XDP_API_ROUTINE XdpApiRoutines[] = {
     { DECLARE_EXPERIMENTAL_XDP_API_ROUTINE(XdpRssSet, XDP_RSS_SET_FN_NAME) },
     { DECLARE_EXPERIMENTAL_XDP_API_ROUTINE(XdpRssGet, XDP_RSS_GET_FN_NAME) },
     { DECLARE_EXPERIMENTAL_XDP_API_ROUTINE(XdpQeoSet, XDP_QEO_SET_FN_NAME) },
+    { DECLARE_EXPERIMENTAL_XDP_API_ROUTINE(XskNotifySocketPrecise, XSK_NOTIFY_SOCKET_PRECISE_FN_NAME) },
+    { DECLARE_EXPERIMENTAL_XDP_API_ROUTINE(XskNotifySetCreate, XSK_NOTIFY_SET_CREATE_FN_NAME) },
+    { DECLARE_EXPERIMENTAL_XDP_API_ROUTINE(XskNotifySetAdd, XSK_NOTIFY_SET_ADD_FN_NAME) },
+    { DECLARE_EXPERIMENTAL_XDP_API_ROUTINE(XskNotifySetRemove, XSK_NOTIFY_SET_REMOVE_FN_NAME) },
+    { DECLARE_EXPERIMENTAL_XDP_API_ROUTINE(XskNotifySetWait, XSK_NOTIFY_SET_WAIT_FN_NAME) },
 };
 
 static CONST XDP_API_TABLE XdpApiTableV1 = {
@@ -7,7 +7,12 @@
 #include <setupapi.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <ebpf_nethooks.h>
+#include <ebpf_program_types.h>
+#include <ebpf_store_helper.h>
+#include <ebpf_structs.h>
 
+#include <xdpebpfprograminfo.h>
 #include <xdpioctl.h>
 
 static
@@ -17,11 +22,12 @@ Usage(
     )
 {
     fprintf(stderr,
-        "Usage: xdpcfg.exe <SetDeviceSddl> [OPTIONS ...]\n"
+        "Usage: xdpcfg.exe <SetDeviceSddl|UpdateEbpfStore> [OPTIONS ...]\n"
         "\n"
         "OPTIONS:\n"
         "\n"
-        "    SetDeviceSddl <SDDL>\n");
+        "    SetDeviceSddl <SDDL>\n"
+        "    UpdateEbpfStore\n");
     exit(EXIT_FAILURE);
 }
 
@@ -54,6 +60,32 @@ SetDeviceSddl(
     return EXIT_SUCCESS;
 }
 
+static
+INT
+UpdateEbpfStore(
+    _In_ INT ArgC,
+    _In_ WCHAR **ArgV
+    )
+{
+    ebpf_result_t Result;
+
+    UNREFERENCED_PARAMETER(ArgC);
+    UNREFERENCED_PARAMETER(ArgV);
+
+    //
+    // Replace the XDP program information installed by eBPF-for-Windows with
+    // XDP's own, which describes every XDP helper, so the verifier can resolve
+    // them.
+    //
+    Result = ebpf_store_update_program_information_array(&EbpfXdpProgramInfo, 1);
+    if (Result != EBPF_SUCCESS) {
+        fprintf(stderr, "ebpf_store_update_program_information_array failed: %d\n", Result);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
 INT
 __cdecl
 wmain(
@@ -67,6 +99,8 @@ wmain(
 
     if (!_wcsicmp(ArgV[1], L"SetDeviceSddl")) {
         return SetDeviceSddl(ArgC, ArgV);
+    } else if (!_wcsicmp(ArgV[1], L"UpdateEbpfStore")) {
+        return UpdateEbpfStore(ArgC, ArgV);
     } else {
         Usage();
     }
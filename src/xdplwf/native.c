@@ -21,6 +21,26 @@ XDP_HOOK_ID NativeHooks[] = {
     },
 };
 
+static
+CONST
+XDP_HOOK_ID NativeTxInspectHooks[] = {
+    {
+        .Layer      = XDP_HOOK_L2,
+        .Direction  = XDP_HOOK_RX,
+        .SubLayer   = XDP_HOOK_INSPECT,
+    },
+    {
+        .Layer      = XDP_HOOK_L2,
+        .Direction  = XDP_HOOK_TX,
+        .SubLayer   = XDP_HOOK_INJECT,
+    },
+    {
+        .Layer      = XDP_HOOK_L2,
+        .Direction  = XDP_HOOK_TX,
+        .SubLayer   = XDP_HOOK_INSPECT,
+    },
+};
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 VOID
 XdpNativeRemoveInterfaceComplete(
@@ -105,6 +125,18 @@ XdpNativeAttachInterface(
 
     Native->Capabilities.CapabilitiesSize = BytesReturned;
 
+    if (CapabilitiesEx->Header.Revision >= XDP_CAPABILITIES_EX_REVISION_2 &&
+        CapabilitiesEx->Header.Size >= XDP_SIZEOF_CAPABILITIES_EX_REVISION_2 &&
+        BytesReturned >= XDP_SIZEOF_CAPABILITIES_EX_REVISION_2 &&
+        (CapabilitiesEx->Flags & XDP_CAPABILITIES_EX_FLAG_TX_INSPECT)) {
+        //
+        // The interface indicates locally sent frames to XDP before posting
+        // them to hardware.
+        //
+        Native->Capabilities.Hooks = NativeTxInspectHooks;
+        Native->Capabilities.HookCount = RTL_NUMBER_OF(NativeTxInspectHooks);
+    }
+
     RtlZeroMemory(AddIf, sizeof(*AddIf));
     AddIf->InterfaceCapabilities = &Native->Capabilities;
     AddIf->RemoveInterfaceComplete = XdpNativeRemoveInterfaceComplete;
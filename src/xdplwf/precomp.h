@@ -43,7 +43,6 @@
 #include <xdppcw.h>
 #include <xdpregistry.h>
 #include <xdprtl.h>
-#include <xdprxqueue_internal.h>
 #include <xdpstatusconvert.h>
 #include <xdptimer.h>
 #include <xdptxqueue_internal.h>
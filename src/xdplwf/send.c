@@ -259,6 +259,7 @@ XdpGenericInitiateTx(
     NBL_COUNTED_QUEUE Nbls;
     XDP_RING *FrameRing;
     ULONG NblsAvailable;
+    UINT64 FrameBytes = 0;
 
     if (ReadPointerAcquire(&TxQueue->XdpTxQueue) == NULL) {
         return FALSE;
@@ -302,10 +303,15 @@ XdpGenericInitiateTx(
             TxQueue->Stats.BatchesPosted);
 
         FrameRing->ConsumerIndex++;
+        FrameBytes += Buffer->DataLength;
     }
 
     ASSERT(Nbls.NblCount > 0);
 
+    EventWriteGenericTxEnqueueBatch(
+        &MICROSOFT_XDP_PROVIDER, TxQueue, FrameRing->ConsumerIndex - (UINT32)Nbls.NblCount,
+        (UINT32)Nbls.NblCount, FrameBytes, TxQueue->Stats.BatchesPosted);
+
     TxQueue->OutstandingCount += (ULONG)Nbls.NblCount;
 
     EventWriteGenericTxPostBatchStart(
@@ -9,6 +9,16 @@
 
 typedef struct _PCW_INSTANCE PCW_INSTANCE;
 
+//
+// Histograms use log2 buckets; the last bucket is unbounded.
+//
+#define XDP_PCW_HISTOGRAM_BUCKETS 8
+#define XDP_PCW_BATCH_SIZE_FIRST_BUCKET_LIMIT_LOG2 1
+#define XDP_PCW_FRAME_LENGTH_FIRST_BUCKET_LIMIT_LOG2 7
+
+#pragma warning(push)
+#pragma warning(disable:4201) // nonstandard extension used: nameless struct/union
+
 typedef struct _XDP_PCW_RX_QUEUE {
     UINT64 XskFramesDelivered;
     UINT64 XskFramesDropped;
@@ -19,20 +29,90 @@ typedef struct _XDP_PCW_RX_QUEUE {
     UINT64 InspectFramesDropped;
     UINT64 InspectFramesRedirected;
     UINT64 InspectFramesForwarded;
+    UINT64 CycleSampledBatches;
+    UINT64 CycleSampledFrames;
+    UINT64 InspectCycles;
+    UINT64 RedirectFlushCycles;
+    UINT64 XskRxCopyCycles;
+    union {
+        UINT64 InspectBatchSizeHistogram[XDP_PCW_HISTOGRAM_BUCKETS];
+        struct {
+            UINT64 InspectBatchSize1;
+            UINT64 InspectBatchSize2To3;
+            UINT64 InspectBatchSize4To7;
+            UINT64 InspectBatchSize8To15;
+            UINT64 InspectBatchSize16To31;
+            UINT64 InspectBatchSize32To63;
+            UINT64 InspectBatchSize64To127;
+            UINT64 InspectBatchSize128Plus;
+        };
+    };
+    union {
+        UINT64 InspectFrameLengthHistogram[XDP_PCW_HISTOGRAM_BUCKETS];
+        struct {
+            UINT64 InspectFrameLength0To127;
+            UINT64 InspectFrameLength128To255;
+            UINT64 InspectFrameLength256To511;
+            UINT64 InspectFrameLength512To1023;
+            UINT64 InspectFrameLength1024To2047;
+            UINT64 InspectFrameLength2048To4095;
+            UINT64 InspectFrameLength4096To8191;
+            UINT64 InspectFrameLength8192Plus;
+        };
+    };
+    UINT64 InspectFramesMirrored;
+    UINT64 EbpfCycleSampledFrames;
+    UINT64 EbpfCycles;
 } XDP_PCW_RX_QUEUE;
 
+#pragma warning(pop)
+
 typedef struct _XDP_PCW_LWF_RX_QUEUE {
     UINT64 MappingFailures;
     UINT64 LinearizationFailures;
     UINT64 ForwardingFailures;
 } XDP_PCW_LWF_RX_QUEUE;
 
+#pragma warning(push)
+#pragma warning(disable:4201) // nonstandard extension used: nameless struct/union
+
 typedef struct _XDP_PCW_TX_QUEUE {
     UINT64 XskInvalidDescriptors;
     UINT64 InjectionBatches;
     UINT64 QueueDepth;
+    UINT64 CycleSampledBatches;
+    UINT64 CompletionCycles;
+    UINT64 FillCycles;
+    union {
+        UINT64 InjectionBatchSizeHistogram[XDP_PCW_HISTOGRAM_BUCKETS];
+        struct {
+            UINT64 InjectionBatchSize1;
+            UINT64 InjectionBatchSize2To3;
+            UINT64 InjectionBatchSize4To7;
+            UINT64 InjectionBatchSize8To15;
+            UINT64 InjectionBatchSize16To31;
+            UINT64 InjectionBatchSize32To63;
+            UINT64 InjectionBatchSize64To127;
+            UINT64 InjectionBatchSize128Plus;
+        };
+    };
+    union {
+        UINT64 InjectionFrameLengthHistogram[XDP_PCW_HISTOGRAM_BUCKETS];
+        struct {
+            UINT64 InjectionFrameLength0To127;
+            UINT64 InjectionFrameLength128To255;
+            UINT64 InjectionFrameLength256To511;
+            UINT64 InjectionFrameLength512To1023;
+            UINT64 InjectionFrameLength1024To2047;
+            UINT64 InjectionFrameLength2048To4095;
+            UINT64 InjectionFrameLength4096To8191;
+            UINT64 InjectionFrameLength8192Plus;
+        };
+    };
 } XDP_PCW_TX_QUEUE;
 
+#pragma warning(pop)
+
 typedef struct _XDP_PCW_LWF_TX_QUEUE {
     UINT64 FramesDroppedPause;
     UINT64 FramesDroppedNic;
@@ -42,6 +122,29 @@ typedef struct _XDP_PCW_LWF_TX_QUEUE {
 #define STAT_ADD(_Stats, _Field, _Bias) (((_Stats)->_Field) += (_Bias))
 #define STAT_SET(_Stats, _Field, _Value) (((_Stats)->_Field) = (_Value))
 
+//
+// Returns the histogram bucket for a value: values below 2^FirstBucketLimitLog2
+// fall into the first bucket, and each following bucket doubles the range.
+//
+FORCEINLINE
+UINT32
+XdpPcwHistogramBucket(
+    _In_ UINT32 Value,
+    _In_ UINT32 FirstBucketLimitLog2
+    )
+{
+    ULONG Log2;
+
+    if (!_BitScanReverse(&Log2, Value) || Log2 < FirstBucketLimitLog2) {
+        return 0;
+    }
+
+    return min(Log2 - FirstBucketLimitLog2 + 1, XDP_PCW_HISTOGRAM_BUCKETS - 1);
+}
+
+#define STAT_HISTOGRAM_INC(_Stats, _Field, _Value, _FirstBucketLimitLog2) \
+    (((_Stats)->_Field##Histogram[XdpPcwHistogramBucket((_Value), (_FirstBucketLimitLog2))])++)
+
 #ifdef KERNEL_MODE
 //
 // Before including the autogenerated PCW helpers, set the PCW version macro to
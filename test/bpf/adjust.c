@@ -0,0 +1,77 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+
+#include "bpf_helpers.h"
+#include "xdp_ebpf_helpers.h"
+
+#define ADJUST_DELTA 4
+
+//
+// Applies a head, tail, or meta adjustment and then reverts it. Returns zero if
+// the adjustment either failed without modifying the context or succeeded and
+// moved the context bounds by exactly the requested delta.
+//
+static int
+adjust_and_revert(xdp_md_t *ctx, int helper)
+{
+    void *data = ctx->data;
+    void *data_end = ctx->data_end;
+    void *data_meta = ctx->data_meta;
+    int result;
+
+    if (helper == 0) {
+        result = bpf_xdp_adjust_head(ctx, -ADJUST_DELTA);
+    } else if (helper == 1) {
+        result = bpf_xdp_adjust_tail(ctx, ADJUST_DELTA);
+    } else {
+        result = bpf_xdp_adjust_meta(ctx, -ADJUST_DELTA);
+    }
+
+    if (result < 0) {
+        return (ctx->data == data && ctx->data_end == data_end && ctx->data_meta == data_meta) ?
+            0 : -1;
+    }
+
+    if (helper == 0) {
+        if ((char *)ctx->data + ADJUST_DELTA != data || ctx->data_end != data_end) {
+            return -1;
+        }
+        result = bpf_xdp_adjust_head(ctx, ADJUST_DELTA);
+    } else if (helper == 1) {
+        if (ctx->data != data || (char *)ctx->data_end != (char *)data_end + ADJUST_DELTA) {
+            return -1;
+        }
+        result = bpf_xdp_adjust_tail(ctx, -ADJUST_DELTA);
+    } else {
+        if ((char *)ctx->data_meta + ADJUST_DELTA != data || ctx->data != data) {
+            return -1;
+        }
+        result = bpf_xdp_adjust_meta(ctx, ADJUST_DELTA);
+    }
+
+    if (result < 0 || ctx->data != data || ctx->data_end != data_end) {
+        return -1;
+    }
+
+    return 0;
+}
+
+SEC("xdp/adjust")
+int
+adjust(xdp_md_t *ctx)
+{
+    //
+    // Exercise the head, tail, and meta adjustment helpers. Every adjustment is
+    // reverted, so the frame is passed unmodified whether or not the interface
+    // supports data adjustment; any inconsistency drops the frame.
+    //
+    if (adjust_and_revert(ctx, 0) < 0 ||
+        adjust_and_revert(ctx, 1) < 0 ||
+        adjust_and_revert(ctx, 2) < 0) {
+        return XDP_DROP;
+    }
+
+    return XDP_PASS;
+}
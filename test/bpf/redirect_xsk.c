@@ -0,0 +1,19 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+
+#include "bpf_endian.h"
+#include "bpf_helpers.h"
+#include "xdp_ebpf_helpers.h"
+
+SEC("xdp/redirect_xsk")
+int
+redirect_xsk(xdp_md_t *ctx)
+{
+    //
+    // Redirect every frame to the XSK registered on the RX queue, or pass the
+    // frame if no XSK is registered.
+    //
+    return bpf_xdp_redirect_xsk(ctx, XDP_PASS);
+}
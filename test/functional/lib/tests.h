@@ -26,9 +26,23 @@ GenericBindingResetAdapter();
 VOID
 GenericRxSingleFrame();
 
+VOID
+GenericRxMirror();
+
 VOID
 GenericRxNoPoke();
 
+VOID
+GenericRxMetadata();
+
+VOID
+GenericRxFilter();
+
+VOID
+GenericRxInvalidFill(
+    _In_ BOOLEAN Exclusive
+    );
+
 VOID
 GenericRxBackfillAndTrailer();
 
@@ -121,9 +135,18 @@ GenericRxEbpfPayload();
 VOID
 GenericRxEbpfFragments();
 
+VOID
+GenericRxEbpfRedirectXsk();
+
+VOID
+GenericRxEbpfAdjust();
+
 VOID
 GenericRxEbpfUnload();
 
+VOID
+GenericRxEbpfChained();
+
 VOID
 GenericTxToRxInject();
 
@@ -154,6 +177,18 @@ GenericXskWaitAsync(
     _In_ BOOLEAN Tx
     );
 
+VOID
+GenericXskNotifyPrecise();
+
+VOID
+GenericXskNotifySet();
+
+VOID
+GenericXskTxDoorbell();
+
+VOID
+GenericXskPollSocketConfig();
+
 VOID
 GenericLwfDelayDetach(
     _In_ BOOLEAN Rx,
@@ -168,6 +203,9 @@ GenericLoopback(
 VOID
 FnMpNativeHandleTest();
 
+VOID
+FnMpNativeTxInspectFallback();
+
 VOID
 FnLwfRx();
 
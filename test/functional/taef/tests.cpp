@@ -108,10 +108,30 @@ public:
         ::GenericRxSingleFrame();
     }
 
+    TEST_METHOD(GenericRxMirror) {
+        ::GenericRxMirror();
+    }
+
     TEST_METHOD(GenericRxNoPoke) {
         ::GenericRxNoPoke();
     }
 
+    TEST_METHOD(GenericRxMetadata) {
+        ::GenericRxMetadata();
+    }
+
+    TEST_METHOD(GenericRxFilter) {
+        ::GenericRxFilter();
+    }
+
+    TEST_METHOD(GenericRxInvalidFillRedirect) {
+        ::GenericRxInvalidFill(FALSE);
+    }
+
+    TEST_METHOD(GenericRxInvalidFillExclusive) {
+        ::GenericRxInvalidFill(TRUE);
+    }
+
     TEST_METHOD(GenericRxBackfillAndTrailer) {
         ::GenericRxBackfillAndTrailer();
     }
@@ -156,6 +176,10 @@ public:
         ::FnMpNativeHandleTest();
     }
 
+    TEST_METHOD(FnMpNativeTxInspectFallback) {
+        ::FnMpNativeTxInspectFallback();
+    }
+
     TEST_METHOD(GenericRxTcpControlV4) {
         GenericRxTcpControl(AF_INET);
     }
@@ -292,6 +316,22 @@ public:
         GenericXskWaitAsync(TRUE, TRUE);
     }
 
+    TEST_METHOD(GenericXskNotifyPrecise) {
+        GenericXskNotifyPrecise();
+    }
+
+    TEST_METHOD(GenericXskNotifySet) {
+        GenericXskNotifySet();
+    }
+
+    TEST_METHOD(GenericXskTxDoorbell) {
+        GenericXskTxDoorbell();
+    }
+
+    TEST_METHOD(GenericXskPollSocketConfig) {
+        GenericXskPollSocketConfig();
+    }
+
     TEST_METHOD(GenericLwfDelayDetachRx) {
         GenericLwfDelayDetach(TRUE, FALSE);
     }
@@ -424,10 +464,22 @@ public:
         ::GenericRxEbpfFragments();
     }
 
+    TEST_METHOD(GenericRxEbpfRedirectXsk) {
+        ::GenericRxEbpfRedirectXsk();
+    }
+
+    TEST_METHOD(GenericRxEbpfAdjust) {
+        ::GenericRxEbpfAdjust();
+    }
+
     TEST_METHOD(GenericRxEbpfUnload) {
         ::GenericRxEbpfUnload();
     }
 
+    TEST_METHOD(GenericRxEbpfChained) {
+        ::GenericRxEbpfChained();
+    }
+
     TEST_METHOD(GenericLoopbackV4) {
         GenericLoopback(AF_INET);
     }
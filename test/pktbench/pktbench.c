@@ -0,0 +1,751 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+
+//
+// User mode benchmark for the XDP rule engine. Reuses the pktfuzz stubs to run
+// XdpInspect over synthetic frame and fragment rings and reports the cost per
+// frame for a matrix of rule sets, frame layouts and batch sizes.
+//
+
+#include "precomp.h"
+#include <stdio.h>
+#include <programinspect.h>
+
+#define PKTBENCH_MAX_CASES 32
+#define PKTBENCH_MAX_RULES 60000
+#define PKTBENCH_MAX_BATCH 4096
+#define PKTBENCH_MAX_FRAME 9000
+#define PKTBENCH_QUIC_CID_LENGTH XDP_QUIC_MAX_CID_LENGTH
+#define PKTBENCH_PORT_DST 4433
+#define PKTBENCH_PORT_SRC 1234
+
+typedef struct _XDP_FRAME_WITH_EXTENSIONS {
+    XDP_FRAME Frame;
+    XDP_BUFFER_VIRTUAL_ADDRESS BufferVirtualAddress;
+    XDP_FRAME_FRAGMENT Fragment;
+} XDP_FRAME_WITH_EXTENSIONS;
+
+C_ASSERT(
+    FIELD_OFFSET(XDP_FRAME_WITH_EXTENSIONS, BufferVirtualAddress) ==
+    RTL_SIZEOF_THROUGH_FIELD(XDP_FRAME_WITH_EXTENSIONS, Frame.Buffer));
+
+typedef struct _XDP_BUFFER_WITH_EXTENSIONS {
+    XDP_BUFFER Buffer;
+    XDP_BUFFER_VIRTUAL_ADDRESS BufferVirtualAddress;
+} XDP_BUFFER_WITH_EXTENSIONS;
+
+C_ASSERT(
+    FIELD_OFFSET(XDP_BUFFER_WITH_EXTENSIONS, BufferVirtualAddress) ==
+    RTL_SIZEOF_THROUGH_FIELD(XDP_BUFFER_WITH_EXTENSIONS, Buffer));
+
+typedef enum _PKTBENCH_PROTO {
+    PROTO_UDP,
+    PROTO_TCP,
+    PROTO_QUIC,
+    PROTO_DEFAULT,
+} PKTBENCH_PROTO;
+
+typedef enum _PKTBENCH_LAYOUT {
+    LAYOUT_CONTIGUOUS,
+    LAYOUT_FRAGMENTED,
+} PKTBENCH_LAYOUT;
+
+typedef struct _PKTBENCH_MATCH {
+    CONST CHAR *Name;
+    XDP_MATCH_TYPE Match;
+    PKTBENCH_PROTO DefaultProto;
+} PKTBENCH_MATCH;
+
+static CONST PKTBENCH_MATCH Matches[] = {
+    { "all",                 XDP_MATCH_ALL,                   PROTO_UDP },
+    { "udp",                 XDP_MATCH_UDP,                   PROTO_UDP },
+    { "udp_dst",             XDP_MATCH_UDP_DST,               PROTO_UDP },
+    { "ipv4_dst_mask",       XDP_MATCH_IPV4_DST_MASK,         PROTO_UDP },
+    { "ipv6_dst_mask",       XDP_MATCH_IPV6_DST_MASK,         PROTO_UDP },
+    { "quic_flow_src_cid",   XDP_MATCH_QUIC_FLOW_SRC_CID,     PROTO_QUIC },
+    { "quic_flow_dst_cid",   XDP_MATCH_QUIC_FLOW_DST_CID,     PROTO_QUIC },
+    { "ipv4_udp_tuple",      XDP_MATCH_IPV4_UDP_TUPLE,        PROTO_UDP },
+    { "ipv6_udp_tuple",      XDP_MATCH_IPV6_UDP_TUPLE,        PROTO_UDP },
+    { "udp_port_set",        XDP_MATCH_UDP_PORT_SET,          PROTO_UDP },
+    { "ipv4_udp_port_set",   XDP_MATCH_IPV4_UDP_PORT_SET,     PROTO_UDP },
+    { "ipv6_udp_port_set",   XDP_MATCH_IPV6_UDP_PORT_SET,     PROTO_UDP },
+    { "ipv4_tcp_port_set",   XDP_MATCH_IPV4_TCP_PORT_SET,     PROTO_TCP },
+    { "ipv6_tcp_port_set",   XDP_MATCH_IPV6_TCP_PORT_SET,     PROTO_TCP },
+    { "tcp_dst",             XDP_MATCH_TCP_DST,               PROTO_TCP },
+    { "tcp_quic_flow_src_cid", XDP_MATCH_TCP_QUIC_FLOW_SRC_CID, PROTO_TCP },
+    { "tcp_quic_flow_dst_cid", XDP_MATCH_TCP_QUIC_FLOW_DST_CID, PROTO_TCP },
+    { "tcp_control_dst",     XDP_MATCH_TCP_CONTROL_DST,       PROTO_TCP },
+};
+
+static CONST CHAR *ProtoNames[] = { "udp", "tcp", "quic" };
+static CONST CHAR *LayoutNames[] = { "contiguous", "fragmented" };
+
+typedef struct _PKTBENCH_FRAME_INFO {
+    ADDRESS_FAMILY Af;
+    PKTBENCH_PROTO Proto;
+    INET_ADDR IpSrc;
+    INET_ADDR IpDst;
+    UINT16 PortSrc;
+    UINT16 PortDst;
+    UCHAR Cid[PKTBENCH_QUIC_CID_LENGTH];
+} PKTBENCH_FRAME_INFO;
+
+typedef struct _PKTBENCH_RINGS {
+    XDP_RING *FrameRing;
+    XDP_RING *FragmentRing;
+    UINT32 *FragmentIndexes;
+    UCHAR *FrameData;
+    UINT32 NumFrames;
+} PKTBENCH_RINGS;
+
+CONST CHAR *UsageText =
+"pktbench.exe [OPTIONS]\n"
+"\n"
+"Measures XdpInspect ns/frame and frames/sec in user mode. By default, sweeps\n"
+"every match type across the rule counts, address families and layouts below.\n"
+"Each option narrows one dimension of the sweep.\n"
+"\n"
+"OPTIONS:\n"
+"   -match <name>      A match type, e.g. udp_dst, ipv6_udp_tuple, tcp_dst\n"
+"                      Default: all match types\n"
+"   -rules <count>     Number of rules; all but the last miss the frame\n"
+"                      Default: 1, 10, 100, 1000, 10000\n"
+"   -af <4|6>          IP address family of the frames\n"
+"                      Default: 4 and 6\n"
+"   -proto <udp|tcp|quic>\n"
+"                      Transport of the frames; quic is UDP with a QUIC short\n"
+"                      header. Default: the natural protocol for each match\n"
+"   -layout <contiguous|fragmented>\n"
+"                      Whether frames are split across the fragment ring\n"
+"                      Default: both\n"
+"   -fragsize <bytes>  Size of each buffer of a fragmented frame\n"
+"                      Default: 32\n"
+"   -payload <bytes>   Transport payload length\n"
+"                      Default: 64\n"
+"   -batch <frames>    Frames inspected per batch\n"
+"                      Default: 64\n"
+"   -duration <ms>     Measurement time per case\n"
+"                      Default: 100\n"
+"\n"
+"Output is one CSV line per case.\n"
+;
+
+UINT32 MatchFilter[PKTBENCH_MAX_CASES];
+UINT32 NumMatchFilter;
+UINT32 RuleCounts[PKTBENCH_MAX_CASES] = { 1, 10, 100, 1000, 10000 };
+UINT32 NumRuleCounts = 5;
+ADDRESS_FAMILY Afs[2] = { AF_INET, AF_INET6 };
+UINT32 NumAfs = 2;
+PKTBENCH_PROTO ProtoOverride = PROTO_DEFAULT;
+PKTBENCH_LAYOUT Layouts[2] = { LAYOUT_CONTIGUOUS, LAYOUT_FRAGMENTED };
+UINT32 NumLayouts = 2;
+UINT32 FragmentSize = 32;
+UINT32 PayloadLength = 64;
+UINT32 BatchSizes[PKTBENCH_MAX_CASES] = { 64 };
+UINT32 NumBatchSizes = 1;
+UINT32 DurationMs = 100;
+
+XDP_EXTENSION FragmentExtension = {
+    .Reserved = FIELD_OFFSET(XDP_FRAME_WITH_EXTENSIONS, Fragment)
+};
+
+XDP_EXTENSION VirtualAddressExtension = {
+    .Reserved = FIELD_OFFSET(XDP_BUFFER_WITH_EXTENSIONS, BufferVirtualAddress)
+};
+
+//
+// Port sets that do and do not contain the benchmark destination port. Other
+// ports are sparsely populated so the bitmap is not trivially empty or full.
+//
+static UINT8 HitPortSet[XDP_PORT_SET_BUFFER_SIZE];
+static UINT8 MissPortSet[XDP_PORT_SET_BUFFER_SIZE];
+
+VOID
+Usage(
+    _In_ CONST CHAR *Error
+    )
+{
+    fprintf(stderr, "Error: %s\n%s", Error, UsageText);
+    exit(1);
+}
+
+static
+UINT32
+RoundUpPow2(
+    _In_ UINT32 Value
+    )
+{
+    UINT32 Result = 1;
+
+    while (Result < Value) {
+        Result <<= 1;
+    }
+
+    return Result;
+}
+
+static
+UINT32
+ParseCount(
+    _In_ CONST CHAR *Arg,
+    _In_ UINT32 Max
+    )
+{
+    UINT32 Value = (UINT32)strtoul(Arg, NULL, 0);
+
+    if (Value == 0 || Value > Max) {
+        Usage("invalid count");
+    }
+
+    return Value;
+}
+
+static
+VOID
+ParseArgs(
+    _In_ INT ArgC,
+    _In_ CHAR **ArgV
+    )
+{
+    BOOLEAN RulesSet = FALSE;
+    BOOLEAN AfSet = FALSE;
+    BOOLEAN LayoutSet = FALSE;
+    BOOLEAN BatchSet = FALSE;
+
+    for (INT i = 1; i < ArgC; i++) {
+        if (i + 1 >= ArgC) {
+            Usage("missing option value");
+        }
+
+        if (!_stricmp(ArgV[i], "-match")) {
+            UINT32 Index;
+
+            ++i;
+            for (Index = 0; Index < RTL_NUMBER_OF(Matches); Index++) {
+                if (!_stricmp(ArgV[i], Matches[Index].Name)) {
+                    break;
+                }
+            }
+
+            if (Index == RTL_NUMBER_OF(Matches) || NumMatchFilter == PKTBENCH_MAX_CASES) {
+                Usage("invalid -match");
+            }
+
+            MatchFilter[NumMatchFilter++] = Index;
+        } else if (!_stricmp(ArgV[i], "-rules")) {
+            if (!RulesSet) {
+                NumRuleCounts = 0;
+                RulesSet = TRUE;
+            }
+            if (NumRuleCounts == PKTBENCH_MAX_CASES) {
+                Usage("too many -rules");
+            }
+            RuleCounts[NumRuleCounts++] = ParseCount(ArgV[++i], PKTBENCH_MAX_RULES);
+        } else if (!_stricmp(ArgV[i], "-af")) {
+            if (!AfSet) {
+                NumAfs = 0;
+                AfSet = TRUE;
+            }
+            ++i;
+            if (NumAfs == RTL_NUMBER_OF(Afs)) {
+                Usage("too many -af");
+            } else if (!strcmp(ArgV[i], "4")) {
+                Afs[NumAfs++] = AF_INET;
+            } else if (!strcmp(ArgV[i], "6")) {
+                Afs[NumAfs++] = AF_INET6;
+            } else {
+                Usage("invalid -af");
+            }
+        } else if (!_stricmp(ArgV[i], "-proto")) {
+            ++i;
+            if (!_stricmp(ArgV[i], "udp")) {
+                ProtoOverride = PROTO_UDP;
+            } else if (!_stricmp(ArgV[i], "tcp")) {
+                ProtoOverride = PROTO_TCP;
+            } else if (!_stricmp(ArgV[i], "quic")) {
+                ProtoOverride = PROTO_QUIC;
+            } else {
+                Usage("invalid -proto");
+            }
+        } else if (!_stricmp(ArgV[i], "-layout")) {
+            if (!LayoutSet) {
+                NumLayouts = 0;
+                LayoutSet = TRUE;
+            }
+            ++i;
+            if (NumLayouts == RTL_NUMBER_OF(Layouts)) {
+                Usage("too many -layout");
+            } else if (!_stricmp(ArgV[i], "contiguous")) {
+                Layouts[NumLayouts++] = LAYOUT_CONTIGUOUS;
+            } else if (!_stricmp(ArgV[i], "fragmented")) {
+                Layouts[NumLayouts++] = LAYOUT_FRAGMENTED;
+            } else {
+                Usage("invalid -layout");
+            }
+        } else if (!_stricmp(ArgV[i], "-fragsize")) {
+            FragmentSize = ParseCount(ArgV[++i], PKTBENCH_MAX_FRAME);
+        } else if (!_stricmp(ArgV[i], "-payload")) {
+            PayloadLength = (UINT32)strtoul(ArgV[++i], NULL, 0);
+            if (PayloadLength < 1 + PKTBENCH_QUIC_CID_LENGTH ||
+                PayloadLength > PKTBENCH_MAX_FRAME - TCP_HEADER_BACKFILL(AF_INET6)) {
+                Usage("invalid -payload");
+            }
+        } else if (!_stricmp(ArgV[i], "-batch")) {
+            if (!BatchSet) {
+                NumBatchSizes = 0;
+                BatchSet = TRUE;
+            }
+            if (NumBatchSizes == PKTBENCH_MAX_CASES) {
+                Usage("too many -batch");
+            }
+            BatchSizes[NumBatchSizes++] = ParseCount(ArgV[++i], PKTBENCH_MAX_BATCH);
+        } else if (!_stricmp(ArgV[i], "-duration")) {
+            DurationMs = ParseCount(ArgV[++i], MAXUINT32);
+        } else {
+            Usage("unexpected parameter");
+        }
+    }
+
+    if (NumMatchFilter == 0) {
+        for (UINT32 Index = 0; Index < RTL_NUMBER_OF(Matches); Index++) {
+            MatchFilter[NumMatchFilter++] = Index;
+        }
+    }
+}
+
+static
+VOID
+InitializeFrameInfo(
+    _Out_ PKTBENCH_FRAME_INFO *Info,
+    _In_ ADDRESS_FAMILY Af,
+    _In_ PKTBENCH_PROTO Proto
+    )
+{
+    ADDRESS_FAMILY ParsedAf;
+
+    RtlZeroMemory(Info, sizeof(*Info));
+    Info->Af = Af;
+    Info->Proto = Proto;
+    Info->PortSrc = htons(PKTBENCH_PORT_SRC);
+    Info->PortDst = htons(PKTBENCH_PORT_DST);
+
+    if (Af == AF_INET) {
+        PktStringToInetAddressA(&Info->IpSrc, &ParsedAf, "192.168.100.1");
+        PktStringToInetAddressA(&Info->IpDst, &ParsedAf, "192.168.100.2");
+    } else {
+        PktStringToInetAddressA(&Info->IpSrc, &ParsedAf, "fc00::100:1");
+        PktStringToInetAddressA(&Info->IpDst, &ParsedAf, "fc00::100:2");
+    }
+
+    for (UINT32 Index = 0; Index < RTL_NUMBER_OF(Info->Cid); Index++) {
+        Info->Cid[Index] = (UCHAR)(Index + 1);
+    }
+}
+
+static
+VOID
+InitPortSets(
+    VOID
+    )
+{
+    //
+    // Port sets are indexed by the port in network byte order.
+    //
+    UINT16 Port = htons(PKTBENCH_PORT_DST);
+
+    RtlFillMemory(HitPortSet, sizeof(HitPortSet), 0x55);
+    RtlFillMemory(MissPortSet, sizeof(MissPortSet), 0x55);
+
+    HitPortSet[Port >> 3] |= (UINT8)(1 << (Port & 0x7));
+    MissPortSet[Port >> 3] &= (UINT8)~(1 << (Port & 0x7));
+}
+
+static
+UINT32
+BuildFrame(
+    _Out_writes_bytes_(PKTBENCH_MAX_FRAME) UCHAR *Frame,
+    _In_ CONST PKTBENCH_FRAME_INFO *Info
+    )
+{
+    static CONST ETHERNET_ADDRESS EthSrc = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55};
+    static CONST ETHERNET_ADDRESS EthDst = {0x00, 0x66, 0x77, 0x88, 0x99, 0xaa};
+    UCHAR Payload[PKTBENCH_MAX_FRAME] = {0};
+    UINT32 FrameLength = PKTBENCH_MAX_FRAME;
+
+    //
+    // The payload of QUIC and TCP frames begins with a QUIC short header so
+    // CID match types exercise the full header parse and compare.
+    //
+    if (Info->Proto != PROTO_UDP) {
+        Payload[0] = 0x40;
+        RtlCopyMemory(&Payload[1], Info->Cid, sizeof(Info->Cid));
+    }
+
+    if (Info->Proto == PROTO_TCP) {
+        if (!PktBuildTcpFrame(
+                Frame, &FrameLength, Payload, (UINT16)PayloadLength, NULL, 0, 1, 2,
+                TH_SYN | TH_ACK, 65535, &EthDst, &EthSrc, Info->Af, &Info->IpDst,
+                &Info->IpSrc, Info->PortDst, Info->PortSrc)) {
+            Usage("failed to build TCP frame");
+        }
+    } else {
+        if (!PktBuildUdpFrame(
+                Frame, &FrameLength, Payload, (UINT16)PayloadLength, &EthDst, &EthSrc,
+                Info->Af, &Info->IpDst, &Info->IpSrc, Info->PortDst, Info->PortSrc)) {
+            Usage("failed to build UDP frame");
+        }
+    }
+
+    return FrameLength;
+}
+
+static
+VOID
+BuildRule(
+    _Out_ XDP_RULE *Rule,
+    _In_ XDP_MATCH_TYPE Match,
+    _In_ CONST PKTBENCH_FRAME_INFO *Info,
+    _In_ UINT32 Miss
+    )
+{
+    XDP_MATCH_PATTERN *Pattern = &Rule->Pattern;
+
+    //
+    // Build a rule that matches the benchmark frame if Miss is zero, and a
+    // distinct non-matching rule otherwise. Match types without a pattern
+    // cannot miss, so their non-matching rules match a different destination
+    // port of the frame's protocol instead.
+    //
+
+    RtlZeroMemory(Rule, sizeof(*Rule));
+    Rule->Action = Miss ? XDP_PROGRAM_ACTION_DROP : XDP_PROGRAM_ACTION_PASS;
+
+    if (Miss && (Match == XDP_MATCH_ALL || Match == XDP_MATCH_UDP)) {
+        Match = (Info->Proto == PROTO_TCP) ? XDP_MATCH_TCP_DST : XDP_MATCH_UDP_DST;
+    }
+
+    Rule->Match = Match;
+
+    switch (Match) {
+    case XDP_MATCH_UDP_DST:
+    case XDP_MATCH_TCP_DST:
+    case XDP_MATCH_TCP_CONTROL_DST:
+        Pattern->Port = htons((UINT16)(PKTBENCH_PORT_DST + Miss));
+        break;
+
+    case XDP_MATCH_IPV4_DST_MASK:
+        Pattern->IpMask.Mask.Ipv4.s_addr = MAXUINT32;
+        Pattern->IpMask.Address.Ipv4 = Info->IpDst.Ipv4;
+        Pattern->IpMask.Address.Ipv4.s_addr ^= htonl(Miss);
+        break;
+
+    case XDP_MATCH_IPV6_DST_MASK:
+        RtlFillMemory(&Pattern->IpMask.Mask.Ipv6, sizeof(Pattern->IpMask.Mask.Ipv6), 0xff);
+        Pattern->IpMask.Address.Ipv6 = Info->IpDst.Ipv6;
+        *(UINT32 UNALIGNED *)&Pattern->IpMask.Address.Ipv6.u.Byte[12] ^= htonl(Miss);
+        break;
+
+    case XDP_MATCH_IPV4_UDP_TUPLE:
+    case XDP_MATCH_IPV6_UDP_TUPLE:
+        Pattern->Tuple.SourceAddress = *(XDP_INET_ADDR *)&Info->IpSrc;
+        Pattern->Tuple.DestinationAddress = *(XDP_INET_ADDR *)&Info->IpDst;
+        Pattern->Tuple.SourcePort = htons((UINT16)(PKTBENCH_PORT_SRC + Miss));
+        Pattern->Tuple.DestinationPort = Info->PortDst;
+        break;
+
+    case XDP_MATCH_QUIC_FLOW_SRC_CID:
+    case XDP_MATCH_QUIC_FLOW_DST_CID:
+    case XDP_MATCH_TCP_QUIC_FLOW_SRC_CID:
+    case XDP_MATCH_TCP_QUIC_FLOW_DST_CID:
+        Pattern->QuicFlow.UdpPort = Info->PortDst;
+        Pattern->QuicFlow.CidLength = sizeof(Info->Cid);
+        Pattern->QuicFlow.CidOffset = 0;
+        RtlCopyMemory(Pattern->QuicFlow.CidData, Info->Cid, sizeof(Info->Cid));
+        *(UINT32 UNALIGNED *)&Pattern->QuicFlow.CidData[sizeof(Info->Cid) - sizeof(UINT32)] ^= Miss;
+        break;
+
+    case XDP_MATCH_UDP_PORT_SET:
+        Pattern->PortSet.PortSet = Miss ? MissPortSet : HitPortSet;
+        break;
+
+    case XDP_MATCH_IPV4_UDP_PORT_SET:
+    case XDP_MATCH_IPV6_UDP_PORT_SET:
+    case XDP_MATCH_IPV4_TCP_PORT_SET:
+    case XDP_MATCH_IPV6_TCP_PORT_SET:
+        Pattern->IpPortSet.Address = *(XDP_INET_ADDR *)&Info->IpDst;
+        Pattern->IpPortSet.PortSet.PortSet = Miss ? MissPortSet : HitPortSet;
+        break;
+
+    default:
+        break;
+    }
+}
+
+static
+XDP_PROGRAM *
+CreateProgram(
+    _In_ XDP_MATCH_TYPE Match,
+    _In_ CONST PKTBENCH_FRAME_INFO *Info,
+    _In_ UINT32 RuleCount
+    )
+{
+    XDP_PROGRAM *Program;
+    XDP_RULE UserRule;
+    NTSTATUS Status;
+
+    Program = calloc(1, FIELD_OFFSET(XDP_PROGRAM, Rules) + (SIZE_T)RuleCount * sizeof(XDP_RULE));
+    if (Program == NULL) {
+        Usage("out of memory");
+    }
+
+    //
+    // Every rule but the last misses, so each frame walks the entire program.
+    //
+    for (UINT32 Index = 0; Index < RuleCount; Index++) {
+        BuildRule(&UserRule, Match, Info, RuleCount - 1 - Index);
+
+        Status =
+            XdpProgramValidateRule(
+                &Program->Rules[Index], UserMode, &UserRule, RuleCount, Index);
+        if (!NT_SUCCESS(Status)) {
+            Usage("failed to validate rule");
+        }
+
+        Program->RuleCount++;
+    }
+
+    return Program;
+}
+
+static
+VOID
+DeleteProgram(
+    _In_ XDP_PROGRAM *Program
+    )
+{
+    for (UINT32 Index = 0; Index < Program->RuleCount; Index++) {
+        XdpProgramDeleteRule(&Program->Rules[Index]);
+    }
+
+    free(Program);
+}
+
+static
+XDP_RING *
+AllocateRing(
+    _In_ UINT32 ElementCount,
+    _In_ UINT32 ElementStride
+    )
+{
+    XDP_RING *Ring;
+
+    ElementCount = RoundUpPow2(ElementCount);
+
+    Ring = calloc(1, sizeof(*Ring) + (SIZE_T)ElementCount * ElementStride);
+    if (Ring == NULL) {
+        Usage("out of memory");
+    }
+
+    Ring->ElementStride = ElementStride;
+    Ring->Mask = ElementCount - 1;
+
+    return Ring;
+}
+
+static
+VOID
+CreateRings(
+    _Out_ PKTBENCH_RINGS *Rings,
+    _In_ CONST UCHAR *Frame,
+    _In_ UINT32 FrameLength,
+    _In_ PKTBENCH_LAYOUT Layout,
+    _In_ UINT32 BatchSize
+    )
+{
+    UINT32 BufferLength = FrameLength;
+    UINT32 FragmentCount = 0;
+    UINT32 FragmentRingIndex = 0;
+
+    RtlZeroMemory(Rings, sizeof(*Rings));
+    Rings->NumFrames = BatchSize;
+
+    if (Layout == LAYOUT_FRAGMENTED) {
+        BufferLength = min(FragmentSize, FrameLength);
+        FragmentCount = (FrameLength - 1) / BufferLength;
+
+        if (FragmentCount > MAXUINT8) {
+            Usage("-fragsize too small for the frame");
+        }
+
+        Rings->FragmentRing =
+            AllocateRing(max(1, BatchSize * FragmentCount), sizeof(XDP_BUFFER_WITH_EXTENSIONS));
+    }
+
+    Rings->FrameRing = AllocateRing(BatchSize, sizeof(XDP_FRAME_WITH_EXTENSIONS));
+    Rings->FragmentIndexes = calloc(BatchSize, sizeof(*Rings->FragmentIndexes));
+    Rings->FrameData = malloc((SIZE_T)BatchSize * FrameLength);
+    if (Rings->FragmentIndexes == NULL || Rings->FrameData == NULL) {
+        Usage("out of memory");
+    }
+
+    //
+    // Each frame has a private copy of the data so the working set grows with
+    // the batch size, as it would on a real RX queue.
+    //
+    for (UINT32 FrameIndex = 0; FrameIndex < BatchSize; FrameIndex++) {
+        XDP_FRAME_WITH_EXTENSIONS *FrameExt =
+            XdpRingGetElement(Rings->FrameRing, FrameIndex);
+        UCHAR *Data = Rings->FrameData + (SIZE_T)FrameIndex * FrameLength;
+
+        RtlCopyMemory(Data, Frame, FrameLength);
+
+        FrameExt->Frame.Buffer.DataOffset = 0;
+        FrameExt->Frame.Buffer.DataLength = BufferLength;
+        FrameExt->Frame.Buffer.BufferLength = BufferLength;
+        FrameExt->BufferVirtualAddress.VirtualAddress = Data;
+        FrameExt->Fragment.FragmentBufferCount = (UINT8)FragmentCount;
+
+        if (Rings->FragmentRing == NULL) {
+            continue;
+        }
+
+        Rings->FragmentIndexes[FrameIndex] = FragmentRingIndex;
+
+        for (UINT32 Index = 1; Index <= FragmentCount; Index++) {
+            XDP_BUFFER_WITH_EXTENSIONS *BufferExt =
+                XdpRingGetElement(Rings->FragmentRing, FragmentRingIndex);
+            UINT32 Offset = Index * BufferLength;
+
+            BufferExt->Buffer.DataOffset = 0;
+            BufferExt->Buffer.DataLength = min(BufferLength, FrameLength - Offset);
+            BufferExt->Buffer.BufferLength = BufferLength;
+            BufferExt->BufferVirtualAddress.VirtualAddress = Data + Offset;
+
+            FragmentRingIndex = (FragmentRingIndex + 1) & Rings->FragmentRing->Mask;
+        }
+    }
+}
+
+static
+VOID
+DeleteRings(
+    _In_ PKTBENCH_RINGS *Rings
+    )
+{
+    free(Rings->FrameData);
+    free(Rings->FragmentIndexes);
+    free(Rings->FragmentRing);
+    free(Rings->FrameRing);
+}
+
+static
+VOID
+RunCase(
+    _In_ CONST PKTBENCH_MATCH *Match,
+    _In_ UINT32 RuleCount,
+    _In_ ADDRESS_FAMILY Af,
+    _In_ PKTBENCH_PROTO Proto,
+    _In_ PKTBENCH_LAYOUT Layout,
+    _In_ UINT32 BatchSize,
+    _In_ INT64 Frequency
+    )
+{
+    PKTBENCH_FRAME_INFO Info;
+    PKTBENCH_RINGS Rings;
+    XDP_INSPECTION_CONTEXT InspectionContext = {0};
+    XDP_PROGRAM *Program;
+    UCHAR *Frame;
+    UINT32 FrameLength;
+    UINT64 Passed = 0;
+    UINT64 Frames = 0;
+    UINT32 BatchesPerCheck;
+    LARGE_INTEGER Start;
+    LARGE_INTEGER End;
+    INT64 Deadline;
+    double Ns;
+
+    Frame = malloc(PKTBENCH_MAX_FRAME);
+    if (Frame == NULL) {
+        Usage("out of memory");
+    }
+
+    InitializeFrameInfo(&Info, Af, Proto);
+    FrameLength = BuildFrame(Frame, &Info);
+    CreateRings(&Rings, Frame, FrameLength, Layout, BatchSize);
+    Program = CreateProgram(Match->Match, &Info, RuleCount);
+
+    //
+    // Amortize the timestamp cost across roughly 4K frames.
+    //
+    BatchesPerCheck = max(1, 4096 / BatchSize);
+    Deadline = Frequency * DurationMs / 1000;
+
+    QueryPerformanceCounter(&Start);
+
+    do {
+        for (UINT32 Batch = 0; Batch < BatchesPerCheck; Batch++) {
+            for (UINT32 Index = 0; Index < Rings.NumFrames; Index++) {
+                XDP_RX_ACTION Action =
+                    XdpInspect(
+                        Program, &InspectionContext, Rings.FrameRing, Index, Rings.FragmentRing,
+                        Rings.FragmentRing != NULL ? &FragmentExtension : NULL,
+                        Rings.FragmentIndexes[Index], &VirtualAddressExtension);
+
+                Passed += (Action == XDP_RX_ACTION_PASS);
+            }
+        }
+
+        Frames += (UINT64)BatchesPerCheck * Rings.NumFrames;
+        QueryPerformanceCounter(&End);
+    } while (End.QuadPart - Start.QuadPart < Deadline);
+
+    Ns = (double)(End.QuadPart - Start.QuadPart) * 1000000000.0 / (double)Frequency / (double)Frames;
+
+    printf(
+        "%s,%u,%s,%s,%s,%u,%u,%llu,%.2f,%.3f,%.1f\n",
+        Match->Name, RuleCount, Af == AF_INET ? "v4" : "v6", ProtoNames[Proto],
+        LayoutNames[Layout], BatchSize, FrameLength, Frames, Ns, 1000.0 / Ns,
+        100.0 * (double)Passed / (double)Frames);
+
+    DeleteProgram(Program);
+    DeleteRings(&Rings);
+    free(Frame);
+}
+
+INT
+__cdecl
+main(
+    INT ArgC,
+    CHAR **ArgV
+    )
+{
+    LARGE_INTEGER Frequency;
+
+    ParseArgs(ArgC, ArgV);
+    QueryPerformanceFrequency(&Frequency);
+
+    InitPortSets();
+
+    printf("match,rules,af,proto,layout,batch,frame_bytes,frames,ns_per_frame,mfps,pass_pct\n");
+
+    for (UINT32 m = 0; m < NumMatchFilter; m++) {
+        CONST PKTBENCH_MATCH *Match = &Matches[MatchFilter[m]];
+        PKTBENCH_PROTO Proto = (ProtoOverride != PROTO_DEFAULT) ? ProtoOverride : Match->DefaultProto;
+
+        for (UINT32 r = 0; r < NumRuleCounts; r++) {
+            for (UINT32 a = 0; a < NumAfs; a++) {
+                for (UINT32 l = 0; l < NumLayouts; l++) {
+                    for (UINT32 b = 0; b < NumBatchSizes; b++) {
+                        RunCase(
+                            Match, RuleCounts[r], Afs[a], Proto, Layouts[l], BatchSizes[b],
+                            Frequency.QuadPart);
+                    }
+                }
+            }
+        }
+    }
+
+    return 0;
+}
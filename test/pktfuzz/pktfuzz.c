@@ -6,6 +6,11 @@
 #include "precomp.h"
 #include <programinspect.h>
 
+#define PKTFUZZ_SEED_RULES 8
+#define PKTFUZZ_MAX_RULES 4096
+#define PKTFUZZ_FRAME_RING_SIZE 32
+#define PKTFUZZ_FRAGMENT_RING_SIZE 256
+
 typedef struct _XDP_FRAME_WITH_EXTENSIONS {
     XDP_FRAME Frame;
     XDP_BUFFER_VIRTUAL_ADDRESS BufferVirtualAddress;
@@ -18,7 +23,7 @@ C_ASSERT(
 
 typedef struct _XDP_FRAME_RING {
     XDP_RING Ring;
-    XDP_FRAME_WITH_EXTENSIONS Frames[8];
+    XDP_FRAME_WITH_EXTENSIONS Frames[PKTFUZZ_FRAME_RING_SIZE];
 } XDP_FRAME_RING;
 
 C_ASSERT(
@@ -36,7 +41,7 @@ C_ASSERT(
 
 typedef struct _XDP_FRAGMENT_RING {
     XDP_RING Ring;
-    XDP_BUFFER_WITH_EXTENSIONS Buffers[16];
+    XDP_BUFFER_WITH_EXTENSIONS Buffers[PKTFUZZ_FRAGMENT_RING_SIZE];
 } XDP_FRAGMENT_RING;
 
 C_ASSERT(
@@ -49,19 +54,63 @@ typedef struct _PKTFUZZ_BUFFER_METADATA {
     UINT16 DataLength;
 } PKTFUZZ_BUFFER_METADATA;
 
+//
+// The input is a PKTFUZZ_METADATA followed by up to a full frame ring of
+// frames, each a PKTFUZZ_FRAME_METADATA, its fragment buffer metadata, and the
+// data for every buffer. The seed rules are expanded into RuleCount rules;
+// all but the final copy of the seeds are perturbed so most rules miss.
+//
 typedef struct _PKTFUZZ_METADATA {
     UINT32 FragmentRingEnabled : 1;
     UINT32 FrameRingIndex;
-    UINT32 FrameRingProducerIndex;
-    UINT32 FrameRingConsumerIndex;
     UINT32 FragmentRingIndex;
-    UINT32 FragmentRingProducerIndex;
-    UINT32 FragmentRingConsumerIndex;
-    XDP_RULE Rules[4];
-    PKTFUZZ_BUFFER_METADATA FrameBuffer;
-    PKTFUZZ_BUFFER_METADATA FragmentBuffers[RTL_NUMBER_OF_FIELD(XDP_FRAGMENT_RING, Buffers)];
+    UINT16 RuleCount;
+    UINT16 SeedRuleCount;
+    XDP_RULE Rules[PKTFUZZ_SEED_RULES];
 } PKTFUZZ_METADATA;
 
+typedef struct _PKTFUZZ_FRAME_METADATA {
+    PKTFUZZ_BUFFER_METADATA FrameBuffer;
+    UINT8 FragmentCount;
+} PKTFUZZ_FRAME_METADATA;
+
+//
+// The reference model: an independent, straight-line evaluation of the rule
+// semantics over a linearized copy of the frame.
+//
+typedef struct _REF_FRAME {
+    CONST UCHAR *Data;
+    UINT32 Length;
+    BOOLEAN EthValid;
+    BOOLEAN Ip4Valid;
+    BOOLEAN Ip6Valid;
+    BOOLEAN UdpValid;
+    BOOLEAN TcpValid;
+    BOOLEAN QuicValid;
+    BOOLEAN QuicIsLongHeader;
+    UINT32 IpOffset;
+    UINT32 TransportOffset;
+    UINT32 PayloadOffset;
+    UINT16 DestinationPort;
+    UINT8 TcpFlags;
+    UINT32 QuicCidOffset;
+    UINT32 QuicCidLength;
+} REF_FRAME;
+
+typedef struct _REF_RESULT {
+    XDP_RX_ACTION Action;
+    BOOLEAN Redirected;
+    XDP_REDIRECT_TARGET_TYPE TargetType;
+    VOID *Target;
+    UINT32 RuleIndex;
+    UINT32 Tag;
+    UINT32 MirrorCount;
+    XDP_REDIRECT_TARGET_TYPE MirrorTargetType;
+    VOID *MirrorTarget;
+    UINT32 MirrorSnapLength;
+    UINT32 MirrorRuleIndex;
+} REF_RESULT;
+
 XDP_EXTENSION FragmentExtension = {
     .Reserved = FIELD_OFFSET(XDP_FRAME_WITH_EXTENSIONS, Fragment)
 };
@@ -70,6 +119,542 @@ XDP_EXTENSION VirtualAddressExtension = {
     .Reserved = FIELD_OFFSET(XDP_BUFFER_WITH_EXTENSIONS, BufferVirtualAddress)
 };
 
+static
+UINT16
+RefReadUInt16(
+    _In_ CONST UCHAR *Data
+    )
+{
+    UINT16 Value;
+
+    //
+    // Ports and EtherTypes are compared in network byte order.
+    //
+    RtlCopyMemory(&Value, Data, sizeof(Value));
+    return Value;
+}
+
+static
+VOID
+RefParseQuic(
+    _Inout_ REF_FRAME *Ref
+    )
+{
+    CONST UCHAR *Quic = Ref->Data + Ref->PayloadOffset;
+    UINT32 Length = Ref->Length - Ref->PayloadOffset;
+    UINT32 DestCidLength;
+    UINT32 SourceCidLength;
+
+    if (Length < 1) {
+        return;
+    }
+
+    if ((Quic[0] & 0x80) == 0) {
+        //
+        // Short header: the destination CID follows the first byte, and its
+        // length is unknown, so all remaining bytes (up to the maximum) count.
+        //
+        Ref->QuicValid = TRUE;
+        Ref->QuicIsLongHeader = FALSE;
+        Ref->QuicCidOffset = Ref->PayloadOffset + 1;
+        Ref->QuicCidLength = min(Length - 1, XDP_QUIC_MAX_CID_LENGTH);
+        return;
+    }
+
+    //
+    // Long header: flags (1), version (4), DCID length (1), DCID, SCID length
+    // (1), SCID. The source CID is matched.
+    //
+    if (Length < 6) {
+        return;
+    }
+
+    DestCidLength = Quic[5];
+    if (DestCidLength > XDP_QUIC_MAX_CID_LENGTH || Length < 6 + DestCidLength + 1) {
+        return;
+    }
+
+    SourceCidLength = Quic[6 + DestCidLength];
+    if (SourceCidLength > XDP_QUIC_MAX_CID_LENGTH ||
+        Length < 6 + DestCidLength + 1 + SourceCidLength) {
+        return;
+    }
+
+    Ref->QuicValid = TRUE;
+    Ref->QuicIsLongHeader = TRUE;
+    Ref->QuicCidOffset = Ref->PayloadOffset + 6 + DestCidLength + 1;
+    Ref->QuicCidLength = SourceCidLength;
+}
+
+static
+VOID
+RefParseFrame(
+    _Out_ REF_FRAME *Ref,
+    _In_ CONST UCHAR *Data,
+    _In_ UINT32 Length
+    )
+{
+    UINT32 Offset;
+    UINT8 Protocol;
+    UINT16 EtherType;
+
+    RtlZeroMemory(Ref, sizeof(*Ref));
+    Ref->Data = Data;
+    Ref->Length = Length;
+
+    //
+    // Ethernet (14 bytes), then IPv4 without options (20 bytes) or IPv6
+    // without extension headers (40 bytes), then UDP (8 bytes) or TCP
+    // (20 to 60 bytes).
+    //
+    if (Length < 14) {
+        return;
+    }
+
+    Ref->EthValid = TRUE;
+    EtherType = RefReadUInt16(&Data[12]);
+    Offset = 14;
+    Ref->IpOffset = Offset;
+
+    if (EtherType == htons(ETHERNET_TYPE_IPV4)) {
+        if (Length < Offset + 20 || (Data[Offset] & 0x0f) != 5) {
+            return;
+        }
+        Ref->Ip4Valid = TRUE;
+        Protocol = Data[Offset + 9];
+        Offset += 20;
+    } else if (EtherType == htons(ETHERNET_TYPE_IPV6)) {
+        if (Length < Offset + 40) {
+            return;
+        }
+        Ref->Ip6Valid = TRUE;
+        Protocol = Data[Offset + 6];
+        Offset += 40;
+    } else {
+        return;
+    }
+
+    Ref->TransportOffset = Offset;
+
+    if (Protocol == IPPROTO_UDP) {
+        if (Length < Offset + 8) {
+            return;
+        }
+        Ref->UdpValid = TRUE;
+        Ref->DestinationPort = RefReadUInt16(&Data[Offset + 2]);
+        Ref->PayloadOffset = Offset + 8;
+    } else if (Protocol == IPPROTO_TCP) {
+        UINT32 HeaderLength;
+
+        if (Length < Offset + 20) {
+            return;
+        }
+        HeaderLength = (Data[Offset + 12] >> 4) * 4;
+        if (HeaderLength < 20 || Length < Offset + HeaderLength) {
+            return;
+        }
+        Ref->TcpValid = TRUE;
+        Ref->DestinationPort = RefReadUInt16(&Data[Offset + 2]);
+        Ref->TcpFlags = Data[Offset + 13];
+        Ref->PayloadOffset = Offset + HeaderLength;
+    } else {
+        return;
+    }
+
+    RefParseQuic(Ref);
+}
+
+static
+BOOLEAN
+RefTestPort(
+    _In_ CONST UINT8 *PortSet,
+    _In_ UINT16 Port
+    )
+{
+    return (PortSet[Port / 8] & (1 << (Port % 8))) != 0;
+}
+
+static
+BOOLEAN
+RefAddressEqual(
+    _In_ CONST REF_FRAME *Ref,
+    _In_ UINT32 FieldOffset,
+    _In_ CONST VOID *Address,
+    _In_ UINT32 AddressLength
+    )
+{
+    return memcmp(&Ref->Data[Ref->IpOffset + FieldOffset], Address, AddressLength) == 0;
+}
+
+static
+BOOLEAN
+RefAddressMaskMatch(
+    _In_ CONST REF_FRAME *Ref,
+    _In_ UINT32 FieldOffset,
+    _In_ CONST UCHAR *Prefix,
+    _In_ CONST UCHAR *Mask,
+    _In_ UINT32 AddressLength
+    )
+{
+    for (UINT32 i = 0; i < AddressLength; i++) {
+        if ((Ref->Data[Ref->IpOffset + FieldOffset + i] & Mask[i]) != Prefix[i]) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static
+BOOLEAN
+RefQuicMatch(
+    _In_ CONST REF_FRAME *Ref,
+    _In_ BOOLEAN TransportValid,
+    _In_ BOOLEAN SourceCid,
+    _In_ CONST XDP_QUIC_FLOW *Flow
+    )
+{
+    return
+        TransportValid &&
+        Ref->DestinationPort == Flow->UdpPort &&
+        Ref->QuicValid &&
+        Ref->QuicIsLongHeader == SourceCid &&
+        Ref->QuicCidLength >= (UINT32)Flow->CidOffset + Flow->CidLength &&
+        memcmp(
+            &Ref->Data[Ref->QuicCidOffset + Flow->CidOffset], Flow->CidData,
+            Flow->CidLength) == 0;
+}
+
+static
+BOOLEAN
+RefMatchRule(
+    _In_ CONST REF_FRAME *Ref,
+    _In_ CONST XDP_RULE *Rule
+    )
+{
+    CONST XDP_MATCH_PATTERN *Pattern = &Rule->Pattern;
+
+    switch (Rule->Match) {
+    case XDP_MATCH_ALL:
+        return TRUE;
+
+    case XDP_MATCH_UDP:
+        return Ref->UdpValid;
+
+    case XDP_MATCH_UDP_DST:
+        return Ref->UdpValid && Ref->DestinationPort == Pattern->Port;
+
+    case XDP_MATCH_IPV4_DST_MASK:
+        return
+            Ref->Ip4Valid &&
+            RefAddressMaskMatch(
+                Ref, 16, (CONST UCHAR *)&Pattern->IpMask.Address.Ipv4,
+                (CONST UCHAR *)&Pattern->IpMask.Mask.Ipv4, 4);
+
+    case XDP_MATCH_IPV6_DST_MASK:
+        return
+            Ref->Ip6Valid &&
+            RefAddressMaskMatch(
+                Ref, 24, (CONST UCHAR *)&Pattern->IpMask.Address.Ipv6,
+                (CONST UCHAR *)&Pattern->IpMask.Mask.Ipv6, 16);
+
+    case XDP_MATCH_QUIC_FLOW_SRC_CID:
+        return RefQuicMatch(Ref, Ref->UdpValid, TRUE, &Pattern->QuicFlow);
+
+    case XDP_MATCH_QUIC_FLOW_DST_CID:
+        return RefQuicMatch(Ref, Ref->UdpValid, FALSE, &Pattern->QuicFlow);
+
+    case XDP_MATCH_IPV4_UDP_TUPLE:
+        return
+            Ref->UdpValid && Ref->Ip4Valid &&
+            RefReadUInt16(&Ref->Data[Ref->TransportOffset]) == Pattern->Tuple.SourcePort &&
+            Ref->DestinationPort == Pattern->Tuple.DestinationPort &&
+            RefAddressEqual(Ref, 12, &Pattern->Tuple.SourceAddress.Ipv4, 4) &&
+            RefAddressEqual(Ref, 16, &Pattern->Tuple.DestinationAddress.Ipv4, 4);
+
+    case XDP_MATCH_IPV6_UDP_TUPLE:
+        return
+            Ref->UdpValid && Ref->Ip6Valid &&
+            RefReadUInt16(&Ref->Data[Ref->TransportOffset]) == Pattern->Tuple.SourcePort &&
+            Ref->DestinationPort == Pattern->Tuple.DestinationPort &&
+            RefAddressEqual(Ref, 8, &Pattern->Tuple.SourceAddress.Ipv6, 16) &&
+            RefAddressEqual(Ref, 24, &Pattern->Tuple.DestinationAddress.Ipv6, 16);
+
+    case XDP_MATCH_UDP_PORT_SET:
+        return Ref->UdpValid && RefTestPort(Pattern->PortSet.PortSet, Ref->DestinationPort);
+
+    case XDP_MATCH_IPV4_UDP_PORT_SET:
+        return
+            Ref->Ip4Valid && Ref->UdpValid &&
+            RefAddressEqual(Ref, 16, &Pattern->IpPortSet.Address.Ipv4, 4) &&
+            RefTestPort(Pattern->IpPortSet.PortSet.PortSet, Ref->DestinationPort);
+
+    case XDP_MATCH_IPV6_UDP_PORT_SET:
+        return
+            Ref->Ip6Valid && Ref->UdpValid &&
+            RefAddressEqual(Ref, 24, &Pattern->IpPortSet.Address.Ipv6, 16) &&
+            RefTestPort(Pattern->IpPortSet.PortSet.PortSet, Ref->DestinationPort);
+
+    case XDP_MATCH_IPV4_TCP_PORT_SET:
+        return
+            Ref->Ip4Valid && Ref->TcpValid &&
+            RefAddressEqual(Ref, 16, &Pattern->IpPortSet.Address.Ipv4, 4) &&
+            RefTestPort(Pattern->IpPortSet.PortSet.PortSet, Ref->DestinationPort);
+
+    case XDP_MATCH_IPV6_TCP_PORT_SET:
+        return
+            Ref->Ip6Valid && Ref->TcpValid &&
+            RefAddressEqual(Ref, 24, &Pattern->IpPortSet.Address.Ipv6, 16) &&
+            RefTestPort(Pattern->IpPortSet.PortSet.PortSet, Ref->DestinationPort);
+
+    case XDP_MATCH_TCP_DST:
+        return Ref->TcpValid && Ref->DestinationPort == Pattern->Port;
+
+    case XDP_MATCH_TCP_QUIC_FLOW_SRC_CID:
+        return RefQuicMatch(Ref, Ref->TcpValid, TRUE, &Pattern->QuicFlow);
+
+    case XDP_MATCH_TCP_QUIC_FLOW_DST_CID:
+        return RefQuicMatch(Ref, Ref->TcpValid, FALSE, &Pattern->QuicFlow);
+
+    case XDP_MATCH_TCP_CONTROL_DST:
+        return
+            Ref->TcpValid && Ref->DestinationPort == Pattern->Port &&
+            (Ref->TcpFlags & (TH_SYN | TH_FIN | TH_RST)) != 0;
+
+    default:
+        FRE_ASSERT(FALSE);
+        return FALSE;
+    }
+}
+
+static
+VOID
+RefInspect(
+    _In_ CONST XDP_PROGRAM *Program,
+    _Inout_updates_bytes_(Length) UCHAR *Data,
+    _In_ UINT32 Length,
+    _Out_ REF_RESULT *Result
+    )
+{
+    REF_FRAME Ref;
+
+    RtlZeroMemory(Result, sizeof(*Result));
+    Result->Action = XDP_RX_ACTION_PASS;
+
+    RefParseFrame(&Ref, Data, Length);
+
+    for (UINT32 i = 0; i < Program->RuleCount; i++) {
+        CONST XDP_RULE *Rule = &Program->Rules[i];
+
+        if (!RefMatchRule(&Ref, Rule)) {
+            continue;
+        }
+
+        switch (Rule->Action) {
+        case XDP_PROGRAM_ACTION_DROP:
+            Result->Action = XDP_RX_ACTION_DROP;
+            break;
+
+        case XDP_PROGRAM_ACTION_PASS:
+            Result->Action = XDP_RX_ACTION_PASS;
+            break;
+
+        case XDP_PROGRAM_ACTION_REDIRECT:
+            Result->Action = XDP_RX_ACTION_DROP;
+            Result->Redirected = TRUE;
+            Result->RuleIndex = i;
+            if (Rule->Redirect.TargetType == XDP_REDIRECT_TARGET_TYPE_XSK_TAGGED) {
+                Result->TargetType = XDP_REDIRECT_TARGET_TYPE_XSK;
+                Result->Target = Rule->TaggedRedirect.Target;
+                Result->Tag = Rule->TaggedRedirect.Tag;
+            } else {
+                Result->TargetType = Rule->Redirect.TargetType;
+                Result->Target = Rule->Redirect.Target;
+                Result->Tag = 0;
+            }
+            break;
+
+        case XDP_PROGRAM_ACTION_MIRROR:
+            //
+            // Mirroring copies the frame and continues rule evaluation.
+            //
+            Result->MirrorCount++;
+            Result->MirrorTargetType = Rule->Mirror.TargetType;
+            Result->MirrorTarget = Rule->Mirror.Target;
+            Result->MirrorSnapLength = Rule->Mirror.SnapLength;
+            Result->MirrorRuleIndex = i;
+            continue;
+
+        case XDP_PROGRAM_ACTION_L2FWD:
+            if (!Ref.EthValid) {
+                Result->Action = XDP_RX_ACTION_DROP;
+            } else {
+                UCHAR Temp[6];
+
+                //
+                // Swap the Ethernet destination and source addresses.
+                //
+                RtlCopyMemory(Temp, &Data[0], sizeof(Temp));
+                RtlCopyMemory(&Data[0], &Data[6], sizeof(Temp));
+                RtlCopyMemory(&Data[6], Temp, sizeof(Temp));
+                Result->Action = XDP_RX_ACTION_TX;
+            }
+            break;
+
+        default:
+            FRE_ASSERT(FALSE);
+            break;
+        }
+
+        return;
+    }
+}
+
+static
+BOOLEAN
+RefFilter(
+    _In_ CONST XDP_PROGRAM *Filter,
+    _In_reads_bytes_(Length) CONST UCHAR *Data,
+    _In_ UINT32 Length
+    )
+{
+    REF_FRAME Ref;
+
+    RefParseFrame(&Ref, Data, Length);
+
+    for (UINT32 i = 0; i < Filter->RuleCount; i++) {
+        CONST XDP_RULE *Rule = &Filter->Rules[i];
+
+        if (RefMatchRule(&Ref, Rule)) {
+            return Rule->Action == XDP_PROGRAM_ACTION_PASS;
+        }
+    }
+
+    return TRUE;
+}
+
+static
+VOID
+PerturbRule(
+    _Inout_ XDP_RULE *Rule,
+    _In_ UINT32 Round
+    )
+{
+    XDP_MATCH_PATTERN *Pattern = &Rule->Pattern;
+    UINT16 Delta = (UINT16)(Round * 0x9e37 + 1);
+
+    //
+    // Produce a distinct rule of the same type that is unlikely to match the
+    // same frames, while keeping the rule valid.
+    //
+    switch (Rule->Match) {
+    case XDP_MATCH_UDP_DST:
+    case XDP_MATCH_TCP_DST:
+    case XDP_MATCH_TCP_CONTROL_DST:
+        Pattern->Port ^= Delta;
+        break;
+
+    case XDP_MATCH_IPV4_DST_MASK:
+    case XDP_MATCH_IPV6_DST_MASK:
+        *(UINT16 UNALIGNED *)&Pattern->IpMask.Address ^= Delta;
+        break;
+
+    case XDP_MATCH_IPV4_UDP_TUPLE:
+    case XDP_MATCH_IPV6_UDP_TUPLE:
+        Pattern->Tuple.SourcePort ^= Delta;
+        break;
+
+    case XDP_MATCH_QUIC_FLOW_SRC_CID:
+    case XDP_MATCH_QUIC_FLOW_DST_CID:
+    case XDP_MATCH_TCP_QUIC_FLOW_SRC_CID:
+    case XDP_MATCH_TCP_QUIC_FLOW_DST_CID:
+        Pattern->QuicFlow.UdpPort ^= Delta;
+        break;
+
+    case XDP_MATCH_IPV4_UDP_PORT_SET:
+    case XDP_MATCH_IPV6_UDP_PORT_SET:
+    case XDP_MATCH_IPV4_TCP_PORT_SET:
+    case XDP_MATCH_IPV6_TCP_PORT_SET:
+        *(UINT16 UNALIGNED *)&Pattern->IpPortSet.Address ^= Delta;
+        break;
+
+    default:
+        break;
+    }
+}
+
+static
+UINT32
+LinearizeFrame(
+    _In_ XDP_FRAME_RING *FrameRing,
+    _In_ UINT32 FrameIndex,
+    _In_ XDP_FRAGMENT_RING *FragmentRing,
+    _In_ UINT32 FragmentIndex,
+    _Out_opt_ UCHAR *Data
+    )
+{
+    XDP_FRAME_WITH_EXTENSIONS *FrameExt = &FrameRing->Frames[FrameIndex];
+    XDP_BUFFER *Buffer = &FrameExt->Frame.Buffer;
+    UCHAR *Va = FrameExt->BufferVirtualAddress.VirtualAddress;
+    UINT32 Length = 0;
+    UINT32 FragmentCount = FrameExt->Fragment.FragmentBufferCount;
+
+    for (;;) {
+        if (Data != NULL) {
+            RtlCopyMemory(Data + Length, Va + Buffer->DataOffset, Buffer->DataLength);
+        }
+        Length += Buffer->DataLength;
+
+        if (FragmentCount-- == 0) {
+            break;
+        }
+
+        Buffer = &FragmentRing->Buffers[FragmentIndex].Buffer;
+        Va = FragmentRing->Buffers[FragmentIndex].BufferVirtualAddress.VirtualAddress;
+        FragmentIndex = (FragmentIndex + 1) & FragmentRing->Ring.Mask;
+    }
+
+    return Length;
+}
+
+static
+BOOLEAN
+InitializeBuffer(
+    _Inout_ XDP_BUFFER *Buffer,
+    _Inout_ UCHAR **VirtualAddress,
+    _In_ CONST PKTFUZZ_BUFFER_METADATA *Metadata,
+    _Inout_ CONST UINT8 **Data,
+    _Inout_ SIZE_T *Size
+    )
+{
+    if (*Size < Metadata->DataLength) {
+        return FALSE;
+    }
+
+    Buffer->DataLength = Metadata->DataLength;
+    Buffer->DataOffset = Metadata->DataOffset;
+    Buffer->BufferLength = Buffer->DataOffset + Buffer->DataLength + Metadata->Trailer;
+
+    //
+    // Violate the XDP spec in order to catch data under- and over-reads as
+    // reliably as possible: the entire buffer should be treated as readable,
+    // but since XDP currently does not adjust buffer lengths, treat the
+    // backfill and trailer as invalid.
+    //
+    *VirtualAddress = malloc(max(1, Buffer->DataLength));
+    if (*VirtualAddress == NULL) {
+        return FALSE;
+    }
+
+    RtlCopyMemory(*VirtualAddress, *Data, Buffer->DataLength);
+    *VirtualAddress -= Buffer->DataOffset;
+
+    *Data += Buffer->DataLength;
+    *Size -= Buffer->DataLength;
+
+    return TRUE;
+}
+
 #pragma warning(suppress:6262) // Using a LOT of stack space
 int
 LLVMFuzzerTestOneInput(
@@ -89,13 +674,18 @@ LLVMFuzzerTestOneInput(
         .Ring.Mask = RTL_NUMBER_OF(FragmentRing.Buffers) - 1,
     };
     XDP_RING *FragmentRingOption = NULL;
-    UCHAR ProgramBuffer[FIELD_OFFSET(XDP_PROGRAM, Rules) + sizeof(Metadata->Rules)];
-    XDP_PROGRAM *Program = (XDP_PROGRAM *)ProgramBuffer;
+    XDP_PROGRAM *Program = NULL;
+    XDP_PROGRAM *Filter = NULL;
     XDP_INSPECTION_CONTEXT InspectionContext = {0};
-    UINT32 FrameRingIndex;
-    UINT32 FragmentRingIndex = 0;
-    XDP_FRAME_WITH_EXTENSIONS *FrameExt = NULL;
-    XDP_BUFFER *Buffer;
+    UINT32 FrameRingStart;
+    UINT32 FragmentRingStart = 0;
+    UINT32 FragmentsUsed = 0;
+    UINT32 FrameCount = 0;
+    UINT32 SeedRuleCount;
+    UINT32 RuleCount;
+    UINT32 FragmentIndexes[PKTFUZZ_FRAME_RING_SIZE] = {0};
+    UCHAR *Expected = NULL;
+    UCHAR *Actual = NULL;
 
     if (Size < sizeof(*Metadata)) {
         return -1;
@@ -104,98 +694,192 @@ LLVMFuzzerTestOneInput(
     Data += sizeof(*Metadata);
     Size -= sizeof(*Metadata);
 
-    FrameRingIndex = Metadata->FrameRingIndex & FrameRing.Ring.Mask;
-    FrameRing.Ring.ProducerIndex = Metadata->FrameRingProducerIndex;
-    FrameRing.Ring.ConsumerIndex = Metadata->FrameRingConsumerIndex;
+    FrameRingStart = Metadata->FrameRingIndex & FrameRing.Ring.Mask;
 
-    if (Size < Metadata->FrameBuffer.DataLength) {
-        return -1;
+    if (Metadata->FragmentRingEnabled) {
+        FragmentRingStart = Metadata->FragmentRingIndex & FragmentRing.Ring.Mask;
+        FragmentRingOption = &FragmentRing.Ring;
     }
 
-    FrameExt = &FrameRing.Frames[FrameRingIndex];
-    Buffer = &FrameExt->Frame.Buffer;
-
-    Buffer->DataLength = Metadata->FrameBuffer.DataLength;
-    Buffer->DataOffset = Metadata->FrameBuffer.DataOffset;
-    Buffer->BufferLength = Buffer->DataOffset + Buffer->DataLength + Metadata->FrameBuffer.Trailer;
-
     //
-    // Violate the XDP spec in order to catch data under- and over-reads as
-    // reliably as possible: the entire buffer should be treated as readable,
-    // but since XDP currently does not adjust buffer lengths, treat the
-    // backfill and trailer as invalid.
+    // Build up to a full ring of frames from the remaining input.
     //
-    FrameExt->BufferVirtualAddress.VirtualAddress = malloc(Buffer->DataLength);
-    if (FrameExt->BufferVirtualAddress.VirtualAddress == NULL) {
-        Result = 0;
-        goto Exit;
-    }
+    while (FrameCount < RTL_NUMBER_OF(FrameRing.Frames)) {
+        const PKTFUZZ_FRAME_METADATA *FrameMetadata = (const PKTFUZZ_FRAME_METADATA *)Data;
+        const PKTFUZZ_BUFFER_METADATA *FragmentMetadata;
+        UINT32 FrameIndex = (FrameRingStart + FrameCount) & FrameRing.Ring.Mask;
+        XDP_FRAME_WITH_EXTENSIONS *FrameExt = &FrameRing.Frames[FrameIndex];
+        UINT32 FragmentCount;
+        UINT32 FragmentIndex;
+
+        if (Size < sizeof(*FrameMetadata)) {
+            break;
+        }
 
-    RtlCopyMemory(FrameExt->BufferVirtualAddress.VirtualAddress, Data, Buffer->DataLength);
-    FrameExt->BufferVirtualAddress.VirtualAddress -= Buffer->DataOffset;
+        FragmentCount = Metadata->FragmentRingEnabled ? FrameMetadata->FragmentCount : 0;
 
-    Data += Buffer->DataLength;
-    Size -= Buffer->DataLength;
+        if (Size < sizeof(*FrameMetadata) + FragmentCount * sizeof(*FragmentMetadata) ||
+            FragmentsUsed + FragmentCount > RTL_NUMBER_OF(FragmentRing.Buffers)) {
+            break;
+        }
 
-    if (Metadata->FragmentRingEnabled) {
-        FragmentRingIndex = Metadata->FragmentRingIndex & FragmentRing.Ring.Mask;
+        FragmentMetadata = (const PKTFUZZ_BUFFER_METADATA *)(FrameMetadata + 1);
+        Data += sizeof(*FrameMetadata) + FragmentCount * sizeof(*FragmentMetadata);
+        Size -= sizeof(*FrameMetadata) + FragmentCount * sizeof(*FragmentMetadata);
 
-        FragmentRing.Ring.ProducerIndex = Metadata->FragmentRingProducerIndex;
-        FragmentRing.Ring.ConsumerIndex = Metadata->FragmentRingConsumerIndex;
-        FragmentRingOption = &FragmentRing.Ring;
+        if (!InitializeBuffer(
+                &FrameExt->Frame.Buffer, &FrameExt->BufferVirtualAddress.VirtualAddress,
+                &FrameMetadata->FrameBuffer, &Data, &Size)) {
+            break;
+        }
+
+        FrameExt->Fragment.FragmentBufferCount = (UINT8)FragmentCount;
+        FragmentIndex = (FragmentRingStart + FragmentsUsed) & FragmentRing.Ring.Mask;
+        FragmentIndexes[FrameIndex] = Metadata->FragmentRingEnabled ? FragmentIndex : 0;
+        FrameCount++;
 
-        for (UINT32 i = 0; i < RTL_NUMBER_OF(Metadata->FragmentBuffers); i++) {
-            XDP_BUFFER_WITH_EXTENSIONS *BufferExt = &FragmentRing.Buffers[FragmentRingIndex];
+        for (UINT32 i = 0; i < FragmentCount; i++) {
+            XDP_BUFFER_WITH_EXTENSIONS *BufferExt = &FragmentRing.Buffers[FragmentIndex];
 
-            if (Size < Metadata->FragmentBuffers[i].DataLength) {
+            if (!InitializeBuffer(
+                    &BufferExt->Buffer, &BufferExt->BufferVirtualAddress.VirtualAddress,
+                    &FragmentMetadata[i], &Data, &Size)) {
                 Result = -1;
                 goto Exit;
             }
 
-            Buffer = &BufferExt->Buffer;
+            FragmentsUsed++;
+            FragmentIndex = (FragmentIndex + 1) & FragmentRing.Ring.Mask;
+        }
+    }
 
-            Buffer->DataLength = Metadata->FragmentBuffers[i].DataLength;
-            Buffer->DataOffset = Metadata->FragmentBuffers[i].DataOffset;
-            Buffer->BufferLength =
-                Buffer->DataOffset + Buffer->DataLength + Metadata->FragmentBuffers[i].Trailer;
+    if (FrameCount == 0) {
+        Result = -1;
+        goto Exit;
+    }
 
-            BufferExt->BufferVirtualAddress.VirtualAddress = malloc(Buffer->DataLength);
-            if (BufferExt->BufferVirtualAddress.VirtualAddress == NULL) {
-                Result = 0;
-                goto Exit;
-            }
+    //
+    // Expand the seed rules into a large program.
+    //
+    SeedRuleCount = Metadata->SeedRuleCount % RTL_NUMBER_OF(Metadata->Rules) + 1;
+    RuleCount = max(SeedRuleCount, (UINT32)Metadata->RuleCount % (PKTFUZZ_MAX_RULES + 1));
 
-            RtlCopyMemory(BufferExt->BufferVirtualAddress.VirtualAddress, Data, Buffer->DataLength);
-            BufferExt->BufferVirtualAddress.VirtualAddress -= Buffer->DataOffset;
+    Program = calloc(1, FIELD_OFFSET(XDP_PROGRAM, Rules) + RuleCount * sizeof(XDP_RULE));
+    if (Program == NULL) {
+        Result = 0;
+        goto Exit;
+    }
 
-            Data += Buffer->DataLength;
-            Size -= Buffer->DataLength;
+    for (UINT32 i = 0; i < RuleCount; i++) {
+        XDP_RULE UserRule = Metadata->Rules[i % SeedRuleCount];
 
-            FragmentRingIndex = (FragmentRingIndex + 1) & FragmentRing.Ring.Mask;
+        if (i < RuleCount - SeedRuleCount) {
+            PerturbRule(&UserRule, i / SeedRuleCount);
         }
-    }
-
-    Program->RuleCount = RTL_NUMBER_OF(Metadata->Rules);
 
-    for (UINT32 i = 0; i < Program->RuleCount; i++) {
         Status =
-            XdpProgramValidateRule(
-                &Program->Rules[i], UserMode, &Metadata->Rules[i], Program->RuleCount, i);
+            XdpProgramValidateRule(&Program->Rules[i], UserMode, &UserRule, RuleCount, i);
 
         if (!NT_SUCCESS(Status)) {
             Result = -1;
             goto Exit;
         }
+
+        Program->RuleCount++;
     }
 
-    XdpInspect(
-        Program, &InspectionContext, &FrameRing.Ring, FrameRingIndex, FragmentRingOption,
-        &FragmentExtension, FragmentRingIndex, &VirtualAddressExtension);
+    //
+    // Reuse the rules' match conditions as an XSK RX filter, alternating
+    // between the filter's deliver and drop actions.
+    //
+    Filter = calloc(1, FIELD_OFFSET(XDP_PROGRAM, Rules) + RuleCount * sizeof(XDP_RULE));
+    if (Filter == NULL) {
+        Result = 0;
+        goto Exit;
+    }
+
+    for (UINT32 i = 0; i < RuleCount; i++) {
+        Filter->Rules[i].Match = Program->Rules[i].Match;
+        Filter->Rules[i].Pattern = Program->Rules[i].Pattern;
+        Filter->Rules[i].Action = (i & 1) ? XDP_PROGRAM_ACTION_DROP : XDP_PROGRAM_ACTION_PASS;
+    }
+    Filter->RuleCount = RuleCount;
+
+    //
+    // Inspect each frame in the batch and verify the action, the redirect
+    // target, and any frame modifications against the reference model.
+    //
+    for (UINT32 i = 0; i < FrameCount; i++) {
+        UINT32 FrameIndex = (FrameRingStart + i) & FrameRing.Ring.Mask;
+        UINT32 FragmentIndex = FragmentIndexes[FrameIndex];
+        UINT32 Length;
+        REF_RESULT RefResult;
+        XDP_RX_ACTION Action;
+
+        Length = LinearizeFrame(&FrameRing, FrameIndex, &FragmentRing, FragmentIndex, NULL);
+        Expected = malloc(max(1, Length));
+        Actual = malloc(max(1, Length));
+        if (Expected == NULL || Actual == NULL) {
+            Result = 0;
+            goto Exit;
+        }
+
+        LinearizeFrame(&FrameRing, FrameIndex, &FragmentRing, FragmentIndex, Expected);
+
+        FRE_ASSERT(
+            XdpInspectFilter(
+                Filter, &FrameRing.Ring, FrameIndex, FragmentRingOption, &FragmentExtension,
+                FragmentIndex, &VirtualAddressExtension) ==
+            RefFilter(Filter, Expected, Length));
+
+        RefInspect(Program, Expected, Length, &RefResult);
+
+        RtlZeroMemory(&XdpRedirectStubRecord, sizeof(XdpRedirectStubRecord));
+        RtlZeroMemory(&XdpMirrorStubRecord, sizeof(XdpMirrorStubRecord));
+
+        Action =
+            XdpInspect(
+                Program, &InspectionContext, &FrameRing.Ring, FrameIndex, FragmentRingOption,
+                &FragmentExtension, FragmentIndex, &VirtualAddressExtension);
+
+        LinearizeFrame(&FrameRing, FrameIndex, &FragmentRing, FragmentIndex, Actual);
+
+        FRE_ASSERT(Action == RefResult.Action);
+        FRE_ASSERT(XdpRedirectStubRecord.Count == (RefResult.Redirected ? 1u : 0u));
+        if (RefResult.Redirected) {
+            FRE_ASSERT(XdpRedirectStubRecord.FrameIndex == FrameIndex);
+            FRE_ASSERT(XdpRedirectStubRecord.FragmentIndex == FragmentIndex);
+            FRE_ASSERT(XdpRedirectStubRecord.TargetType == RefResult.TargetType);
+            FRE_ASSERT(XdpRedirectStubRecord.Target == RefResult.Target);
+            FRE_ASSERT(XdpRedirectStubRecord.Metadata.RuleIndex == RefResult.RuleIndex);
+            FRE_ASSERT(XdpRedirectStubRecord.Metadata.Tag == RefResult.Tag);
+        }
+        FRE_ASSERT(XdpMirrorStubRecord.Count == RefResult.MirrorCount);
+        if (RefResult.MirrorCount > 0) {
+            FRE_ASSERT(XdpMirrorStubRecord.FrameIndex == FrameIndex);
+            FRE_ASSERT(XdpMirrorStubRecord.FragmentIndex == FragmentIndex);
+            FRE_ASSERT(XdpMirrorStubRecord.TargetType == RefResult.MirrorTargetType);
+            FRE_ASSERT(XdpMirrorStubRecord.Target == RefResult.MirrorTarget);
+            FRE_ASSERT(XdpMirrorStubRecord.SnapLength == RefResult.MirrorSnapLength);
+            FRE_ASSERT(XdpMirrorStubRecord.Metadata.RuleIndex == RefResult.MirrorRuleIndex);
+        }
+        FRE_ASSERT(memcmp(Expected, Actual, Length) == 0);
+
+        free(Expected);
+        Expected = NULL;
+        free(Actual);
+        Actual = NULL;
+    }
 
     Result = 0;
 
 Exit:
 
+    free(Expected);
+    free(Actual);
+    free(Program);
+    free(Filter);
+
     for (UINT32 i = 0; i < RTL_NUMBER_OF(FragmentRing.Buffers); i++) {
         XDP_BUFFER_WITH_EXTENSIONS *BufferExt = &FragmentRing.Buffers[i];
 
@@ -204,7 +888,9 @@ Exit:
         }
     }
 
-    if (FrameExt != NULL) {
+    for (UINT32 i = 0; i < RTL_NUMBER_OF(FrameRing.Frames); i++) {
+        XDP_FRAME_WITH_EXTENSIONS *FrameExt = &FrameRing.Frames[i];
+
         if (FrameExt->BufferVirtualAddress.VirtualAddress != NULL) {
             free(FrameExt->BufferVirtualAddress.VirtualAddress + FrameExt->Frame.Buffer.DataOffset);
         }
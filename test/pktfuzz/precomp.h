@@ -33,4 +33,5 @@
 #include <program.h>
 #include <stubs/rx.h>
 #include <stubs/xsk.h>
+#include <stubs/redirectstub.h>
 #include <xdpp.h>
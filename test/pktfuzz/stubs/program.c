@@ -29,3 +29,32 @@ XdpProgramCapturePortSet(
 
     return STATUS_SUCCESS;
 }
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+XDP_RX_ACTION
+XdpInvokeEbpf(
+    _In_ XDP_PROGRAM *Program,
+    _In_ XDP_INSPECTION_CONTEXT *InspectionContext,
+    _In_ XDP_FRAME *Frame,
+    _In_ UINT32 FrameIndex,
+    _In_opt_ XDP_RING *FragmentRing,
+    _In_opt_ XDP_EXTENSION *FragmentExtension,
+    _In_ UINT32 FragmentIndex,
+    _In_ XDP_EXTENSION *VirtualAddressExtension
+    )
+{
+    UNREFERENCED_PARAMETER(Program);
+    UNREFERENCED_PARAMETER(InspectionContext);
+    UNREFERENCED_PARAMETER(Frame);
+    UNREFERENCED_PARAMETER(FrameIndex);
+    UNREFERENCED_PARAMETER(FragmentRing);
+    UNREFERENCED_PARAMETER(FragmentExtension);
+    UNREFERENCED_PARAMETER(FragmentIndex);
+    UNREFERENCED_PARAMETER(VirtualAddressExtension);
+
+    //
+    // eBPF rules cannot be created from user mode.
+    //
+    FRE_ASSERT(FALSE);
+    return XDP_RX_ACTION_DROP;
+}
@@ -5,6 +5,9 @@
 
 #include "precomp.h"
 
+XDP_REDIRECT_STUB_RECORD XdpRedirectStubRecord;
+XDP_MIRROR_STUB_RECORD XdpMirrorStubRecord;
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 VOID
 XdpRedirect(
@@ -12,12 +15,48 @@ XdpRedirect(
     _In_ UINT32 FrameIndex,
     _In_ UINT32 FragmentIndex,
     _In_ XDP_REDIRECT_TARGET_TYPE TargetType,
-    _In_ VOID *Target
+    _In_ VOID *Target,
+    _In_ CONST XDP_REDIRECT_METADATA *Metadata
+    )
+{
+    UNREFERENCED_PARAMETER(Redirect);
+
+    XdpRedirectStubRecord.Count++;
+    XdpRedirectStubRecord.FrameIndex = FrameIndex;
+    XdpRedirectStubRecord.FragmentIndex = FragmentIndex;
+    XdpRedirectStubRecord.TargetType = TargetType;
+    XdpRedirectStubRecord.Target = Target;
+    XdpRedirectStubRecord.Metadata = *Metadata;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+XdpMirror(
+    _In_ XDP_REDIRECT_CONTEXT *Redirect,
+    _In_ UINT32 FrameIndex,
+    _In_ UINT32 FragmentIndex,
+    _In_ XDP_REDIRECT_TARGET_TYPE TargetType,
+    _In_ VOID *Target,
+    _In_ UINT32 SnapLength,
+    _In_ CONST XDP_REDIRECT_METADATA *Metadata
+    )
+{
+    UNREFERENCED_PARAMETER(Redirect);
+
+    XdpMirrorStubRecord.Count++;
+    XdpMirrorStubRecord.FrameIndex = FrameIndex;
+    XdpMirrorStubRecord.FragmentIndex = FragmentIndex;
+    XdpMirrorStubRecord.TargetType = TargetType;
+    XdpMirrorStubRecord.Target = Target;
+    XdpMirrorStubRecord.SnapLength = SnapLength;
+    XdpMirrorStubRecord.Metadata = *Metadata;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+XdpFlushRedirect(
+    _In_ XDP_REDIRECT_CONTEXT *Redirect
     )
 {
     UNREFERENCED_PARAMETER(Redirect);
-    UNREFERENCED_PARAMETER(FrameIndex);
-    UNREFERENCED_PARAMETER(FragmentIndex);
-    UNREFERENCED_PARAMETER(TargetType);
-    UNREFERENCED_PARAMETER(Target);
 }
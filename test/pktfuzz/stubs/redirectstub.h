@@ -0,0 +1,35 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+
+#pragma once
+
+//
+// Records the most recent call to the XdpRedirect stub.
+//
+typedef struct _XDP_REDIRECT_STUB_RECORD {
+    UINT32 Count;
+    UINT32 FrameIndex;
+    UINT32 FragmentIndex;
+    XDP_REDIRECT_TARGET_TYPE TargetType;
+    VOID *Target;
+    XDP_REDIRECT_METADATA Metadata;
+} XDP_REDIRECT_STUB_RECORD;
+
+extern XDP_REDIRECT_STUB_RECORD XdpRedirectStubRecord;
+
+//
+// Records the number of calls to the XdpMirror stub and the most recent call.
+//
+typedef struct _XDP_MIRROR_STUB_RECORD {
+    UINT32 Count;
+    UINT32 FrameIndex;
+    UINT32 FragmentIndex;
+    XDP_REDIRECT_TARGET_TYPE TargetType;
+    VOID *Target;
+    UINT32 SnapLength;
+    XDP_REDIRECT_METADATA Metadata;
+} XDP_MIRROR_STUB_RECORD;
+
+extern XDP_MIRROR_STUB_RECORD XdpMirrorStubRecord;
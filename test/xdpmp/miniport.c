@@ -14,9 +14,13 @@ NDIS_STRING RegTxRingSize = NDIS_STRING_CONST("TxRingSize");
 NDIS_STRING RegTxXdpQosPct = NDIS_STRING_CONST("TxXdpQosPct");
 NDIS_STRING RegNumRxBuffers = NDIS_STRING_CONST("NumRxBuffers");
 NDIS_STRING RegRxBufferLength = NDIS_STRING_CONST("RxBufferLength");
+NDIS_STRING RegRxHeadroom = NDIS_STRING_CONST("RxHeadroom");
 NDIS_STRING RegRxDataLength = NDIS_STRING_CONST("RxDataLength");
 NDIS_STRING RegRxPattern = NDIS_STRING_CONST("RxPattern");
 NDIS_STRING RegRxPatternCopy = NDIS_STRING_CONST("RxPatternCopy");
+NDIS_STRING RegRxPatternTable = NDIS_STRING_CONST("RxPatternTable");
+NDIS_STRING RegRxFlowCount = NDIS_STRING_CONST("RxFlowCount");
+NDIS_STRING RegRxFragmentSize = NDIS_STRING_CONST("RxFragmentSize");
 NDIS_STRING RegPollProvider = NDIS_STRING_CONST("PollProvider");
 
 PCSTR MpDriverFriendlyName = "XDPMP";
@@ -42,10 +46,20 @@ UCHAR MpMacAddressBase[MAC_ADDR_LEN] = {0x22, 0x22, 0x22, 0x22, 0x00, 0x00};
 #define DEFAULT_RX_BUFFER_LENGTH 2048
 #define MAX_RX_BUFFER_LENGTH 65536
 
+#define DEFAULT_RX_HEADROOM XDP_RX_HEADROOM_DEFAULT
+#define MAX_RX_HEADROOM MAXUINT16
+
 #define MIN_RX_DATA_LENGTH 64
 #define DEFAULT_RX_BUFFER_DATA_LENGTH 64
 #define MAX_RX_DATA_LENGTH 65536
 
+#define MIN_RX_FLOW_COUNT 1
+#define DEFAULT_RX_FLOW_COUNT 1
+#define MAX_RX_FLOW_COUNT 65536
+
+#define MIN_RX_FRAGMENT_SIZE 64
+#define DEFAULT_RX_FRAGMENT_SIZE 0
+
 //
 // The driver only supports the driver API version in the DDK or higher.
 // Drivers can set lower values for backwards compatibility.
@@ -278,6 +292,8 @@ MpInitialize(
         goto Exit;
     }
 
+    Adapter->Capabilities.CapabilitiesEx.Flags |= XDP_CAPABILITIES_EX_FLAG_TX_INSPECT;
+
     RegistrationAttributes = &AdapterAttributes.RegistrationAttributes;
 
     RegistrationAttributes->Header.Type =
@@ -659,6 +675,12 @@ DriverEntry(
         XDP_FRAME_EXTENSION_RX_ACTION_VERSION_1,
         XDP_EXTENSION_TYPE_FRAME);
 
+    XdpInitializeExtensionInfo(
+        &MpSupportedXdpExtensions.Fragment,
+        XDP_FRAME_EXTENSION_FRAGMENT_NAME,
+        XDP_FRAME_EXTENSION_FRAGMENT_VERSION_1,
+        XDP_EXTENSION_TYPE_FRAME);
+
     MpGlobalContext.NdisVersion = NdisGetVersion();
     MpGlobalContext.Medium = NdisMedium802_3;
     MpGlobalContext.LinkSpeed = MAXULONG;
@@ -878,31 +900,116 @@ MpHexToBin(
     return NDIS_STATUS_INVALID_PARAMETER;
 }
 
+static
+VOID
+MpSetRxTemplateSourcePort(
+    _Inout_ RX_FRAME_TEMPLATE *Template
+    )
+{
+    CONST ETHERNET_HEADER *Ethernet = (CONST ETHERNET_HEADER *)Template->Pattern;
+    UINT32 Offset = sizeof(*Ethernet);
+    UINT8 Protocol;
+
+    //
+    // Locate the TCP or UDP source port within the pattern, if any, so the
+    // receive path can rotate flows without reparsing each frame.
+    //
+
+    Template->SourcePortOffset = 0;
+
+    if (Template->PatternLength < Offset) {
+        return;
+    }
+
+    if (Ethernet->Type == RtlUshortByteSwap(ETHERNET_TYPE_IPV4)) {
+        CONST IPV4_HEADER *Ip = (CONST IPV4_HEADER *)&Template->Pattern[Offset];
+
+        if (Template->PatternLength < Offset + sizeof(*Ip)) {
+            return;
+        }
+
+        Protocol = Ip->Protocol;
+        Offset += Ip->HeaderLength * 4;
+    } else if (Ethernet->Type == RtlUshortByteSwap(ETHERNET_TYPE_IPV6)) {
+        CONST IPV6_HEADER *Ip = (CONST IPV6_HEADER *)&Template->Pattern[Offset];
+
+        if (Template->PatternLength < Offset + sizeof(*Ip)) {
+            return;
+        }
+
+        Protocol = Ip->NextHeader;
+        Offset += sizeof(*Ip);
+    } else {
+        return;
+    }
+
+    if ((Protocol != IPPROTO_TCP && Protocol != IPPROTO_UDP) ||
+        Template->PatternLength < Offset + sizeof(UINT16)) {
+        return;
+    }
+
+    Template->SourcePortOffset = Offset;
+    Template->SourcePort =
+        RtlUshortByteSwap(*(UINT16 UNALIGNED *)&Template->Pattern[Offset]);
+}
+
 NDIS_STATUS
-MpSetRxPattern(
-    _Inout_ ADAPTER_CONTEXT *Adapter,
+MpSetRxTemplate(
+    _Out_ RX_FRAME_TEMPLATE *Template,
     _In_ CONST WCHAR *Pattern,
-    _In_ UINT32 Length
+    _In_ UINT32 Length,
+    _In_ UINT32 DefaultDataLength
     )
 {
     NDIS_STATUS Status;
+    UINT32 PatternLength;
 
     //
-    // Parse the pattern string as hexadecimal pairs.
+    // Parse the pattern string as hexadecimal pairs, optionally followed by a
+    // colon and the decimal frame length.
     //
 
     ASSERT(Length % sizeof(*Pattern) == 0);
     Length /= sizeof(*Pattern);
 
-    if (Length % 2 > 0) {
+    RtlZeroMemory(Template, sizeof(*Template));
+    Template->DataLength = DefaultDataLength;
+
+    for (PatternLength = 0; PatternLength < Length; PatternLength++) {
+        if (Pattern[PatternLength] == L':') {
+            break;
+        }
+    }
+
+    if (PatternLength < Length) {
+        Template->DataLength = 0;
+
+        for (UINT32 Index = PatternLength + 1; Index < Length; Index++) {
+            if (Pattern[Index] < L'0' || Pattern[Index] > L'9') {
+                return NDIS_STATUS_INVALID_PARAMETER;
+            }
+
+            Template->DataLength = Template->DataLength * 10 + (Pattern[Index] - L'0');
+
+            if (Template->DataLength > MAX_RX_DATA_LENGTH) {
+                return NDIS_STATUS_INVALID_PARAMETER;
+            }
+        }
+    }
+
+    if (Template->DataLength < MIN_RX_DATA_LENGTH) {
         return NDIS_STATUS_INVALID_PARAMETER;
     }
 
-    if (Length > sizeof(Adapter->RxPattern) * 2) {
+    if (PatternLength % 2 > 0) {
+        return NDIS_STATUS_INVALID_PARAMETER;
+    }
+
+    if (PatternLength > sizeof(Template->Pattern) * 2) {
         return NDIS_STATUS_BUFFER_TOO_SHORT;
     }
 
-    for (UINT32 Index = 0; Index < Length  / 2; Index++) {
+    for (UINT32 Index = 0; Index < PatternLength / 2; Index++) {
         UCHAR Byte;
 
         Status = MpHexToBin(Pattern[Index * 2], &Byte);
@@ -910,17 +1017,69 @@ MpSetRxPattern(
             return Status;
         }
 
-        Adapter->RxPattern[Index] = Byte << 4;
+        Template->Pattern[Index] = Byte << 4;
 
         Status = MpHexToBin(Pattern[Index * 2 + 1], &Byte);
         if (Status != NDIS_STATUS_SUCCESS) {
             return Status;
         }
 
-        Adapter->RxPattern[Index] |= Byte;
+        Template->Pattern[Index] |= Byte;
+    }
+
+    Template->PatternLength = PatternLength / 2;
+    MpSetRxTemplateSourcePort(Template);
+
+    return NDIS_STATUS_SUCCESS;
+}
+
+NDIS_STATUS
+MpSetRxTemplateTable(
+    _Inout_ ADAPTER_CONTEXT *Adapter,
+    _In_ CONST WCHAR *Table,
+    _In_ UINT32 Length
+    )
+{
+    NDIS_STATUS Status;
+    UINT32 Start = 0;
+
+    //
+    // The table is a multi-string: one template per NUL-terminated string.
+    //
+
+    ASSERT(Length % sizeof(*Table) == 0);
+    Length /= sizeof(*Table);
+
+    Adapter->NumRxTemplates = 0;
+
+    for (UINT32 Index = 0; Index <= Length; Index++) {
+        if (Index < Length && Table[Index] != UNICODE_NULL) {
+            continue;
+        }
+
+        if (Index > Start) {
+            if (Adapter->NumRxTemplates == MAX_RX_TEMPLATES) {
+                return NDIS_STATUS_BUFFER_TOO_SHORT;
+            }
+
+            Status =
+                MpSetRxTemplate(
+                    &Adapter->RxTemplates[Adapter->NumRxTemplates], &Table[Start],
+                    (Index - Start) * sizeof(*Table), Adapter->RxDataLength);
+            if (Status != NDIS_STATUS_SUCCESS) {
+                return Status;
+            }
+
+            Adapter->NumRxTemplates++;
+        }
+
+        Start = Index + 1;
+    }
+
+    if (Adapter->NumRxTemplates == 0) {
+        return NDIS_STATUS_INVALID_PARAMETER;
     }
 
-    Adapter->RxPatternLength = Length / 2;
     return NDIS_STATUS_SUCCESS;
 }
 
@@ -1000,15 +1159,30 @@ MpReadConfiguration(
         goto Exit;
     }
 
+    //
+    // Frames are generated after the headroom, which XDP programs may use to
+    // push headers.
+    //
+    Adapter->RxHeadroom = DEFAULT_RX_HEADROOM;
+    TRY_READ_INT_CONFIGURATION(ConfigHandle, RegRxHeadroom, &Adapter->RxHeadroom);
+    if (Adapter->RxHeadroom > MAX_RX_HEADROOM ||
+        Adapter->RxHeadroom > Adapter->RxBufferLength - MIN_RX_DATA_LENGTH) {
+        Status = NDIS_STATUS_INVALID_PARAMETER;
+        goto Exit;
+    }
+
     Adapter->RxDataLength = DEFAULT_RX_BUFFER_DATA_LENGTH;
     TRY_READ_INT_CONFIGURATION(ConfigHandle, RegRxDataLength, &Adapter->RxDataLength);
     if (Adapter->RxDataLength < MIN_RX_DATA_LENGTH ||
         Adapter->RxDataLength > MAX_RX_DATA_LENGTH ||
-        Adapter->RxDataLength > Adapter->RxBufferLength) {
+        Adapter->RxDataLength > Adapter->RxBufferLength - Adapter->RxHeadroom) {
         Status = NDIS_STATUS_INVALID_PARAMETER;
         goto Exit;
     }
 
+    Adapter->NumRxTemplates = 1;
+    Adapter->RxTemplates[0].DataLength = Adapter->RxDataLength;
+
     NdisReadConfiguration(&Status, &ConfigParam, ConfigHandle, &RegRxPattern, NdisParameterString);
     if (Status == NDIS_STATUS_SUCCESS) {
         if (ConfigParam->ParameterType != NdisParameterString) {
@@ -1017,7 +1191,27 @@ MpReadConfiguration(
         }
 
         Status =
-            MpSetRxPattern(
+            MpSetRxTemplate(
+                &Adapter->RxTemplates[0], ConfigParam->ParameterData.StringData.Buffer,
+                ConfigParam->ParameterData.StringData.Length, Adapter->RxDataLength);
+        if (Status != NDIS_STATUS_SUCCESS) {
+            goto Exit;
+        }
+    }
+
+    //
+    // A pattern table, if present, supersedes the single RX pattern.
+    //
+    NdisReadConfiguration(
+        &Status, &ConfigParam, ConfigHandle, &RegRxPatternTable, NdisParameterMultiString);
+    if (Status == NDIS_STATUS_SUCCESS) {
+        if (ConfigParam->ParameterType != NdisParameterMultiString) {
+            Status = NDIS_STATUS_INVALID_PARAMETER;
+            goto Exit;
+        }
+
+        Status =
+            MpSetRxTemplateTable(
                 Adapter, ConfigParam->ParameterData.StringData.Buffer,
                 ConfigParam->ParameterData.StringData.Length);
         if (Status != NDIS_STATUS_SUCCESS) {
@@ -1025,10 +1219,57 @@ MpReadConfiguration(
         }
     }
 
+    for (UINT32 Index = 0; Index < Adapter->NumRxTemplates; Index++) {
+        if (Adapter->RxTemplates[Index].DataLength >
+                Adapter->RxBufferLength - Adapter->RxHeadroom) {
+            Status = NDIS_STATUS_INVALID_PARAMETER;
+            goto Exit;
+        }
+    }
+
     Adapter->RxPatternCopy = 0;
     TRY_READ_INT_CONFIGURATION(ConfigHandle, RegRxPatternCopy, &Adapter->RxPatternCopy);
     Adapter->RxPatternCopy = !!Adapter->RxPatternCopy;
 
+    Adapter->RxFlowCount = DEFAULT_RX_FLOW_COUNT;
+    TRY_READ_INT_CONFIGURATION(ConfigHandle, RegRxFlowCount, &Adapter->RxFlowCount);
+    if (Adapter->RxFlowCount < MIN_RX_FLOW_COUNT ||
+        Adapter->RxFlowCount > MAX_RX_FLOW_COUNT) {
+        Status = NDIS_STATUS_INVALID_PARAMETER;
+        goto Exit;
+    }
+
+    //
+    // Each RSS queue generates a disjoint range of flows, and all ranges must
+    // fit within the 16-bit source port space.
+    //
+    if ((UINT64)Adapter->NumRssQueues * Adapter->RxFlowCount > MAX_RX_FLOW_COUNT) {
+        Status = NDIS_STATUS_INVALID_PARAMETER;
+        goto Exit;
+    }
+
+    Adapter->RxFragmentSize = DEFAULT_RX_FRAGMENT_SIZE;
+    Adapter->RxMaxFragments = 0;
+    TRY_READ_INT_CONFIGURATION(ConfigHandle, RegRxFragmentSize, &Adapter->RxFragmentSize);
+    if (Adapter->RxFragmentSize != 0) {
+        if (Adapter->RxFragmentSize < MIN_RX_FRAGMENT_SIZE ||
+            Adapter->RxFragmentSize > Adapter->RxBufferLength - Adapter->RxHeadroom) {
+            Status = NDIS_STATUS_INVALID_PARAMETER;
+            goto Exit;
+        }
+
+        for (UINT32 Index = 0; Index < Adapter->NumRxTemplates; Index++) {
+            UINT32 Fragments =
+                (Adapter->RxTemplates[Index].DataLength - 1) / Adapter->RxFragmentSize;
+            Adapter->RxMaxFragments = max(Adapter->RxMaxFragments, Fragments);
+        }
+
+        if (Adapter->RxMaxFragments > MAX_RX_FRAGMENTS) {
+            Status = NDIS_STATUS_INVALID_PARAMETER;
+            goto Exit;
+        }
+    }
+
     Adapter->RateSim.IntervalUs = 1000;             // 1ms
     Adapter->RateSim.RxFramesPerInterval = 1000;    // 1Mpps
     Adapter->RateSim.TxFramesPerInterval = 1000;    // 1Mpps
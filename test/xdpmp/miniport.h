@@ -12,6 +12,10 @@
 #define MAX_MULTICAST_ADDRESSES 16
 #define MAX_RSS_QUEUES 64
 #define MAX_RSS_INDIR_COUNT 128
+#define MAX_RX_TEMPLATES 32
+#define MAX_RX_PATTERN_LENGTH 128
+#define MAX_RX_FRAGMENTS 16
+#define MAX_TX_INSPECT_FRAGMENTS 64
 
 #define TRY_READ_INT_CONFIGURATION(hConfig, Keyword, pValue) \
     { \
@@ -46,6 +50,19 @@ typedef struct {
     TX_SOURCE Source;
 } TX_SHADOW_DESCRIPTOR;
 
+//
+// A synthetic RX frame template: the leading bytes of the frame and the total
+// frame length. If the pattern contains a TCP or UDP header, the source port
+// is rotated to generate multiple flows.
+//
+typedef struct _RX_FRAME_TEMPLATE {
+    UCHAR Pattern[MAX_RX_PATTERN_LENGTH];
+    UINT32 PatternLength;
+    UINT32 DataLength;
+    UINT32 SourcePortOffset;
+    UINT16 SourcePort;
+} RX_FRAME_TEMPLATE;
+
 typedef struct _ADAPTER_RX_QUEUE ADAPTER_RX_QUEUE;
 typedef struct _ADAPTER_TX_QUEUE ADAPTER_TX_QUEUE;
 
@@ -66,12 +83,27 @@ typedef struct _ADAPTER_RX_QUEUE {
     UINT32 NumBuffers;
     UINT32 BufferLength;
     UINT32 BufferMask;
-    UINT32 DataLength;
-    UINT32 PatternLength;
-    CONST UCHAR *PatternBuffer;
+    UINT32 Headroom;
+    UINT32 *DataLengthArray;
     UINT32 RecycleIndex;
     UINT32 RxTxIndex;
 
+    //
+    // Synthetic traffic generation: frames cycle through the adapter's
+    // templates and the flows assigned to this queue. Frames longer than the
+    // fragment size are indicated to XDP as multiple buffers.
+    //
+    CONST RX_FRAME_TEMPLATE *Templates;
+    UINT32 NumTemplates;
+    UINT32 TemplateIndex;
+    BOOLEAN PatternCopy;
+    UINT32 FlowCount;
+    UINT32 FlowIndex;
+    UINT16 FlowBase;
+    UINT32 FragmentSize;
+    XDP_RING *FragmentRing;
+    XDP_EXTENSION FragmentExtension;
+
     UINT32 RateSimFramesAvailable;
 
     struct {
@@ -87,6 +119,32 @@ typedef struct _ADAPTER_RX_QUEUE {
     KEVENT *DeleteComplete;
 } ADAPTER_RX_QUEUE;
 
+//
+// An XDP RX queue bound to the TX inspect hook: frames sent by the local stack
+// are indicated to XDP before they are posted to the hardware TX ring.
+//
+typedef struct _ADAPTER_TX_INSPECT_QUEUE {
+    XDP_QUEUE_STATE XdpState;
+    BOOLEAN NeedFlush;
+
+    XDP_RX_QUEUE_HANDLE XdpRxQueue;
+    XDP_RING *FrameRing;
+    XDP_RING *FragmentRing;
+    XDP_EXTENSION BufferVaExtension;
+    XDP_EXTENSION RxActionExtension;
+    XDP_EXTENSION FragmentExtension;
+
+    //
+    // NBs that passed inspection and await posting to the hardware TX ring.
+    // Accessed only within the poll EC.
+    //
+    UINT32 NbPassCount;
+    NET_BUFFER *NbPassHead;
+    NET_BUFFER **NbPassTail;
+
+    KEVENT *DeleteComplete;
+} ADAPTER_TX_INSPECT_QUEUE;
+
 typedef struct _ADAPTER_TX_QUEUE {
     XDP_QUEUE_STATE XdpState;
     BOOLEAN NeedFlush;
@@ -114,15 +172,30 @@ typedef struct _ADAPTER_TX_QUEUE {
     NET_BUFFER **NbQueueTail;
     KSPIN_LOCK NbQueueLock;
 
+    ADAPTER_TX_INSPECT_QUEUE Inspect;
+
     KEVENT *DeleteComplete;
 } ADAPTER_TX_QUEUE;
 
+//
+// XDP RX queues are created for either the RX inspect hook or the TX inspect
+// hook of an RSS queue; the XDP interface RX queue handle references one of
+// these.
+//
+typedef struct _ADAPTER_XDP_RX_HANDLE {
+    struct _ADAPTER_QUEUE *AdapterQueue;
+    BOOLEAN TxInspect;
+} ADAPTER_XDP_RX_HANDLE;
+
 typedef struct DECLSPEC_CACHEALIGN _ADAPTER_QUEUE {
     UINT32 QueueId;
 
     ADAPTER_RX_QUEUE Rq;
     ADAPTER_TX_QUEUE Tq;
 
+    ADAPTER_XDP_RX_HANDLE XdpRxHandle;
+    ADAPTER_XDP_RX_HANDLE XdpTxInspectHandle;
+
     NDIS_POLL_HANDLE NdisPollHandle;
 
     //
@@ -188,10 +261,14 @@ typedef struct _ADAPTER_CONTEXT {
     ULONG TxXdpQosPct;
     ULONG NumRxBuffers;
     ULONG RxBufferLength;
+    ULONG RxHeadroom;
     ULONG RxDataLength;
-    ULONG RxPatternLength;
-    UCHAR RxPattern[128];
     ULONG RxPatternCopy;
+    ULONG NumRxTemplates;
+    RX_FRAME_TEMPLATE RxTemplates[MAX_RX_TEMPLATES];
+    ULONG RxFlowCount;
+    ULONG RxFragmentSize;
+    ULONG RxMaxFragments;
     XDPMP_RATE_SIM_WMI RateSim;
     FNDIS_NPI_CLIENT FndisClient;
     ADAPTER_POLL_PROVIDER PollProvider;
@@ -218,6 +295,7 @@ typedef struct _MINIPORT_SUPPORTED_XDP_EXTENSIONS {
     XDP_EXTENSION_INFO VirtualAddress;
     XDP_EXTENSION_INFO LogicalAddress;
     XDP_EXTENSION_INFO RxAction;
+    XDP_EXTENSION_INFO Fragment;
 } MINIPORT_SUPPORTED_XDP_EXTENSIONS;
 
 extern MINIPORT_SUPPORTED_XDP_EXTENSIONS MpSupportedXdpExtensions;
@@ -10,6 +10,7 @@
 #include <ntintsafe.h>
 #include <pkthlp.h>
 #include <xdpddi.h>
+#include <xdp/hookid.h>
 #include <xdpassert.h>
 #include <xdprtl.h>
 #include <fndispoll.h>
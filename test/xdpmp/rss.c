@@ -94,6 +94,27 @@ MpXdpNotify(
     }
 }
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+VOID
+MpXdpRxNotify(
+    _In_ XDP_INTERFACE_HANDLE InterfaceQueue,
+    _In_ XDP_NOTIFY_QUEUE_FLAGS Flags
+    )
+{
+    ADAPTER_XDP_RX_HANDLE *RxHandle = (ADAPTER_XDP_RX_HANDLE *)InterfaceQueue;
+    ADAPTER_QUEUE *RssQueue = RxHandle->AdapterQueue;
+
+    if (!RxHandle->TxInspect) {
+        MpXdpNotify((XDP_INTERFACE_HANDLE)RssQueue, Flags);
+        return;
+    }
+
+    if (Flags & XDP_NOTIFY_QUEUE_FLAG_RX_FLUSH) {
+        RssQueue->Tq.Inspect.NeedFlush = TRUE;
+        RssQueue->Adapter->PollDispatch.RequestPoll(RssQueue->NdisPollHandle, 0);
+    }
+}
+
 VOID
 MpDepopulateRssQueues(
     _Inout_ ADAPTER_CONTEXT *Adapter
@@ -155,6 +176,10 @@ MpPopulateRssQueues(
 
         RssQueue->QueueId = Index;
         RssQueue->Adapter = Adapter;
+        RssQueue->XdpRxHandle.AdapterQueue = RssQueue;
+        RssQueue->XdpRxHandle.TxInspect = FALSE;
+        RssQueue->XdpTxInspectHandle.AdapterQueue = RssQueue;
+        RssQueue->XdpTxInspectHandle.TxInspect = TRUE;
 
         Status = MpInitializeReceiveQueue(&RssQueue->Rq, RssQueue);
         if (Status != NDIS_STATUS_SUCCESS) {
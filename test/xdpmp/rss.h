@@ -12,6 +12,13 @@ MpXdpNotify(
     _In_ XDP_NOTIFY_QUEUE_FLAGS Flags
     );
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+VOID
+MpXdpRxNotify(
+    _In_ XDP_INTERFACE_HANDLE InterfaceQueue,
+    _In_ XDP_NOTIFY_QUEUE_FLAGS Flags
+    );
+
 VOID
 MpDepopulateRssQueues(
     _Inout_ ADAPTER_CONTEXT *Adapter
@@ -106,6 +106,63 @@ MpNdisReceive(
     Rq->Stats.RxBytes += DataLength;
 }
 
+static
+UINT32
+MpReceiveGenerateFrame(
+    _Inout_ ADAPTER_RX_QUEUE *Rq,
+    _In_ UINT32 HwRxDescriptor
+    )
+{
+    CONST RX_FRAME_TEMPLATE *Template = &Rq->Templates[Rq->TemplateIndex];
+    UCHAR *Pkt = Rq->BufferArray + HwRxDescriptor + Rq->Headroom;
+    UINT32 PatternLength = min(Template->PatternLength, Template->DataLength);
+
+    //
+    // Write the next template into the RX buffer, rewriting the source port to
+    // select the next flow, and record the frame length for this descriptor.
+    //
+
+    RtlCopyMemory(Pkt, Template->Pattern, PatternLength);
+
+    if (Template->SourcePortOffset > 0 && Rq->FlowCount > 1) {
+        UINT16 SourcePort = (UINT16)(Template->SourcePort + Rq->FlowBase + Rq->FlowIndex);
+        *(UINT16 UNALIGNED *)&Pkt[Template->SourcePortOffset] = RtlUshortByteSwap(SourcePort);
+    }
+
+    Rq->DataLengthArray[HwRxDescriptor / Rq->BufferLength] = Template->DataLength;
+
+    if (++Rq->TemplateIndex == Rq->NumTemplates) {
+        Rq->TemplateIndex = 0;
+    }
+
+    if (++Rq->FlowIndex == Rq->FlowCount) {
+        Rq->FlowIndex = 0;
+    }
+
+    return Template->DataLength;
+}
+
+static
+UINT32
+MpReceiveFrameLength(
+    _In_ CONST ADAPTER_RX_QUEUE *Rq,
+    _In_ CONST XDP_BUFFER *Buffer,
+    _In_ UINT32 HwRxDescriptor
+    )
+{
+    UINT32 DataLength = Rq->DataLengthArray[HwRxDescriptor / Rq->BufferLength];
+
+    //
+    // Fragments are contiguous views of a single RX buffer, so the total frame
+    // length is the (possibly adjusted) first fragment plus the remainder.
+    //
+    if (Rq->FragmentRing == NULL) {
+        return Buffer->DataLength;
+    }
+
+    return Buffer->DataLength + DataLength - min(DataLength, Rq->FragmentSize);
+}
+
 static
 UINT32
 MpReceiveProcessBatch(
@@ -120,6 +177,7 @@ MpReceiveProcessBatch(
     XDP_FRAME_RX_ACTION *Action;
     XDP_BUFFER_VIRTUAL_ADDRESS *Va;
     UINT32 HwRxDescriptor;
+    UINT32 DataLength;
     UINT32 XdpAbsorbed = 0;
 
     //
@@ -137,13 +195,14 @@ MpReceiveProcessBatch(
         Action = XdpGetRxActionExtension(Frame, &Rq->RxActionExtension);
         Va = XdpGetVirtualAddressExtension(Buffer, &Rq->BufferVaExtension);
         HwRxDescriptor = (UINT32)(Va->VirtualAddress - Rq->BufferArray);
+        DataLength = MpReceiveFrameLength(Rq, Buffer, HwRxDescriptor);
 
         switch (Action->RxAction) {
         case XDP_RX_ACTION_PASS:
             //
             // Pass the frame onto the regular NDIS receive path.
             //
-            MpNdisReceive(Rq, HwRxDescriptor, Buffer->DataOffset, Buffer->DataLength, NblChain);
+            MpNdisReceive(Rq, HwRxDescriptor, Buffer->DataOffset, DataLength, NblChain);
             break;
 
         case XDP_RX_ACTION_DROP:
@@ -153,13 +212,13 @@ MpReceiveProcessBatch(
             //
             XdpAbsorbed++;
             Rq->Stats.RxFrames++;
-            Rq->Stats.RxBytes += Buffer->DataLength;
+            Rq->Stats.RxBytes += DataLength;
             MpReceiveRecycle(Rq, HwRxDescriptor);
             break;
 
         case XDP_RX_ACTION_TX:
             Rq->Stats.RxFrames++;
-            Rq->Stats.RxBytes += Buffer->DataLength;
+            Rq->Stats.RxBytes += DataLength;
             XdpAbsorbed++;
             Rq->RxTxArray[Rq->RxTxIndex++] = FrameRingIndex;
             break;
@@ -185,6 +244,7 @@ MpReceiveProcessBatch(
             for (UINT32 Index = 0; Index < Count; Index++) {
                 Frame = XdpRingGetElement(FrameRing, Rq->RxTxArray[Index]);
                 Va = XdpGetVirtualAddressExtension(&Frame->Buffer, &Rq->BufferVaExtension);
+                HwRxDescriptor = (UINT32)(Va->VirtualAddress - Rq->BufferArray);
 
                 //
                 // XDPMP is a software device not capable of DMA, so just use
@@ -192,7 +252,7 @@ MpReceiveProcessBatch(
                 //
                 MpTransmitRxTx(
                     Rq->Tq, Head + Index, (UINT64)(Va->VirtualAddress) + Frame->Buffer.DataOffset,
-                    Frame->Buffer.DataLength);
+                    MpReceiveFrameLength(Rq, &Frame->Buffer, HwRxDescriptor));
             }
 
             HwRingMpCommit(Rq->Tq->HwRing, Count, Head, OldIrql);
@@ -237,24 +297,65 @@ MpReceiveUseXdpMultiFrameApi(
         while (FrameQuota-- > 0 && HwRingConsPeek(Rq->HwRing) > 0) {
             XDP_FRAME *Frame;
             XDP_BUFFER_VIRTUAL_ADDRESS *Va;
+            UINT32 DataLength;
 
             HwRxDescriptor = HwRingConsPopElement(Rq->HwRing);
 
-            if (Rq->PatternLength > 0) {
+            if (Rq->PatternCopy) {
                 //
                 // Reinitialize packet content. This is disabled by default, but
                 // needs to be enabled in scenarios where the upper protocol
                 // rewrites packets.
                 //
-                UCHAR *Pkt = Rq->BufferArray + *HwRxDescriptor;
-                RtlCopyMemory(Pkt, Rq->PatternBuffer, Rq->PatternLength);
+                DataLength = MpReceiveGenerateFrame(Rq, *HwRxDescriptor);
+            } else {
+                DataLength = Rq->DataLengthArray[*HwRxDescriptor / Rq->BufferLength];
             }
 
-            Frame = XdpRingGetElement(FrameRing, FrameRing->ProducerIndex++ & FrameRing->Mask);
+            if (Rq->FragmentRing != NULL) {
+                XDP_RING *FragmentRing = Rq->FragmentRing;
+                UINT32 FragmentCount = (DataLength - 1) / Rq->FragmentSize;
+
+                //
+                // Indicate frames larger than the fragment size as a chain of
+                // contiguous buffers within the same RX buffer. Only the first
+                // buffer includes the headroom.
+                //
+                if (XdpRingFree(FragmentRing) < FragmentCount) {
+                    XdpAbsorbed += MpReceiveProcessBatch(Rq, &StartIndex, NblChain);
+                }
+
+                Frame =
+                    XdpRingGetElement(FrameRing, FrameRing->ProducerIndex++ & FrameRing->Mask);
+                XdpGetFragmentExtension(Frame, &Rq->FragmentExtension)->FragmentBufferCount =
+                    (UINT8)FragmentCount;
+
+                for (UINT32 Index = 1; Index <= FragmentCount; Index++) {
+                    XDP_BUFFER *Fragment =
+                        XdpRingGetElement(
+                            FragmentRing, FragmentRing->ProducerIndex++ & FragmentRing->Mask);
+
+                    Fragment->DataLength = min(DataLength - Index * Rq->FragmentSize, Rq->FragmentSize);
+                    Fragment->BufferLength = Rq->FragmentSize;
+                    Fragment->DataOffset = 0;
+
+                    Va = XdpGetVirtualAddressExtension(Fragment, &Rq->BufferVaExtension);
+                    Va->VirtualAddress =
+                        Rq->BufferArray + *HwRxDescriptor + Rq->Headroom +
+                            Index * Rq->FragmentSize;
+                }
+
+                Frame->Buffer.DataLength = min(DataLength, Rq->FragmentSize);
+                Frame->Buffer.BufferLength = Rq->Headroom + Rq->FragmentSize;
+            } else {
+                Frame =
+                    XdpRingGetElement(FrameRing, FrameRing->ProducerIndex++ & FrameRing->Mask);
+
+                Frame->Buffer.DataLength = DataLength;
+                Frame->Buffer.BufferLength = Rq->BufferLength;
+            }
 
-            Frame->Buffer.DataLength = Rq->DataLength;
-            Frame->Buffer.BufferLength = Rq->BufferLength;
-            Frame->Buffer.DataOffset = 0;
+            Frame->Buffer.DataOffset = Rq->Headroom;
 
             Va = XdpGetVirtualAddressExtension(&Frame->Buffer, &Rq->BufferVaExtension);
             Va->VirtualAddress = Rq->BufferArray + *HwRxDescriptor;
@@ -274,19 +375,22 @@ MpReceiveUseXdpMultiFrameApi(
         }
     } else {
         while (FrameQuota-- > 0 && HwRingConsPeek(Rq->HwRing) > 0) {
+            UINT32 DataLength;
+
             HwRxDescriptor = HwRingConsPopElement(Rq->HwRing);
 
-            if (Rq->PatternLength > 0) {
+            if (Rq->PatternCopy) {
                 //
                 // Reinitialize packet content. This is disabled by default, but
                 // needs to be enabled in scenarios where the upper protocol
                 // rewrites packets.
                 //
-                UCHAR *Pkt = Rq->BufferArray + *HwRxDescriptor;
-                RtlCopyMemory(Pkt, Rq->PatternBuffer, Rq->PatternLength);
+                DataLength = MpReceiveGenerateFrame(Rq, *HwRxDescriptor);
+            } else {
+                DataLength = Rq->DataLengthArray[*HwRxDescriptor / Rq->BufferLength];
             }
 
-            MpNdisReceive(Rq, *HwRxDescriptor, 0, Rq->DataLength, NblChain);
+            MpNdisReceive(Rq, *HwRxDescriptor, Rq->Headroom, DataLength, NblChain);
         }
     }
 
@@ -417,6 +521,11 @@ MpCleanupReceiveQueue(
         Rq->RxTxArray = NULL;
     }
 
+    if (Rq->DataLengthArray != NULL) {
+        ExFreePoolWithTag(Rq->DataLengthArray, POOLTAG_RXBUFFER);
+        Rq->DataLengthArray = NULL;
+    }
+
     if (Rq->RecycleArray != NULL) {
         ExFreePoolWithTag(Rq->RecycleArray, POOLTAG_RXBUFFER);
         Rq->RecycleArray = NULL;
@@ -441,14 +550,13 @@ MpInitializeReceiveQueue(
 {
     NDIS_STATUS Status;
     CONST ADAPTER_CONTEXT *Adapter = RssQueue->Adapter;
-    const UINT32 PatternLength = min(Adapter->RxDataLength, Adapter->RxPatternLength);
 
     TraceEnter(TRACE_CONTROL, "NdisMiniportHandle=%p", Adapter->MiniportHandle);
 
     Rq->NumBuffers = Adapter->NumRxBuffers;
     Rq->BufferLength = Adapter->RxBufferLength;
     Rq->BufferMask = ~(Rq->BufferLength - 1);
-    Rq->DataLength = Adapter->RxDataLength;
+    Rq->Headroom = Adapter->RxHeadroom;
     Rq->NblRundown = Adapter->NblRundown;
     Rq->Tq = &RssQueue->Tq;
 
@@ -492,8 +600,26 @@ MpInitializeReceiveQueue(
         goto Exit;
     }
 
-    Rq->PatternBuffer = Adapter->RxPattern;
-    Rq->PatternLength = Adapter->RxPatternCopy ? PatternLength : 0;
+    Rq->DataLengthArray =
+        ExAllocatePoolZero(
+            NonPagedPoolNx, Rq->NumBuffers * sizeof(*Rq->DataLengthArray), POOLTAG_RXBUFFER);
+    if (Rq->DataLengthArray == NULL) {
+        Status = NDIS_STATUS_RESOURCES;
+        goto Exit;
+    }
+
+    //
+    // Each RSS queue generates a disjoint range of flows.
+    //
+    Rq->Templates = Adapter->RxTemplates;
+    Rq->NumTemplates = Adapter->NumRxTemplates;
+    Rq->TemplateIndex = 0;
+    Rq->PatternCopy = !!Adapter->RxPatternCopy;
+    Rq->FlowCount = Adapter->RxFlowCount;
+    Rq->FlowIndex = 0;
+    ASSERT((UINT64)RssQueue->QueueId * Adapter->RxFlowCount <= MAXUINT16);
+    Rq->FlowBase = (UINT16)(RssQueue->QueueId * Adapter->RxFlowCount);
+    Rq->FragmentSize = Adapter->RxFragmentSize;
 
     for (UINT32 i = 0; i < Rq->NumBuffers; i++) {
         UINT32 *Descriptor = HwRingGetElement(Rq->HwRing, i & Rq->HwRing->Mask);
@@ -543,10 +669,7 @@ MpInitializeReceiveQueue(
         //
         // Initialize packet content.
         //
-        if (PatternLength > 0) {
-            UCHAR *Pkt = Rq->BufferArray + *Descriptor;
-            RtlCopyMemory(Pkt, Rq->PatternBuffer, PatternLength);
-        }
+        MpReceiveGenerateFrame(Rq, *Descriptor);
 
         MpReceiveRecycle(Rq, *Descriptor);
     }
@@ -561,7 +684,7 @@ Exit:
 }
 
 static CONST XDP_INTERFACE_RX_QUEUE_DISPATCH MpXdpRxDispatch = {
-    MpXdpNotify,
+    MpXdpRxNotify,
 };
 
 _IRQL_requires_(PASSIVE_LEVEL)
@@ -575,12 +698,14 @@ MpXdpCreateRxQueue(
 {
     ADAPTER_CONTEXT *Adapter = (ADAPTER_CONTEXT *)InterfaceContext;
     CONST XDP_QUEUE_INFO *QueueInfo;
+    CONST XDP_HOOK_ID *HookId;
     ADAPTER_QUEUE *AdapterQueue;
     ADAPTER_RX_QUEUE *Rq;
     XDP_RX_CAPABILITIES RxCapabilities;
     XDP_POLL_INFO PollInfo;
 
     QueueInfo = XdpRxQueueGetTargetQueueInfo(Config);
+    HookId = XdpRxQueueGetHookId(Config);
 
     if (QueueInfo->QueueType != XDP_QUEUE_TYPE_DEFAULT_RSS) {
         return STATUS_NOT_SUPPORTED;
@@ -591,6 +716,13 @@ MpXdpCreateRxQueue(
     }
 
     AdapterQueue = &Adapter->RssQueues[QueueInfo->QueueId];
+
+    if (HookId != NULL && HookId->Direction == XDP_HOOK_TX) {
+        return
+            MpXdpCreateTxInspectQueue(
+                AdapterQueue, Config, InterfaceRxQueue, InterfaceRxQueueDispatch);
+    }
+
     Rq = &AdapterQueue->Rq;
     ASSERT(Rq->XdpState == XDP_STATE_INACTIVE);
 
@@ -598,14 +730,27 @@ MpXdpCreateRxQueue(
 
     XdpRxQueueRegisterExtensionVersion(Config, &MpSupportedXdpExtensions.RxAction);
 
+    if (Adapter->RxMaxFragments > 0) {
+        XdpRxQueueRegisterExtensionVersion(Config, &MpSupportedXdpExtensions.Fragment);
+    }
+
     XdpInitializeRxCapabilitiesDriverVa(&RxCapabilities);
     RxCapabilities.TxActionSupported = TRUE;
+    RxCapabilities.MaximumFragments = (UINT8)Adapter->RxMaxFragments;
+
+    //
+    // PASS and TX frames are indicated using the buffer's DataOffset and
+    // DataLength, so programs may adjust the data, including into the headroom
+    // reserved before each frame.
+    //
+    RxCapabilities.DataAdjustSupported = TRUE;
+    RxCapabilities.Headroom = (UINT16)Adapter->RxHeadroom;
     XdpRxQueueSetCapabilities(Config, &RxCapabilities);
 
     XdpInitializeExclusivePollInfo(&PollInfo, AdapterQueue->NdisPollHandle);
     XdpRxQueueSetPollInfo(Config, &PollInfo);
 
-    *InterfaceRxQueue = (XDP_INTERFACE_HANDLE)AdapterQueue;
+    *InterfaceRxQueue = (XDP_INTERFACE_HANDLE)&AdapterQueue->XdpRxHandle;
     *InterfaceRxQueueDispatch = &MpXdpRxDispatch;
 
     return STATUS_SUCCESS;
@@ -619,9 +764,14 @@ MpXdpActivateRxQueue(
     _In_ XDP_RX_QUEUE_CONFIG_ACTIVATE Config
     )
 {
-    ADAPTER_QUEUE *AdapterQueue = (ADAPTER_QUEUE *)InterfaceRxQueue;
+    ADAPTER_XDP_RX_HANDLE *RxHandle = (ADAPTER_XDP_RX_HANDLE *)InterfaceRxQueue;
+    ADAPTER_QUEUE *AdapterQueue = RxHandle->AdapterQueue;
     ADAPTER_RX_QUEUE *Rq = &AdapterQueue->Rq;
 
+    if (RxHandle->TxInspect) {
+        return MpXdpActivateTxInspectQueue(AdapterQueue, XdpRxQueue, Config);
+    }
+
     ASSERT(Rq->XdpState == XDP_STATE_INACTIVE);
 
     Rq->XdpRxQueue = XdpRxQueue;
@@ -636,6 +786,12 @@ MpXdpActivateRxQueue(
     XdpRxQueueGetExtension(
         Config, &MpSupportedXdpExtensions.RxAction, &Rq->RxActionExtension);
 
+    if (Rq->FragmentSize > 0 && AdapterQueue->Adapter->RxMaxFragments > 0) {
+        Rq->FragmentRing = XdpRxQueueGetFragmentRing(Config);
+        XdpRxQueueGetExtension(
+            Config, &MpSupportedXdpExtensions.Fragment, &Rq->FragmentExtension);
+    }
+
     WriteUInt32Release((UINT32 *)&Rq->XdpState, XDP_STATE_ACTIVE);
 
     return STATUS_SUCCESS;
@@ -647,10 +803,16 @@ MpXdpDeleteRxQueue(
     _In_ XDP_INTERFACE_HANDLE InterfaceRxQueue
     )
 {
-    ADAPTER_QUEUE *AdapterQueue = (ADAPTER_QUEUE*)InterfaceRxQueue;
+    ADAPTER_XDP_RX_HANDLE *RxHandle = (ADAPTER_XDP_RX_HANDLE *)InterfaceRxQueue;
+    ADAPTER_QUEUE *AdapterQueue = RxHandle->AdapterQueue;
     ADAPTER_RX_QUEUE *Rq = &AdapterQueue->Rq;
     KEVENT DeleteComplete;
 
+    if (RxHandle->TxInspect) {
+        MpXdpDeleteTxInspectQueue(AdapterQueue);
+        return;
+    }
+
     if (Rq->XdpState == XDP_STATE_INACTIVE) {
         //
         // XDP is allowed to delete a created but inactive queue.
@@ -675,4 +837,5 @@ MpXdpDeleteRxQueue(
     Rq->DeleteComplete = NULL;
     Rq->XdpRxQueue = NULL;
     Rq->FrameRing = NULL;
+    Rq->FragmentRing = NULL;
 }
@@ -198,7 +198,8 @@ _IRQL_requires_max_(DISPATCH_LEVEL)
 UINT32
 MpTransmitProcessPosts(
     ADAPTER_TX_QUEUE *Tq,
-    BOOLEAN XdpActive
+    BOOLEAN XdpActive,
+    BOOLEAN InspectActive
     )
 {
     KIRQL OldIrql;
@@ -263,9 +264,22 @@ MpTransmitProcessPosts(
     }
 
     //
-    // Post NBL TX to HW.
+    // Post NBs that passed TX inspection to HW ahead of any NBs queued since.
+    //
+    if (Tq->Inspect.NbPassCount > 0) {
+        Count = PostNbQueueToHw(Tq, Tq->Inspect.NbPassCount, &Tq->Inspect.NbPassHead);
+        Tq->Inspect.NbPassCount -= Count;
+        if (Tq->Inspect.NbPassHead == NULL) {
+            ASSERT(Tq->Inspect.NbPassCount == 0);
+            Tq->Inspect.NbPassTail = &Tq->Inspect.NbPassHead;
+        }
+    }
+
+    //
+    // Post NBL TX to HW. While TX inspection is active, queued NBs are posted
+    // only after XDP has inspected them.
     //
-    if (Tq->NbQueueCount > 0) {
+    if (Tq->NbQueueCount > 0 && !InspectActive && Tq->Inspect.NbPassCount == 0) {
         KeAcquireSpinLock(&Tq->NbQueueLock, &OldIrql);
 
         Count = PostNbQueueToHw(Tq, Tq->NbQueueCount, &Tq->NbQueueHead);
@@ -281,6 +295,210 @@ MpTransmitProcessPosts(
     return XdpFramesTransmitted;
 }
 
+static
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+MpTransmitDropNb(
+    _In_ ADAPTER_TX_QUEUE *Tq,
+    _In_ NET_BUFFER *Nb,
+    _Inout_ COUNTED_NBL_CHAIN *NblChain
+    )
+{
+    NET_BUFFER_LIST **OwningNbl = MP_NB_GET_OWNING_NBL(Nb);
+    ULONG *OwningNblRefCount = MP_NBL_GET_REF_COUNT(*OwningNbl);
+
+    Tq->Stats.TxDrops++;
+
+    if (--(*OwningNblRefCount) == 0) {
+        (*OwningNbl)->Status = NDIS_STATUS_SUCCESS;
+        CountedNblChainAppend(NblChain, *OwningNbl);
+    }
+}
+
+//
+// Returns the number of fragment buffers describing the NB data that follows
+// its current MDL. NDIS allows excess MDLs past the data length; those are
+// ignored.
+//
+static
+UINT32
+MpTransmitInspectFragmentCount(
+    _In_ NET_BUFFER *Nb
+    )
+{
+    MDL *Mdl = NET_BUFFER_CURRENT_MDL(Nb);
+    UINT32 DataLength = NET_BUFFER_DATA_LENGTH(Nb);
+    UINT32 FragmentCount = 0;
+
+    DataLength -= min(DataLength, MmGetMdlByteCount(Mdl) - NET_BUFFER_CURRENT_MDL_OFFSET(Nb));
+
+    for (Mdl = Mdl->Next; Mdl != NULL && DataLength > 0; Mdl = Mdl->Next) {
+        DataLength -= min(DataLength, MmGetMdlByteCount(Mdl));
+        FragmentCount++;
+    }
+
+    return FragmentCount;
+}
+
+//
+// Describes an NB with the next frame and fragment ring elements, without
+// producing them. Returns FALSE if an MDL cannot be mapped.
+//
+static
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+MpTransmitInspectMapNb(
+    _In_ ADAPTER_TX_INSPECT_QUEUE *Inspect,
+    _In_ NET_BUFFER *Nb,
+    _In_ UINT32 FragmentCount
+    )
+{
+    XDP_RING *FrameRing = Inspect->FrameRing;
+    XDP_RING *FragmentRing = Inspect->FragmentRing;
+    XDP_FRAME *Frame = XdpRingGetElement(FrameRing, FrameRing->ProducerIndex & FrameRing->Mask);
+    XDP_BUFFER *Buffer = &Frame->Buffer;
+    MDL *Mdl = NET_BUFFER_CURRENT_MDL(Nb);
+    UINT32 DataLength = NET_BUFFER_DATA_LENGTH(Nb);
+    UINT32 Index = 0;
+
+    ASSERT(FragmentCount <= MAX_TX_INSPECT_FRAGMENTS);
+
+    Buffer->DataOffset = NET_BUFFER_CURRENT_MDL_OFFSET(Nb);
+
+    while (TRUE) {
+        XDP_BUFFER_VIRTUAL_ADDRESS *Va =
+            XdpGetVirtualAddressExtension(Buffer, &Inspect->BufferVaExtension);
+
+        Buffer->DataLength = min(DataLength, MmGetMdlByteCount(Mdl) - Buffer->DataOffset);
+        Buffer->BufferLength = Buffer->DataOffset + Buffer->DataLength;
+        Va->VirtualAddress =
+            MmGetSystemAddressForMdlSafe(Mdl, LowPagePriority | MdlMappingNoExecute);
+        if (Va->VirtualAddress == NULL) {
+            return FALSE;
+        }
+
+        DataLength -= Buffer->DataLength;
+
+        if (Index == FragmentCount) {
+            break;
+        }
+
+        Mdl = Mdl->Next;
+        Buffer =
+            XdpRingGetElement(
+                FragmentRing, (FragmentRing->ProducerIndex + Index++) & FragmentRing->Mask);
+        Buffer->DataOffset = 0;
+    }
+
+    XdpGetFragmentExtension(Frame, &Inspect->FragmentExtension)->FragmentBufferCount =
+        (UINT8)FragmentCount;
+
+    return TRUE;
+}
+
+static
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+MpTransmitInspect(
+    _In_ ADAPTER_TX_QUEUE *Tq,
+    _Inout_ COUNTED_NBL_CHAIN *NblChain
+    )
+{
+    ADAPTER_TX_INSPECT_QUEUE *Inspect = &Tq->Inspect;
+    XDP_RING *FrameRing = Inspect->FrameRing;
+    XDP_RING *FragmentRing = Inspect->FragmentRing;
+    NET_BUFFER *Nb;
+    KIRQL OldIrql;
+
+    if (Tq->NbQueueCount == 0) {
+        return;
+    }
+
+    //
+    // Take ownership of every NB queued by the send path.
+    //
+    KeAcquireSpinLock(&Tq->NbQueueLock, &OldIrql);
+    Nb = Tq->NbQueueHead;
+    Tq->NbQueueHead = NULL;
+    Tq->NbQueueTail = &Tq->NbQueueHead;
+    Tq->NbQueueCount = 0;
+    KeReleaseSpinLock(&Tq->NbQueueLock, OldIrql);
+
+    while (Nb != NULL) {
+        NET_BUFFER *BatchHead = NULL;
+        NET_BUFFER **BatchTail = &BatchHead;
+        UINT32 StartIndex = FrameRing->ProducerIndex;
+
+        //
+        // Build a batch of frames describing each NB, with one fragment buffer
+        // per additional MDL. NBs that cannot be mapped or that exceed the
+        // fragment limit are dropped. XDP consumes both rings in full, so an
+        // NB that does not fit in the fragment ring fits once the batch is
+        // inspected.
+        //
+        while (Nb != NULL && XdpRingFree(FrameRing) > 0) {
+            NET_BUFFER *NextNb = *MP_NB_GET_NB_QUEUE_LINK(Nb);
+            UINT32 FragmentCount = MpTransmitInspectFragmentCount(Nb);
+
+            if (FragmentCount > XdpRingFree(FragmentRing) &&
+                FragmentCount <= MAX_TX_INSPECT_FRAGMENTS) {
+                ASSERT(BatchHead != NULL);
+                break;
+            }
+
+            if (FragmentCount > MAX_TX_INSPECT_FRAGMENTS ||
+                !MpTransmitInspectMapNb(Inspect, Nb, FragmentCount)) {
+                MpTransmitDropNb(Tq, Nb, NblChain);
+            } else {
+                FrameRing->ProducerIndex++;
+                FragmentRing->ProducerIndex += FragmentCount;
+
+                *BatchTail = Nb;
+                BatchTail = MP_NB_GET_NB_QUEUE_LINK(Nb);
+            }
+
+            Nb = NextNb;
+        }
+
+        *BatchTail = NULL;
+
+        if (BatchHead == NULL) {
+            continue;
+        }
+
+        //
+        // Inspect the batch, then either queue each NB for the hardware or
+        // drop it.
+        //
+        XdpReceive(Inspect->XdpRxQueue);
+
+        while (StartIndex != FrameRing->ProducerIndex) {
+            XDP_FRAME *Frame = XdpRingGetElement(FrameRing, StartIndex++ & FrameRing->Mask);
+            XDP_FRAME_RX_ACTION *Action =
+                XdpGetRxActionExtension(Frame, &Inspect->RxActionExtension);
+            NET_BUFFER *BatchNb = BatchHead;
+
+            ASSERT(BatchNb != NULL);
+            BatchHead = *MP_NB_GET_NB_QUEUE_LINK(BatchNb);
+
+            if (Action->RxAction == XDP_RX_ACTION_PASS) {
+                *Inspect->NbPassTail = BatchNb;
+                Inspect->NbPassTail = MP_NB_GET_NB_QUEUE_LINK(BatchNb);
+                Inspect->NbPassCount++;
+            } else {
+                //
+                // The TX inspect queue does not support the TX action, so all
+                // other actions drop the frame.
+                //
+                ASSERT(Action->RxAction == XDP_RX_ACTION_DROP);
+                MpTransmitDropNb(Tq, BatchNb, NblChain);
+            }
+        }
+
+        *Inspect->NbPassTail = NULL;
+    }
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 VOID
 MpTransmit(
@@ -290,7 +508,9 @@ MpTransmit(
     )
 {
     BOOLEAN XdpActive = FALSE;
+    BOOLEAN InspectActive = FALSE;
     XDP_QUEUE_STATE XdpState = ReadUInt32Acquire((UINT32 *)&Tq->XdpState);
+    XDP_QUEUE_STATE InspectState = ReadUInt32Acquire((UINT32 *)&Tq->Inspect.XdpState);
     COUNTED_NBL_CHAIN NblChain;
 
     CountedNblChainInitialize(&NblChain);
@@ -309,9 +529,26 @@ MpTransmit(
         }
     }
 
+    if (InspectState == XDP_STATE_DELETE_PENDING) {
+        Tq->Inspect.XdpState = XDP_STATE_INACTIVE;
+        KeSetEvent(Tq->Inspect.DeleteComplete, 0, FALSE);
+    } else if (InspectState == XDP_STATE_ACTIVE) {
+        InspectActive = TRUE;
+        if (Tq->Inspect.NeedFlush) {
+            Tq->Inspect.NeedFlush = FALSE;
+            XdpFlushReceive(Tq->Inspect.XdpRxQueue);
+        }
+
+        //
+        // Inspect NBs before completions are processed, so any NBLs fully
+        // dropped by XDP are returned to NDIS by this poll.
+        //
+        MpTransmitInspect(Tq, &NblChain);
+    }
+
     XdpPoll->FramesCompleted +=
         MpTransmitProcessCompletions(Tq, XdpActive, Poll->MaxNblsToComplete, &NblChain);
-    XdpPoll->FramesTransmitted += MpTransmitProcessPosts(Tq, XdpActive);
+    XdpPoll->FramesTransmitted += MpTransmitProcessPosts(Tq, XdpActive, InspectActive);
 
     //
     // If NBLs were completed, return those to NDIS.
@@ -406,9 +643,11 @@ MpSendNetBufferLists(
     }
 
     //
-    // Attempt to post NBs to the HW ring.
+    // Attempt to post NBs to the HW ring, unless XDP must inspect them first
+    // within the poll EC.
     //
-    if (Tq->NbQueueCount == 0) {
+    if (Tq->NbQueueCount == 0 &&
+        ReadUInt32Acquire((UINT32 *)&Tq->Inspect.XdpState) == XDP_STATE_INACTIVE) {
         PostedNbCount = PostNbQueueToHw(Tq, NbCount, &LocalNbQueueHead);
         if (PostedNbCount > 0) {
             //
@@ -470,6 +709,9 @@ MpInitializeTransmitQueue(
     Tq->NblRundown = Adapter->NblRundown;
     Tq->Rq = &RssQueue->Rq;
     KeInitializeSpinLock(&Tq->NbQueueLock);
+    Tq->Inspect.NbPassCount = 0;
+    Tq->Inspect.NbPassHead = NULL;
+    Tq->Inspect.NbPassTail = &Tq->Inspect.NbPassHead;
 
     Tq->XdpHwDescriptorsAvailable = Adapter->TxRingSize * Adapter->TxXdpQosPct / 100;
     if (Tq->XdpHwDescriptorsAvailable == 0) {
@@ -515,17 +757,28 @@ MpXdpCreateTxQueue(
 {
     ADAPTER_CONTEXT *Adapter = (ADAPTER_CONTEXT *)InterfaceContext;
     CONST XDP_QUEUE_INFO *QueueInfo;
+    CONST XDP_HOOK_ID *HookId;
     ADAPTER_QUEUE *AdapterQueue;
     ADAPTER_TX_QUEUE *Tq;
     XDP_TX_CAPABILITIES TxCapabilities;
     XDP_POLL_INFO PollInfo;
 
     QueueInfo = XdpTxQueueGetTargetQueueInfo(Config);
+    HookId = XdpTxQueueGetHookId(Config);
 
     if (QueueInfo->QueueType != XDP_QUEUE_TYPE_DEFAULT_RSS) {
         return STATUS_NOT_SUPPORTED;
     }
 
+    //
+    // Only the L2 TX inject hook is backed by the hardware TX queue.
+    //
+    if (HookId != NULL &&
+        (HookId->Layer != XDP_HOOK_L2 || HookId->Direction != XDP_HOOK_TX ||
+            HookId->SubLayer != XDP_HOOK_INJECT)) {
+        return STATUS_NOT_SUPPORTED;
+    }
+
     if (QueueInfo->QueueId >= Adapter->NumRssQueues) {
         return STATUS_NOT_FOUND;
     }
@@ -617,3 +870,114 @@ MpXdpDeleteTxQueue(
     Tq->XdpTxQueue = NULL;
     Tq->FrameRing = NULL;
 }
+
+static CONST XDP_INTERFACE_RX_QUEUE_DISPATCH MpXdpTxInspectDispatch = {
+    MpXdpRxNotify,
+};
+
+_IRQL_requires_(PASSIVE_LEVEL)
+NTSTATUS
+MpXdpCreateTxInspectQueue(
+    _In_ ADAPTER_QUEUE *AdapterQueue,
+    _Inout_ XDP_RX_QUEUE_CONFIG_CREATE Config,
+    _Out_ XDP_INTERFACE_HANDLE *InterfaceRxQueue,
+    _Out_ CONST XDP_INTERFACE_RX_QUEUE_DISPATCH **InterfaceRxQueueDispatch
+    )
+{
+    ADAPTER_TX_INSPECT_QUEUE *Inspect = &AdapterQueue->Tq.Inspect;
+    XDP_RX_CAPABILITIES RxCapabilities;
+    XDP_POLL_INFO PollInfo;
+
+    ASSERT(Inspect->XdpState == XDP_STATE_INACTIVE);
+
+    XdpRxQueueRegisterExtensionVersion(Config, &MpSupportedXdpExtensions.VirtualAddress);
+    XdpRxQueueRegisterExtensionVersion(Config, &MpSupportedXdpExtensions.RxAction);
+    XdpRxQueueRegisterExtensionVersion(Config, &MpSupportedXdpExtensions.Fragment);
+
+    //
+    // Frames are indicated from NBs allocated by the upper stack, so inspection
+    // cannot redirect them onto the hardware TX ring. Each MDL beyond the first
+    // is indicated as a fragment buffer.
+    //
+    XdpInitializeRxCapabilitiesDriverVa(&RxCapabilities);
+    RxCapabilities.TxActionSupported = FALSE;
+    RxCapabilities.MaximumFragments = MAX_TX_INSPECT_FRAGMENTS;
+    XdpRxQueueSetCapabilities(Config, &RxCapabilities);
+
+    XdpInitializeExclusivePollInfo(&PollInfo, AdapterQueue->NdisPollHandle);
+    XdpRxQueueSetPollInfo(Config, &PollInfo);
+
+    *InterfaceRxQueue = (XDP_INTERFACE_HANDLE)&AdapterQueue->XdpTxInspectHandle;
+    *InterfaceRxQueueDispatch = &MpXdpTxInspectDispatch;
+
+    return STATUS_SUCCESS;
+}
+
+_IRQL_requires_(PASSIVE_LEVEL)
+NTSTATUS
+MpXdpActivateTxInspectQueue(
+    _In_ ADAPTER_QUEUE *AdapterQueue,
+    _In_ XDP_RX_QUEUE_HANDLE XdpRxQueue,
+    _In_ XDP_RX_QUEUE_CONFIG_ACTIVATE Config
+    )
+{
+    ADAPTER_TX_INSPECT_QUEUE *Inspect = &AdapterQueue->Tq.Inspect;
+
+    ASSERT(Inspect->XdpState == XDP_STATE_INACTIVE);
+
+    Inspect->XdpRxQueue = XdpRxQueue;
+    Inspect->FrameRing = XdpRxQueueGetFrameRing(Config);
+    Inspect->FragmentRing = XdpRxQueueGetFragmentRing(Config);
+    Inspect->NeedFlush = FALSE;
+    Inspect->DeleteComplete = NULL;
+
+    ASSERT(XdpRxQueueIsVirtualAddressEnabled(Config));
+    XdpRxQueueGetExtension(
+        Config, &MpSupportedXdpExtensions.VirtualAddress, &Inspect->BufferVaExtension);
+
+    XdpRxQueueGetExtension(
+        Config, &MpSupportedXdpExtensions.RxAction, &Inspect->RxActionExtension);
+
+    XdpRxQueueGetExtension(
+        Config, &MpSupportedXdpExtensions.Fragment, &Inspect->FragmentExtension);
+
+    WriteUInt32Release((UINT32 *)&Inspect->XdpState, XDP_STATE_ACTIVE);
+
+    return STATUS_SUCCESS;
+}
+
+_IRQL_requires_(PASSIVE_LEVEL)
+VOID
+MpXdpDeleteTxInspectQueue(
+    _In_ ADAPTER_QUEUE *AdapterQueue
+    )
+{
+    ADAPTER_TX_INSPECT_QUEUE *Inspect = &AdapterQueue->Tq.Inspect;
+    KEVENT DeleteComplete;
+
+    if (Inspect->XdpState == XDP_STATE_INACTIVE) {
+        //
+        // XDP is allowed to delete a created but inactive queue.
+        //
+        return;
+    }
+
+    KeInitializeEvent(&DeleteComplete, NotificationEvent, FALSE);
+    Inspect->DeleteComplete = &DeleteComplete;
+
+    //
+    // Ensure the state is changed with release semantics, then trigger
+    // an NDIS poll to perform the actual delete work within the poll EC.
+    //
+    ASSERT(Inspect->XdpState == XDP_STATE_ACTIVE);
+    WriteUInt32Release((UINT32 *)&Inspect->XdpState, XDP_STATE_DELETE_PENDING);
+    AdapterQueue->Adapter->PollDispatch.RequestPoll(AdapterQueue->NdisPollHandle, 0);
+
+    KeWaitForSingleObject(&DeleteComplete, Executive, KernelMode, FALSE, NULL);
+    ASSERT(Inspect->XdpState == XDP_STATE_INACTIVE);
+
+    Inspect->DeleteComplete = NULL;
+    Inspect->XdpRxQueue = NULL;
+    Inspect->FrameRing = NULL;
+    Inspect->FragmentRing = NULL;
+}
@@ -38,3 +38,26 @@ MpCleanupTransmitQueue(
 XDP_CREATE_TX_QUEUE     MpXdpCreateTxQueue;
 XDP_ACTIVATE_TX_QUEUE   MpXdpActivateTxQueue;
 XDP_DELETE_TX_QUEUE     MpXdpDeleteTxQueue;
+
+_IRQL_requires_(PASSIVE_LEVEL)
+NTSTATUS
+MpXdpCreateTxInspectQueue(
+    _In_ ADAPTER_QUEUE *AdapterQueue,
+    _Inout_ XDP_RX_QUEUE_CONFIG_CREATE Config,
+    _Out_ XDP_INTERFACE_HANDLE *InterfaceRxQueue,
+    _Out_ CONST XDP_INTERFACE_RX_QUEUE_DISPATCH **InterfaceRxQueueDispatch
+    );
+
+_IRQL_requires_(PASSIVE_LEVEL)
+NTSTATUS
+MpXdpActivateTxInspectQueue(
+    _In_ ADAPTER_QUEUE *AdapterQueue,
+    _In_ XDP_RX_QUEUE_HANDLE XdpRxQueue,
+    _In_ XDP_RX_QUEUE_CONFIG_ACTIVATE Config
+    );
+
+_IRQL_requires_(PASSIVE_LEVEL)
+VOID
+MpXdpDeleteTxInspectQueue(
+    _In_ ADAPTER_QUEUE *AdapterQueue
+    );
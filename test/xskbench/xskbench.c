@@ -3,13 +3,16 @@
 // Licensed under the MIT License.
 //
 
+#include <winsock2.h>
 #include <windows.h>
+#include <ws2ipdef.h>
 #include <assert.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <afxdp_helper.h>
 #include <afxdp_experimental.h>
+#include <pkthlp.h>
 #include <xdpapi.h>
 
 #pragma warning(disable:4200) // nonstandard extension used: zero-sized array in struct/union
@@ -36,8 +39,8 @@
 #define DEFAULT_UDP_DEST_PORT 0
 #define DEFAULT_DURATION ULONG_MAX
 #define DEFAULT_TX_IO_SIZE 64
-#define DEFAULT_LAT_COUNT 10000000
 #define DEFAULT_YIELD_COUNT 0
+#define DEFAULT_TX_FLOW_COUNT 1
 
 CHAR *HELP =
 "xskbench.exe <rx|tx|fwd|lat> -i <ifindex> [OPTIONS] <-t THREAD_PARAMS> [-t THREAD_PARAMS...] \n"
@@ -46,6 +49,10 @@ CHAR *HELP =
 "   -q <QUEUE_PARAMS> [-q QUEUE_PARAMS...] \n"
 "   -w                 Wait for IO completion\n"
 "                      Default: off (busy loop IO mode)\n"
+"   -wait_us <us>      Wait for IO completion for at most the given number\n"
+"                      of microseconds, using a high-resolution timer.\n"
+"                      Implies -w\n"
+"                      Default: off\n"
 "   -na <nodenumber>   The NUMA node affinity. -1 is any node\n"
 "                      Default: " STR_OF(DEFAULT_NODE_AFFINITY) "\n"
 "   -group <groupid>   The processor group. -1 is any group\n"
@@ -81,6 +88,9 @@ CHAR *HELP =
 "                      - busy:    The system aggressively polls\n"
 "                      - socket:  The socket polls\n"
 "                      Default: system\n"
+"   -tx_doorbell <ms>  Enable the TX doorbell poller with the given idle\n"
+"                      timeout, in milliseconds, up to 100\n"
+"                      Default: off\n"
 "   -xdp_mode <mode>   The XDP interface provider:\n"
 "                      - system:  The system determines the ideal XDP provider\n"
 "                      - generic: A generic XDP interface provider\n"
@@ -90,15 +100,28 @@ CHAR *HELP =
 "                      Default: off\n"
 "   -rx_inject         Inject TX and FWD frames onto the local RX path\n"
 "                      Default: off\n"
-"   -tx_inspect        Inspect RX and FWD frames from the local TX path\n"
+"   -tx_inspect        Inspect RX and FWD frames from the local TX path. Native\n"
+"                      mode requires an interface with TX inspect support\n"
 "                      Default: off\n"
 "   -tx_pattern        Pattern for the leading bytes of TX, in hexadecimal.\n"
 "                      The pktcmd.exe tool outputs hexadecimal headers. Any\n"
 "                      trailing bytes in the XSK buffer are set to zero\n"
 "                      Default: \"\"\n"
-"   -lat_count         Number of latency samples to collect\n"
-"                      Default: " STR_OF(DEFAULT_LAT_COUNT) "\n"
-
+"   -tx_imix <sizes>   Distribution of TX frame sizes, as a comma separated list\n"
+"                      of <size>:<weight> pairs, or \"simple\" for the simple\n"
+"                      IMIX (60:7,590:4,1514:1). Overrides -txio. Requires an\n"
+"                      Ethernet/IP/UDP -tx_pattern, whose lengths and\n"
+"                      checksums are rewritten for each frame\n"
+"                      Default: off\n"
+"   -tx_flows <count>  The number of flows to rotate TX frames across, by\n"
+"                      incrementing the UDP source port of -tx_pattern.\n"
+"                      Requires an Ethernet/IP/UDP -tx_pattern\n"
+"                      Default: " STR_OF(DEFAULT_TX_FLOW_COUNT) "\n"
+"   -tx_pcap <file>    Replay the frames of a pcap file in tx mode. The frames\n"
+"                      are preloaded into the UMEM, one frame per chunk and\n"
+"                      truncated to the chunk size. Excludes -tx_pattern,\n"
+"                      -tx_imix and -tx_flows\n"
+"                      Default: off\n"
 "\n"
 "OPTIONS: \n"
 "   -d                 Duration of execution in seconds\n"
@@ -109,11 +132,19 @@ CHAR *HELP =
 "                      Default: " STR_OF(DEFAULT_UDP_DEST_PORT) "\n"
 "   -lp                Use large pages. Requires privileged account.\n"
 "                      Default: off\n"
+"   -lat_file <path>   Write the final latency histograms of lat mode to a file\n"
+"                      Default: off\n"
+"   -lat_format <fmt>  The format of the latency histogram file:\n"
+"                      - csv:   One row per queue and percentile\n"
+"                      - json:  Percentiles and non-empty buckets per queue\n"
+"                      Default: csv\n"
 "\n"
 "Examples\n"
 "   xskbench.exe rx -i 6 -t -q -id 0\n"
 "   xskbench.exe rx -i 6 -t -ca 0x2 -q -id 0 -t -ca 0x4 -q -id 1\n"
 "   xskbench.exe tx -i 6 -t -q -id 0 -q -id 1\n"
+"   xskbench.exe tx -i 6 -t -q -id 0 -tx_pattern <hex> -tx_imix simple -tx_flows 64\n"
+"   xskbench.exe tx -i 6 -t -q -id 0 -tx_pcap capture.pcap\n"
 "   xskbench.exe fwd -i 6 -t -q -id 0 -y\n"
 "   xskbench.exe lat -i 6 -t -q -id 0 -ring_size 8\n"
 ;
@@ -141,6 +172,41 @@ CHAR *HELP =
 #define WAIT_DRIVER_TIMEOUT_MS 1050
 #define STATS_ARRAY_SIZE 60
 
+//
+// Latency samples are recorded into a log-linear histogram: values below
+// 2^LAT_HISTO_SUB_BUCKET_BITS are counted exactly, and every larger power of
+// two is split into 2^LAT_HISTO_SUB_BUCKET_BITS linear sub-buckets, bounding
+// the relative error to roughly 1 / 2^LAT_HISTO_SUB_BUCKET_BITS.
+//
+#define LAT_HISTO_SUB_BUCKET_BITS 5
+#define LAT_HISTO_SUB_BUCKET_COUNT (1ui32 << LAT_HISTO_SUB_BUCKET_BITS)
+#define LAT_HISTO_BUCKET_COUNT \
+    ((64 - LAT_HISTO_SUB_BUCKET_BITS + 1) * LAT_HISTO_SUB_BUCKET_COUNT)
+
+#define TX_IMIX_MAX_WEIGHT 4096
+#define TX_IMIX_SIMPLE "60:7,590:4,1514:1"
+
+#define PCAP_MAGIC_US 0xa1b2c3d4
+#define PCAP_MAGIC_NS 0xa1b23c4d
+#define PCAP_LINKTYPE_ETHERNET 1
+
+typedef struct {
+    UINT32 MagicNumber;
+    UINT16 VersionMajor;
+    UINT16 VersionMinor;
+    INT32 ThisZone;
+    UINT32 SigFigs;
+    UINT32 SnapLength;
+    UINT32 LinkType;
+} PCAP_FILE_HEADER;
+
+typedef struct {
+    UINT32 TimestampSeconds;
+    UINT32 TimestampFraction;
+    UINT32 CapturedLength;
+    UINT32 OriginalLength;
+} PCAP_RECORD_HEADER;
+
 typedef enum {
     ModeRx,
     ModeTx,
@@ -154,6 +220,18 @@ typedef enum {
     XdpModeNative,
 } XDP_MODE;
 
+typedef enum {
+    LatFormatCsv,
+    LatFormatJson,
+} LAT_FORMAT;
+
+typedef struct {
+    UINT64 count;
+    INT64 min;
+    INT64 max;
+    UINT64 buckets[LAT_HISTO_BUCKET_COUNT];
+} LAT_HISTOGRAM;
+
 typedef struct {
     INT queueId;
     HANDLE sock;
@@ -167,10 +245,23 @@ typedef struct {
     UINT32 ringsize;
     UCHAR *txPattern;
     UINT32 txPatternLength;
-    INT64 *latSamples;
-    UINT32 latSamplesCount;
-    UINT32 latIndex;
+    UINT32 *txSizes;
+    UINT32 txSizeCount;
+    UINT32 txSizeIndex;
+    UINT32 txFlowCount;
+    UINT32 txFlowIndex;
+    UINT16 txFlowBasePort;
+    ADDRESS_FAMILY txAddressFamily;
+    UINT32 txIpOffset;
+    UINT32 txUdpOffset;
+    CHAR *txPcapFile;
+    UINT32 *txChunkLengths;
+    LAT_HISTOGRAM *latHisto;
+    LAT_HISTOGRAM *lastLatHisto;
+    LAT_HISTOGRAM *intervalLatHisto;
     XSK_POLL_MODE pollMode;
+    UINT32 txDoorbellIdleTimeoutMs;
+    UINT32 waitTimeoutUs;
 
     struct {
         BOOLEAN periodicStats : 1;
@@ -210,12 +301,14 @@ typedef struct {
     UINT32 yieldCount;
     DWORD_PTR cpuAffinity;
     BOOLEAN wait;
+    UINT32 waitTimeoutUs;
 
     UINT32 queueCount;
     MY_QUEUE *queues;
 } MY_THREAD;
 
 CONST XDP_API_TABLE *XdpApi;
+XSK_NOTIFY_SOCKET_PRECISE_FN *XskNotifySocketPrecise;
 INT ifindex = -1;
 UINT16 udpDestPort = DEFAULT_UDP_DEST_PORT;
 ULONG duration = DEFAULT_DURATION;
@@ -225,6 +318,15 @@ BOOLEAN largePages = FALSE;
 MODE mode;
 CHAR *modestr;
 HANDLE periodicStatsEvent;
+INT64 qpcFrequency;
+CHAR *latFile = NULL;
+LAT_FORMAT latFormat = LatFormatCsv;
+
+CONST double LatPercentiles[] = { 50, 90, 99, 99.9, 99.99, 99.999, 99.9999 };
+CONST CHAR *LatPercentileNames[] = {
+    "P50", "P90", "P99", "P99.9", "P99.99", "P99.999", "P99.9999"
+};
+C_ASSERT(RTL_NUMBER_OF(LatPercentiles) == RTL_NUMBER_OF(LatPercentileNames));
 
 UINT32
 RingPairReserve(
@@ -385,6 +487,258 @@ GetDescriptorPattern(
     }
 }
 
+VOID
+ParseTxImix(
+    MY_QUEUE *Queue,
+    CONST CHAR *Imix
+    )
+{
+    UINT32 sizes[32];
+    INT32 weights[32];
+    INT32 currentWeights[32] = {0};
+    UINT32 count = 0;
+    INT32 totalWeight = 0;
+
+    if (!_stricmp(Imix, "simple")) {
+        Imix = TX_IMIX_SIMPLE;
+    }
+
+    while (*Imix != '\0') {
+        CHAR *end;
+
+        ASSERT_FRE(count < RTL_NUMBER_OF(sizes));
+
+        sizes[count] = strtoul(Imix, &end, 0);
+        ASSERT_FRE(end != Imix && *end == ':');
+        Imix = end + 1;
+
+        weights[count] = strtol(Imix, &end, 0);
+        ASSERT_FRE(end != Imix && (*end == ',' || *end == '\0'));
+        ASSERT_FRE(sizes[count] > 0 && weights[count] > 0);
+        Imix = (*end == ',') ? end + 1 : end;
+
+        totalWeight += weights[count];
+        ASSERT_FRE(totalWeight <= TX_IMIX_MAX_WEIGHT);
+        count++;
+    }
+
+    ASSERT_FRE(count > 0);
+
+    Queue->txSizeCount = totalWeight;
+    Queue->txSizes = malloc(Queue->txSizeCount * sizeof(*Queue->txSizes));
+    ASSERT_FRE(Queue->txSizes != NULL);
+
+    //
+    // Expand the weights into a lookup table using smooth weighted round
+    // robin, which spreads each size evenly across the table instead of
+    // sending runs of identical sizes.
+    //
+    for (UINT32 i = 0; i < Queue->txSizeCount; i++) {
+        UINT32 selected = 0;
+
+        for (UINT32 j = 0; j < count; j++) {
+            currentWeights[j] += weights[j];
+            if (currentWeights[j] > currentWeights[selected]) {
+                selected = j;
+            }
+        }
+
+        currentWeights[selected] -= totalWeight;
+        Queue->txSizes[i] = sizes[selected];
+    }
+}
+
+VOID
+ParseTxPatternHeaders(
+    MY_QUEUE *Queue
+    )
+{
+    CONST ETHERNET_HEADER *ethernet = (CONST ETHERNET_HEADER *)Queue->txPattern;
+    CONST UDP_HDR *udp;
+    UINT8 protocol;
+
+    //
+    // Rewriting frame sizes and flows requires a pattern that contains at least
+    // the Ethernet, IP and UDP headers.
+    //
+    ASSERT_FRE(Queue->txPattern != NULL);
+    ASSERT_FRE(Queue->txPatternLength >= sizeof(*ethernet));
+
+    Queue->txIpOffset = sizeof(*ethernet);
+
+    if (ethernet->Type == htons(ETHERNET_TYPE_IPV4)) {
+        CONST IPV4_HEADER *ip = (CONST IPV4_HEADER *)(Queue->txPattern + Queue->txIpOffset);
+
+        ASSERT_FRE(Queue->txPatternLength >= Queue->txIpOffset + sizeof(*ip));
+        ASSERT_FRE((UINT32)ip->HeaderLength * 4 >= sizeof(*ip));
+        Queue->txAddressFamily = AF_INET;
+        Queue->txUdpOffset = Queue->txIpOffset + (UINT32)ip->HeaderLength * 4;
+        protocol = ip->Protocol;
+    } else if (ethernet->Type == htons(ETHERNET_TYPE_IPV6)) {
+        CONST IPV6_HEADER *ip = (CONST IPV6_HEADER *)(Queue->txPattern + Queue->txIpOffset);
+
+        ASSERT_FRE(Queue->txPatternLength >= Queue->txIpOffset + sizeof(*ip));
+        Queue->txAddressFamily = AF_INET6;
+        Queue->txUdpOffset = Queue->txIpOffset + sizeof(*ip);
+        protocol = ip->NextHeader;
+    } else {
+        ABORT("-tx_pattern must contain an IPv4 or IPv6 header\n");
+    }
+
+    if (protocol != IPPROTO_UDP) {
+        ABORT("-tx_pattern must contain a UDP header\n");
+    }
+
+    ASSERT_FRE(Queue->txPatternLength >= Queue->txUdpOffset + sizeof(*udp));
+    udp = (CONST UDP_HDR *)(Queue->txPattern + Queue->txUdpOffset);
+    Queue->txFlowBasePort = ntohs(udp->uh_sport);
+}
+
+VOID
+WriteTxFrameHeaders(
+    MY_QUEUE *Queue,
+    UCHAR *Frame,
+    UINT32 FrameLength
+    )
+{
+    UDP_HDR *udp = (UDP_HDR *)(Frame + Queue->txUdpOffset);
+    UINT16 udpLength = (UINT16)(FrameLength - Queue->txUdpOffset);
+    CONST VOID *ipSource;
+    CONST VOID *ipDestination;
+    UINT8 addressLength;
+
+    if (Queue->txFlowCount > 1) {
+        udp->uh_sport = htons((UINT16)(Queue->txFlowBasePort + Queue->txFlowIndex));
+
+        if (++Queue->txFlowIndex == Queue->txFlowCount) {
+            Queue->txFlowIndex = 0;
+        }
+    }
+
+    udp->uh_ulen = htons(udpLength);
+
+    if (Queue->txAddressFamily == AF_INET) {
+        IPV4_HEADER *ip = (IPV4_HEADER *)(Frame + Queue->txIpOffset);
+
+        ip->TotalLength = htons((UINT16)(FrameLength - Queue->txIpOffset));
+        ip->HeaderChecksum = 0;
+        ip->HeaderChecksum = PktChecksum(0, ip, (UINT16)(ip->HeaderLength * 4));
+        ipSource = &ip->SourceAddress;
+        ipDestination = &ip->DestinationAddress;
+        addressLength = sizeof(IN_ADDR);
+    } else {
+        IPV6_HEADER *ip = (IPV6_HEADER *)(Frame + Queue->txIpOffset);
+
+        ip->PayloadLength = htons(udpLength);
+        ipSource = &ip->SourceAddress;
+        ipDestination = &ip->DestinationAddress;
+        addressLength = sizeof(IN6_ADDR);
+    }
+
+    //
+    // Bytes beyond the TX pattern are always zero, so only the UDP header and
+    // the payload bytes of the pattern contribute to the checksum. The
+    // pseudo-header sum is seeded into the checksum field, so it is already
+    // covered by the checksum over the UDP header.
+    //
+    udp->uh_sum =
+        PktPseudoHeaderChecksum(ipSource, ipDestination, addressLength, udpLength, IPPROTO_UDP);
+    udp->uh_sum = PktChecksum(0, udp, (UINT16)(Queue->txPatternLength - Queue->txUdpOffset));
+
+    if (udp->uh_sum == 0) {
+        udp->uh_sum = (UINT16)~0;
+    }
+}
+
+VOID
+LoadTxPcap(
+    MY_QUEUE *Queue
+    )
+{
+    FILE *file;
+    PCAP_FILE_HEADER fileHeader;
+    PCAP_RECORD_HEADER recordHeader;
+    BOOLEAN swapped;
+    UINT32 numDescriptors = Queue->umemsize / Queue->umemchunksize;
+    UINT32 maxLength = Queue->umemchunksize - Queue->umemheadroom;
+    UINT32 frameCount = 0;
+    UCHAR *umem = Queue->umemReg.Address;
+
+    if (fopen_s(&file, Queue->txPcapFile, "rb") != 0) {
+        ABORT("Failed to open pcap file %s\n", Queue->txPcapFile);
+    }
+
+    ASSERT_FRE(fread(&fileHeader, sizeof(fileHeader), 1, file) == 1);
+
+    if (fileHeader.MagicNumber == PCAP_MAGIC_US || fileHeader.MagicNumber == PCAP_MAGIC_NS) {
+        swapped = FALSE;
+    } else if (_byteswap_ulong(fileHeader.MagicNumber) == PCAP_MAGIC_US ||
+               _byteswap_ulong(fileHeader.MagicNumber) == PCAP_MAGIC_NS) {
+        swapped = TRUE;
+        fileHeader.LinkType = _byteswap_ulong(fileHeader.LinkType);
+    } else {
+        ABORT("%s is not a pcap file\n", Queue->txPcapFile);
+    }
+
+    if (fileHeader.LinkType != PCAP_LINKTYPE_ETHERNET) {
+        ABORT("%s: unsupported pcap link type %u\n", Queue->txPcapFile, fileHeader.LinkType);
+    }
+
+    Queue->txChunkLengths = calloc(numDescriptors, sizeof(*Queue->txChunkLengths));
+    ASSERT_FRE(Queue->txChunkLengths != NULL);
+
+    //
+    // Load one frame into each UMEM chunk, in capture order. Chunks are
+    // recycled through the free ring in the order they complete, so replay
+    // order is preserved; captures larger than the UMEM are truncated to the
+    // leading frames.
+    //
+    while (frameCount < numDescriptors &&
+            fread(&recordHeader, sizeof(recordHeader), 1, file) == 1) {
+        UINT32 capturedLength = recordHeader.CapturedLength;
+        UINT32 copyLength;
+        UCHAR *chunk = umem + (UINT64)frameCount * Queue->umemchunksize + Queue->umemheadroom;
+
+        if (swapped) {
+            capturedLength = _byteswap_ulong(capturedLength);
+        }
+
+        copyLength = min(capturedLength, maxLength);
+        ASSERT_FRE(fread(chunk, 1, copyLength, file) == copyLength);
+
+        if (copyLength < capturedLength) {
+            ASSERT_FRE(fseek(file, (LONG)(capturedLength - copyLength), SEEK_CUR) == 0);
+        }
+
+        if (copyLength == 0) {
+            continue;
+        }
+
+        Queue->txChunkLengths[frameCount++] = copyLength;
+    }
+
+    fclose(file);
+
+    if (frameCount == 0) {
+        ABORT("%s does not contain any frames\n", Queue->txPcapFile);
+    }
+
+    //
+    // Repeat the capture to fill the remaining chunks.
+    //
+    for (UINT32 i = frameCount; i < numDescriptors; i++) {
+        UINT32 source = i % frameCount;
+
+        memcpy(
+            umem + (UINT64)i * Queue->umemchunksize + Queue->umemheadroom,
+            umem + (UINT64)source * Queue->umemchunksize + Queue->umemheadroom,
+            Queue->txChunkLengths[source]);
+        Queue->txChunkLengths[i] = Queue->txChunkLengths[source];
+    }
+
+    printf_verbose("loaded %u frames from %s\n", frameCount, Queue->txPcapFile);
+}
+
 VOID
 SetupSock(
     INT IfIndex,
@@ -487,6 +841,19 @@ SetupSock(
         ASSERT_FRE(res == S_OK);
     }
 
+    if (Queue->txDoorbellIdleTimeoutMs > 0) {
+        XSK_TX_DOORBELL_CONFIG doorbell = {0};
+        doorbell.Header.Revision = XSK_TX_DOORBELL_CONFIG_REVISION_1;
+        doorbell.Header.Size = XSK_SIZEOF_TX_DOORBELL_CONFIG_REVISION_1;
+        doorbell.IdleTimeoutMs = Queue->txDoorbellIdleTimeoutMs;
+
+        printf_verbose("configuring tx doorbell\n");
+        res =
+            XdpApi->XskSetSockopt(
+                Queue->sock, XSK_SOCKOPT_TX_DOORBELL, &doorbell, sizeof(doorbell));
+        ASSERT_FRE(res == S_OK);
+    }
+
     printf_verbose(
         "binding sock to ifindex %d queueId %d flags 0x%x\n", IfIndex, Queue->queueId, bindFlags);
     res = XdpApi->XskBind(Queue->sock, IfIndex, Queue->queueId, bindFlags);
@@ -560,9 +927,331 @@ SetupSock(
     }
     XskRingProducerSubmit(&Queue->freeRing, numDescriptors);
 
+    if (Queue->txPcapFile != NULL && mode == ModeTx) {
+        LoadTxPcap(Queue);
+    }
+
     AttachXdpProgram(Queue);
 }
 
+INT64
+QpcToUs64(
+    INT64 Qpc,
+    INT64 QpcFrequency
+    )
+{
+    //
+    // Multiply by a big number (1000000, to convert seconds to microseconds)
+    // and divide by a big number (QpcFrequency, to convert counts to secs).
+    //
+    // Avoid overflow with separate multiplication/division of the high and low
+    // bits.
+    //
+    // Taken from QuicTimePlatToUs64 (https://github.com/microsoft/msquic).
+    //
+    UINT64 High = (Qpc >> 32) * 1000000;
+    UINT64 Low = (Qpc & 0xFFFFFFFF) * 1000000;
+    return
+        ((High / QpcFrequency) << 32) +
+        ((Low + ((High % QpcFrequency) << 32)) / QpcFrequency);
+}
+
+UINT32
+LatHistoBucketIndex(
+    UINT64 Value
+    )
+{
+    DWORD msb;
+    UINT32 shift;
+
+    if (Value < LAT_HISTO_SUB_BUCKET_COUNT) {
+        return (UINT32)Value;
+    }
+
+    //
+    // Keep the LAT_HISTO_SUB_BUCKET_BITS bits below the most significant bit
+    // as the linear sub-bucket within the power-of-two range.
+    //
+    _BitScanReverse64(&msb, Value);
+    shift = msb - LAT_HISTO_SUB_BUCKET_BITS;
+
+    return
+        (shift + 1) * LAT_HISTO_SUB_BUCKET_COUNT +
+        (UINT32)((Value >> shift) - LAT_HISTO_SUB_BUCKET_COUNT);
+}
+
+UINT64
+LatHistoBucketLowest(
+    UINT32 Index
+    )
+{
+    UINT32 shift;
+
+    if (Index < 2 * LAT_HISTO_SUB_BUCKET_COUNT) {
+        return Index;
+    }
+
+    shift = Index / LAT_HISTO_SUB_BUCKET_COUNT - 1;
+    return
+        (UINT64)(LAT_HISTO_SUB_BUCKET_COUNT + Index % LAT_HISTO_SUB_BUCKET_COUNT) << shift;
+}
+
+UINT64
+LatHistoBucketHighest(
+    UINT32 Index
+    )
+{
+    UINT32 shift;
+
+    if (Index < 2 * LAT_HISTO_SUB_BUCKET_COUNT) {
+        return Index;
+    }
+
+    shift = Index / LAT_HISTO_SUB_BUCKET_COUNT - 1;
+    return LatHistoBucketLowest(Index) + (1ui64 << shift) - 1;
+}
+
+LAT_HISTOGRAM *
+LatHistoAllocate(
+    VOID
+    )
+{
+    LAT_HISTOGRAM *histo = calloc(1, sizeof(*histo));
+    ASSERT_FRE(histo != NULL);
+    histo->min = MAXINT64;
+    return histo;
+}
+
+VOID
+LatHistoRecord(
+    LAT_HISTOGRAM *Histo,
+    INT64 Value
+    )
+{
+    if (Value < 0) {
+        Value = 0;
+    }
+
+    Histo->buckets[LatHistoBucketIndex(Value)]++;
+    Histo->count++;
+    Histo->min = min(Histo->min, Value);
+    Histo->max = max(Histo->max, Value);
+}
+
+VOID
+LatHistoMerge(
+    LAT_HISTOGRAM *Dest,
+    CONST LAT_HISTOGRAM *Source
+    )
+{
+    for (UINT32 i = 0; i < LAT_HISTO_BUCKET_COUNT; i++) {
+        Dest->buckets[i] += Source->buckets[i];
+    }
+
+    Dest->count += Source->count;
+    Dest->min = min(Dest->min, Source->min);
+    Dest->max = max(Dest->max, Source->max);
+}
+
+VOID
+LatHistoSnapshotInterval(
+    MY_QUEUE *Queue
+    )
+{
+    LAT_HISTOGRAM *interval = Queue->intervalLatHisto;
+    LAT_HISTOGRAM *last = Queue->lastLatHisto;
+
+    //
+    // The data path thread updates the histogram without synchronization, so
+    // derive the interval histogram from bucket deltas only; the count and
+    // bounds are recomputed from the buckets rather than read separately.
+    //
+    interval->count = 0;
+    interval->min = MAXINT64;
+    interval->max = 0;
+
+    for (UINT32 i = 0; i < LAT_HISTO_BUCKET_COUNT; i++) {
+        UINT64 current = ReadULong64NoFence(&Queue->latHisto->buckets[i]);
+
+        interval->buckets[i] = current - last->buckets[i];
+        last->buckets[i] = current;
+
+        if (interval->buckets[i] > 0) {
+            interval->count += interval->buckets[i];
+            interval->min = min(interval->min, (INT64)LatHistoBucketLowest(i));
+            interval->max = (INT64)LatHistoBucketHighest(i);
+        }
+    }
+}
+
+INT64
+LatHistoValueAtPercentile(
+    CONST LAT_HISTOGRAM *Histo,
+    double Percentile
+    )
+{
+    UINT64 target;
+    UINT64 cumulative = 0;
+
+    if (Histo->count == 0) {
+        return 0;
+    }
+
+    target = (UINT64)ceil(Histo->count * Percentile / 100);
+    target = max(target, 1);
+
+    for (UINT32 i = 0; i < LAT_HISTO_BUCKET_COUNT; i++) {
+        cumulative += Histo->buckets[i];
+
+        if (cumulative >= target) {
+            //
+            // Report the highest value equivalent to the bucket, clamped to
+            // the observed range, so tail percentiles are never understated.
+            //
+            INT64 value = (INT64)LatHistoBucketHighest(i);
+            return max(min(value, Histo->max), Histo->min);
+        }
+    }
+
+    return Histo->max;
+}
+
+VOID
+PrintLatHisto(
+    CONST CHAR *QueueName,
+    CONST LAT_HISTOGRAM *Histo
+    )
+{
+    if (Histo->count == 0) {
+        printf("%-3s[%s]: no latency samples\n", modestr, QueueName);
+        return;
+    }
+
+    printf("%-3s[%s]: min=%llu", modestr, QueueName, QpcToUs64(Histo->min, qpcFrequency));
+
+    for (UINT32 i = 0; i < RTL_NUMBER_OF(LatPercentiles); i++) {
+        printf(
+            " %s=%llu", LatPercentileNames[i],
+            QpcToUs64(LatHistoValueAtPercentile(Histo, LatPercentiles[i]), qpcFrequency));
+    }
+
+    printf(
+        " max=%llu us rtt (%llu samples)\n", QpcToUs64(Histo->max, qpcFrequency),
+        Histo->count);
+}
+
+double
+QpcToNs(
+    UINT64 Qpc
+    )
+{
+    return (double)Qpc * 1000000000 / qpcFrequency;
+}
+
+VOID
+WriteLatHistoCsv(
+    FILE *File,
+    CONST CHAR *QueueName,
+    CONST LAT_HISTOGRAM *Histo
+    )
+{
+    for (UINT32 i = 0; i < RTL_NUMBER_OF(LatPercentiles); i++) {
+        fprintf(
+            File, "%s,%s,%s,%llu,%.1f\n", modestr, QueueName, LatPercentileNames[i],
+            Histo->count, QpcToNs(LatHistoValueAtPercentile(Histo, LatPercentiles[i])) / 1000);
+    }
+}
+
+VOID
+WriteLatHistoJson(
+    FILE *File,
+    CONST CHAR *QueueName,
+    CONST LAT_HISTOGRAM *Histo,
+    BOOLEAN Last
+    )
+{
+    BOOLEAN first = TRUE;
+
+    fprintf(File, "    {\n");
+    fprintf(File, "      \"queue\": \"%s\",\n", QueueName);
+    fprintf(File, "      \"count\": %llu,\n", Histo->count);
+    fprintf(File, "      \"min_us\": %.3f,\n", Histo->count ? QpcToNs(Histo->min) / 1000 : 0);
+    fprintf(File, "      \"max_us\": %.3f,\n", QpcToNs(Histo->max) / 1000);
+    fprintf(File, "      \"percentiles_us\": {");
+
+    for (UINT32 i = 0; i < RTL_NUMBER_OF(LatPercentiles); i++) {
+        fprintf(
+            File, "%s\"%s\": %.3f", (i > 0) ? ", " : "", LatPercentileNames[i],
+            QpcToNs(LatHistoValueAtPercentile(Histo, LatPercentiles[i])) / 1000);
+    }
+
+    fprintf(File, "},\n");
+    fprintf(File, "      \"buckets_ns\": [");
+
+    for (UINT32 i = 0; i < LAT_HISTO_BUCKET_COUNT; i++) {
+        if (Histo->buckets[i] == 0) {
+            continue;
+        }
+
+        fprintf(
+            File, "%s[%.1f, %.1f, %llu]", first ? "" : ", ",
+            QpcToNs(LatHistoBucketLowest(i)), QpcToNs(LatHistoBucketHighest(i) + 1),
+            Histo->buckets[i]);
+        first = FALSE;
+    }
+
+    fprintf(File, "]\n");
+    fprintf(File, "    }%s\n", Last ? "" : ",");
+}
+
+VOID
+WriteLatHistoFile(
+    MY_THREAD *Threads,
+    UINT32 ThreadCount,
+    CONST LAT_HISTOGRAM *Total
+    )
+{
+    FILE *file;
+    CHAR queueName[16];
+
+    if (fopen_s(&file, latFile, "w") != 0) {
+        ABORT("Failed to open latency file %s\n", latFile);
+    }
+
+    if (latFormat == LatFormatCsv) {
+        fprintf(file, "mode,queue,percentile,count,latency_us\n");
+    } else {
+        fprintf(file, "{\n");
+        fprintf(file, "  \"mode\": \"%s\",\n", modestr);
+        fprintf(file, "  \"histograms\": [\n");
+    }
+
+    for (UINT32 tIndex = 0; tIndex < ThreadCount; tIndex++) {
+        MY_THREAD *Thread = &Threads[tIndex];
+        for (UINT32 qIndex = 0; qIndex < Thread->queueCount; qIndex++) {
+            MY_QUEUE *queue = &Thread->queues[qIndex];
+
+            sprintf_s(queueName, sizeof(queueName), "%d", queue->queueId);
+
+            if (latFormat == LatFormatCsv) {
+                WriteLatHistoCsv(file, queueName, queue->latHisto);
+            } else {
+                WriteLatHistoJson(file, queueName, queue->latHisto, FALSE);
+            }
+        }
+    }
+
+    if (latFormat == LatFormatCsv) {
+        WriteLatHistoCsv(file, "all", Total);
+    } else {
+        WriteLatHistoJson(file, "all", Total, TRUE);
+        fprintf(file, "  ]\n");
+        fprintf(file, "}\n");
+    }
+
+    fclose(file);
+}
+
 VOID
 ProcessPeriodicStats(
     MY_QUEUE *Queue
@@ -630,6 +1319,14 @@ ProcessPeriodicStats(
 
         Queue->lastPokesRequestedCount = pokesRequested;
         Queue->lastPokesPerformedCount = pokesPerformed;
+
+        if (mode == ModeLat) {
+            CHAR queueName[16];
+
+            sprintf_s(queueName, sizeof(queueName), "%d", Queue->queueId);
+            LatHistoSnapshotInterval(Queue);
+            PrintLatHisto(queueName, Queue->intervalLatHisto);
+        }
     }
 
     Queue->statsArray[Queue->currStatsArrayIdx++ % STATS_ARRAY_SIZE] = kpps;
@@ -637,64 +1334,15 @@ ProcessPeriodicStats(
     Queue->lastTick = currentTick;
 }
 
-INT
-LatCmp(
-    CONST VOID *A,
-    CONST VOID *B
-    )
-{
-    CONST UINT64 *a = A;
-    CONST UINT64 *b = B;
-    return (*a > *b) - (*a < *b);
-}
-
-INT64
-QpcToUs64(
-    INT64 Qpc,
-    INT64 QpcFrequency
-    )
-{
-    //
-    // Multiply by a big number (1000000, to convert seconds to microseconds)
-    // and divide by a big number (QpcFrequency, to convert counts to secs).
-    //
-    // Avoid overflow with separate multiplication/division of the high and low
-    // bits.
-    //
-    // Taken from QuicTimePlatToUs64 (https://github.com/microsoft/msquic).
-    //
-    UINT64 High = (Qpc >> 32) * 1000000;
-    UINT64 Low = (Qpc & 0xFFFFFFFF) * 1000000;
-    return
-        ((High / QpcFrequency) << 32) +
-        ((Low + ((High % QpcFrequency) << 32)) / QpcFrequency);
-}
-
 VOID
 PrintFinalLatStats(
     MY_QUEUE *Queue
     )
 {
-    LARGE_INTEGER FreqQpc;
-    VERIFY(QueryPerformanceFrequency(&FreqQpc));
+    CHAR queueName[16];
 
-    qsort(Queue->latSamples, Queue->latIndex, sizeof(*Queue->latSamples), LatCmp);
-
-    for (UINT32 i = 0; i < Queue->latIndex; i++) {
-        Queue->latSamples[i] = QpcToUs64(Queue->latSamples[i], FreqQpc.QuadPart);
-    }
-
-    printf(
-        "%-3s[%d]: min=%llu P50=%llu P90=%llu P99=%llu P99.9=%llu P99.99=%llu P99.999=%llu P99.9999=%llu us rtt\n",
-        modestr, Queue->queueId,
-        Queue->latSamples[0],
-        Queue->latSamples[(UINT32)(Queue->latIndex * 0.5)],
-        Queue->latSamples[(UINT32)(Queue->latIndex * 0.9)],
-        Queue->latSamples[(UINT32)(Queue->latIndex * 0.99)],
-        Queue->latSamples[(UINT32)(Queue->latIndex * 0.999)],
-        Queue->latSamples[(UINT32)(Queue->latIndex * 0.9999)],
-        Queue->latSamples[(UINT32)(Queue->latIndex * 0.99999)],
-        Queue->latSamples[(UINT32)(Queue->latIndex * 0.999999)]);
+    sprintf_s(queueName, sizeof(queueName), "%d", Queue->queueId);
+    PrintLatHisto(queueName, Queue->latHisto);
 }
 
 VOID
@@ -795,9 +1443,16 @@ NotifyDriver(
 
     if (DirectionFlags != 0) {
         Queue->pokesPerformedCount++;
-        res =
-            XdpApi->XskNotifySocket(
-                Queue->sock, DirectionFlags, WAIT_DRIVER_TIMEOUT_MS, &notifyResult);
+        if (Queue->waitTimeoutUs > 0 &&
+            (DirectionFlags & (XSK_NOTIFY_FLAG_WAIT_RX | XSK_NOTIFY_FLAG_WAIT_TX))) {
+            res =
+                XskNotifySocketPrecise(
+                    Queue->sock, DirectionFlags, Queue->waitTimeoutUs, &notifyResult);
+        } else {
+            res =
+                XdpApi->XskNotifySocket(
+                    Queue->sock, DirectionFlags, WAIT_DRIVER_TIMEOUT_MS, &notifyResult);
+        }
 
         if (DirectionFlags & (XSK_NOTIFY_FLAG_WAIT_RX | XSK_NOTIFY_FLAG_WAIT_TX)) {
             ASSERT_FRE(res == S_OK || res == HRESULT_FROM_WIN32(ERROR_TIMEOUT));
@@ -945,9 +1600,30 @@ WriteTxPackets(
         txDesc->Address.BaseAddress = *freeDesc;
         assert(Queue->umemReg.Headroom <= MAXUINT16);
         txDesc->Address.Offset = (UINT16)Queue->umemReg.Headroom;
-        txDesc->Length = Queue->txiosize;
+
+        if (Queue->txChunkLengths != NULL) {
+            txDesc->Length = Queue->txChunkLengths[*freeDesc / Queue->umemchunksize];
+        } else if (Queue->txSizeCount > 0) {
+            txDesc->Length = Queue->txSizes[Queue->txSizeIndex];
+
+            if (++Queue->txSizeIndex == Queue->txSizeCount) {
+                Queue->txSizeIndex = 0;
+            }
+        } else {
+            txDesc->Length = Queue->txiosize;
+        }
+
+        if (Queue->txSizeCount > 0 || Queue->txFlowCount > 1) {
+            WriteTxFrameHeaders(
+                Queue,
+                (UCHAR *)Queue->umemReg.Address + txDesc->Address.BaseAddress +
+                    txDesc->Address.Offset,
+                txDesc->Length);
+        }
+
         //
-        // This benchmark does not write data into the TX packet.
+        // Other than the headers above, this benchmark does not write data
+        // into the TX packet.
         //
         printf_verbose("Producing TX entry {address:%llu, offset:%llu, length:%d}\n",
             txDesc->Address.BaseAddress, txDesc->Address.Offset, txDesc->Length);
@@ -1260,9 +1936,7 @@ ProcessLat(
 
             printf_verbose("latency: %lld\n", NowQpc.QuadPart - *Timestamp);
 
-            if (Queue->latIndex < Queue->latSamplesCount) {
-                Queue->latSamples[Queue->latIndex++] = NowQpc.QuadPart - *Timestamp;
-            }
+            LatHistoRecord(Queue->latHisto, NowQpc.QuadPart - *Timestamp);
 
             *fillDesc = rxDesc->Address.BaseAddress;
 
@@ -1421,7 +2095,7 @@ ParseQueueArgs(
     Queue->pollMode = XSK_POLL_MODE_DEFAULT;
     Queue->flags.optimizePoking = TRUE;
     Queue->txiosize = DEFAULT_TX_IO_SIZE;
-    Queue->latSamplesCount = DEFAULT_LAT_COUNT;
+    Queue->txFlowCount = DEFAULT_TX_FLOW_COUNT;
 
     for (INT i = 0; i < argc; i++) {
         if (!_stricmp(argv[i], "-id")) {
@@ -1476,6 +2150,11 @@ ParseQueueArgs(
             } else {
                 Usage();
             }
+        } else if (!_stricmp(argv[i], "-tx_doorbell")) {
+            if (++i >= argc) {
+                Usage();
+            }
+            Queue->txDoorbellIdleTimeoutMs = atoi(argv[i]);
         } else if (!_stricmp(argv[i], "-xdp_mode")) {
             if (++i >= argc) {
                 Usage();
@@ -1503,11 +2182,22 @@ ParseQueueArgs(
             Queue->txPattern = malloc(Queue->txPatternLength);
             ASSERT_FRE(Queue->txPattern != NULL);
             GetDescriptorPattern(Queue->txPattern, Queue->txPatternLength, argv[i]);
-        } else if (!strcmp(argv[i], "-lat_count")) {
+        } else if (!strcmp(argv[i], "-tx_imix")) {
+            if (++i >= argc) {
+                Usage();
+            }
+            ParseTxImix(Queue, argv[i]);
+        } else if (!strcmp(argv[i], "-tx_flows")) {
             if (++i >= argc) {
                 Usage();
             }
-            Queue->latSamplesCount = atoi(argv[i]);
+            Queue->txFlowCount = atoi(argv[i]);
+            ASSERT_FRE(Queue->txFlowCount > 0 && Queue->txFlowCount <= MAXUINT16);
+        } else if (!strcmp(argv[i], "-tx_pcap")) {
+            if (++i >= argc) {
+                Usage();
+            }
+            Queue->txPcapFile = argv[i];
         } else {
             Usage();
         }
@@ -1525,13 +2215,33 @@ ParseQueueArgs(
     ASSERT_FRE(Queue->umemchunksize >= Queue->umemheadroom);
     ASSERT_FRE(Queue->umemchunksize - Queue->umemheadroom >= Queue->txPatternLength);
 
+    if (Queue->txPcapFile != NULL) {
+        ASSERT_FRE(mode == ModeTx);
+        ASSERT_FRE(Queue->txPattern == NULL && Queue->txSizeCount == 0);
+        ASSERT_FRE(Queue->txFlowCount == 1);
+    }
+
+    if (Queue->txSizeCount > 0 || Queue->txFlowCount > 1) {
+        ASSERT_FRE(mode == ModeTx);
+        ParseTxPatternHeaders(Queue);
+
+        for (UINT32 i = 0; i < Queue->txSizeCount; i++) {
+            ASSERT_FRE(Queue->txSizes[i] >= Queue->txPatternLength);
+            ASSERT_FRE(Queue->txSizes[i] <= Queue->umemchunksize - Queue->umemheadroom);
+        }
+
+        if (Queue->txSizeCount == 0) {
+            ASSERT_FRE(Queue->txiosize >= Queue->txPatternLength);
+        }
+    }
+
     if (mode == ModeLat) {
         ASSERT_FRE(
             Queue->umemchunksize - Queue->umemheadroom >= Queue->txPatternLength + sizeof(UINT64));
 
-        Queue->latSamples = malloc(Queue->latSamplesCount * sizeof(*Queue->latSamples));
-        ASSERT_FRE(Queue->latSamples != NULL);
-        ZeroMemory(Queue->latSamples, Queue->latSamplesCount * sizeof(*Queue->latSamples));
+        Queue->latHisto = LatHistoAllocate();
+        Queue->lastLatHisto = LatHistoAllocate();
+        Queue->intervalLatHisto = LatHistoAllocate();
     }
 }
 
@@ -1546,6 +2256,7 @@ ParseThreadArgs(
     BOOLEAN cpuAffinitySet = FALSE;
 
     Thread->wait = FALSE;
+    Thread->waitTimeoutUs = 0;
     Thread->nodeAffinity = DEFAULT_NODE_AFFINITY;
     Thread->idealCpu = DEFAULT_IDEAL_CPU;
     Thread->cpuAffinity = DEFAULT_CPU_AFFINITY;
@@ -1579,6 +2290,12 @@ ParseThreadArgs(
             cpuAffinitySet = TRUE;
         } else if (!strcmp(argv[i], "-w")) {
             Thread->wait = TRUE;
+        } else if (!_stricmp(argv[i], "-wait_us")) {
+            if (++i >= argc) {
+                Usage();
+            }
+            Thread->waitTimeoutUs = atoi(argv[i]);
+            Thread->wait = TRUE;
         } else if (!_stricmp(argv[i], "-yield")) {
             if (++i >= argc) {
                 Usage();
@@ -1616,6 +2333,10 @@ ParseThreadArgs(
         }
     }
     ParseQueueArgs(&Thread->queues[qIndex++], argc - qStart, &argv[qStart]);
+
+    for (UINT32 i = 0; i < Thread->queueCount; i++) {
+        Thread->queues[i].waitTimeoutUs = Thread->waitTimeoutUs;
+    }
 }
 
 VOID
@@ -1671,6 +2392,22 @@ ParseArgs(
         } else if (!_stricmp(argv[i], "-lp")) {
             largePages = TRUE;
             EnableLargePages();
+        } else if (!_stricmp(argv[i], "-lat_file")) {
+            if (++i >= argc) {
+                Usage();
+            }
+            latFile = argv[i];
+        } else if (!_stricmp(argv[i], "-lat_format")) {
+            if (++i >= argc) {
+                Usage();
+            }
+            if (!_stricmp(argv[i], "csv")) {
+                latFormat = LatFormatCsv;
+            } else if (!_stricmp(argv[i], "json")) {
+                latFormat = LatFormatJson;
+            } else {
+                Usage();
+            }
         } else if (threadCount == 0) {
             Usage();
         }
@@ -1801,11 +2538,28 @@ main(
 {
     MY_THREAD *threads;
     UINT32 threadCount;
+    LARGE_INTEGER freqQpc;
+
+    VERIFY(QueryPerformanceFrequency(&freqQpc));
+    qpcFrequency = freqQpc.QuadPart;
 
     ParseArgs(&threads, &threadCount, argc, argv);
 
     ASSERT_FRE(SUCCEEDED(XdpOpenApi(XDP_API_VERSION_1, &XdpApi)));
 
+    //
+    // Only require the experimental precise notify routine if -wait_us is used.
+    //
+    for (UINT32 tIndex = 0; tIndex < threadCount; tIndex++) {
+        if (threads[tIndex].waitTimeoutUs > 0) {
+            XskNotifySocketPrecise =
+                (XSK_NOTIFY_SOCKET_PRECISE_FN *)
+                    XdpApi->XdpGetRoutine(XSK_NOTIFY_SOCKET_PRECISE_FN_NAME);
+            ASSERT_FRE(XskNotifySocketPrecise != NULL);
+            break;
+        }
+    }
+
     periodicStatsEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
     ASSERT_FRE(periodicStatsEvent != NULL);
 
@@ -1840,6 +2594,28 @@ main(
         }
     }
 
+    if (mode == ModeLat) {
+        //
+        // Merge the per-queue histograms into a single distribution.
+        //
+        LAT_HISTOGRAM *totalLatHisto = LatHistoAllocate();
+
+        for (UINT32 tIndex = 0; tIndex < threadCount; tIndex++) {
+            MY_THREAD *Thread = &threads[tIndex];
+            for (UINT32 qIndex = 0; qIndex < Thread->queueCount; qIndex++) {
+                LatHistoMerge(totalLatHisto, Thread->queues[qIndex].latHisto);
+            }
+        }
+
+        PrintLatHisto("all", totalLatHisto);
+
+        if (latFile != NULL) {
+            WriteLatHistoFile(threads, threadCount, totalLatHisto);
+        }
+
+        free(totalLatHisto);
+    }
+
     XdpCloseApi(XdpApi);
 
     return 0;
@@ -0,0 +1,633 @@
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+
+//
+// This application attaches an XSK capture tap to an XDP queue and writes the
+// sampled frames, along with their XDP verdicts and matching rule indices, to
+// a pcapng file. The tap is detached when the application exits.
+//
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <afxdp_helper.h>
+#include <afxdp_experimental.h>
+#include <xdpapi.h>
+
+#define DEFAULT_QUEUE_ID 0
+#define DEFAULT_SAMPLE_INTERVAL 1
+#define DEFAULT_SNAP_LENGTH 128
+#define DEFAULT_RING_SIZE 256
+#define DEFAULT_CHUNK_SIZE 2048
+#define WAIT_TIMEOUT_MS 1000
+
+#define PCAPNG_BLOCK_TYPE_SHB 0x0A0D0D0A
+#define PCAPNG_BLOCK_TYPE_IDB 0x00000001
+#define PCAPNG_BLOCK_TYPE_EPB 0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4D
+#define PCAPNG_LINKTYPE_ETHERNET 1
+#define PCAPNG_OPT_ENDOFOPT 0
+#define PCAPNG_OPT_COMMENT 1
+#define PCAPNG_OPT_EPB_FLAGS 2
+#define PCAPNG_EPB_FLAG_INBOUND 0x1
+#define PCAPNG_EPB_FLAG_OUTBOUND 0x2
+#define PCAPNG_COMMENT_MAX_LENGTH 64
+
+#define ALIGN_DOWN_BY(length, alignment) \
+    ((ULONG_PTR)(length)& ~(alignment - 1))
+#define ALIGN_UP_BY(length, alignment) \
+    (ALIGN_DOWN_BY(((ULONG_PTR)(length)+alignment - 1), alignment))
+
+//
+// The offset between the FILETIME and UNIX epochs, in 100ns units.
+//
+#define FILETIME_UNIX_EPOCH_OFFSET 116444736000000000ULL
+
+CONST CHAR *UsageText =
+"Usage: xskcap -IfIndex <ifindex> -File <path> [OPTIONS]"
+"\n"
+"\nCaptures a sample of the frames inspected by the XDP program on a queue"
+"\ninto a pcapng file until Ctrl+C is pressed or the duration elapses."
+"\n"
+"\nOPTIONS:"
+"\n   -QueueId <queueid>  The queue to capture. Default: 0"
+"\n   -Hook <rx|tx>       The inspection hook to capture. Default: rx"
+"\n   -Sample <K>         Capture one in every K frames. Default: 1"
+"\n   -SnapLen <N>        Capture at most the first N bytes of each frame."
+"\n                       Default: 128"
+"\n   -RingSize <N>       The number of capture buffers. Must be a power of two."
+"\n                       Default: 256"
+"\n   -Mode <mode>        The XDP interface mode. Default: system"
+"\n                       system:  Let the system decide the mode"
+"\n                       generic: Use generic XDP"
+"\n                       native:  Use native XDP"
+"\n   -Duration <sec>     Stop after the given number of seconds."
+"\n                       Default: infinite"
+"\n";
+
+typedef struct _PCAPNG_EPB_OPTIONS {
+    UINT16 FlagsCode;
+    UINT16 FlagsLength;
+    UINT32 Flags;
+    UINT16 CommentCode;
+    UINT16 CommentLength;
+
+    //
+    // Followed by the zeroed end-of-options option.
+    //
+    CHAR Comment[PCAPNG_COMMENT_MAX_LENGTH + sizeof(UINT32)];
+} PCAPNG_EPB_OPTIONS;
+
+CONST XDP_API_TABLE *XdpApi;
+HANDLE StopEvent;
+
+typedef struct _CAPTURE {
+    UINT32 IfIndex;
+    UINT32 QueueId;
+    XDP_HOOK_DIRECTION Direction;
+    UINT32 SampleInterval;
+    UINT32 SnapLength;
+    UINT32 RingSize;
+    UINT32 BindFlags;
+    UINT32 DurationSeconds;
+    CONST CHAR *FileName;
+
+    HANDLE Socket;
+    XSK_UMEM_REG UmemReg;
+    XSK_RING RxRing;
+    XSK_RING FillRing;
+    FILE *File;
+
+    LARGE_INTEGER QpcFrequency;
+    LARGE_INTEGER QpcBase;
+    UINT64 UnixMicrosecondsBase;
+    UINT64 FramesCaptured;
+} CAPTURE;
+
+VOID
+Usage(
+    _In_ CONST CHAR *Error
+    )
+{
+    fprintf(stderr, "Error: %s\n%s", Error, UsageText);
+    exit(1);
+}
+
+BOOL
+WINAPI
+ConsoleCtrlHandler(
+    _In_ DWORD CtrlType
+    )
+{
+    UNREFERENCED_PARAMETER(CtrlType);
+
+    SetEvent(StopEvent);
+    return TRUE;
+}
+
+CONST CHAR *
+ActionToString(
+    _In_ UINT8 Action
+    )
+{
+    switch (Action) {
+    case XDP_RX_ACTION_DROP:
+        return "drop";
+    case XDP_RX_ACTION_PASS:
+        return "pass";
+    case XDP_RX_ACTION_TX:
+        return "tx";
+    default:
+        return "unknown";
+    }
+}
+
+VOID
+WriteBlock(
+    _In_ CAPTURE *Capture,
+    _In_ UINT32 BlockType,
+    _In_reads_bytes_(BodyLength) CONST VOID *Body,
+    _In_ UINT32 BodyLength,
+    _In_reads_bytes_opt_(DataLength) CONST VOID *Data,
+    _In_ UINT32 DataLength,
+    _In_reads_bytes_opt_(OptionsLength) CONST VOID *Options,
+    _In_ UINT32 OptionsLength
+    )
+{
+    CONST UINT32 Padding = 0;
+    UINT32 DataPadding = (UINT32)(ALIGN_UP_BY(DataLength, sizeof(UINT32)) - DataLength);
+    UINT32 BlockLength =
+        3 * sizeof(UINT32) + BodyLength + DataLength + DataPadding + OptionsLength;
+
+    //
+    // Every block is framed by its type and total length, and the total length
+    // is repeated at the end of the block.
+    //
+    fwrite(&BlockType, sizeof(BlockType), 1, Capture->File);
+    fwrite(&BlockLength, sizeof(BlockLength), 1, Capture->File);
+    fwrite(Body, BodyLength, 1, Capture->File);
+
+    if (DataLength > 0) {
+        fwrite(Data, DataLength, 1, Capture->File);
+        fwrite(&Padding, DataPadding, 1, Capture->File);
+    }
+
+    if (OptionsLength > 0) {
+        fwrite(Options, OptionsLength, 1, Capture->File);
+    }
+
+    fwrite(&BlockLength, sizeof(BlockLength), 1, Capture->File);
+}
+
+VOID
+WriteFileHeader(
+    _In_ CAPTURE *Capture
+    )
+{
+    struct {
+        UINT32 ByteOrderMagic;
+        UINT16 MajorVersion;
+        UINT16 MinorVersion;
+        INT64 SectionLength;
+    } Shb = {0};
+    struct {
+        UINT16 LinkType;
+        UINT16 Reserved;
+        UINT32 SnapLength;
+    } Idb = {0};
+
+    Shb.ByteOrderMagic = PCAPNG_BYTE_ORDER_MAGIC;
+    Shb.MajorVersion = 1;
+    Shb.MinorVersion = 0;
+    Shb.SectionLength = -1;
+    WriteBlock(Capture, PCAPNG_BLOCK_TYPE_SHB, &Shb, sizeof(Shb), NULL, 0, NULL, 0);
+
+    //
+    // A single interface with the default microsecond timestamp resolution.
+    //
+    Idb.LinkType = PCAPNG_LINKTYPE_ETHERNET;
+    Idb.SnapLength = Capture->SnapLength;
+    WriteBlock(Capture, PCAPNG_BLOCK_TYPE_IDB, &Idb, sizeof(Idb), NULL, 0, NULL, 0);
+}
+
+VOID
+WriteFrame(
+    _In_ CAPTURE *Capture,
+    _In_ CONST XSK_CAPTURE_HEADER *Header,
+    _In_reads_bytes_(Header->CaptureLength) CONST UCHAR *Data
+    )
+{
+    struct {
+        UINT32 InterfaceId;
+        UINT32 TimestampHigh;
+        UINT32 TimestampLow;
+        UINT32 CapturedLength;
+        UINT32 OriginalLength;
+    } Epb = {0};
+    PCAPNG_EPB_OPTIONS Options = {0};
+    UINT32 OptionsLength;
+    UINT64 Timestamp;
+    INT CommentLength;
+
+    //
+    // Translate the performance counter into UNIX time in microseconds.
+    //
+    Timestamp =
+        Capture->UnixMicrosecondsBase +
+        (UINT64)((Header->Timestamp - Capture->QpcBase.QuadPart) * 1000000.0 /
+            Capture->QpcFrequency.QuadPart);
+
+    Epb.TimestampHigh = (UINT32)(Timestamp >> 32);
+    Epb.TimestampLow = (UINT32)Timestamp;
+    Epb.CapturedLength = Header->CaptureLength;
+    Epb.OriginalLength = Header->FrameLength;
+
+    Options.FlagsCode = PCAPNG_OPT_EPB_FLAGS;
+    Options.FlagsLength = sizeof(Options.Flags);
+    Options.Flags =
+        (Capture->Direction == XDP_HOOK_RX) ? PCAPNG_EPB_FLAG_INBOUND : PCAPNG_EPB_FLAG_OUTBOUND;
+
+    Options.CommentCode = PCAPNG_OPT_COMMENT;
+    if (Header->RuleIndex == XSK_CAPTURE_RULE_INDEX_NONE) {
+        CommentLength =
+            sprintf_s(
+                Options.Comment, PCAPNG_COMMENT_MAX_LENGTH, "action=%s",
+                ActionToString(Header->Action));
+    } else {
+        CommentLength =
+            sprintf_s(
+                Options.Comment, PCAPNG_COMMENT_MAX_LENGTH, "action=%s rule=%u",
+                ActionToString(Header->Action), Header->RuleIndex);
+    }
+    Options.CommentLength = (UINT16)CommentLength;
+
+    //
+    // Option values are padded to 32 bits and the list ends with an empty
+    // end-of-options option, which is already zeroed.
+    //
+    OptionsLength =
+        (UINT32)(FIELD_OFFSET(PCAPNG_EPB_OPTIONS, Comment) +
+            ALIGN_UP_BY(CommentLength, sizeof(UINT32)) + sizeof(UINT32));
+
+    WriteBlock(
+        Capture, PCAPNG_BLOCK_TYPE_EPB, &Epb, sizeof(Epb), Data, Header->CaptureLength,
+        &Options, OptionsLength);
+}
+
+VOID
+ParseArgs(
+    _Inout_ CAPTURE *Capture,
+    _In_ INT ArgC,
+    _In_ CHAR **ArgV
+    )
+{
+    Capture->IfIndex = MAXUINT32;
+    Capture->QueueId = DEFAULT_QUEUE_ID;
+    Capture->Direction = XDP_HOOK_RX;
+    Capture->SampleInterval = DEFAULT_SAMPLE_INTERVAL;
+    Capture->SnapLength = DEFAULT_SNAP_LENGTH;
+    Capture->RingSize = DEFAULT_RING_SIZE;
+
+    for (INT i = 1; i < ArgC; i++) {
+        if (i + 1 == ArgC) {
+            Usage("Missing option value");
+        }
+
+        if (!_stricmp(ArgV[i], "-IfIndex")) {
+            Capture->IfIndex = atoi(ArgV[++i]);
+        } else if (!_stricmp(ArgV[i], "-QueueId")) {
+            Capture->QueueId = atoi(ArgV[++i]);
+        } else if (!_stricmp(ArgV[i], "-File")) {
+            Capture->FileName = ArgV[++i];
+        } else if (!_stricmp(ArgV[i], "-Hook")) {
+            ++i;
+            if (!_stricmp(ArgV[i], "rx")) {
+                Capture->Direction = XDP_HOOK_RX;
+            } else if (!_stricmp(ArgV[i], "tx")) {
+                Capture->Direction = XDP_HOOK_TX;
+            } else {
+                Usage("Invalid hook");
+            }
+        } else if (!_stricmp(ArgV[i], "-Sample")) {
+            Capture->SampleInterval = atoi(ArgV[++i]);
+        } else if (!_stricmp(ArgV[i], "-SnapLen")) {
+            Capture->SnapLength = atoi(ArgV[++i]);
+        } else if (!_stricmp(ArgV[i], "-RingSize")) {
+            Capture->RingSize = atoi(ArgV[++i]);
+        } else if (!_stricmp(ArgV[i], "-Mode")) {
+            ++i;
+            if (!_stricmp(ArgV[i], "system")) {
+                Capture->BindFlags = 0;
+            } else if (!_stricmp(ArgV[i], "generic")) {
+                Capture->BindFlags = XSK_BIND_FLAG_GENERIC;
+            } else if (!_stricmp(ArgV[i], "native")) {
+                Capture->BindFlags = XSK_BIND_FLAG_NATIVE;
+            } else {
+                Usage("Invalid mode");
+            }
+        } else if (!_stricmp(ArgV[i], "-Duration")) {
+            Capture->DurationSeconds = atoi(ArgV[++i]);
+        } else {
+            Usage("Invalid option");
+        }
+    }
+
+    if (Capture->IfIndex == MAXUINT32) {
+        Usage("Missing IfIndex");
+    }
+    if (Capture->FileName == NULL) {
+        Usage("Missing File");
+    }
+    if (Capture->SampleInterval == 0 || Capture->SnapLength == 0) {
+        Usage("Sample and SnapLen must be non-zero");
+    }
+    if (Capture->RingSize == 0 || (Capture->RingSize & (Capture->RingSize - 1)) != 0) {
+        Usage("RingSize must be a power of two");
+    }
+}
+
+HRESULT
+SetupSocket(
+    _Inout_ CAPTURE *Capture
+    )
+{
+    HRESULT Result;
+    XSK_CAPTURE_CONFIG Config = {0};
+    XDP_HOOK_ID HookId = {0};
+    XSK_RING_INFO_SET InfoSet = {0};
+    UINT32 InfoSetSize = sizeof(InfoSet);
+    UINT32 ChunkSize = DEFAULT_CHUNK_SIZE;
+    UINT32 FillIndex;
+
+    Result = XdpApi->XskCreate(&Capture->Socket);
+    if (FAILED(Result)) {
+        fprintf(stderr, "XskCreate failed: %x\n", Result);
+        goto Exit;
+    }
+
+    //
+    // Each capture buffer holds a capture header and the captured bytes.
+    //
+    while (ChunkSize < sizeof(XSK_CAPTURE_HEADER) + Capture->SnapLength) {
+        ChunkSize *= 2;
+    }
+
+    Capture->UmemReg.ChunkSize = ChunkSize;
+    Capture->UmemReg.TotalSize = (UINT64)ChunkSize * Capture->RingSize;
+    Capture->UmemReg.Address =
+        VirtualAlloc(NULL, Capture->UmemReg.TotalSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (Capture->UmemReg.Address == NULL) {
+        Result = HRESULT_FROM_WIN32(GetLastError());
+        fprintf(stderr, "VirtualAlloc failed: %x\n", Result);
+        goto Exit;
+    }
+
+    Result =
+        XdpApi->XskSetSockopt(
+            Capture->Socket, XSK_SOCKOPT_UMEM_REG, &Capture->UmemReg, sizeof(Capture->UmemReg));
+    if (FAILED(Result)) {
+        fprintf(stderr, "XSK_SOCKOPT_UMEM_REG failed: %x\n", Result);
+        goto Exit;
+    }
+
+    Result =
+        XdpApi->XskSetSockopt(
+            Capture->Socket, XSK_SOCKOPT_RX_RING_SIZE, &Capture->RingSize,
+            sizeof(Capture->RingSize));
+    if (FAILED(Result)) {
+        fprintf(stderr, "XSK_SOCKOPT_RX_RING_SIZE failed: %x\n", Result);
+        goto Exit;
+    }
+
+    Result =
+        XdpApi->XskSetSockopt(
+            Capture->Socket, XSK_SOCKOPT_RX_FILL_RING_SIZE, &Capture->RingSize,
+            sizeof(Capture->RingSize));
+    if (FAILED(Result)) {
+        fprintf(stderr, "XSK_SOCKOPT_RX_FILL_RING_SIZE failed: %x\n", Result);
+        goto Exit;
+    }
+
+    HookId.Layer = XDP_HOOK_L2;
+    HookId.Direction = Capture->Direction;
+    HookId.SubLayer = XDP_HOOK_INSPECT;
+    Result =
+        XdpApi->XskSetSockopt(Capture->Socket, XSK_SOCKOPT_RX_HOOK_ID, &HookId, sizeof(HookId));
+    if (FAILED(Result)) {
+        fprintf(stderr, "XSK_SOCKOPT_RX_HOOK_ID failed: %x\n", Result);
+        goto Exit;
+    }
+
+    Config.Header.Revision = XSK_CAPTURE_CONFIG_REVISION_1;
+    Config.Header.Size = XSK_SIZEOF_CAPTURE_CONFIG_REVISION_1;
+    Config.SampleInterval = Capture->SampleInterval;
+    Config.SnapLength = Capture->SnapLength;
+    Result = XdpApi->XskSetSockopt(Capture->Socket, XSK_SOCKOPT_CAPTURE, &Config, sizeof(Config));
+    if (FAILED(Result)) {
+        fprintf(stderr, "XSK_SOCKOPT_CAPTURE failed: %x\n", Result);
+        goto Exit;
+    }
+
+    Result =
+        XdpApi->XskBind(
+            Capture->Socket, Capture->IfIndex, Capture->QueueId,
+            XSK_BIND_FLAG_RX | Capture->BindFlags);
+    if (FAILED(Result)) {
+        fprintf(stderr, "XskBind failed: %x\n", Result);
+        goto Exit;
+    }
+
+    Result = XdpApi->XskActivate(Capture->Socket, 0);
+    if (FAILED(Result)) {
+        fprintf(stderr, "XskActivate failed: %x\n", Result);
+        goto Exit;
+    }
+
+    Result =
+        XdpApi->XskGetSockopt(Capture->Socket, XSK_SOCKOPT_RING_INFO, &InfoSet, &InfoSetSize);
+    if (FAILED(Result)) {
+        fprintf(stderr, "XSK_SOCKOPT_RING_INFO failed: %x\n", Result);
+        goto Exit;
+    }
+
+    XskRingInitialize(&Capture->RxRing, &InfoSet.Rx);
+    XskRingInitialize(&Capture->FillRing, &InfoSet.Fill);
+
+    //
+    // The fill ring is as large as the UMEM, so every buffer starts out posted
+    // and each consumed RX descriptor can be returned to the fill ring as is.
+    //
+    if (XskRingProducerReserve(&Capture->FillRing, Capture->RingSize, &FillIndex) !=
+            Capture->RingSize) {
+        Result = E_UNEXPECTED;
+        goto Exit;
+    }
+
+    for (UINT32 i = 0; i < Capture->RingSize; i++) {
+        *(UINT64 *)XskRingGetElement(&Capture->FillRing, FillIndex++) = (UINT64)i * ChunkSize;
+    }
+
+    XskRingProducerSubmit(&Capture->FillRing, Capture->RingSize);
+
+Exit:
+
+    return Result;
+}
+
+VOID
+CaptureLoop(
+    _Inout_ CAPTURE *Capture
+    )
+{
+    ULONGLONG EndTime = MAXULONGLONG;
+
+    if (Capture->DurationSeconds != 0) {
+        EndTime = GetTickCount64() + Capture->DurationSeconds * 1000ULL;
+    }
+
+    while (WaitForSingleObject(StopEvent, 0) == WAIT_TIMEOUT && GetTickCount64() < EndTime) {
+        XSK_NOTIFY_FLAGS NotifyFlags = XSK_NOTIFY_FLAG_WAIT_RX;
+        XSK_NOTIFY_RESULT_FLAGS NotifyResult;
+        UINT32 RxIndex;
+        UINT32 FillIndex;
+        UINT32 Count;
+        HRESULT Result;
+
+        Count = XskRingConsumerReserve(&Capture->RxRing, MAXUINT32, &RxIndex);
+
+        if (Count == 0) {
+            if (XskRingError(&Capture->RxRing)) {
+                fprintf(stderr, "The capture socket was detached\n");
+                break;
+            }
+
+            if (XskRingProducerNeedPoke(&Capture->FillRing)) {
+                NotifyFlags |= XSK_NOTIFY_FLAG_POKE_RX;
+            }
+
+            Result =
+                XdpApi->XskNotifySocket(
+                    Capture->Socket, NotifyFlags, WAIT_TIMEOUT_MS, &NotifyResult);
+            if (FAILED(Result) && Result != HRESULT_FROM_WIN32(ERROR_TIMEOUT)) {
+                fprintf(stderr, "XskNotifySocket failed: %x\n", Result);
+                break;
+            }
+
+            continue;
+        }
+
+        XskRingProducerReserve(&Capture->FillRing, Count, &FillIndex);
+
+        for (UINT32 i = 0; i < Count; i++) {
+            XSK_BUFFER_DESCRIPTOR *Buffer = XskRingGetElement(&Capture->RxRing, RxIndex++);
+            UCHAR *Data =
+                (UCHAR *)Capture->UmemReg.Address + Buffer->Address.BaseAddress +
+                    Buffer->Address.Offset;
+            XSK_CAPTURE_HEADER Header;
+
+            if (Buffer->Length >= sizeof(Header)) {
+                memcpy(&Header, Data, sizeof(Header));
+                WriteFrame(Capture, &Header, Data + sizeof(Header));
+                Capture->FramesCaptured++;
+            }
+
+            *(UINT64 *)XskRingGetElement(&Capture->FillRing, FillIndex++) =
+                Buffer->Address.BaseAddress;
+        }
+
+        XskRingConsumerRelease(&Capture->RxRing, Count);
+        XskRingProducerSubmit(&Capture->FillRing, Count);
+    }
+}
+
+INT
+__cdecl
+main(
+    INT ArgC,
+    CHAR **ArgV
+    )
+{
+    CAPTURE Capture = {0};
+    XSK_STATISTICS Statistics = {0};
+    UINT32 StatisticsSize = sizeof(Statistics);
+    FILETIME SystemTime;
+    HRESULT Result;
+    INT Err = 1;
+
+    ParseArgs(&Capture, ArgC, ArgV);
+
+    StopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (StopEvent == NULL || !SetConsoleCtrlHandler(ConsoleCtrlHandler, TRUE)) {
+        fprintf(stderr, "Failed to set up the console handler\n");
+        goto Exit;
+    }
+
+    Result = XdpOpenApi(XDP_API_VERSION_1, &XdpApi);
+    if (FAILED(Result)) {
+        fprintf(stderr, "XdpOpenApi failed: %x\n", Result);
+        goto Exit;
+    }
+
+    if (fopen_s(&Capture.File, Capture.FileName, "wb") != 0) {
+        fprintf(stderr, "Failed to open %s\n", Capture.FileName);
+        goto Exit;
+    }
+
+    //
+    // Correlate the performance counter with wall clock time once; capture
+    // headers carry performance counter timestamps.
+    //
+    QueryPerformanceFrequency(&Capture.QpcFrequency);
+    QueryPerformanceCounter(&Capture.QpcBase);
+    GetSystemTimePreciseAsFileTime(&SystemTime);
+    Capture.UnixMicrosecondsBase =
+        ((((UINT64)SystemTime.dwHighDateTime) << 32 | SystemTime.dwLowDateTime) -
+            FILETIME_UNIX_EPOCH_OFFSET) / 10;
+
+    WriteFileHeader(&Capture);
+
+    Result = SetupSocket(&Capture);
+    if (FAILED(Result)) {
+        goto Exit;
+    }
+
+    printf(
+        "Capturing 1 in %u frames on IfIndex %u QueueId %u to %s\n",
+        Capture.SampleInterval, Capture.IfIndex, Capture.QueueId, Capture.FileName);
+
+    CaptureLoop(&Capture);
+
+    Result =
+        XdpApi->XskGetSockopt(
+            Capture.Socket, XSK_SOCKOPT_STATISTICS, &Statistics, &StatisticsSize);
+    if (SUCCEEDED(Result)) {
+        printf(
+            "Captured %llu frames, dropped %llu\n",
+            Capture.FramesCaptured, Statistics.RxDropped);
+    }
+
+    Err = 0;
+
+Exit:
+
+    if (Capture.Socket != NULL) {
+        CloseHandle(Capture.Socket);
+    }
+    if (Capture.UmemReg.Address != NULL) {
+        VirtualFree(Capture.UmemReg.Address, 0, MEM_RELEASE);
+    }
+    if (Capture.File != NULL) {
+        fclose(Capture.File);
+    }
+    if (XdpApi != NULL) {
+        XdpCloseApi(XdpApi);
+    }
+    if (StopEvent != NULL) {
+        CloseHandle(StopEvent);
+    }
+
+    return Err;
+}
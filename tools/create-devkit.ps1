@@ -35,6 +35,7 @@ copy "artifacts\bin\$($Platform)_$($Config)\pktcmd.exe" $DstPath\bin
 copy "artifacts\bin\$($Platform)_$($Config)\rxfilter.exe" $DstPath\bin
 copy "artifacts\bin\$($Platform)_$($Config)\xdpcfg.exe" $DstPath\bin
 copy "artifacts\bin\$($Platform)_$($Config)\xskbench.exe" $DstPath\bin
+copy "artifacts\bin\$($Platform)_$($Config)\xskcap.exe" $DstPath\bin
 copy "artifacts\bin\$($Platform)_$($Config)\xskfwd.exe" $DstPath\bin
 
 New-Item -Path $DstPath\symbols -ItemType Directory > $null
@@ -44,6 +45,7 @@ copy "artifacts\bin\$($Platform)_$($Config)\pktcmd.pdb" $DstPath\symbols
 copy "artifacts\bin\$($Platform)_$($Config)\rxfilter.pdb" $DstPath\symbols
 copy "artifacts\bin\$($Platform)_$($Config)\xdpcfg.pdb" $DstPath\symbols
 copy "artifacts\bin\$($Platform)_$($Config)\xskbench.pdb" $DstPath\symbols
+copy "artifacts\bin\$($Platform)_$($Config)\xskcap.pdb" $DstPath\symbols
 copy "artifacts\bin\$($Platform)_$($Config)\xskfwd.pdb" $DstPath\symbols
 
 New-Item -Path $DstPath\include -ItemType Directory > $null
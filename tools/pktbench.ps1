@@ -0,0 +1,39 @@
+param (
+    [Parameter(Mandatory = $false)]
+    [ValidateSet("Debug", "Release")]
+    [string]$Config = "Debug",
+
+    [Parameter(Mandatory = $false)]
+    [ValidateSet("x64", "arm64")]
+    [string]$Arch = "x64",
+
+    [Parameter(Mandatory = $false)]
+    [int]$DurationMs = 100,
+
+    [Parameter(Mandatory = $false)]
+    [string]$Options = ""
+)
+
+Set-StrictMode -Version 'Latest'
+$ErrorActionPreference = 'Stop'
+
+# Important paths.
+$RootDir = Split-Path $PSScriptRoot -Parent
+$ArtifactsDir = "$RootDir\artifacts\bin\$($Arch)_$($Config)"
+$LogsDir = "$RootDir\artifacts\logs"
+
+# Ensure the output path exists.
+New-Item -ItemType Directory -Force -Path $LogsDir | Out-Null
+
+$BenchArgs = @("-duration", $DurationMs)
+
+if (![string]::IsNullOrEmpty($Options)) {
+    $BenchArgs += $Options.Split(" ")
+}
+
+Write-Verbose "$ArtifactsDir\pktbench.exe $BenchArgs"
+& $ArtifactsDir\pktbench.exe $BenchArgs | Tee-Object -FilePath "$LogsDir\pktbench_$($Arch)_$($Config).csv"
+
+if ($LastExitCode -ne 0) {
+    Write-Error "pktbench.exe failed: $LastExitCode"
+}
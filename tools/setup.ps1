@@ -595,6 +595,13 @@ function Install-Ebpf {
     }
     # Stop eBPF's XDP hook since it conflicts with our XDP implementation.
     Stop-Service netebpfext
+    # Replace eBPF's XDP program information with XDP's, which describes every
+    # XDP helper, so the verifier can resolve them.
+    Write-Verbose "$ArtifactsDir\xdpcfg.exe UpdateEbpfStore"
+    & "$ArtifactsDir\xdpcfg.exe" UpdateEbpfStore | Write-Verbose
+    if (!$?) {
+        Write-Error "xdpcfg.exe UpdateEbpfStore failed"
+    }
     Refresh-Path
 }
 
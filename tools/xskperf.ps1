@@ -181,6 +181,13 @@ try {
             Set-NetAdapterAdvancedProperty -Name $AdapterName -RegistryKeyword RxBufferLength -RegistryValue $BufferSize -NoRestart
         }
 
+        if (@("RX", "FWD").Contains($Mode) -and -not $TxInspect) {
+            # Reserve as much of the default headroom as fits in the buffer.
+            $RxHeadroom = [Math]::Max(0, [Math]::Min(256, $BufferSize - $IoSize))
+            Write-Verbose "Setting XDPMP RX headroom to $RxHeadroom"
+            Set-NetAdapterAdvancedProperty -Name $AdapterName -RegistryKeyword RxHeadroom -RegistryValue $RxHeadroom -NoRestart
+        }
+
         if (@("RX", "FWD").Contains($Mode) -and -not $TxInspect) {
             Write-Verbose "Setting XDPMP RX data length to $IoSize"
             Set-NetAdapterAdvancedProperty -Name $AdapterName -RegistryKeyword RxDataLength -RegistryValue $IoSize -NoRestart